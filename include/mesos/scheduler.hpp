@@ -40,6 +40,7 @@ namespace mesos {
 class SchedulerDriver;
 
 namespace internal {
+class OfferPool;
 class SchedulerProcess;
 }
 
@@ -132,6 +133,23 @@ public:
   virtual void statusUpdate(SchedulerDriver* driver,
                             const TaskStatus& status) = 0;
 
+  /**
+   * Invoked with a batch of status updates when the driver has been
+   * configured to batch status updates (see the
+   * 'status_update_batch_interval' option of MesosSchedulerDriver).
+   * The status updates are in the order they were received and, as
+   * with Scheduler::statusUpdate, returning from this callback
+   * _acknowledges_ receipt of all of them. The default
+   * implementation invokes Scheduler::statusUpdate for each status.
+   */
+  virtual void statusUpdates(SchedulerDriver* driver,
+                             const std::vector<TaskStatus>& statuses)
+  {
+    for (size_t i = 0; i < statuses.size(); i++) {
+      statusUpdate(driver, statuses[i]);
+    }
+  }
+
   /**
    * Invoked when an executor sends a message. These messages are best
    * effort; do not expect a framework message to be retransmitted in
@@ -247,6 +265,56 @@ public:
                              const std::vector<TaskInfo>& tasks,
                              const Filters& filters = Filters()) = 0;
 
+  /**
+   * Launches the given set of tasks using multiple offers at once,
+   * which is equivalent to (but much cheaper than) invoking
+   * launchTasks for each offer. Each task is launched using the
+   * offer from the slave specified in the task (the first such offer
+   * if more than one offer is from the same slave), and a task whose
+   * slave is not in any of the offers is lost. Offers that are not
+   * used by any tasks are declined. The specified filters are
+   * applied on the unused resources of every offer. Failures are
+   * reported per task (via TASK_LOST status updates). The default
+   * implementation launches all of the tasks using the first offer
+   * and declines the others, so a task from a slave other than that
+   * of the first offer gets lost.
+   */
+  virtual Status launchTasks(const std::vector<OfferID>& offerIds,
+                             const std::vector<TaskInfo>& tasks,
+                             const Filters& filters = Filters())
+  {
+    for (size_t i = 1; i < offerIds.size(); i++) {
+      declineOffer(offerIds[i], filters);
+    }
+
+    // Without any offers the tasks still get reported as lost (since
+    // an offer with an empty ID is not valid).
+    OfferID offerId;
+    offerId.set_value("");
+    if (!offerIds.empty()) {
+      offerId = offerIds[0];
+    }
+
+    return launchTasks(offerId, tasks, filters);
+  }
+
+  /**
+   * Matches the given tasks against the offers the driver is holding
+   * (see MesosSchedulerDriver for how to enable the offer pool) and
+   * launches the tasks that fit in one batch, each using the offer
+   * it was placed into (even if several of those offers are from
+   * the same slave). Tasks are bin packed, the largest first, each
+   * into the held offer with the least available resources that
+   * still fits it. A task with a non-empty slave ID is only placed
+   * into an offer from that slave, otherwise its slave ID is set to
+   * that of the offer it was placed into. The tasks that don't fit
+   * into any held offer are appended to 'unmatched' (which is all of
+   * them if the offer pool isn't enabled).
+   */
+  virtual Status matchTasks(const std::vector<TaskInfo>& tasks,
+                            std::vector<TaskInfo>* unmatched,
+                            const Filters& filters = Filters()) = 0;
+
   /**
    * Kills the specified task. Note that attempting to kill a task is
    * currently not reliable. If, for example, a scheduler fails over
@@ -321,7 +389,18 @@ public:
    *
    * Any Mesos configuration options are read from environment
    * variables, as well as any configuration files found through the
-   * environment variables.
+   * environment variables. Setting 'status_update_batch_interval'
+   * (in seconds) to a positive value makes the driver deliver status
+   * updates via Scheduler::statusUpdates in batches collected over
+   * that interval, and acknowledge them with one message per slave.
+   *
+   * Setting 'offer_pool_capacity' to a positive value makes the
+   * driver hold on to (at most that many) outstanding offers so that
+   * tasks can be matched against them via matchTasks. Offers are
+   * still passed to Scheduler::resourceOffers but are removed from
+   * the pool once they're used (or declined) by the scheduler or
+   * rescinded. When the pool is full the oldest offers are declined
+   * to make room, which is reported via Scheduler::offerRescinded.
    */
   MesosSchedulerDriver(Scheduler* scheduler,
                        const FrameworkInfo& framework,
@@ -347,6 +426,12 @@ public:
   virtual Status launchTasks(const OfferID& offerId,
                              const std::vector<TaskInfo>& tasks,
                              const Filters& filters = Filters());
+  virtual Status launchTasks(const std::vector<OfferID>& offerIds,
+                             const std::vector<TaskInfo>& tasks,
+                             const Filters& filters = Filters());
+  virtual Status matchTasks(const std::vector<TaskInfo>& tasks,
+                            std::vector<TaskInfo>* unmatched,
+                            const Filters& filters = Filters());
   virtual Status killTask(const TaskID& taskId);
   virtual Status declineOffer(const OfferID& offerId,
                               const Filters& filters = Filters());
@@ -363,6 +448,9 @@ private:
   // Libprocess process for communicating with master.
   internal::SchedulerProcess* process;
 
+  // Offers held on behalf of the scheduler (shared with the process).
+  internal::OfferPool* pool;
+
   // Mutex to enforce all non-callbacks are execute serially.
   pthread_mutex_t mutex;
 
@@ -0,0 +1,90 @@
+#!/usr/bin/env python
+
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+# 
+#     http://www.apache.org/licenses/LICENSE-2.0
+# 
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+# Tests the list of lazily parsed protobufs that the native code
+# passes to callbacks like Scheduler.resourceOffers.
+
+import unittest
+
+import mesos
+import mesos_pb2
+
+
+class LazyProtobufListTest(unittest.TestCase):
+  def setUp(self):
+    self.statuses = []
+
+    # Serialize the statuses as one batch like the native code does.
+    data = ""
+    offsets = []
+    for i in range(3):
+      status = mesos_pb2.TaskStatus()
+      status.task_id.value = "task-%d" % i
+      status.state = mesos_pb2.TASK_RUNNING
+      self.statuses.append(status)
+      data += status.SerializeToString()
+      offsets.append(len(data))
+
+    self.list = mesos._LazyProtobufList(
+        mesos_pb2.TaskStatus, data, tuple(offsets))
+
+  def test_isinstance(self):
+    for status in self.list:
+      self.assertTrue(isinstance(status, mesos_pb2.TaskStatus))
+
+  def test_field_access(self):
+    self.assertEqual("task-1", self.list[1].task_id.value)
+    self.assertEqual(mesos_pb2.TASK_RUNNING, self.list[1].state)
+
+    # Changes stick since the same message is returned every time.
+    self.list[1].message = "changed"
+    self.assertEqual("changed", self.list[1].message)
+    self.assertTrue(self.list[1] is self.list[1])
+
+  def test_copy_from(self):
+    status = mesos_pb2.TaskStatus()
+    status.CopyFrom(self.list[0])
+    self.assertEqual(self.statuses[0], status)
+
+    status = mesos_pb2.TaskStatus()
+    status.MergeFrom(self.list[2])
+    self.assertEqual(self.statuses[2], status)
+
+    update = mesos_pb2.TaskStatus()
+    update.CopyFrom(self.statuses[1])
+    update.state = mesos_pb2.TASK_FINISHED
+    self.list[1].CopyFrom(update)
+    self.assertEqual(mesos_pb2.TASK_FINISHED, self.list[1].state)
+
+  def test_list(self):
+    self.assertEqual(3, len(self.list))
+    self.assertEqual(self.statuses, list(self.list))
+    self.assertEqual(self.statuses[1:], self.list[1:])
+    self.assertEqual(self.statuses[2], self.list[-1])
+    self.assertTrue(self.statuses[0] in self.list)
+    self.assertEqual(self.statuses, self.list)
+    self.assertRaises(IndexError, lambda: self.list[3])
+
+  def test_empty(self):
+    statuses = mesos._LazyProtobufList(mesos_pb2.TaskStatus, "", ())
+    self.assertEqual(0, len(statuses))
+    self.assertEqual([], list(statuses))
+
+
+if __name__ == "__main__":
+  unittest.main()
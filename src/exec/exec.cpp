@@ -21,6 +21,7 @@
 #include <iostream>
 #include <string>
 #include <sstream>
+#include <vector>
 
 #include <mesos/executor.hpp>
 
@@ -31,6 +32,7 @@
 #include <process/protobuf.hpp>
 
 #include <stout/fatal.hpp>
+#include <stout/foreach.hpp>
 #include <stout/uuid.hpp>
 
 #include "common/lock.hpp"
@@ -48,6 +50,7 @@ using namespace mesos::internal;
 using namespace process;
 
 using std::string;
+using std::vector;
 
 using process::wait; // Necessary on some OS's to disambiguate.
 
@@ -100,20 +103,25 @@ public:
       executorId(_executorId),
       local(_local),
       aborted(false),
+      checkpoint(false),
+      connected(true),
       directory(_directory)
   {
     install<ExecutorRegisteredMessage>(
-        &ExecutorProcess::registered,
-        &ExecutorRegisteredMessage::executor_info,
-        &ExecutorRegisteredMessage::framework_id,
-        &ExecutorRegisteredMessage::framework_info,
-        &ExecutorRegisteredMessage::slave_id,
-        &ExecutorRegisteredMessage::slave_info);
+        &ExecutorProcess::registered);
+
+    install<ReconnectExecutorMessage>(
+        &ExecutorProcess::reconnect,
+        &ReconnectExecutorMessage::slave_id);
 
     install<RunTaskMessage>(
         &ExecutorProcess::runTask,
         &RunTaskMessage::task);
 
+    install<RunTasksMessage>(
+        &ExecutorProcess::runTasks,
+        &RunTasksMessage::tasks);
+
     install<KillTaskMessage>(
         &ExecutorProcess::killTask,
         &KillTaskMessage::task_id);
@@ -145,22 +153,57 @@ protected:
     send(slave, message);
   }
 
-  void registered(const ExecutorInfo& executorInfo,
-                  const FrameworkID& frameworkId,
-                  const FrameworkInfo& frameworkInfo,
-                  const SlaveID& slaveId,
-                  const SlaveInfo& slaveInfo)
+  virtual void finalize()
+  {
+    // Don't lose the status updates that haven't been sent yet (e.g.,
+    // a final TASK_FINISHED right before the driver gets stopped).
+    flushStatusUpdates();
+  }
+
+  void registered(const ExecutorRegisteredMessage& message)
   {
     if (aborted) {
-      VLOG(1) << "Ignoring registered message from slave " << slaveId
+      VLOG(1) << "Ignoring registered message from slave "
+              << message.slave_id()
               << " because the driver is aborted!";
       return;
     }
 
-    VLOG(1) << "Executor registered on slave " << slaveId;
+    VLOG(1) << "Executor registered on slave " << message.slave_id();
 
-    this->slaveId = slaveId;
-    executor->registered(driver, executorInfo, frameworkInfo, slaveInfo);
+    slaveId = message.slave_id();
+    checkpoint = message.checkpoint();
+    executor->registered(driver,
+                         message.executor_info(),
+                         message.framework_info(),
+                         message.slave_info());
+  }
+
+  void reconnect(const SlaveID& slaveId)
+  {
+    if (aborted) {
+      VLOG(1) << "Ignoring reconnect message from slave " << slaveId
+              << " because the driver is aborted!";
+      return;
+    }
+
+    VLOG(1) << "Received reconnect request from slave " << slaveId
+            << " at " << from;
+
+    // The recovered slave is (most likely) a new process.
+    slave = from;
+    link(slave);
+
+    ReregisterExecutorMessage message;
+    message.mutable_framework_id()->MergeFrom(frameworkId);
+    message.mutable_executor_id()->MergeFrom(executorId);
+    send(slave, message);
+
+    connected = true;
+
+    // Send the status updates that were held back while the slave
+    // was gone.
+    flushStatusUpdates();
   }
 
   void runTask(const TaskInfo& task)
@@ -176,6 +219,13 @@ protected:
     executor->launchTask(driver, task);
   }
 
+  void runTasks(const vector<TaskInfo>& tasks)
+  {
+    foreach (const TaskInfo& task, tasks) {
+      runTask(task);
+    }
+  }
+
   void killTask(const TaskID& taskId)
   {
     if (aborted) {
@@ -239,6 +289,34 @@ protected:
       return;
     }
 
+    // A checkpointing slave reconnects to us once it has recovered,
+    // so give it some time to do so before shutting down.
+    if (checkpoint) {
+      VLOG(1) << "Slave exited, waiting for it to recover";
+      connected = false;
+      delay(slave::EXECUTOR_REREGISTER_TIMEOUT,
+            self(),
+            &Self::reregisterTimeout);
+      return;
+    }
+
+    slaveLost();
+  }
+
+  void reregisterTimeout()
+  {
+    if (aborted || connected) {
+      return;
+    }
+
+    VLOG(1) << "Slave did not reconnect within "
+            << slave::EXECUTOR_REREGISTER_TIMEOUT;
+
+    slaveLost();
+  }
+
+  void slaveLost()
+  {
     VLOG(1) << "Slave exited, trying to shutdown";
 
     if (!local) {
@@ -275,20 +353,55 @@ protected:
       return;
     }
 
-    StatusUpdateMessage message;
-    StatusUpdate* update = message.mutable_update();
-    update->mutable_framework_id()->MergeFrom(frameworkId);
-    update->mutable_executor_id()->MergeFrom(executorId);
-    update->mutable_slave_id()->MergeFrom(slaveId);
-    update->mutable_status()->MergeFrom(status);
-    update->set_timestamp(Clock::now());
-    update->set_uuid(UUID::random().toBytes());
+    StatusUpdate update;
+    update.mutable_framework_id()->MergeFrom(frameworkId);
+    update.mutable_executor_id()->MergeFrom(executorId);
+    update.mutable_slave_id()->MergeFrom(slaveId);
+    update.mutable_status()->MergeFrom(status);
+    update.set_timestamp(Clock::now());
+    update.set_uuid(UUID::random().toBytes());
+
+    // Send the update once we're done processing the messages that
+    // are already queued (e.g., other status updates from an executor
+    // that's finishing a lot of tasks) so that they share a message.
+    if (outgoing.empty()) {
+      dispatch(self(), &Self::flushStatusUpdates);
+    }
 
-    send(slave, message);
+    outgoing.push_back(update);
+  }
+
+  void flushStatusUpdates()
+  {
+    // Hold on to the updates until the slave reconnects (see
+    // 'reconnect').
+    if (!connected) {
+      return;
+    }
+
+    // NOTE: A single update is sent as a StatusUpdateMessage so that
+    // slaves that don't know about batches can still handle it.
+    if (outgoing.size() == 1) {
+      StatusUpdateMessage message;
+      message.mutable_update()->MergeFrom(outgoing.front());
+      send(slave, message);
+    } else if (outgoing.size() > 1) {
+      StatusUpdatesMessage message;
+      foreach (const StatusUpdate& update, outgoing) {
+        message.add_updates()->MergeFrom(update);
+      }
+      send(slave, message);
+    }
+
+    outgoing.clear();
   }
 
   void sendFrameworkMessage(const string& data)
   {
+    // Don't let the message overtake status updates that were sent
+    // before it.
+    flushStatusUpdates();
+
     ExecutorToFrameworkMessage message;
     message.mutable_slave_id()->MergeFrom(slaveId);
     message.mutable_framework_id()->MergeFrom(frameworkId);
@@ -308,7 +421,13 @@ private:
   SlaveID slaveId;
   bool local;
   bool aborted;
+  bool checkpoint; // Whether the slave checkpoints (see 'exited').
+  bool connected; // False while waiting for the slave to reconnect.
   const std::string directory;
+
+  // Status updates waiting to be sent to the slave (see
+  // 'flushStatusUpdates').
+  vector<StatusUpdate> outgoing;
 };
 
 } // namespace internal {
@@ -446,7 +565,10 @@ Status MesosExecutorDriver::stop()
 
   CHECK(process != NULL);
 
-  terminate(process);
+  // NOTE: We don't inject the termination so that the status updates
+  // (and framework messages) dispatched before stopping still get
+  // processed (and sent, see ExecutorProcess::finalize).
+  terminate(process, false);
 
   // TODO(benh): Set the condition variable in ExecutorProcess just as
   // we do with the MesosSchedulerDriver and SchedulerProcess:
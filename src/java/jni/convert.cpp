@@ -17,24 +17,41 @@
  */
 
 #include <jni.h>
+#include <pthread.h>
 
+#include <map>
 #include <string>
+#include <vector>
 #include <assert.h>
 
+#include <google/protobuf/message.h>
+
+#include <google/protobuf/io/coded_stream.h>
+
 #include <mesos/mesos.hpp>
 
+#include <stout/foreach.hpp>
 #include <stout/strings.hpp>
 
 #include "construct.hpp"
 #include "convert.hpp"
 
+#include "common/lock.hpp"
+
 #include "jvm/jvm.hpp"
 
 #include "logging/logging.hpp"
 
 using namespace mesos;
+using namespace mesos::internal;
+
+using google::protobuf::Message;
+
+using google::protobuf::io::CodedOutputStream;
 
+using std::map;
 using std::string;
+using std::vector;
 
 // Facilities for loading Mesos-related classes with the correct
 // ClassLoader. Unfortunately, JNI's FindClass uses the system
@@ -105,6 +122,184 @@ jclass FindMesosClass(JNIEnv* env, const char* className)
   return cls;
 }
 
+
+// Looking up classes and method IDs is expensive (especially via
+// FindMesosClass which goes through a ClassLoader) so we do it only
+// once per class/method and cache the results. We keep global
+// references to the classes so that the method IDs remain valid. The
+// caches are cleared in JNI_OnUnLoad (see below).
+pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+map<string, jclass> classes;
+map<string, jmethodID> methods;
+
+
+jclass findClass(JNIEnv* env, const string& name)
+{
+  Lock lock(&mutex);
+
+  if (classes.count(name) == 0) {
+    jclass clazz = name.find("org/apache/mesos/") == 0
+      ? FindMesosClass(env, name.c_str())
+      : env->FindClass(name.c_str());
+    if (clazz == NULL) {
+      return NULL; // Don't cache failures, an exception is pending.
+    }
+    classes[name] = (jclass) env->NewGlobalRef(clazz);
+    env->DeleteLocalRef(clazz);
+  }
+
+  return classes[name];
+}
+
+
+jmethodID getMethodID(
+    JNIEnv* env,
+    const string& className,
+    const string& name,
+    const string& signature,
+    bool isStatic = false)
+{
+  jclass clazz = findClass(env, className);
+  if (clazz == NULL) {
+    return NULL;
+  }
+
+  Lock lock(&mutex);
+
+  const string& key = className + "." + name + signature;
+
+  if (methods.count(key) == 0) {
+    jmethodID method = isStatic
+      ? env->GetStaticMethodID(clazz, name.c_str(), signature.c_str())
+      : env->GetMethodID(clazz, name.c_str(), signature.c_str());
+    if (method == NULL) {
+      return NULL; // Don't cache failures, an exception is pending.
+    }
+    methods[key] = method;
+  }
+
+  return methods[key];
+}
+
+
+// Returns the JNI name of the Java class generated for the specified
+// (Mesos) protobuf message, e.g., "org/apache/mesos/Protos$Offer".
+string className(const Message& message)
+{
+  return "org/apache/mesos/Protos$" + message.GetDescriptor()->name();
+}
+
+
+// Converts a protobuf message by serializing it directly into a Java
+// byte array (i.e., without an intermediate std::string) and then
+// invoking the static 'parseFrom' of the corresponding Java class.
+jobject parse(JNIEnv* env, const Message& message)
+{
+  const string& name = className(message);
+
+  jclass clazz = findClass(env, name);
+
+  jmethodID parseFrom = getMethodID(
+      env, name, "parseFrom", "([B)L" + name + ";", true);
+
+  // byte[] data = ..;
+  const int size = message.ByteSize();
+  jbyteArray jdata = env->NewByteArray(size);
+  void* data = env->GetPrimitiveArrayCritical(jdata, NULL);
+  message.SerializeWithCachedSizesToArray((uint8_t*) data);
+  env->ReleasePrimitiveArrayCritical(jdata, data, 0);
+
+  jobject jmessage = env->CallStaticObjectMethod(clazz, parseFrom, jdata);
+
+  env->DeleteLocalRef(jdata);
+
+  return jmessage;
+}
+
+
+// Converts a batch of protobuf messages (all of the same type) into a
+// java.util.List. All of the messages get serialized (length
+// delimited) into a single Java byte array which then gets parsed in
+// place via the static 'parseDelimitedFrom' of the corresponding Java
+// class, rather than allocating, copying, and parsing an array for
+// each message.
+template <typename T>
+jobject parse(JNIEnv* env, const vector<T>& messages)
+{
+  // List list = new ArrayList(size);
+  jclass clazz = findClass(env, "java/util/ArrayList");
+
+  jmethodID _init_ = getMethodID(env, "java/util/ArrayList", "<init>", "(I)V");
+  jobject jlist = env->NewObject(clazz, _init_, (jint) messages.size());
+
+  if (messages.empty()) {
+    return jlist;
+  }
+
+  jmethodID add = getMethodID(
+      env, "java/util/ArrayList", "add", "(Ljava/lang/Object;)Z");
+
+  // Compute (and cache) the sizes of the messages.
+  int size = 0;
+  foreach (const T& message, messages) {
+    const int length = message.ByteSize();
+    size += CodedOutputStream::VarintSize32(length) + length;
+  }
+
+  // byte[] data = ..;
+  jbyteArray jdata = env->NewByteArray(size);
+  uint8_t* data = (uint8_t*) env->GetPrimitiveArrayCritical(jdata, NULL);
+  uint8_t* target = data;
+  foreach (const T& message, messages) {
+    target = CodedOutputStream::WriteVarint32ToArray(
+        message.GetCachedSize(), target);
+    target = message.SerializeWithCachedSizesToArray(target);
+  }
+  CHECK_EQ(size, (int) (target - data));
+  env->ReleasePrimitiveArrayCritical(jdata, data, 0);
+
+  // InputStream stream = new ByteArrayInputStream(data);
+  clazz = findClass(env, "java/io/ByteArrayInputStream");
+
+  _init_ = getMethodID(env, "java/io/ByteArrayInputStream", "<init>", "([B)V");
+  jobject jstream = env->NewObject(clazz, _init_, jdata);
+
+  // list.add(T.parseDelimitedFrom(stream));
+  const string& name = className(messages.front());
+
+  clazz = findClass(env, name);
+
+  jmethodID parseDelimitedFrom = getMethodID(
+      env,
+      name,
+      "parseDelimitedFrom",
+      "(Ljava/io/InputStream;)L" + name + ";",
+      true);
+
+  for (size_t i = 0; i < messages.size(); i++) {
+    jobject jmessage =
+      env->CallStaticObjectMethod(clazz, parseDelimitedFrom, jstream);
+
+    // Leave the exception (e.g., an InvalidProtocolBufferException)
+    // pending for the caller rather than invoking any more methods
+    // with it pending.
+    if (env->ExceptionCheck()) {
+      env->DeleteLocalRef(jstream);
+      env->DeleteLocalRef(jdata);
+      env->DeleteLocalRef(jlist);
+      return NULL;
+    }
+
+    env->CallBooleanMethod(jlist, add, jmessage);
+    env->DeleteLocalRef(jmessage);
+  }
+
+  env->DeleteLocalRef(jstream);
+  env->DeleteLocalRef(jdata);
+
+  return jlist;
+}
+
 } // namespace {
 
 
@@ -190,6 +385,15 @@ JNIEXPORT void JNICALL JNI_OnUnLoad(JavaVM* jvm, void* reserved)
     env->DeleteWeakGlobalRef(mesosClassLoader);
     mesosClassLoader = NULL;
   }
+
+  Lock lock(&mutex);
+
+  foreachvalue (jclass clazz, classes) {
+    env->DeleteGlobalRef(clazz);
+  }
+
+  classes.clear();
+  methods.clear();
 }
 
 
@@ -203,184 +407,64 @@ jobject convert(JNIEnv* env, const string& s)
 template <>
 jobject convert(JNIEnv* env, const FrameworkID& frameworkId)
 {
-  string data;
-  frameworkId.SerializeToString(&data);
-
-  // byte[] data = ..;
-  jbyteArray jdata = env->NewByteArray(data.size());
-  env->SetByteArrayRegion(jdata, 0, data.size(), (jbyte*) data.data());
-
   // FrameworkID frameworkId = FrameworkID.parseFrom(data);
-  jclass clazz = FindMesosClass(env, "org/apache/mesos/Protos$FrameworkID");
-
-  jmethodID parseFrom =
-    env->GetStaticMethodID(clazz, "parseFrom",
-                           "([B)Lorg/apache/mesos/Protos$FrameworkID;");
-
-  jobject jframeworkId = env->CallStaticObjectMethod(clazz, parseFrom, jdata);
-
-  return jframeworkId;
+  return parse(env, frameworkId);
 }
 
 
 template <>
 jobject convert(JNIEnv* env, const FrameworkInfo& frameworkInfo)
 {
-  string data;
-  frameworkInfo.SerializeToString(&data);
-
-  // byte[] data = ..;
-  jbyteArray jdata = env->NewByteArray(data.size());
-  env->SetByteArrayRegion(jdata, 0, data.size(), (jbyte*) data.data());
-
   // FrameworkInfo frameworkInfo = FrameworkInfo.parseFrom(data);
-  jclass clazz = FindMesosClass(env, "org/apache/mesos/Protos$FrameworkInfo");
-
-  jmethodID parseFrom =
-    env->GetStaticMethodID(clazz, "parseFrom",
-                           "([B)Lorg/apache/mesos/Protos$FrameworkInfo;");
-
-  jobject jframeworkInfo = env->CallStaticObjectMethod(clazz, parseFrom, jdata);
-
-  return jframeworkInfo;
+  return parse(env, frameworkInfo);
 }
 
 
 template <>
 jobject convert(JNIEnv* env, const MasterInfo& masterInfo)
 {
-  string data;
-  masterInfo.SerializeToString(&data);
-
-  // byte[] data = ..;
-  jbyteArray jdata = env->NewByteArray(data.size());
-  env->SetByteArrayRegion(jdata, 0, data.size(), (jbyte*) data.data());
-
   // MasterInfo masterInfo = MasterInfo.parseFrom(data);
-  jclass clazz = FindMesosClass(env, "org/apache/mesos/Protos$MasterInfo");
-
-  jmethodID parseFrom =
-    env->GetStaticMethodID(clazz, "parseFrom",
-                           "([B)Lorg/apache/mesos/Protos$MasterInfo;");
-
-  jobject jmasterInfo = env->CallStaticObjectMethod(clazz, parseFrom, jdata);
-
-  return jmasterInfo;
+  return parse(env, masterInfo);
 }
 
 
 template <>
 jobject convert(JNIEnv* env, const ExecutorID& executorId)
 {
-  string data;
-  executorId.SerializeToString(&data);
-
-  // byte[] data = ..;
-  jbyteArray jdata = env->NewByteArray(data.size());
-  env->SetByteArrayRegion(jdata, 0, data.size(), (jbyte*) data.data());
-
   // ExecutorID executorId = ExecutorID.parseFrom(data);
-  jclass clazz = FindMesosClass(env, "org/apache/mesos/Protos$ExecutorID");
-
-  jmethodID parseFrom =
-    env->GetStaticMethodID(clazz, "parseFrom",
-                           "([B)Lorg/apache/mesos/Protos$ExecutorID;");
-
-  jobject jexecutorId = env->CallStaticObjectMethod(clazz, parseFrom, jdata);
-
-  return jexecutorId;
+  return parse(env, executorId);
 }
 
 
 template <>
 jobject convert(JNIEnv* env, const TaskID& taskId)
 {
-  string data;
-  taskId.SerializeToString(&data);
-
-  // byte[] data = ..;
-  jbyteArray jdata = env->NewByteArray(data.size());
-  env->SetByteArrayRegion(jdata, 0, data.size(), (jbyte*) data.data());
-
   // TaskID taskId = TaskID.parseFrom(data);
-  jclass clazz = FindMesosClass(env, "org/apache/mesos/Protos$TaskID");
-
-  jmethodID parseFrom =
-    env->GetStaticMethodID(clazz, "parseFrom",
-                           "([B)Lorg/apache/mesos/Protos$TaskID;");
-
-  jobject jtaskId = env->CallStaticObjectMethod(clazz, parseFrom, jdata);
-
-  return jtaskId;
+  return parse(env, taskId);
 }
 
 
 template <>
 jobject convert(JNIEnv* env, const SlaveID& slaveId)
 {
-  string data;
-  slaveId.SerializeToString(&data);
-
-  // byte[] data = ..;
-  jbyteArray jdata = env->NewByteArray(data.size());
-  env->SetByteArrayRegion(jdata, 0, data.size(), (jbyte*) data.data());
-
   // SlaveID slaveId = SlaveID.parseFrom(data);
-  jclass clazz = FindMesosClass(env, "org/apache/mesos/Protos$SlaveID");
-
-  jmethodID parseFrom =
-    env->GetStaticMethodID(clazz, "parseFrom",
-                           "([B)Lorg/apache/mesos/Protos$SlaveID;");
-
-  jobject jslaveId = env->CallStaticObjectMethod(clazz, parseFrom, jdata);
-
-  return jslaveId;
+  return parse(env, slaveId);
 }
 
 
 template <>
 jobject convert(JNIEnv* env, const SlaveInfo& slaveInfo)
 {
-  string data;
-  slaveInfo.SerializeToString(&data);
-
-  // byte[] data = ..;
-  jbyteArray jdata = env->NewByteArray(data.size());
-  env->SetByteArrayRegion(jdata, 0, data.size(), (jbyte*) data.data());
-
   // SlaveInfo slaveInfo = SlaveInfo.parseFrom(data);
-  jclass clazz = FindMesosClass(env, "org/apache/mesos/Protos$SlaveInfo");
-
-  jmethodID parseFrom =
-    env->GetStaticMethodID(clazz, "parseFrom",
-                           "([B)Lorg/apache/mesos/Protos$SlaveInfo;");
-
-  jobject jslaveInfo = env->CallStaticObjectMethod(clazz, parseFrom, jdata);
-
-  return jslaveInfo;
+  return parse(env, slaveInfo);
 }
 
 
 template <>
 jobject convert(JNIEnv* env, const OfferID& offerId)
 {
-  string data;
-  offerId.SerializeToString(&data);
-
-  // byte[] data = ..;
-  jbyteArray jdata = env->NewByteArray(data.size());
-  env->SetByteArrayRegion(jdata, 0, data.size(), (jbyte*) data.data());
-
   // OfferID offerId = OfferID.parseFrom(data);
-  jclass clazz = FindMesosClass(env, "org/apache/mesos/Protos$OfferID");
-
-  jmethodID parseFrom =
-    env->GetStaticMethodID(clazz, "parseFrom",
-                           "([B)Lorg/apache/mesos/Protos$OfferID;");
-
-  jobject jofferId = env->CallStaticObjectMethod(clazz, parseFrom, jdata);
-
-  return jofferId;
+  return parse(env, offerId);
 }
 
 
@@ -390,11 +474,11 @@ jobject convert(JNIEnv* env, const TaskState& state)
   jint jvalue = state;
 
   // TaskState state = TaskState.valueOf(value);
-  jclass clazz = FindMesosClass(env, "org/apache/mesos/Protos$TaskState");
+  jclass clazz = findClass(env, "org/apache/mesos/Protos$TaskState");
 
   jmethodID valueOf =
-    env->GetStaticMethodID(clazz, "valueOf",
-                           "(I)Lorg/apache/mesos/Protos$TaskState;");
+    getMethodID(env, "org/apache/mesos/Protos$TaskState", "valueOf",
+                "(I)Lorg/apache/mesos/Protos$TaskState;", true);
 
   jobject jstate = env->CallStaticObjectMethod(clazz, valueOf, jvalue);
 
@@ -405,92 +489,32 @@ jobject convert(JNIEnv* env, const TaskState& state)
 template <>
 jobject convert(JNIEnv* env, const TaskInfo& task)
 {
-  string data;
-  task.SerializeToString(&data);
-
-  // byte[] data = ..;
-  jbyteArray jdata = env->NewByteArray(data.size());
-  env->SetByteArrayRegion(jdata, 0, data.size(), (jbyte*) data.data());
-
   // TaskInfo task = TaskInfo.parseFrom(data);
-  jclass clazz = FindMesosClass(env, "org/apache/mesos/Protos$TaskInfo");
-
-  jmethodID parseFrom =
-    env->GetStaticMethodID(clazz, "parseFrom",
-                           "([B)Lorg/apache/mesos/Protos$TaskInfo;");
-
-  jobject jtask = env->CallStaticObjectMethod(clazz, parseFrom, jdata);
-
-  return jtask;
+  return parse(env, task);
 }
 
 
 template <>
 jobject convert(JNIEnv* env, const TaskStatus& status)
 {
-  string data;
-  status.SerializeToString(&data);
-
-  // byte[] data = ..;
-  jbyteArray jdata = env->NewByteArray(data.size());
-  env->SetByteArrayRegion(jdata, 0, data.size(), (jbyte*) data.data());
-
   // TaskStatus status = TaskStatus.parseFrom(data);
-  jclass clazz = FindMesosClass(env, "org/apache/mesos/Protos$TaskStatus");
-
-  jmethodID parseFrom =
-    env->GetStaticMethodID(clazz, "parseFrom",
-                           "([B)Lorg/apache/mesos/Protos$TaskStatus;");
-
-  jobject jstatus = env->CallStaticObjectMethod(clazz, parseFrom, jdata);
-
-  return jstatus;
+  return parse(env, status);
 }
 
 
 template <>
 jobject convert(JNIEnv* env, const Offer& offer)
 {
-  string data;
-  offer.SerializeToString(&data);
-
-  // byte[] data = ..;
-  jbyteArray jdata = env->NewByteArray(data.size());
-  env->SetByteArrayRegion(jdata, 0, data.size(), (jbyte*) data.data());
-
   // Offer offer = Offer.parseFrom(data);
-  jclass clazz = FindMesosClass(env, "org/apache/mesos/Protos$Offer");
-
-  jmethodID parseFrom =
-    env->GetStaticMethodID(clazz, "parseFrom",
-                           "([B)Lorg/apache/mesos/Protos$Offer;");
-
-  jobject joffer = env->CallStaticObjectMethod(clazz, parseFrom, jdata);
-
-  return joffer;
+  return parse(env, offer);
 }
 
 
 template <>
 jobject convert(JNIEnv* env, const ExecutorInfo& executor)
 {
-  string data;
-  executor.SerializeToString(&data);
-
-  // byte[] data = ..;
-  jbyteArray jdata = env->NewByteArray(data.size());
-  env->SetByteArrayRegion(jdata, 0, data.size(), (jbyte*) data.data());
-
   // ExecutorInfo executor = ExecutorInfo.parseFrom(data);
-  jclass clazz = FindMesosClass(env, "org/apache/mesos/Protos$ExecutorInfo");
-
-  jmethodID parseFrom =
-    env->GetStaticMethodID(clazz, "parseFrom",
-                           "([B)Lorg/apache/mesos/Protos$ExecutorInfo;");
-
-  jobject jexecutor = env->CallStaticObjectMethod(clazz, parseFrom, jdata);
-
-  return jexecutor;
+  return parse(env, executor);
 }
 
 
@@ -499,13 +523,29 @@ jobject convert(JNIEnv* env, const Status& status)
 {
   jint jvalue = status;
 
-  jclass clazz = FindMesosClass(env, "org/apache/mesos/Protos$Status");
+  jclass clazz = findClass(env, "org/apache/mesos/Protos$Status");
 
   jmethodID valueOf =
-    env->GetStaticMethodID(clazz, "valueOf",
-                           "(I)Lorg/apache/mesos/Protos$Status;");
+    getMethodID(env, "org/apache/mesos/Protos$Status", "valueOf",
+                "(I)Lorg/apache/mesos/Protos$Status;", true);
 
   jobject jstate = env->CallStaticObjectMethod(clazz, valueOf, jvalue);
 
   return jstate;
 }
+
+
+template <>
+jobject convert(JNIEnv* env, const vector<TaskStatus>& statuses)
+{
+  // List<TaskStatus> statuses = ..;
+  return parse(env, statuses);
+}
+
+
+template <>
+jobject convert(JNIEnv* env, const vector<Offer>& offers)
+{
+  // List<Offer> offers = ..;
+  return parse(env, offers);
+}
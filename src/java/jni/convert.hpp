@@ -21,8 +21,17 @@
 
 #include <jni.h>
 
+#include <vector>
+
 
 template <typename T>
 jobject convert(JNIEnv* env, const T& t);
 
+// Converts a batch of protobufs into a java.util.List at once, which
+// is considerably cheaper than converting each one individually.
+// Returns NULL (leaving the Java exception pending) if any of the
+// protobufs fails to get parsed on the Java side.
+template <typename T>
+jobject convert(JNIEnv* env, const std::vector<T>& ts);
+
 #endif // __CONVERT_HPP__
@@ -57,6 +57,8 @@ public:
                               const vector<Offer>& offers);
   virtual void offerRescinded(SchedulerDriver* driver, const OfferID& offerId);
   virtual void statusUpdate(SchedulerDriver* driver, const TaskStatus& status);
+  virtual void statusUpdates(SchedulerDriver* driver,
+                             const vector<TaskStatus>& statuses);
   virtual void frameworkMessage(SchedulerDriver* driver,
                                 const ExecutorID& executorId,
                                 const SlaveID& slaveId,
@@ -200,18 +202,15 @@ void JNIScheduler::resourceOffers(SchedulerDriver* driver,
 		     "(Lorg/apache/mesos/SchedulerDriver;"
 		     "Ljava/util/List;)V");
 
-  // List offers = new ArrayList();
-  clazz = env->FindClass("java/util/ArrayList");
+  // List offers = ..;
+  jobject joffers = convert<Offer>(env, offers);
 
-  jmethodID _init_ = env->GetMethodID(clazz, "<init>", "()V");
-  jobject joffers = env->NewObject(clazz, _init_);
-
-  jmethodID add = env->GetMethodID(clazz, "add", "(Ljava/lang/Object;)Z");
-
-  // Loop through C++ vector and add each offer to the Java list.
-  foreach (const Offer& offer, offers) {
-    jobject joffer = convert<Offer>(env, offer);
-    env->CallBooleanMethod(joffers, add, joffer);
+  if (joffers == NULL) {
+    env->ExceptionDescribe();
+    env->ExceptionClear();
+    jvm->DetachCurrentThread();
+    driver->abort();
+    return;
   }
 
   env->ExceptionClear();
@@ -302,6 +301,61 @@ void JNIScheduler::statusUpdate(SchedulerDriver* driver,
 }
 
 
+void JNIScheduler::statusUpdates(SchedulerDriver* driver,
+                                 const vector<TaskStatus>& statuses)
+{
+  jvm->AttachCurrentThread(JNIENV_CAST(&env), NULL);
+
+  jclass clazz = env->GetObjectClass(jdriver);
+
+  jfieldID scheduler = env->GetFieldID(clazz, "scheduler", "Lorg/apache/mesos/Scheduler;");
+  jobject jscheduler = env->GetObjectField(jdriver, scheduler);
+
+  clazz = env->GetObjectClass(jscheduler);
+
+  jmethodID statusUpdate =
+    env->GetMethodID(clazz, "statusUpdate",
+		     "(Lorg/apache/mesos/SchedulerDriver;"
+		     "Lorg/apache/mesos/Protos$TaskStatus;)V");
+
+  // Convert all of the statuses at once.
+  jobject jstatuses = convert<TaskStatus>(env, statuses);
+
+  if (jstatuses == NULL) {
+    env->ExceptionDescribe();
+    env->ExceptionClear();
+    jvm->DetachCurrentThread();
+    driver->abort();
+    return;
+  }
+
+  clazz = env->GetObjectClass(jstatuses);
+
+  jmethodID get = env->GetMethodID(clazz, "get", "(I)Ljava/lang/Object;");
+
+  for (size_t i = 0; i < statuses.size(); i++) {
+    jobject jstatus = env->CallObjectMethod(jstatuses, get, (jint) i);
+
+    env->ExceptionClear();
+
+    // scheduler.statusUpdate(driver, status);
+    env->CallVoidMethod(jscheduler, statusUpdate, jdriver, jstatus);
+
+    if (env->ExceptionCheck()) {
+      env->ExceptionDescribe();
+      env->ExceptionClear();
+      jvm->DetachCurrentThread();
+      driver->abort();
+      return;
+    }
+
+    env->DeleteLocalRef(jstatus);
+  }
+
+  jvm->DetachCurrentThread();
+}
+
+
 void JNIScheduler::frameworkMessage(SchedulerDriver* driver,
                                     const ExecutorID& executorId,
                                     const SlaveID& slaveId,
@@ -26,6 +26,7 @@
 
 #include <glog/logging.h>
 
+#include <algorithm>
 #include <fstream>
 #include <list>
 #include <map>
@@ -1111,6 +1112,50 @@ Future<uint64_t> listen(
 
 namespace internal {
 
+// Returns the delay before the given state check attempt. Most cgroups
+// become frozen, thawed or empty within a few milliseconds, so rather
+// than always waiting for 'interval' we start with a short delay and
+// back off exponentially until we reach 'interval'. Note that the
+// kernel does not provide event notifications for 'freezer.state' or
+// 'tasks' (cgroup.event_control only supports memory thresholds), so
+// we still have to poll these control files.
+// @param   interval    The maximum time interval between two checks.
+// @param   attempt     The number of checks done so far.
+// @return  The time to wait before the next check.
+static Duration backoff(const Duration& interval, unsigned int attempt)
+{
+  Duration duration = Nanoseconds(
+      MIN_CHECK_INTERVAL.ns() * (1ULL << std::min(attempt, 20U)));
+  return std::min(duration, interval);
+}
+
+
+// Returns the time spent backing off before the given attempt.
+static Duration waited(const Duration& interval, unsigned int attempt)
+{
+  double ns = 0.0;
+  for (unsigned int i = 0; i < attempt; i++) {
+    ns += backoff(interval, i).ns();
+  }
+  return Nanoseconds(ns);
+}
+
+
+// Returns true if the given attempt is beyond the retry budget. The
+// budget is the time that 'retries' checks spaced 'interval' apart
+// would take, so that backing off doesn't change the total timeout.
+static bool exhausted(
+    const Duration& interval,
+    unsigned int attempt,
+    unsigned int retries)
+{
+  if (interval == Seconds(0)) {
+    return attempt > retries;
+  }
+
+  return waited(interval, attempt).ns() > interval.ns() * retries;
+}
+
 
 // The process that freezes or thaws the cgroup.
 class Freezer : public Process<Freezer>
@@ -1238,9 +1283,9 @@ private:
         }
       }
 
-      if (attempt > retries) {
+      if (exhausted(interval, attempt, retries)) {
         LOG(WARNING) << "Unable to freeze " << path::join(hierarchy, cgroup)
-                     << " within " << retries + 1 << " attempts";
+                     << " within " << waited(interval, attempt);
         promise.set(false);
         terminate(self());
         return;
@@ -1258,13 +1303,16 @@ private:
       }
 
       // Not done yet, keep watching (and possibly retrying).
-      delay(interval, self(), &Freezer::watchFrozen, attempt + 1);
+      delay(backoff(interval, attempt),
+            self(),
+            &Freezer::watchFrozen,
+            attempt + 1);
     } else {
       LOG(FATAL) << "Unexpected state: " << strings::trim(state.get());
     }
   }
 
-  void watchThawed()
+  void watchThawed(unsigned int attempt = 0)
   {
     Try<string> state = internal::read(hierarchy, cgroup, "freezer.state");
 
@@ -1280,7 +1328,10 @@ private:
       terminate(self());
     } else if (strings::trim(state.get()) == "FROZEN") {
       // Not done yet, keep watching.
-      delay(interval, self(), &Freezer::watchThawed);
+      delay(backoff(interval, attempt),
+            self(),
+            &Freezer::watchThawed,
+            attempt + 1);
     } else {
       LOG(FATAL) << "Unexpected state: " << strings::trim(state.get());
     }
@@ -1413,14 +1464,17 @@ private:
       terminate(self());
       return;
     } else {
-      if (attempt > retries) {
+      if (exhausted(interval, attempt, retries)) {
         promise.set(false);
         terminate(self());
         return;
       }
 
       // Re-check needed.
-      delay(interval, self(), &EmptyWatcher::check, attempt + 1);
+      delay(backoff(interval, attempt),
+            self(),
+            &EmptyWatcher::check,
+            attempt + 1);
     }
   }
 
@@ -1470,6 +1524,20 @@ protected:
 
 private:
   void killTasks() {
+    // Avoid the freeze/kill/thaw round trips if the cgroup is already
+    // empty (e.g., the executor exited on its own), which is the
+    // common case when a slave is reclaiming resources.
+    Try<set<pid_t> > pids = tasks(hierarchy, cgroup);
+    if (pids.isError()) {
+      promise.fail("Failed to get tasks of cgroup: " + pids.error());
+      terminate(self());
+      return;
+    } else if (pids.get().empty()) {
+      promise.set(true);
+      terminate(self());
+      return;
+    }
+
     lambda::function<Future<bool>(const bool&)>
       funcFreeze = defer(self(), &Self::freeze);
     lambda::function<Future<Nothing>(const bool&)>
@@ -37,6 +37,11 @@ namespace cgroups {
 const unsigned int FREEZE_RETRIES = 50;
 const unsigned int EMPTY_WATCHER_RETRIES = 50;
 
+// Initial time interval between two state checks when freezing,
+// thawing or waiting for a cgroup to become empty. The interval backs
+// off exponentially up to the interval given by the caller.
+const Duration MIN_CHECK_INTERVAL = Milliseconds(1);
+
 
 // We use the following notations throughout the cgroups code. The notations
 // here are derived from the kernel documentation. More details can be found in
@@ -284,10 +289,12 @@ process::Future<uint64_t> listen(
 // the given cgroup is not valid, or the given cgroup has already been frozen.
 // @param   hierarchy   Path to the hierarchy root.
 // @param   cgroup      Path to the cgroup relative to the hierarchy root.
-// @param   interval    The time interval between two state check
+// @param   interval    The maximum time interval between two state check
 //                      requests (default: 0.1 seconds).
-// @param   retries     Number of retry attempts before giving up. None
-//                      indicates infinite retries. (default: 50 attempts).
+// @param   retries     Number of retry attempts before giving up, which
+//                      bounds the total wait to 'retries' times 'interval'
+//                      (regardless of the shorter initial checks).
+//                      (default: 50 attempts).
 // @return  A future which will become true when all processes are frozen, or
 //          false when all retries have occurred unsuccessfully.
 //          Error if some unexpected happens.
@@ -304,7 +311,7 @@ process::Future<bool> freeze(
 // allow users to cancel the operation.
 // @param   hierarchy   Path to the hierarchy root.
 // @param   cgroup      Path to the cgroup relative to the hierarchy root.
-// @param   interval    The time interval between two state check
+// @param   interval    The maximum time interval between two state check
 //                      requests (default: 0.1 seconds).
 // @return  A future which will become ready when all processes are thawed.
 //          Error if some unexpected happens.
@@ -323,7 +330,7 @@ process::Future<bool> thaw(
 // process. The future will become ready when the destroy operation finishes.
 // @param   hierarchy   Path to the hierarchy root.
 // @param   cgroup      Path to the cgroup relative to the hierarchy root.
-// @param   interval    The time interval between two state check
+// @param   interval    The maximum time interval between two state check
 //                      requests (default: 0.1 seconds).
 // @return  A future which will become ready when the operation is done.
 //          Error if some unexpected happens.
@@ -17,12 +17,14 @@
  */
 
 #include <algorithm>
+#include <map>
 
 #include <process/dispatch.hpp>
 #include <process/future.hpp>
 
 #include <stout/duration.hpp>
 #include <stout/foreach.hpp>
+#include <stout/stringify.hpp>
 
 #include "log/coordinator.hpp"
 #include "log/replica.hpp"
@@ -30,15 +32,66 @@
 using namespace process;
 
 using std::list;
+using std::map;
 using std::pair;
 using std::set;
 using std::string;
+using std::vector;
 
 
 namespace mesos {
 namespace internal {
 namespace log {
 
+// Returns a write request for the specified action.
+static WriteRequest request(uint64_t id, const Action& action, bool learned)
+{
+  WriteRequest request;
+  request.set_id(id);
+  request.set_position(action.position());
+  if (learned) {
+    request.set_learned(true);
+  }
+  request.set_type(action.type());
+  switch (action.type()) {
+    case Action::NOP:
+      CHECK(action.has_nop());
+      request.mutable_nop();
+      break;
+    case Action::APPEND:
+      CHECK(action.has_append());
+      request.mutable_append()->MergeFrom(action.append());
+      break;
+    case Action::TRUNCATE:
+      CHECK(action.has_truncate());
+      request.mutable_truncate()->MergeFrom(action.truncate());
+      break;
+    default:
+      LOG(FATAL) << "Unknown Action::Type!";
+  }
+  return request;
+}
+
+
+// Returns a batch write request for the specified actions.
+static BatchWriteRequest request(
+    uint64_t id,
+    const vector<Action>& actions,
+    bool learned)
+{
+  BatchWriteRequest request;
+  foreach (const Action& action, actions) {
+    request.add_requests()->MergeFrom(log::request(id, action, learned));
+  }
+  return request;
+}
+
+
+// Maximum number of positions requested from the other replicas at a
+// time while catching up the local replica (see Coordinator::catchup).
+static const uint64_t CATCHUP_BATCH_SIZE = 1024;
+
+
 Coordinator::Coordinator(int _quorum,
                          Replica* _replica,
                          Network* _network)
@@ -131,6 +184,40 @@ Result<uint64_t> Coordinator::elect(const Timeout& timeout)
 
     CHECK(positions.isReady()) << "Not expecting a discarded future!";
 
+    // First try and learn the missing positions in bulk from the
+    // other replicas, then only fill the positions that remain
+    // missing (e.g., because they haven't been learned yet).
+    if (!positions.get().empty()) {
+      Result<uint64_t> learned = catchup(positions.get(), timeout);
+
+      if (learned.isError()) {
+        elected = false;
+        return Result<uint64_t>::error(learned.error());
+      } else if (learned.isNone()) {
+        elected = false;
+        return Result<uint64_t>::none();
+      }
+
+      CHECK_SOME(learned);
+
+      if (learned.get() > 0) {
+        positions = replica->missing(index);
+
+        if (!positions.await(timeout.remaining())) {
+          elected = false;
+          return Result<uint64_t>::none();
+        } else if (positions.isFailed()) {
+          elected = false;
+          return Result<uint64_t>::error(positions.failure());
+        }
+
+        CHECK(positions.isReady()) << "Not expecting a discarded future!";
+      }
+    }
+
+    LOG(INFO) << "Coordinator attempting to fill " << positions.get().size()
+              << " missing position(s)";
+
     foreach (uint64_t position, positions.get()) {
       Result<Action> result = fill(position, timeout);
       if (result.isError()) {
@@ -189,6 +276,51 @@ Result<uint64_t> Coordinator::append(
 }
 
 
+Result<uint64_t> Coordinator::append(
+    const vector<string>& entries,
+    size_t window,
+    size_t batch,
+    const Timeout& timeout)
+{
+  if (!elected) {
+    return Result<uint64_t>::error("Coordinator not elected");
+  } else if (entries.empty()) {
+    return Result<uint64_t>::error("No entries to append");
+  }
+
+  CHECK(window > 0);
+  CHECK(batch > 0);
+
+  vector<vector<Action> > batches;
+
+  for (size_t i = 0; i < entries.size(); i++) {
+    if (i % batch == 0) {
+      batches.push_back(vector<Action>());
+    }
+
+    Action action;
+    action.set_position(index + i);
+    action.set_promised(id);
+    action.set_performed(id);
+    action.set_type(Action::APPEND);
+    Action::Append* append = action.mutable_append();
+    append->set_bytes(entries[i]);
+
+    batches.back().push_back(action);
+  }
+
+  Result<uint64_t> result = write(batches, window, timeout);
+
+  if (result.isSome()) {
+    CHECK(result.get() >= index);
+    CHECK(result.get() < index + entries.size());
+    index = result.get() + 1;
+  }
+
+  return result;
+}
+
+
 Result<uint64_t> Coordinator::truncate(
     uint64_t to,
     const Timeout& timeout)
@@ -216,6 +348,58 @@ Result<uint64_t> Coordinator::truncate(
 }
 
 
+Result<uint64_t> Coordinator::snapshot(
+    uint64_t position,
+    const string& bytes,
+    const Timeout& timeout)
+{
+  if (!elected) {
+    return Result<uint64_t>::error("Coordinator not elected");
+  } else if (position > index) {
+    return Result<uint64_t>::error(
+        "Attempted to snapshot past the end of the log");
+  }
+
+  LOG(INFO) << "Coordinator attempting to store snapshot at position "
+            << position << " (" << bytes.size() << " bytes) within "
+            << timeout.remaining();
+
+  StoreSnapshotRequest request;
+  request.mutable_snapshot()->set_position(position);
+  request.mutable_snapshot()->set_bytes(bytes);
+
+  // Broadcast the request to the network (including our local
+  // replica). The snapshot must be stored by a quorum before the log
+  // gets truncated so that any quorum of replicas (e.g., those
+  // reachable by a recovering reader) includes the snapshot.
+  set<Future<StoreSnapshotResponse> > futures =
+    broadcast(protocol::store, request);
+
+  uint32_t okays = 0;
+
+  while (okays < quorum && timeout.remaining() > Seconds(0)) {
+    Future<Future<StoreSnapshotResponse> > future = select(futures);
+    if (future.await(timeout.remaining())) {
+      CHECK(future.get().isReady());
+      CHECK(future.get().get().position() >= position);
+      okays++;
+      futures.erase(future.get());
+    }
+  }
+
+  // Discard the remaining futures (the remaining replicas will still
+  // store the snapshot if and when they get the request).
+  discard(futures);
+
+  if (okays < quorum) {
+    LOG(INFO) << "Coordinator timed out while trying to store snapshot";
+    return Result<uint64_t>::none();
+  }
+
+  return truncate(position, timeout);
+}
+
+
 Result<uint64_t> Coordinator::write(
     const Action& action,
     const Timeout& timeout)
@@ -243,26 +427,7 @@ Result<uint64_t> Coordinator::write(
     }
   }
 
-  WriteRequest request;
-  request.set_id(id);
-  request.set_position(action.position());
-  request.set_type(action.type());
-  switch (action.type()) {
-    case Action::NOP:
-      CHECK(action.has_nop());
-      request.mutable_nop();
-      break;
-    case Action::APPEND:
-      CHECK(action.has_append());
-      request.mutable_append()->MergeFrom(action.append());
-      break;
-    case Action::TRUNCATE:
-      CHECK(action.has_truncate());
-      request.mutable_truncate()->MergeFrom(action.truncate());
-      break;
-    default:
-      LOG(FATAL) << "Unknown Action::Type!";
-  }
+  const WriteRequest& request = log::request(id, action, false);
 
   // Broadcast the request to the network *excluding* the local replica.
   set<Future<WriteResponse> > futures =
@@ -309,6 +474,130 @@ Result<uint64_t> Coordinator::write(
 }
 
 
+Result<uint64_t> Coordinator::write(
+    const vector<vector<Action> >& batches,
+    size_t window,
+    const Timeout& timeout)
+{
+  CHECK(!batches.empty());
+
+  LOG(INFO) << "Coordinator attempting to write " << batches.size()
+            << " batch(es) of actions starting at position "
+            << batches.front().front().position()
+            << " within " << timeout.remaining();
+
+  CHECK(elected);
+
+  // TODO(benh): Eliminate this special case hack?
+  if (quorum == 1) {
+    Result<uint64_t> result = Result<uint64_t>::none();
+    foreach (const vector<Action>& actions, batches) {
+      Result<uint64_t> committed = commit(actions);
+      if (committed.isError()) {
+        return Result<uint64_t>::error(committed.error());
+      } else if (committed.isNone()) {
+        break;
+      }
+      result = committed;
+    }
+    return result;
+  }
+
+  // Outstanding responses for each of the batches in flight, and
+  // which batch each outstanding response belongs to.
+  vector<set<Future<BatchWriteResponse> > > futures(batches.size());
+  map<Future<BatchWriteResponse>, size_t> owners;
+
+  vector<uint32_t> okays(batches.size(), 0);
+
+  size_t sent = 0; // Number of batches sent.
+  size_t committed = 0; // Number of batches committed.
+
+  Result<uint64_t> result = Result<uint64_t>::none();
+
+  do {
+    // Keep the window full.
+    while (sent < batches.size() && sent - committed < window) {
+      futures[sent] =
+        remotecast(protocol::batch, request(id, batches[sent], false));
+      foreach (const Future<BatchWriteResponse>& future, futures[sent]) {
+        owners[future] = sent;
+      }
+      sent++;
+    }
+
+    set<Future<BatchWriteResponse> > outstanding;
+    for (size_t i = committed; i < sent; i++) {
+      outstanding.insert(futures[i].begin(), futures[i].end());
+    }
+
+    Future<Future<BatchWriteResponse> > future = select(outstanding);
+    if (future.await(timeout.remaining())) {
+      CHECK(future.get().isReady());
+      const BatchWriteResponse& response = future.get().get();
+
+      size_t i = owners[future.get()];
+      CHECK(response.responses_size() <= (int) batches[i].size());
+
+      foreach (const WriteResponse& _response, response.responses()) {
+        CHECK(_response.id() == id);
+        if (!_response.okay()) {
+          elected = false;
+          for (size_t j = committed; j < sent; j++) {
+            discard(futures[j]);
+          }
+          return Result<uint64_t>::error("Coordinator demoted");
+        }
+      }
+
+      futures[i].erase(future.get());
+      owners.erase(future.get());
+
+      // A replica that failed part way through the batch only
+      // responds for the writes before the failure, which is as good
+      // as not responding at all.
+      if (response.responses_size() == (int) batches[i].size()) {
+        okays[i]++;
+      }
+
+      // Commit the batches (in order) that got enough remote okays.
+      while (committed < sent &&
+             okays[committed] >= (quorum - 1)) { // N.B. Using (quorum - 1)!
+        discard(futures[committed]);
+        foreach (const Future<BatchWriteResponse>& f, futures[committed]) {
+          owners.erase(f);
+        }
+
+        Result<uint64_t> _result = commit(batches[committed]);
+        if (_result.isError()) {
+          for (size_t j = committed; j < sent; j++) {
+            discard(futures[j]);
+          }
+          return Result<uint64_t>::error(_result.error());
+        }
+
+        result = _result;
+        committed++;
+      }
+
+      if (committed == batches.size()) {
+        return result;
+      }
+    }
+  } while (timeout.remaining() > Seconds(0));
+
+  // Timed out ... discard remaining futures.
+  LOG(INFO) << "Coordinator timed out after writing " << committed
+            << " of " << batches.size() << " batch(es) of actions";
+
+  for (size_t i = committed; i < sent; i++) {
+    discard(futures[i]);
+  }
+
+  return result;
+}
+
+
 Result<uint64_t> Coordinator::commit(const Action& action)
 {
   LOG(INFO) << "Coordinator attempting to commit "
@@ -317,27 +606,8 @@ Result<uint64_t> Coordinator::commit(const Action& action)
 
   CHECK(elected);
 
-  WriteRequest request;
-  request.set_id(id);
-  request.set_position(action.position());
-  request.set_learned(true); // A commit is just a learned write.
-  request.set_type(action.type());
-  switch (action.type()) {
-    case Action::NOP:
-      CHECK(action.has_nop());
-      request.mutable_nop();
-      break;
-    case Action::APPEND:
-      CHECK(action.has_append());
-      request.mutable_append()->MergeFrom(action.append());
-      break;
-    case Action::TRUNCATE:
-      CHECK(action.has_truncate());
-      request.mutable_truncate()->MergeFrom(action.truncate());
-      break;
-    default:
-      LOG(FATAL) << "Unknown Action::Type!";
-  }
+  // A commit is just a learned write.
+  const WriteRequest& request = log::request(id, action, true);
 
   //  TODO(benh): Add a non-message based way to do this write.
   Future<WriteResponse> future = protocol::write(replica->pid(), request);
@@ -388,6 +658,167 @@ Result<uint64_t> Coordinator::commit(const Action& action)
 }
 
 
+Result<uint64_t> Coordinator::commit(const vector<Action>& actions)
+{
+  LOG(INFO) << "Coordinator attempting to commit " << actions.size()
+            << " actions starting at position " << actions.front().position();
+
+  CHECK(elected);
+
+  // A commit is just a learned write (to the local replica).
+  Result<uint64_t> result = learn(actions);
+
+  if (!result.isSome()) {
+    return result;
+  }
+
+  // Commit successful, send learned messages to the network
+  // *excluding* the local replica and return the last position.
+  foreach (const Action& action, actions) {
+    LearnedMessage message;
+    message.mutable_action()->MergeFrom(action);
+    message.mutable_action()->set_learned(true);
+    remotecast(message);
+  }
+
+  LOG(INFO) << "Told other replicas of learned actions at positions "
+            << actions.front().position() << " -> "
+            << actions.back().position();
+
+  return actions.back().position();
+}
+
+
+Result<uint64_t> Coordinator::learn(const vector<Action>& actions)
+{
+  CHECK(elected);
+
+  const BatchWriteRequest& request = log::request(id, actions, true);
+
+  //  TODO(benh): Add a non-message based way to do this write.
+  Future<BatchWriteResponse> future =
+    protocol::batch(replica->pid(), request);
+
+  // See the comment in 'commit' above regarding blocking here.
+  future.await(); // TODO(benh): Don't wait forever, see comment above.
+
+  if (future.isFailed()) {
+    return Result<uint64_t>::error(future.failure());
+  }
+
+  CHECK(future.isReady()) << "Not expecting a discarded future!";
+
+  const BatchWriteResponse& response = future.get();
+  CHECK(response.responses_size() <= (int) actions.size());
+
+  foreach (const WriteResponse& _response, response.responses()) {
+    CHECK(_response.id() == id);
+    if (!_response.okay()) {
+      elected = false;
+      return Result<uint64_t>::error("Coordinator demoted");
+    }
+  }
+
+  if (response.responses_size() < (int) actions.size()) {
+    return Result<uint64_t>::error(
+        "Failed to write action at position " +
+        stringify(actions[response.responses_size()].position()) +
+        " to the local replica");
+  }
+
+  return actions.back().position();
+}
+
+
+Result<uint64_t> Coordinator::catchup(
+    const set<uint64_t>& positions,
+    const Timeout& timeout)
+{
+  LOG(INFO) << "Coordinator attempting to learn " << positions.size()
+            << " missing position(s) from the other replicas";
+
+  CHECK(elected);
+
+  uint64_t learned = 0;
+
+  set<uint64_t>::const_iterator iterator = positions.begin();
+
+  while (iterator != positions.end() && timeout.remaining() > Seconds(0)) {
+    // Request the range of (at most CATCHUP_BATCH_SIZE) positions
+    // starting at the next missing position.
+    const uint64_t from = *iterator;
+
+    set<uint64_t> missing;
+    while (iterator != positions.end() &&
+           *iterator - from < CATCHUP_BATCH_SIZE) {
+      missing.insert(*iterator++);
+    }
+
+    LearnRequest request;
+    request.set_position(from);
+    request.set_end(*missing.rbegin());
+
+    set<Future<LearnResponse> > futures = remotecast(protocol::learn, request);
+
+    // Collect the learned actions until we've got all of the missing
+    // positions or enough responses that any position learned by a
+    // quorum (i.e., committed) must have been included. The positions
+    // that weren't learned this way will just get filled.
+    map<uint64_t, Action> actions;
+    uint32_t responses = 0;
+
+    while (!futures.empty() &&
+           actions.size() < missing.size() &&
+           responses < quorum - 1) {
+      Future<Future<LearnResponse> > future = select(futures);
+
+      if (!future.await(timeout.remaining())) {
+        break;
+      }
+
+      CHECK(future.get().isReady());
+
+      const LearnResponse& response = future.get().get();
+      if (response.okay()) {
+        foreach (const Action& action, response.actions()) {
+          if (missing.count(action.position()) > 0 &&
+              action.has_learned() && action.learned()) {
+            actions[action.position()] = action;
+          }
+        }
+      }
+
+      responses++;
+      futures.erase(future.get());
+    }
+
+    discard(futures);
+
+    if (actions.empty()) {
+      continue;
+    }
+
+    vector<Action> _actions;
+    foreachvalue (const Action& action, actions) {
+      _actions.push_back(action);
+    }
+
+    Result<uint64_t> result = learn(_actions);
+
+    if (!result.isSome()) {
+      return result;
+    }
+
+    learned += _actions.size();
+  }
+
+  LOG(INFO) << "Coordinator learned " << learned << " of "
+            << positions.size() << " missing position(s)";
+
+  return learned;
+}
+
+
 Result<Action> Coordinator::fill(uint64_t position, const Timeout& timeout)
 {
   LOG(INFO) << "Coordinator attempting to fill position "
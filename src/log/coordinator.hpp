@@ -19,6 +19,7 @@
 #ifndef __LOG_COORDINATOR_HPP__
 #define __LOG_COORDINATOR_HPP__
 
+#include <set>
 #include <string>
 #include <vector>
 
@@ -58,22 +59,72 @@ public:
       const std::string& bytes,
       const process::Timeout& timeout);
 
+  // Returns the result of trying to append each of the specified
+  // entries (at consecutive positions). Entries are written in
+  // batches of (at most) 'batch' actions per request, with up to
+  // 'window' batches in flight at a time. A result of none means
+  // nothing was appended (e.g., due to timeout) but can be retried,
+  // otherwise the last position that got appended is returned. Note
+  // that on a timeout this might precede the position of the last
+  // entry (i.e., only a prefix of the entries got appended).
+  Result<uint64_t> append(
+      const std::vector<std::string>& entries,
+      size_t window,
+      size_t batch,
+      const process::Timeout& timeout);
+
   // Returns the result of trying to truncate the log (from the
   // beginning to the specified position exclusive). A result of
   // none means the truncate failed (e.g., due to timeout), but can be
   // retried.
   Result<uint64_t> truncate(uint64_t to, const process::Timeout& timeout);
 
+  // Returns the result of trying to store a snapshot (covering the
+  // log from the beginning to the specified position exclusive) on a
+  // quorum of replicas and then truncating the log to that position.
+  // A result of none means the operation failed (e.g., due to
+  // timeout), but can be retried.
+  Result<uint64_t> snapshot(
+      uint64_t position,
+      const std::string& bytes,
+      const process::Timeout& timeout);
+
 private:
   // Helper that tries to achieve consensus of the specified action. A
   // result of none means the write failed (e.g., due to timeout), but
   // can be retried.
   Result<uint64_t> write(const Action& action, const process::Timeout& timeout);
 
+  // Helper like write, but for a sequence of batches of actions at
+  // consecutive positions. Up to 'window' batches get written
+  // concurrently and batches get committed in order. A some result
+  // returns the last position committed (see 'append' above).
+  Result<uint64_t> write(
+      const std::vector<std::vector<Action> >& batches,
+      size_t window,
+      const process::Timeout& timeout);
+
   // Helper that handles commiting an action (i.e., writing to the
   // local replica and then sending out learned messages).
   Result<uint64_t> commit(const Action& action);
 
+  // Helper like commit, but for a batch of actions (written to the
+  // local replica using a single request).
+  Result<uint64_t> commit(const std::vector<Action>& actions);
+
+  // Helper that writes the specified (already learned) actions to
+  // the local replica only, using a single request.
+  Result<uint64_t> learn(const std::vector<Action>& actions);
+
+  // Helper that tries to learn the specified positions from the
+  // other replicas in bulk (i.e., requesting ranges of positions
+  // rather than running a Paxos round per position) and writes them
+  // to the local replica. Returns the number of positions learned;
+  // those that remain missing need to be filled.
+  Result<uint64_t> catchup(
+      const std::set<uint64_t>& positions,
+      const process::Timeout& timeout);
+
   // Helper that tries to fill a position in the log.
   Result<Action> fill(uint64_t position, const process::Timeout& timeout);
 
@@ -20,10 +20,6 @@
 // general) by figuring out a way to not send the entire action
 // contents a second time (should cut bandwidth used in half).
 
-// TODO(benh): Provide a LearnRequest that requests more than one
-// position at a time, and a LearnResponse that returns as many
-// positions as it knows.
-
 // TODO(benh): Implement background catchup: have a new replica that
 // comes online become part of the group but don't respond to promises
 // or writes until it has caught up! The advantage to becoming part of
@@ -19,14 +19,18 @@
 #ifndef __LOG_HPP__
 #define __LOG_HPP__
 
+#include <algorithm>
 #include <list>
 #include <set>
 #include <string>
+#include <vector>
 
+#include <process/future.hpp>
 #include <process/process.hpp>
 #include <process/timeout.hpp>
 
 #include <stout/foreach.hpp>
+#include <stout/option.hpp>
 #include <stout/result.hpp>
 #include <stout/try.hpp>
 
@@ -112,6 +116,18 @@ public:
       : position(_position), data(_data) {}
   };
 
+  class Snapshot
+  {
+  public:
+    Position position; // Covers all positions before (exclusive).
+    std::string data;
+
+  private:
+    friend class Reader;
+    Snapshot(const Position& _position, const std::string& _data)
+      : position(_position), data(_data) {}
+  };
+
   class Reader
   {
   public:
@@ -135,8 +151,24 @@ public:
     // partitioned).
     Position ending();
 
+    // Returns the most recent snapshot, i.e., the one that the local
+    // replica has or, if the local replica has fallen behind a
+    // truncation (e.g., it was partitioned while the log got
+    // snapshotted), one fetched from another replica (which then
+    // gets stored by the local replica). The state of the log can be
+    // restored by reading the entries from the snapshot's position
+    // up to the ending position. A log that has never been truncated
+    // has an empty snapshot at its beginning. A none result means the
+    // operation timed out, otherwise the snapshot is returned or an
+    // error (e.g., the log was truncated without a snapshot).
+    Result<Snapshot> snapshot(const process::Timeout& timeout);
+
   private:
+    // Maximum number of positions read from the replica at a time.
+    static const uint64_t READ_CHUNK = 1024;
+
     Replica* replica;
+    Network* network;
   };
 
   class Writer
@@ -157,6 +189,20 @@ public:
         const std::string& data,
         const process::Timeout& timeout);
 
+    // Attempts to append each of the specified entries to the log,
+    // pipelining them as batches of (at most) 'batch' entries with up
+    // to 'window' batches in flight at a time. A none result means
+    // the operation timed out before anything was appended,
+    // otherwise the position of the last appended entry is returned
+    // (which precedes the position of the last specified entry if
+    // the operation timed out part way) or an error. Upon error a new
+    // Writer must be created.
+    Result<Position> append(
+        const std::vector<std::string>& data,
+        size_t window,
+        size_t batch,
+        const process::Timeout& timeout);
+
     // Attempts to truncate the log up to but not including the
     // specificed position. A none result means the operation timed
     // out, otherwise the new ending position of the log is returned
@@ -165,6 +211,17 @@ public:
         const Position& to,
         const process::Timeout& timeout);
 
+    // Attempts to store the specified snapshot, i.e., the result of
+    // applying all of the entries before (and exclusive of) the
+    // specified position, and then truncate the log up to that
+    // position. A none result means the operation timed out,
+    // otherwise the new ending position of the log is returned or an
+    // error. Upon error a new Writer must be created.
+    Result<Position> snapshot(
+        const Position& position,
+        const std::string& data,
+        const process::Timeout& timeout);
+
   private:
     Option<std::string> error;
     Coordinator coordinator;
@@ -270,49 +327,66 @@ private:
 };
 
 
-Log::Reader::Reader(Log* log)
-  : replica(log->replica) {}
+inline Log::Reader::Reader(Log* log)
+  : replica(log->replica),
+    network(log->network) {}
 
 
-Log::Reader::~Reader() {}
+inline Log::Reader::~Reader() {}
 
 
-Result<std::list<Log::Entry> > Log::Reader::read(
+inline Result<std::list<Log::Entry> > Log::Reader::read(
     const Log::Position& from,
     const Log::Position& to,
     const process::Timeout& timeout)
 {
-  process::Future<std::list<Action> > actions =
-    replica->read(from.value, to.value);
-
-  if (!actions.await(timeout.remaining())) {
-    return Result<std::list<Log::Entry> >::none();
-  } else if (actions.isFailed()) {
-    return Result<std::list<Log::Entry> >::error(actions.failure());
+  if (to.value < from.value) {
+    return Result<std::list<Log::Entry> >::error(
+        "Bad read range (to < from)");
   }
 
-  CHECK(actions.isReady()) << "Not expecting discarded future!";
-
   std::list<Log::Entry> entries;
 
   uint64_t position = from.value;
 
-  foreach (const Action& action, actions.get()) {
-    // Ensure read range is valid.
-    if (!action.has_performed() ||
-        !action.has_learned() ||
-        !action.learned()) {
-      return Result<std::list<Log::Entry> >::error(
-          "Bad read range (includes pending entries)");
-    } else if (position++ != action.position()) {
-      return Result<std::list<Log::Entry> >::error(
-          "Bad read range (includes missing entries)");
+  // Read the range in chunks so that the replica doesn't have to
+  // materialize (and copy) the entire range at once, and so that it
+  // can handle other requests in between chunks.
+  for (uint64_t start = from.value; start <= to.value; start += READ_CHUNK) {
+    uint64_t end = std::min(to.value, start + READ_CHUNK - 1);
+
+    process::Future<std::list<Action> > actions = replica->read(start, end);
+
+    if (!actions.await(timeout.remaining())) {
+      return Result<std::list<Log::Entry> >::none();
+    } else if (actions.isFailed()) {
+      return Result<std::list<Log::Entry> >::error(actions.failure());
+    }
+
+    CHECK(actions.isReady()) << "Not expecting discarded future!";
+
+    foreach (const Action& action, actions.get()) {
+      // Ensure read range is valid.
+      if (!action.has_performed() ||
+          !action.has_learned() ||
+          !action.learned()) {
+        return Result<std::list<Log::Entry> >::error(
+            "Bad read range (includes pending entries)");
+      } else if (position++ != action.position()) {
+        return Result<std::list<Log::Entry> >::error(
+            "Bad read range (includes missing entries)");
+      }
+
+      // And only return appends.
+      CHECK(action.has_type());
+      if (action.type() == Action::APPEND) {
+        entries.push_back(Entry(action.position(), action.append().bytes()));
+      }
     }
 
-    // And only return appends.
-    CHECK(action.has_type());
-    if (action.type() == Action::APPEND) {
-      entries.push_back(Entry(action.position(), action.append().bytes()));
+    // Don't wrap around when reading up to the largest position.
+    if (end == to.value) {
+      break;
     }
   }
 
@@ -320,7 +394,7 @@ Result<std::list<Log::Entry> > Log::Reader::read(
 }
 
 
-Log::Position Log::Reader::beginning()
+inline Log::Position Log::Reader::beginning()
 {
   // TODO(benh): Take a timeout and return an Option.
   process::Future<uint64_t> value = replica->beginning();
@@ -330,7 +404,7 @@ Log::Position Log::Reader::beginning()
 }
 
 
-Log::Position Log::Reader::ending()
+inline Log::Position Log::Reader::ending()
 {
   // TODO(benh): Take a timeout and return an Option.
   process::Future<uint64_t> value = replica->ending();
@@ -340,7 +414,100 @@ Log::Position Log::Reader::ending()
 }
 
 
-Log::Writer::Writer(Log* log, const Duration& timeout, int retries)
+inline Result<Log::Snapshot> Log::Reader::snapshot(
+    const process::Timeout& timeout)
+{
+  process::Future<uint64_t> begin = replica->beginning();
+
+  if (!begin.await(timeout.remaining())) {
+    return Result<Log::Snapshot>::none();
+  }
+
+  CHECK(begin.isReady()) << "Not expecting a failed or discarded future!";
+
+  process::Future<Option<log::Snapshot> > local = replica->snapshot();
+
+  if (!local.await(timeout.remaining())) {
+    return Result<Log::Snapshot>::none();
+  } else if (local.isFailed()) {
+    return Result<Log::Snapshot>::error(local.failure());
+  }
+
+  CHECK(local.isReady()) << "Not expecting discarded future!";
+
+  if (local.get().isSome() && local.get().get().position() >= begin.get()) {
+    return Log::Snapshot(
+        local.get().get().position(),
+        local.get().get().bytes());
+  } else if (local.get().isNone() && begin.get() == 0) {
+    return Log::Snapshot(0, "");
+  }
+
+  // The local replica's snapshot (if any) doesn't cover all of the
+  // truncated positions, so fetch a more recent one from the other
+  // replicas and store it locally.
+  LOG(INFO) << "Attempting to fetch a snapshot covering position "
+            << begin.get() << " from the other replicas";
+
+  process::Future<std::set<process::Future<FetchSnapshotResponse> > >
+    responses = network->broadcast(protocol::fetch, FetchSnapshotRequest());
+
+  if (!responses.await(timeout.remaining())) {
+    return Result<Log::Snapshot>::none();
+  }
+
+  CHECK(responses.isReady()) << "Not expecting a failed or discarded future!";
+
+  std::set<process::Future<FetchSnapshotResponse> > futures = responses.get();
+
+  Option<log::Snapshot> snapshot;
+
+  while (!futures.empty() && snapshot.isNone()) {
+    process::Future<process::Future<FetchSnapshotResponse> > future =
+      process::select(futures);
+
+    if (!future.await(timeout.remaining())) {
+      break;
+    }
+
+    CHECK(future.get().isReady());
+
+    const FetchSnapshotResponse& response = future.get().get();
+    if (response.has_snapshot() &&
+        response.snapshot().position() >= begin.get()) {
+      snapshot = response.snapshot();
+    }
+
+    futures.erase(future.get());
+  }
+
+  process::discard(futures);
+
+  if (snapshot.isNone()) {
+    if (futures.empty()) {
+      return Result<Log::Snapshot>::error(
+          "No snapshot covers the truncated positions");
+    }
+    return Result<Log::Snapshot>::none();
+  }
+
+  StoreSnapshotRequest request;
+  request.mutable_snapshot()->MergeFrom(snapshot.get());
+
+  process::Future<StoreSnapshotResponse> stored =
+    protocol::store(replica->pid(), request);
+
+  if (!stored.await(timeout.remaining())) {
+    return Result<Log::Snapshot>::none();
+  }
+
+  CHECK(stored.isReady()) << "Not expecting a failed or discarded future!";
+
+  return Log::Snapshot(snapshot.get().position(), snapshot.get().bytes());
+}
+
+
+inline Log::Writer::Writer(Log* log, const Duration& timeout, int retries)
   : error(Option<std::string>::none()),
     coordinator(log->quorum, log->replica, log->network)
 {
@@ -358,13 +525,13 @@ Log::Writer::Writer(Log* log, const Duration& timeout, int retries)
 }
 
 
-Log::Writer::~Writer()
+inline Log::Writer::~Writer()
 {
   coordinator.demote();
 }
 
 
-Result<Log::Position> Log::Writer::append(
+inline Result<Log::Position> Log::Writer::append(
     const std::string& data,
     const process::Timeout& timeout)
 {
@@ -389,7 +556,35 @@ Result<Log::Position> Log::Writer::append(
 }
 
 
-Result<Log::Position> Log::Writer::truncate(
+inline Result<Log::Position> Log::Writer::append(
+    const std::vector<std::string>& data,
+    size_t window,
+    size_t batch,
+    const process::Timeout& timeout)
+{
+  if (error.isSome()) {
+    return Result<Log::Position>::error(error.get());
+  }
+
+  LOG(INFO) << "Attempting to append " << data.size()
+            << " entries to the log";
+
+  Result<uint64_t> result = coordinator.append(data, window, batch, timeout);
+
+  if (result.isError()) {
+    error = result.error();
+    return Result<Log::Position>::error(error.get());
+  } else if (result.isNone()) {
+    return Result<Log::Position>::none();
+  }
+
+  CHECK_SOME(result);
+
+  return Log::Position(result.get());
+}
+
+
+inline Result<Log::Position> Log::Writer::truncate(
     const Log::Position& to,
     const process::Timeout& timeout)
 {
@@ -414,7 +609,35 @@ Result<Log::Position> Log::Writer::truncate(
 }
 
 
-void Log::watch(const std::set<zookeeper::Group::Membership>& memberships)
+inline Result<Log::Position> Log::Writer::snapshot(
+    const Log::Position& position,
+    const std::string& data,
+    const process::Timeout& timeout)
+{
+  if (error.isSome()) {
+    return Result<Log::Position>::error(error.get());
+  }
+
+  LOG(INFO) << "Attempting to snapshot the log at " << position.value;
+
+  Result<uint64_t> result =
+    coordinator.snapshot(position.value, data, timeout);
+
+  if (result.isError()) {
+    error = result.error();
+    return Result<Log::Position>::error(error.get());
+  } else if (result.isNone()) {
+    return Result<Log::Position>::none();
+  }
+
+  CHECK_SOME(result);
+
+  return Log::Position(result.get());
+}
+
+
+inline void Log::watch(
+    const std::set<zookeeper::Group::Membership>& memberships)
 {
   if (membership.isReady() && memberships.count(membership.get()) == 0) {
     // Our replica's membership must have expired, join back up.
@@ -431,13 +654,13 @@ void Log::watch(const std::set<zookeeper::Group::Membership>& memberships)
 }
 
 
-void Log::failed(const std::string& message) const
+inline void Log::failed(const std::string& message) const
 {
   LOG(FATAL) << "Failed to participate in ZooKeeper group: " << message;
 }
 
 
-void Log::discarded() const
+inline void Log::discarded() const
 {
   LOG(FATAL) << "Not expecting future to get discarded!";
 }
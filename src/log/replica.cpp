@@ -23,14 +23,20 @@
 #include <leveldb/write_batch.h>
 
 #include <algorithm>
+#include <map>
+#include <vector>
 
 #include <process/dispatch.hpp>
+#include <process/http.hpp>
 #include <process/protobuf.hpp>
 
 #include <stout/foreach.hpp>
+#include <stout/json.hpp>
 #include <stout/nothing.hpp>
+#include <stout/option.hpp>
 #include <stout/numify.hpp>
 #include <stout/stopwatch.hpp>
+#include <stout/stringify.hpp>
 #include <stout/utils.hpp>
 
 #include "log/replica.hpp"
@@ -44,8 +50,10 @@ using namespace process;
 using process::wait; // Necessary on some OS's to disambiguate.
 
 using std::list;
+using std::map;
 using std::set;
 using std::string;
+using std::vector;
 
 namespace mesos {
 namespace internal {
@@ -56,7 +64,10 @@ namespace protocol {
 // Some replica protocol definitions.
 Protocol<PromiseRequest, PromiseResponse> promise;
 Protocol<WriteRequest, WriteResponse> write;
+Protocol<BatchWriteRequest, BatchWriteResponse> batch;
 Protocol<LearnRequest, LearnResponse> learn;
+Protocol<StoreSnapshotRequest, StoreSnapshotResponse> store;
+Protocol<FetchSnapshotRequest, FetchSnapshotResponse> fetch;
 
 } // namespace protocol {
 
@@ -68,6 +79,7 @@ struct State
   uint64_t end; // Ending position of the log.
   std::set<uint64_t> learned; // Positions present and learned
   std::set<uint64_t> unlearned; // Positions present but unlearned.
+  Option<uint64_t> snapshot; // Position of the snapshot (if any).
 };
 
 
@@ -79,7 +91,19 @@ public:
   virtual Try<State> recover(const string& path) = 0;
   virtual Try<Nothing> persist(const Promise& promise) = 0;
   virtual Try<Nothing> persist(const Action& action) = 0;
+
+  // Persists all of the records using a single synchronous write
+  // (i.e., either all or none of the records get persisted).
+  virtual Try<Nothing> persist(const vector<Record>& records) = 0;
+
   virtual Try<Action> read(uint64_t position) = 0;
+
+  // Returns all the actions present between the specified positions
+  // (inclusive), in order.
+  virtual Try<list<Action> > read(uint64_t from, uint64_t to) = 0;
+
+  // Returns the snapshot, or none if no snapshot has been persisted.
+  virtual Result<Snapshot> snapshot() = 0;
 };
 
 
@@ -93,9 +117,15 @@ public:
   virtual Try<State> recover(const string& path);
   virtual Try<Nothing> persist(const Promise& promise);
   virtual Try<Nothing> persist(const Action& action);
+  virtual Try<Nothing> persist(const vector<Record>& records);
   virtual Try<Action> read(uint64_t position);
+  virtual Try<list<Action> > read(uint64_t from, uint64_t to);
+  virtual Result<Snapshot> snapshot();
 
 private:
+  // Deletes the positions before the specified (truncate) position.
+  void truncate(uint64_t to);
+
   class Varint64Comparator : public leveldb::Comparator
   {
   public:
@@ -171,6 +201,11 @@ private:
     return position.get() - 1; // Actual position is less 1 of stringified.
   }
 
+  // Key of the snapshot record. Note that this sorts before all of
+  // the keys returned from 'encode' so that iterating through a range
+  // of positions never encounters the snapshot record.
+  static const char* const SNAPSHOT_KEY;
+
   // Varint64Comparator comparator; // TODO(benh): Use varint comparator.
 
   leveldb::DB* db;
@@ -179,6 +214,9 @@ private:
 };
 
 
+const char* const LevelDBStorage::SNAPSHOT_KEY = "/snapshot";
+
+
 LevelDBStorage::LevelDBStorage()
   : db(NULL), first(0)
 {
@@ -238,10 +276,44 @@ Try<State> LevelDBStorage::recover(const string& path)
   state.begin = 0;
   state.end = 0;
 
-  // TODO(benh): Consider just reading the "promise" record (e.g.,
-  // 'encode(0, false)') and then iterating over the rest of the
-  // records and confirming that they are all indeed of type
-  // Record::Action.
+  stopwatch.start(); // Restart the stopwatch.
+
+  // Read the promise and snapshot records directly so that we only
+  // need to iterate through the positions after the snapshot (i.e.,
+  // recovery is proportional to the tail of the log rather than to
+  // everything that was ever written to it).
+  string value;
+
+  status = db->Get(leveldb::ReadOptions(), encode(0, false), &value);
+
+  if (status.ok()) {
+    Record record;
+    if (!record.ParseFromString(value) ||
+        record.type() != Record::PROMISE ||
+        !record.has_promise()) {
+      return Try<State>::error("Bad promise record");
+    }
+    state.coordinator = record.promise().id();
+  } else if (!status.IsNotFound()) {
+    return Try<State>::error(status.ToString());
+  }
+
+  status = db->Get(leveldb::ReadOptions(), SNAPSHOT_KEY, &value);
+
+  if (status.ok()) {
+    Record record;
+    if (!record.ParseFromString(value) ||
+        record.type() != Record::SNAPSHOT ||
+        !record.has_snapshot()) {
+      return Try<State>::error("Bad snapshot record");
+    }
+    state.snapshot = record.snapshot().position();
+    state.begin = record.snapshot().position();
+  } else if (!status.IsNotFound()) {
+    return Try<State>::error(status.ToString());
+  }
+
+  LOG(INFO) << "Read promise and snapshot records in " << stopwatch.elapsed();
 
   stopwatch.start(); // Restart the stopwatch.
 
@@ -251,9 +323,12 @@ Try<State> LevelDBStorage::recover(const string& path)
 
   stopwatch.start(); // Restart the stopwatch.
 
-  iterator->SeekToFirst();
+  // Skip any positions covered by the snapshot (that haven't been
+  // deleted yet, see LevelDBStorage::truncate).
+  iterator->Seek(encode(state.begin));
 
-  LOG(INFO) << "Seeked to beginning of db in " << stopwatch.elapsed();
+  LOG(INFO) << "Seeked to position " << state.begin
+            << " in db in " << stopwatch.elapsed();
 
   stopwatch.start(); // Restart the stopwatch.
 
@@ -268,38 +343,27 @@ Try<State> LevelDBStorage::recover(const string& path)
     Record record;
 
     if (!record.ParseFromZeroCopyStream(&stream)) {
+      delete iterator;
       return Try<State>::error("Failed to deserialize record");
     }
 
-    switch (record.type()) {
-      case Record::PROMISE: {
-        CHECK(record.has_promise());
-        const Promise& promise = record.promise();
-        state.coordinator = promise.id();
-        break;
-      }
-
-      case Record::ACTION: {
-        CHECK(record.has_action());
-        const Action& action = record.action();
-        if (action.has_learned() && action.learned()) {
-          state.learned.insert(action.position());
-          state.unlearned.erase(action.position());
-          if (action.has_type() && action.type() == Action::TRUNCATE) {
-            state.begin = std::max(state.begin, action.truncate().to());
-          }
-        } else {
-          state.learned.erase(action.position());
-          state.unlearned.insert(action.position());
-        }
-        state.end = std::max(state.end, action.position());
-        break;
-      }
+    if (record.type() != Record::ACTION || !record.has_action()) {
+      delete iterator;
+      return Try<State>::error("Bad record");
+    }
 
-      default: {
-        return Try<State>::error("Bad record");
+    const Action& action = record.action();
+    if (action.has_learned() && action.learned()) {
+      state.learned.insert(action.position());
+      state.unlearned.erase(action.position());
+      if (action.has_type() && action.type() == Action::TRUNCATE) {
+        state.begin = std::max(state.begin, action.truncate().to());
       }
+    } else {
+      state.learned.erase(action.position());
+      state.unlearned.insert(action.position());
     }
+    state.end = std::max(state.end, action.position());
 
     iterator->Next();
   }
@@ -326,114 +390,133 @@ Try<State> LevelDBStorage::recover(const string& path)
 
 Try<Nothing> LevelDBStorage::persist(const Promise& promise)
 {
-  Stopwatch stopwatch;
-  stopwatch.start();
-
-  leveldb::WriteOptions options;
-  options.sync = true;
-
   Record record;
   record.set_type(Record::PROMISE);
   record.mutable_promise()->MergeFrom(promise);
 
-  string value;
-
-  if (!record.SerializeToString(&value)) {
-    return Try<Nothing>::error("Failed to serialize record");
-  }
+  return persist(vector<Record>(1, record));
+}
 
-  leveldb::Status status = db->Put(options, encode(0, false), value);
 
-  if (!status.ok()) {
-    return Try<Nothing>::error(status.ToString());
-  }
-
-  LOG(INFO) << "Persisting promise (" << value.size()
-            << " bytes) to leveldb took " << stopwatch.elapsed();
+Try<Nothing> LevelDBStorage::persist(const Action& action)
+{
+  Record record;
+  record.set_type(Record::ACTION);
+  record.mutable_action()->MergeFrom(action);
 
-  return Nothing();
+  return persist(vector<Record>(1, record));
 }
 
 
-Try<Nothing> LevelDBStorage::persist(const Action& action)
+Try<Nothing> LevelDBStorage::persist(const vector<Record>& records)
 {
   Stopwatch stopwatch;
   stopwatch.start();
 
-  Record record;
-  record.set_type(Record::ACTION);
-  record.mutable_action()->MergeFrom(action);
+  leveldb::WriteBatch batch;
 
-  string value;
+  size_t size = 0;
+
+  foreach (const Record& record, records) {
+    string value;
+
+    if (!record.SerializeToString(&value)) {
+      return Try<Nothing>::error("Failed to serialize record");
+    }
 
-  if (!record.SerializeToString(&value)) {
-    return Try<Nothing>::error("Failed to serialize record");
+    size += value.size();
+
+    if (record.type() == Record::PROMISE) {
+      CHECK(record.has_promise());
+      batch.Put(encode(0, false), value);
+    } else if (record.type() == Record::SNAPSHOT) {
+      CHECK(record.has_snapshot());
+      batch.Put(SNAPSHOT_KEY, value);
+    } else {
+      CHECK(record.type() == Record::ACTION);
+      CHECK(record.has_action());
+      batch.Put(encode(record.action().position()), value);
+    }
   }
 
   leveldb::WriteOptions options;
   options.sync = true;
 
-  leveldb::Status status = db->Put(options, encode(action.position()), value);
+  leveldb::Status status = db->Write(options, &batch);
 
   if (!status.ok()) {
     return Try<Nothing>::error(status.ToString());
   }
 
-  LOG(INFO) << "Persisting action (" << value.size()
-            << " bytes) to leveldb took " << stopwatch.elapsed();
-
-  // Delete positions if a truncate action has been *learned*. Note
-  // that we do this in a best-effort fashion (i.e., we ignore any
-  // failures to the database since we can always try again).
-  if (action.has_type() && action.type() == Action::TRUNCATE &&
-      action.has_learned() && action.learned()) {
-    CHECK(action.has_truncate());
-
-    stopwatch.start(); // Restart the stopwatch.
-
-    // To actually perform the truncation in leveldb we need to remove
-    // all the keys that represent positions no longer in the log. We
-    // do this by attempting to delete all keys that represent the
-    // first position we know is still in leveldb up to (but
-    // excluding) the truncate position. Note that this works because
-    // the semantics of WriteBatch are such that even if the position
-    // doesn't exist (which is possible because this replica has some
-    // holes), we can attempt to delete the key that represents it and
-    // it will just ignore that key. This is *much* cheaper than
-    // actually iterating through the entire database instead (which
-    // was, for posterity, the original implementation). In addition,
-    // caching the "first" position we know is in the database is
-    // cheaper than using an iterator to determine the first position
-    // (which was, for posterity, the second implementation).
-
-    leveldb::WriteBatch batch;
-
-    // Add positions up to (but excluding) the truncate position to
-    // the batch starting at the first position still in leveldb.
-    uint64_t index = 0;
-    while ((first + index) < action.truncate().to()) {
-      batch.Delete(encode(first + index));
-      index++;
+  LOG(INFO) << "Persisting " << records.size() << " record(s) ("
+            << size << " bytes) to leveldb took " << stopwatch.elapsed();
+
+  // Delete positions if a truncate action has been *learned* or they
+  // are covered by a snapshot. Note that we do this in a best-effort
+  // fashion (i.e., we ignore any failures to the database since we
+  // can always try again).
+  foreach (const Record& record, records) {
+    if (record.type() == Record::SNAPSHOT) {
+      truncate(record.snapshot().position());
+    } else if (record.type() == Record::ACTION) {
+      const Action& action = record.action();
+      if (action.has_type() && action.type() == Action::TRUNCATE &&
+          action.has_learned() && action.learned()) {
+        CHECK(action.has_truncate());
+        truncate(action.truncate().to());
+      }
     }
+  }
 
-    // If we added any positions, attempt to delete them!
-    if (index > 0) {
-      // We do this write asynchronously (e.g., using default options).
-      leveldb::Status status = db->Write(leveldb::WriteOptions(), &batch);
+  return Nothing();
+}
 
-      if (!status.ok()) {
-        LOG(WARNING) << "Ignoring leveldb batch delete failure: "
-                     << status.ToString();
-      } else {
-        first = action.truncate().to(); // Save the new first position!
 
-        LOG(INFO) << "Deleting ~" << index
-                  << " keys from leveldb took " << stopwatch.elapsed();
-      }
-    }
+void LevelDBStorage::truncate(uint64_t to)
+{
+  Stopwatch stopwatch;
+  stopwatch.start();
+
+  // To actually perform the truncation in leveldb we need to remove
+  // all the keys that represent positions no longer in the log. We
+  // do this by attempting to delete all keys that represent the
+  // first position we know is still in leveldb up to (but
+  // excluding) the truncate position. Note that this works because
+  // the semantics of WriteBatch are such that even if the position
+  // doesn't exist (which is possible because this replica has some
+  // holes), we can attempt to delete the key that represents it and
+  // it will just ignore that key. This is *much* cheaper than
+  // actually iterating through the entire database instead (which
+  // was, for posterity, the original implementation). In addition,
+  // caching the "first" position we know is in the database is
+  // cheaper than using an iterator to determine the first position
+  // (which was, for posterity, the second implementation).
+
+  leveldb::WriteBatch batch;
+
+  // Add positions up to (but excluding) the truncate position to
+  // the batch starting at the first position still in leveldb.
+  uint64_t index = 0;
+  while ((first + index) < to) {
+    batch.Delete(encode(first + index));
+    index++;
   }
 
-  return Nothing();
+  // If we added any positions, attempt to delete them!
+  if (index > 0) {
+    // We do this write asynchronously (e.g., using default options).
+    leveldb::Status status = db->Write(leveldb::WriteOptions(), &batch);
+
+    if (!status.ok()) {
+      LOG(WARNING) << "Ignoring leveldb batch delete failure: "
+                   << status.ToString();
+    } else {
+      first = to; // Save the new first position!
+
+      LOG(INFO) << "Deleting ~" << index
+                << " keys from leveldb took " << stopwatch.elapsed();
+    }
+  }
 }
 
 
@@ -470,6 +553,140 @@ Try<Action> LevelDBStorage::read(uint64_t position)
 }
 
 
+Result<Snapshot> LevelDBStorage::snapshot()
+{
+  string value;
+
+  leveldb::Status status =
+    db->Get(leveldb::ReadOptions(), SNAPSHOT_KEY, &value);
+
+  if (status.IsNotFound()) {
+    return Result<Snapshot>::none();
+  } else if (!status.ok()) {
+    return Result<Snapshot>::error(status.ToString());
+  }
+
+  Record record;
+
+  if (!record.ParseFromString(value)) {
+    return Result<Snapshot>::error("Failed to deserialize record");
+  }
+
+  if (record.type() != Record::SNAPSHOT || !record.has_snapshot()) {
+    return Result<Snapshot>::error("Bad record");
+  }
+
+  return record.snapshot();
+}
+
+
+// A histogram of values using power of two buckets, i.e., the bucket
+// labeled N counts the values in [N / 2, N) (and the bucket labeled 1
+// counts the zeros).
+struct Histogram
+{
+  Histogram() : count(0), sum(0) {}
+
+  void add(uint64_t value)
+  {
+    size_t bucket = 0;
+    while (bucket < 64 && (value >> bucket) != 0) {
+      bucket++;
+    }
+
+    if (buckets.size() <= bucket) {
+      buckets.resize(bucket + 1, 0);
+    }
+
+    buckets[bucket]++;
+    count++;
+    sum += value;
+  }
+
+  JSON::Object model() const
+  {
+    JSON::Object object;
+    object.values["count"] = JSON::Number(count);
+    object.values["sum"] = JSON::Number(sum);
+
+    JSON::Object values;
+    for (size_t bucket = 0; bucket < buckets.size(); bucket++) {
+      if (buckets[bucket] > 0) {
+        values.values[stringify((uint64_t) 1 << bucket)] =
+          JSON::Number(buckets[bucket]);
+      }
+    }
+    object.values["buckets"] = values;
+
+    return object;
+  }
+
+  vector<uint64_t> buckets;
+  uint64_t count;
+  uint64_t sum;
+};
+
+
+Try<list<Action> > LevelDBStorage::read(uint64_t from, uint64_t to)
+{
+  Stopwatch stopwatch;
+  stopwatch.start();
+
+  // Don't pollute the cache with a (potentially large) range scan.
+  leveldb::ReadOptions options;
+  options.fill_cache = false;
+
+  leveldb::Iterator* iterator = db->NewIterator(options);
+
+  // NOTE: The keys are ordered by position (see the checks in
+  // 'recover') so a single seek followed by a scan visits exactly
+  // the positions in the range (skipping any holes).
+  iterator->Seek(encode(from));
+
+  list<Action> actions;
+
+  while (iterator->Valid()) {
+    uint64_t position = decode(iterator->key());
+    if (position > to) {
+      break;
+    }
+
+    const leveldb::Slice& slice = iterator->value();
+
+    google::protobuf::io::ArrayInputStream stream(slice.data(), slice.size());
+
+    Record record;
+
+    if (!record.ParseFromZeroCopyStream(&stream)) {
+      delete iterator;
+      return Try<list<Action> >::error("Failed to deserialize record");
+    }
+
+    if (record.type() != Record::ACTION) {
+      delete iterator;
+      return Try<list<Action> >::error("Bad record");
+    }
+
+    actions.push_back(record.action());
+
+    iterator->Next();
+  }
+
+  leveldb::Status status = iterator->status();
+
+  delete iterator;
+
+  if (!status.ok()) {
+    return Try<list<Action> >::error(status.ToString());
+  }
+
+  LOG(INFO) << "Reading " << actions.size() << " positions from leveldb took "
+            << stopwatch.elapsed();
+
+  return actions;
+}
+
+
 class ReplicaProcess : public ProtobufProcess<ReplicaProcess>
 {
 public:
@@ -488,7 +705,8 @@ public:
   Result<Action> read(uint64_t position);
 
   // Returns all the actions between the specified positions, unless
-  // those positions are invalid, in which case returns an error.
+  // those positions are invalid, in which case returns an error. Any
+  // queued records get written to storage first.
   process::Future<std::list<Action> > read(uint64_t from, uint64_t to);
 
   // Returns missing positions in the log (i.e., unlearned or holes)
@@ -504,6 +722,12 @@ public:
   // Returns the highest implicit promise this replica has given.
   uint64_t promised();
 
+  // Returns the snapshot stored by this replica (if any).
+  process::Future<Option<Snapshot> > snapshot();
+
+protected:
+  virtual void finalize();
+
 private:
   // Handles a request from a coordinator to promise not to accept
   // writes from any other coordinator.
@@ -512,17 +736,57 @@ private:
   // Handles a request from a coordinator to write an action.
   void write(const WriteRequest& request);
 
+  // Handles a request from a coordinator to write a batch of actions.
+  // The response only covers the writes up to (but excluding) the
+  // first one that fails without a response (see '_write').
+  void write(const BatchWriteRequest& request);
+
+  // Helper that performs a write request. A none result means no
+  // response should be sent (see the note above
+  // ReplicaProcess::promise).
+  Option<WriteResponse> _write(const WriteRequest& request);
+
   // Handles a request from a coordinator (or replica) to learn the
-  // specified position in the log.
-  void learn(uint64_t position);
+  // specified position (or range of positions) in the log.
+  void learn(const LearnRequest& request);
 
   // Handles a message notifying of a learned action.
   void learned(const Action& action);
 
+  // Handles a request to store a snapshot (replacing the current
+  // snapshot if the requested snapshot is more recent).
+  void store(const Snapshot& snapshot);
+
+  // Handles a request for the snapshot stored by this replica.
+  void fetch(const FetchSnapshotRequest& request);
+
+  // Helper that updates the in-memory state of the replica once
+  // positions before the specified position are no longer needed
+  // (i.e., after a learned truncation or a snapshot).
+  void truncate(uint64_t to);
+
   // Helper routines that write a record corresponding to the
   // specified argument. Returns true on success and false otherwise.
+  // Records are written to storage in batches (see 'flush'), but the
+  // in-memory state of the replica reflects a record right away.
   bool persist(const Promise& promise);
   bool persist(const Action& action);
+  bool persist(const Snapshot& snapshot);
+
+  // Helper that queues the record to be written to storage.
+  bool persist(const Record& record);
+
+  // Writes all of the queued records to storage using a single
+  // synchronous write and then sends out all of the responses that
+  // were held back waiting for those records to be durable.
+  void flush();
+
+  // Replies with the message once all of the records queued so far
+  // have been written to storage (or right away if there are none).
+  void respond(const google::protobuf::Message& message);
+
+  // Handles HTTP requests for the replica's statistics.
+  Future<process::http::Response> stats(const process::http::Request& request);
 
   // Helper routine to recover log (e.g., on restart).
   void recover(const std::string& path);
@@ -544,13 +808,48 @@ private:
 
   // Unlearned positions in the log.
   std::set<uint64_t> unlearned;
+
+  // Position of the snapshot stored by this replica (if any).
+  Option<uint64_t> snapshotted;
+
+  // Records waiting to be written to storage (and their total size),
+  // along with the (latest) queued action for each position so that
+  // reads see them before they are written.
+  vector<Record> records;
+  size_t size;
+  map<uint64_t, Action> actions;
+
+  // Responses waiting for the queued records to be written.
+  struct Response
+  {
+    Response(const UPID& _to, const string& _name, const string& _data)
+      : to(_to), name(_name), data(_data) {}
+
+    UPID to;
+    string name;
+    string data;
+  };
+
+  vector<Response> responses;
+
+  // Number of records written per batch, and how long each batch
+  // took to write (in microseconds).
+  Histogram batches;
+  Histogram latencies;
 };
 
 
+// Maximum total size of the records written to storage as a batch.
+// Records are written as soon as this size is reached rather than
+// waiting for the replica to finish processing the queued requests.
+static const size_t MAX_BATCH_BYTES = 4 * 1024 * 1024;
+
+
 ReplicaProcess::ReplicaProcess(const string& path)
   : coordinator(0),
     begin(0),
-    end(0)
+    end(0),
+    size(0)
 {
   storage = new LevelDBStorage(); // TODO(benh): Factor out and expose storage.
 
@@ -563,13 +862,24 @@ ReplicaProcess::ReplicaProcess(const string& path)
   install<WriteRequest>(
       &ReplicaProcess::write);
 
+  install<BatchWriteRequest>(
+      &ReplicaProcess::write);
+
   install<LearnedMessage>(
       &ReplicaProcess::learned,
       &LearnedMessage::action);
 
   install<LearnRequest>(
-      &ReplicaProcess::learn,
-      &LearnRequest::position);
+      &ReplicaProcess::learn);
+
+  install<StoreSnapshotRequest>(
+      &ReplicaProcess::store,
+      &StoreSnapshotRequest::snapshot);
+
+  install<FetchSnapshotRequest>(
+      &ReplicaProcess::fetch);
+
+  route("/stats.json", &ReplicaProcess::stats);
 }
 
 
@@ -579,6 +889,12 @@ ReplicaProcess::~ReplicaProcess()
 }
 
 
+void ReplicaProcess::finalize()
+{
+  flush();
+}
+
+
 Result<Action> ReplicaProcess::read(uint64_t position)
 {
   if (position < begin) {
@@ -587,6 +903,8 @@ Result<Action> ReplicaProcess::read(uint64_t position)
     return Result<Action>::none(); // These semantics are assumed above!
   } else if (holes.count(position) > 0) {
     return Result<Action>::none();
+  } else if (actions.count(position) > 0) {
+    return actions[position]; // Not yet written to storage.
   }
 
   // Must exist in storage ...
@@ -622,21 +940,20 @@ process::Future<list<Action> > ReplicaProcess::read(
     return promise.future();
   }
 
-  list<Action> actions;
+  // Make sure everything we return has been written to storage
+  // (rather than handing out queued actions that might still be lost
+  // if we crash before they get written).
+  flush();
 
-  for (uint64_t position = from; position <= to; position++) {
-    Result<Action> result = read(position);
+  Try<list<Action> > result = storage->read(from, to);
 
-    if (result.isError()) {
-      process::Promise<list<Action> > promise;
-      promise.fail(result.error());
-      return promise.future();
-    } else if (result.isSome()) {
-      actions.push_back(result.get());
-    }
+  if (result.isError()) {
+    process::Promise<list<Action> > promise;
+    promise.fail(result.error());
+    return promise.future();
   }
 
-  return actions;
+  return result.get();
 }
 
 
@@ -682,6 +999,29 @@ uint64_t ReplicaProcess::promised()
 }
 
 
+process::Future<Option<Snapshot> > ReplicaProcess::snapshot()
+{
+  if (snapshotted.isNone()) {
+    return Option<Snapshot>::none();
+  }
+
+  // Make sure the latest snapshot has been written to storage.
+  flush();
+
+  Result<Snapshot> snapshot = storage->snapshot();
+
+  if (snapshot.isError()) {
+    process::Promise<Option<Snapshot> > promise;
+    promise.fail(snapshot.error());
+    return promise.future();
+  }
+
+  CHECK_SOME(snapshot);
+
+  return Option<Snapshot>::some(snapshot.get());
+}
+
+
 // Note that certain failures that occur result in returning from the
 // current function but *NOT* sending a 'nack' back to the coordinator
 // because that implies a coordinator has been demoted. Not sending
@@ -725,7 +1065,7 @@ void ReplicaProcess::promise(const PromiseRequest& request)
       response.set_okay(true);
       response.set_id(request.id());
       response.mutable_action()->MergeFrom(action);
-      reply(response);
+      respond(response);
     }
 
     // Need to get the action for the specified position.
@@ -744,7 +1084,7 @@ void ReplicaProcess::promise(const PromiseRequest& request)
         response.set_okay(true);
         response.set_id(request.id());
         response.set_position(request.position());
-        reply(response);
+        respond(response);
       }
     } else {
       CHECK_SOME(result);
@@ -756,7 +1096,7 @@ void ReplicaProcess::promise(const PromiseRequest& request)
         response.set_okay(false);
         response.set_id(request.id());
         response.set_position(request.position());
-        reply(response);
+        respond(response);
       } else {
         Action original = action;
         action.set_promised(request.id());
@@ -766,7 +1106,7 @@ void ReplicaProcess::promise(const PromiseRequest& request)
           response.set_okay(true);
           response.set_id(request.id());
           response.mutable_action()->MergeFrom(original);
-          reply(response);
+          respond(response);
         }
       }
     }
@@ -780,7 +1120,7 @@ void ReplicaProcess::promise(const PromiseRequest& request)
       PromiseResponse response;
       response.set_okay(false);
       response.set_id(request.id());
-      reply(response);
+      respond(response);
     } else {
       Promise promise;
       promise.set_id(request.id());
@@ -793,7 +1133,7 @@ void ReplicaProcess::promise(const PromiseRequest& request)
         response.set_okay(true);
         response.set_id(request.id());
         response.set_position(end);
-        reply(response);
+        respond(response);
       }
     }
   }
@@ -804,18 +1144,56 @@ void ReplicaProcess::write(const WriteRequest& request)
 {
   LOG(INFO) << "Replica received write request for position " << request.position();
 
+  Option<WriteResponse> response = _write(request);
+
+  if (response.isSome()) {
+    respond(response.get());
+  }
+}
+
+
+void ReplicaProcess::write(const BatchWriteRequest& request)
+{
+  LOG(INFO) << "Replica received batch write request for "
+            << request.requests_size() << " positions";
+
+  BatchWriteResponse response;
+
+  foreach (const WriteRequest& write, request.requests()) {
+    Option<WriteResponse> _response = _write(write);
+
+    // We still respond if a write fails part way through the batch
+    // (rather than pretending the request never made it here, see
+    // above) since the writes before it have already been queued
+    // and the coordinator shouldn't need to wait for its timeout to
+    // find out. A response for only part of the batch doesn't count
+    // as this replica having written the batch.
+    if (_response.isNone()) {
+      break;
+    }
+
+    response.add_responses()->MergeFrom(_response.get());
+  }
+
+  respond(response);
+}
+
+
+Option<WriteResponse> ReplicaProcess::_write(const WriteRequest& request)
+{
   Result<Action> result = read(request.position());
 
   if (result.isError()) {
     LOG(ERROR) << "Error getting log record at " << request.position()
                << ": " << result.error();
+    return Option<WriteResponse>::none();
   } else if (result.isNone()) {
     if (request.id() < coordinator) {
       WriteResponse response;
       response.set_okay(false);
       response.set_id(request.id());
       response.set_position(request.position());
-      reply(response);
+      return response;
     } else {
       Action action;
       action.set_position(request.position());
@@ -846,7 +1224,7 @@ void ReplicaProcess::write(const WriteRequest& request)
         response.set_okay(true);
         response.set_id(request.id());
         response.set_position(request.position());
-        reply(response);
+        return response;
       }
     }
   } else if (result.isSome()) {
@@ -858,7 +1236,7 @@ void ReplicaProcess::write(const WriteRequest& request)
       response.set_okay(false);
       response.set_id(request.id());
       response.set_position(request.position());
-      reply(response);
+      return response;
     } else {
       // TODO(benh): Check if this position has already been learned,
       // and if so, check that we are re-writing the same value!
@@ -893,10 +1271,12 @@ void ReplicaProcess::write(const WriteRequest& request)
         response.set_okay(true);
         response.set_id(request.id());
         response.set_position(request.position());
-        reply(response);
+        return response;
       }
     }
   }
+
+  return Option<WriteResponse>::none();
 }
 
 
@@ -914,8 +1294,43 @@ void ReplicaProcess::learned(const Action& action)
 }
 
 
-void ReplicaProcess::learn(uint64_t position)
+void ReplicaProcess::learn(const LearnRequest& request)
 {
+  if (request.has_end()) {
+    LOG(INFO) << "Replica received learn request for positions "
+              << request.position() << " -> " << request.end();
+
+    LearnResponse response;
+    response.set_okay(true);
+
+    // Only include the positions we actually have.
+    uint64_t from = std::max(request.position(), begin);
+    uint64_t to = std::min(request.end(), end);
+
+    if (from <= to) {
+      process::Future<list<Action> > actions = read(from, to);
+
+      if (actions.isFailed()) {
+        LOG(ERROR) << "Error getting log records " << from << " -> " << to
+                   << ": " << actions.failure();
+        return;
+      }
+
+      CHECK(actions.isReady());
+
+      foreach (const Action& action, actions.get()) {
+        if (action.has_learned() && action.learned()) {
+          response.add_actions()->MergeFrom(action);
+        }
+      }
+    }
+
+    respond(response);
+    return;
+  }
+
+  uint64_t position = request.position();
+
   LOG(INFO) << "Replica received learn request for position " << position;
 
   Result<Action> result = read(position);
@@ -929,40 +1344,104 @@ void ReplicaProcess::learn(uint64_t position)
     LearnResponse response;
     response.set_okay(true);
     response.mutable_action()->MergeFrom(result.get());
-    reply(response);
+    respond(response);
   } else {
     LearnResponse response;
     response.set_okay(false);
-    reply(response);
+    respond(response);
   }
 }
 
 
+void ReplicaProcess::store(const Snapshot& snapshot)
+{
+  LOG(INFO) << "Replica received request to store snapshot at position "
+            << snapshot.position();
+
+  // Only keep the most recent snapshot.
+  if (snapshotted.isNone() || snapshotted.get() < snapshot.position()) {
+    if (!persist(snapshot)) {
+      return;
+    }
+  }
+
+  StoreSnapshotResponse response;
+  response.set_position(snapshotted.get());
+  respond(response);
+}
+
+
+void ReplicaProcess::fetch(const FetchSnapshotRequest& request)
+{
+  LOG(INFO) << "Replica received request for its snapshot";
+
+  FetchSnapshotResponse response;
+
+  process::Future<Option<Snapshot> > future = snapshot();
+
+  if (future.isFailed()) {
+    LOG(ERROR) << "Error getting snapshot: " << future.failure();
+    return;
+  }
+
+  CHECK(future.isReady());
+
+  if (future.get().isSome()) {
+    response.mutable_snapshot()->MergeFrom(future.get().get());
+  }
+
+  respond(response);
+}
+
+
+void ReplicaProcess::truncate(uint64_t to)
+{
+  // No longer consider truncated positions as holes (so that a
+  // coordinator doesn't try and fill them).
+  foreach (uint64_t position, utils::copy(holes)) {
+    if (position < to) {
+      holes.erase(position);
+    }
+  }
+
+  // No longer consider truncated positions as unlearned (so that a
+  // coordinator doesn't try and fill them).
+  foreach (uint64_t position, utils::copy(unlearned)) {
+    if (position < to) {
+      unlearned.erase(position);
+    }
+  }
+
+  // And update the beginning position.
+  begin = std::max(begin, to);
+}
+
+
 bool ReplicaProcess::persist(const Promise& promise)
 {
-  Try<Nothing> persisted = storage->persist(promise);
+  Record record;
+  record.set_type(Record::PROMISE);
+  record.mutable_promise()->MergeFrom(promise);
 
-  if (persisted.isError()) {
-    LOG(ERROR) << "Error writing to log: " << persisted.error();
+  if (!persist(record)) {
     return false;
   }
 
-  LOG(INFO) << "Persisted promise to " << promise.id();
-
   return true;
 }
 
 
 bool ReplicaProcess::persist(const Action& action)
 {
-  Try<Nothing> persisted = storage->persist(action);
+  Record record;
+  record.set_type(Record::ACTION);
+  record.mutable_action()->MergeFrom(action);
 
-  if (persisted.isError()) {
-    LOG(ERROR) << "Error writing to log: " << persisted.error();
+  if (!persist(record)) {
     return false;
   }
 
-  LOG(INFO) << "Persisted action at " << action.position();
+  actions[action.position()] = action;
 
   // No longer a hole here (if there even was one).
   holes.erase(action.position());
@@ -971,24 +1450,7 @@ bool ReplicaProcess::persist(const Action& action)
   if (action.has_learned() && action.learned()) {
     unlearned.erase(action.position());
     if (action.has_type() && action.type() == Action::TRUNCATE) {
-      // No longer consider truncated positions as holes (so that a
-      // coordinator doesn't try and fill them).
-      foreach (uint64_t position, utils::copy(holes)) {
-        if (position < action.truncate().to()) {
-          holes.erase(position);
-        }
-      }
-
-      // No longer consider truncated positions as unlearned (so that
-      // a coordinator doesn't try and fill them).
-      foreach (uint64_t position, utils::copy(unlearned)) {
-        if (position < action.truncate().to()) {
-          unlearned.erase(position);
-        }
-      }
-
-      // And update the beginning position.
-      begin = std::max(begin, action.truncate().to());
+      truncate(action.truncate().to());
     }
   }
 
@@ -1004,6 +1466,118 @@ bool ReplicaProcess::persist(const Action& action)
 }
 
 
+bool ReplicaProcess::persist(const Snapshot& snapshot)
+{
+  Record record;
+  record.set_type(Record::SNAPSHOT);
+  record.mutable_snapshot()->MergeFrom(snapshot);
+
+  if (!persist(record)) {
+    return false;
+  }
+
+  snapshotted = snapshot.position();
+
+  // The positions covered by the snapshot are no longer needed.
+  truncate(snapshot.position());
+
+  // A replica that was behind the snapshot skips straight past it
+  // (rather than considering the covered positions as holes).
+  if (snapshot.position() > 0) {
+    end = std::max(end, snapshot.position() - 1);
+  }
+
+  return true;
+}
+
+
+bool ReplicaProcess::persist(const Record& record)
+{
+  if (!record.IsInitialized()) {
+    LOG(ERROR) << "Error writing to log: record is missing "
+               << record.InitializationErrorString();
+    return false;
+  }
+
+  // Flush once we're done processing the requests that are already
+  // queued so that these get written together (i.e., group commit).
+  if (records.empty()) {
+    dispatch(self(), &ReplicaProcess::flush);
+  }
+
+  records.push_back(record);
+  size += record.ByteSize();
+
+  if (size >= MAX_BATCH_BYTES) {
+    flush();
+  }
+
+  return true;
+}
+
+
+void ReplicaProcess::flush()
+{
+  if (records.empty()) {
+    return;
+  }
+
+  Stopwatch stopwatch;
+  stopwatch.start();
+
+  // NOTE: We've already updated our in-memory state based on these
+  // records (and might have made decisions based on it) so we can't
+  // continue if they failed to get written. This is safe because
+  // nobody has been told about these records yet.
+  Try<Nothing> persisted = storage->persist(records);
+  CHECK_SOME(persisted) << "Error writing to log";
+
+  batches.add(records.size());
+  latencies.add(stopwatch.elapsed().us());
+
+  LOG(INFO) << "Persisted " << records.size() << " record(s) in "
+            << stopwatch.elapsed();
+
+  records.clear();
+  size = 0;
+  actions.clear();
+
+  foreach (const Response& response, responses) {
+    send(response.to,
+         response.name,
+         response.data.data(),
+         response.data.size());
+  }
+
+  responses.clear();
+}
+
+
+void ReplicaProcess::respond(const google::protobuf::Message& message)
+{
+  if (records.empty()) {
+    reply(message);
+    return;
+  }
+
+  CHECK(from) << "Attempting to reply without a sender";
+
+  string data;
+  message.SerializeToString(&data);
+  responses.push_back(Response(from, message.GetTypeName(), data));
+}
+
+
+Future<process::http::Response> ReplicaProcess::stats(
+    const process::http::Request& request)
+{
+  JSON::Object object;
+  object.values["batches"] = batches.model();
+  object.values["latencies"] = latencies.model();
+  return process::http::OK(object, request.query.get("jsonp"));
+}
+
+
 void ReplicaProcess::recover(const string& path)
 {
   Try<State> state = storage->recover(path);
@@ -1015,6 +1589,12 @@ void ReplicaProcess::recover(const string& path)
   begin = state.get().begin;
   end = state.get().end;
   unlearned = state.get().unlearned;
+  snapshotted = state.get().snapshot;
+
+  // See ReplicaProcess::persist(const Snapshot&).
+  if (begin > 0) {
+    end = std::max(end, begin - 1);
+  }
 
   // Only use the learned positions to help determine the holes.
   const std::set<uint64_t>& learned = state.get().learned;
@@ -1037,7 +1617,10 @@ void ReplicaProcess::recover(const string& path)
   LOG(INFO) << "Replica recovered with log positions "
             << begin << " -> " << end
             << " and holes " << stringify(holes)
-            << " and unlearned " << stringify(unlearned);
+            << " and unlearned " << stringify(unlearned)
+            << (snapshotted.isSome()
+                ? " from snapshot at " + stringify(snapshotted.get())
+                : "");
 }
 
 
@@ -1088,6 +1671,12 @@ process::Future<uint64_t> Replica::promised()
 }
 
 
+process::Future<Option<Snapshot> > Replica::snapshot()
+{
+  return process::dispatch(process, &ReplicaProcess::snapshot);
+}
+
+
 process::PID<ReplicaProcess> Replica::pid()
 {
   return process->self();
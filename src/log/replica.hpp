@@ -26,6 +26,7 @@
 #include <process/process.hpp>
 #include <process/protobuf.hpp>
 
+#include <stout/option.hpp>
 #include <stout/result.hpp>
 #include <stout/try.hpp>
 
@@ -40,7 +41,10 @@ namespace protocol {
 // Some replica protocol declarations.
 extern Protocol<PromiseRequest, PromiseResponse> promise;
 extern Protocol<WriteRequest, WriteResponse> write;
+extern Protocol<BatchWriteRequest, BatchWriteResponse> batch;
 extern Protocol<LearnRequest, LearnResponse> learn;
+extern Protocol<StoreSnapshotRequest, StoreSnapshotResponse> store;
+extern Protocol<FetchSnapshotRequest, FetchSnapshotResponse> fetch;
 
 } // namespace protocol {
 
@@ -58,7 +62,8 @@ public:
   ~Replica();
 
   // Returns all the actions between the specified positions, unless
-  // those positions are invalid, in which case returns an error.
+  // those positions are invalid, in which case returns an error. The
+  // returned actions have all been written to storage.
   process::Future<std::list<Action> > read(uint64_t from, uint64_t to);
 
   // Returns missing positions in the log (i.e., unlearned or holes)
@@ -74,6 +79,9 @@ public:
   // Returns the highest implicit promise this replica has given.
   process::Future<uint64_t> promised();
 
+  // Returns the snapshot stored by this replica (if any).
+  process::Future<Option<Snapshot> > snapshot();
+
   // Returns the PID associated with this replica.
   process::PID<ReplicaProcess> pid();
 
@@ -702,7 +702,8 @@ HierarchicalAllocatorProcess<UserSorter, FrameworkSorter>::allocate(
         sorters[user]->allocated(frameworkIdValue, allocatedResources);
         userSorter->allocated(user, allocatedResources);
 
-        dispatch(master, &Master::offer, frameworkId, offerable);
+        dispatch(master, &Master::offer,
+                 frameworkId, offerable, Clock::now());
       }
     }
   }
@@ -154,6 +154,11 @@ JSON::Object model(const Framework& framework)
   object.values["unregistered_time"] = framework.unregisteredTime;
   object.values["active"] = framework.active;
   object.values["resources"] = model(framework.resources);
+  object.values["offers_outstanding"] = framework.offers.size();
+  object.values["relayed_framework_messages"] = framework.relayedMessages;
+  object.values["average_decline_time"] = framework.declinedOffers > 0
+    ? framework.declineTime / framework.declinedOffers
+    : 0.0;
 
   // TODO(benh): Consider making reregisteredTime an Option.
   if (framework.registeredTime != framework.reregisteredTime) {
@@ -274,6 +279,8 @@ Future<Response> stats(
   object.values["lost_tasks"] = master.stats.tasks[TASK_LOST];
   object.values["valid_status_updates"] = master.stats.validStatusUpdates;
   object.values["invalid_status_updates"] = master.stats.invalidStatusUpdates;
+  object.values["relayed_framework_messages"] =
+    master.stats.relayedFrameworkMessages;
 
   // Get total and used (note, not offered) resources in order to
   // compute capacity of scalar resources.
@@ -349,6 +349,7 @@ void Master::initialize()
   stats.invalidStatusUpdates = 0;
   stats.validFrameworkMessages = 0;
   stats.invalidFrameworkMessages = 0;
+  stats.relayedFrameworkMessages = 0;
 
   startTime = Clock::now();
 
@@ -393,6 +394,12 @@ void Master::initialize()
       &LaunchTasksMessage::tasks,
       &LaunchTasksMessage::filters);
 
+  install<BatchLaunchTasksMessage>(
+      &Master::batchLaunchTasks,
+      &BatchLaunchTasksMessage::framework_id,
+      &BatchLaunchTasksMessage::launches,
+      &BatchLaunchTasksMessage::filters);
+
   install<ReviveOffersMessage>(
       &Master::reviveOffers,
       &ReviveOffersMessage::framework_id);
@@ -429,6 +436,11 @@ void Master::initialize()
       &StatusUpdateMessage::update,
       &StatusUpdateMessage::pid);
 
+  install<StatusUpdatesMessage>(
+      &Master::statusUpdates,
+      &StatusUpdatesMessage::updates,
+      &StatusUpdatesMessage::pid);
+
   install<ExecutorToFrameworkMessage>(
       &Master::executorMessage,
       &ExecutorToFrameworkMessage::slave_id,
@@ -765,10 +777,11 @@ void Master::resourceRequest(const FrameworkID& frameworkId,
 }
 
 
-void Master::launchTasks(const FrameworkID& frameworkId,
-                         const OfferID& offerId,
-                         const vector<TaskInfo>& tasks,
-                         const Filters& filters)
+void Master::launchTasks(
+    const FrameworkID& frameworkId,
+    const OfferID& offerId,
+    const google::protobuf::RepeatedPtrField<TaskInfo>& tasks,
+    const Filters& filters)
 {
   Framework* framework = getFramework(frameworkId);
   if (framework != NULL) {
@@ -782,6 +795,9 @@ void Master::launchTasks(const FrameworkID& frameworkId,
       CHECK(offer->framework_id() == frameworkId);
       Slave* slave = getSlave(offer->slave_id());
       CHECK(slave != NULL) << "An offer should not outlive a slave!";
+      if (tasks.size() == 0) {
+        framework->declineOffer(offer, Clock::now());
+      }
       processTasks(offer, framework, slave, tasks, filters);
     } else {
       // The offer is gone (possibly rescinded, lost slave, re-reply
@@ -790,22 +806,30 @@ void Master::launchTasks(const FrameworkID& frameworkId,
       // situations like these.
       LOG(WARNING) << "Offer " << offerId << " is no longer valid";
       foreach (const TaskInfo& task, tasks) {
-        StatusUpdateMessage message;
-        StatusUpdate* update = message.mutable_update();
-        update->mutable_framework_id()->MergeFrom(frameworkId);
-        TaskStatus* status = update->mutable_status();
-        status->mutable_task_id()->MergeFrom(task.task_id());
-        status->set_state(TASK_LOST);
-        status->set_message("Task launched with invalid offer");
-        update->set_timestamp(Clock::now());
-        update->set_uuid(UUID::random().toBytes());
-        send(framework->pid, message);
+        sendTaskLost(framework, task.task_id(),
+                     "Task launched with invalid offer");
       }
     }
   }
 }
 
 
+void Master::batchLaunchTasks(
+    const FrameworkID& frameworkId,
+    const google::protobuf::RepeatedPtrField<
+        BatchLaunchTasksMessage::Launch>& launches,
+    const Filters& filters)
+{
+  Framework* framework = getFramework(frameworkId);
+  if (framework != NULL) {
+    LOG(INFO) << "Launching tasks using " << launches.size()
+              << " offers for framework " << frameworkId;
+
+    processTasks(framework, launches, filters);
+  }
+}
+
+
 void Master::reviveOffers(const FrameworkID& frameworkId)
 {
   Framework* framework = getFramework(frameworkId);
@@ -848,16 +872,7 @@ void Master::killTask(const FrameworkID& frameworkId,
       LOG(WARNING) << "Cannot kill task " << taskId
                    << " of framework " << frameworkId
                    << " because it cannot be found";
-      StatusUpdateMessage message;
-      StatusUpdate* update = message.mutable_update();
-      update->mutable_framework_id()->MergeFrom(frameworkId);
-      TaskStatus* status = update->mutable_status();
-      status->mutable_task_id()->MergeFrom(taskId);
-      status->set_state(TASK_LOST);
-      status->set_message("Task not found");
-      update->set_timestamp(Clock::now());
-      update->set_uuid(UUID::random().toBytes());
-      send(framework->pid, message);
+      sendTaskLost(framework, taskId, "Task not found");
     }
   }
 }
@@ -883,7 +898,12 @@ void Master::schedulerMessage(const SlaveID& slaveId,
       message.set_data(data);
       send(slave->pid, message);
 
+      // Schedulers normally send framework messages directly to the
+      // slaves, so count those that we have to relay.
+      framework->relayedMessages++;
+
       stats.validFrameworkMessages++;
+      stats.relayedFrameworkMessages++;
     } else {
       LOG(WARNING) << "Cannot send framework message for framework "
                    << frameworkId << " to slave " << slaveId
@@ -1029,7 +1049,7 @@ void Master::statusUpdate(const StatusUpdate& update, const UPID& pid)
     Framework* framework = getFramework(update.framework_id());
     if (framework != NULL) {
       // Pass on the (transformed) status update to the framework.
-      StatusUpdateMessage message;
+      StatusUpdateMessage& message = reuse<StatusUpdateMessage>();
       message.mutable_update()->MergeFrom(update);
       message.set_pid(pid);
       send(framework->pid, message);
@@ -1071,6 +1091,19 @@ void Master::statusUpdate(const StatusUpdate& update, const UPID& pid)
 }
 
 
+void Master::statusUpdates(
+    const google::protobuf::RepeatedPtrField<StatusUpdate>& updates,
+    const UPID& pid)
+{
+  LOG(INFO) << "Received " << updates.size()
+            << " status updates from " << from;
+
+  foreach (const StatusUpdate& update, updates) {
+    statusUpdate(update, pid);
+  }
+}
+
+
 void Master::executorMessage(const SlaveID& slaveId,
                              const FrameworkID& frameworkId,
                              const ExecutorID& executorId,
@@ -1199,7 +1232,8 @@ void Master::frameworkFailoverTimeout(const FrameworkID& frameworkId,
 
 
 void Master::offer(const FrameworkID& frameworkId,
-                   const hashmap<SlaveID, Resources>& resources)
+                   const hashmap<SlaveID, Resources>& resources,
+                   double allocated)
 {
   if (!frameworks.contains(frameworkId) || !frameworks[frameworkId]->active) {
     LOG(WARNING) << "Master returning resources offered to framework "
@@ -1212,8 +1246,9 @@ void Master::offer(const FrameworkID& frameworkId,
     return;
   }
 
-  // Create an offer for each slave and add it to the message.
-  ResourceOffersMessage message;
+  // Create an offer for each slave and add it to the message (which
+  // we reuse since offers are sent frequently).
+  ResourceOffersMessage& message = reuse<ResourceOffersMessage>();
 
   Framework* framework = frameworks[frameworkId];
   foreachpair (const SlaveID& slaveId, const Resources& offered, resources) {
@@ -1247,7 +1282,7 @@ void Master::offer(const FrameworkID& frameworkId,
 
     offers[offer->id()] = offer;
 
-    framework->addOffer(offer);
+    framework->addOffer(offer, Clock::now());
     slave->addOffer(offer);
 
     // Add the offer *AND* the corresponding slave's PID.
@@ -1262,6 +1297,9 @@ void Master::offer(const FrameworkID& frameworkId,
   LOG(INFO) << "Sending " << message.offers().size()
             << " offers to framework " << framework->id;
 
+  message.set_allocated(allocated);
+  message.set_sent(Clock::now());
+
   send(framework->pid, message);
 }
 
@@ -1454,26 +1492,145 @@ struct ExecutorInfoChecker : TaskInfoVisitor
 // Process a resource offer reply (for a non-cancelled offer) by
 // launching the desired tasks (if the offer contains a valid set of
 // tasks) and reporting used resources to the allocator.
-void Master::processTasks(Offer* offer,
-                          Framework* framework,
-                          Slave* slave,
-                          const vector<TaskInfo>& tasks,
-                          const Filters& filters)
+void Master::processTasks(
+    Offer* offer,
+    Framework* framework,
+    Slave* slave,
+    const google::protobuf::RepeatedPtrField<TaskInfo>& tasks,
+    const Filters& filters)
 {
   LOG(INFO) << "Processing reply for offer " << offer->id()
             << " on slave " << slave->id
             << " (" << slave->info.hostname() << ")"
             << " for framework " << framework->id;
 
-  Resources usedResources; // Accumulated resources used from this offer.
+  // Create task visitors (see launchValidTasks for resource usage).
+  list<TaskInfoVisitor*> visitors;
+  visitors.push_back(new SlaveIDChecker());
+  visitors.push_back(new UniqueTaskIDChecker());
+  visitors.push_back(new ExecutorInfoChecker());
+
+  // Accumulated resources used from this offer.
+  Resources usedResources =
+    launchValidTasks(offer, framework, slave, tasks, visitors);
 
-  // Create task visitors.
+  // Cleanup visitors.
+  do {
+    TaskInfoVisitor* visitor = visitors.front();
+    visitors.pop_front();
+    delete visitor;
+  } while (!visitors.empty());
+
+  // Calculate unused resources.
+  Resources unusedResources = offer->resources() - usedResources;
+
+  if (unusedResources.allocatable().size() > 0) {
+    // Tell the allocator about the unused (e.g., refused) resources.
+    allocator->resourcesUnused(offer->framework_id(),
+                               offer->slave_id(),
+                               unusedResources,
+                               filters);
+  }
+
+  removeOffer(offer);
+}
+
+
+// Process the replies for a batch of offers. Each launch is handled
+// like Master::launchTasks handles a single offer, except that the
+// task visitors are shared by the whole batch (so, e.g., task IDs
+// must be unique across all of the offers), a launch using an offer
+// that is no longer valid only fails the tasks in that launch, and
+// the unused resources are reported to the allocator once per slave
+// rather than once per offer.
+void Master::processTasks(
+    Framework* framework,
+    const google::protobuf::RepeatedPtrField<
+        BatchLaunchTasksMessage::Launch>& launches,
+    const Filters& filters)
+{
+  // Create task visitors (see launchValidTasks for resource usage).
   list<TaskInfoVisitor*> visitors;
   visitors.push_back(new SlaveIDChecker());
   visitors.push_back(new UniqueTaskIDChecker());
-  visitors.push_back(new ResourceUsageChecker());
   visitors.push_back(new ExecutorInfoChecker());
 
+  // Resources left unused on each slave.
+  hashmap<SlaveID, Resources> unused;
+
+  foreach (const BatchLaunchTasksMessage::Launch& launch, launches) {
+    // NOTE: Looking up the offer here (rather than up front) also
+    // takes care of an offer that is used more than once in the
+    // batch, since it has been removed by the time it's used again.
+    Offer* offer = getOffer(launch.offer_id());
+
+    Option<string> invalid;
+    if (offer == NULL) {
+      invalid = Option<string>::some("Task launched with invalid offer");
+    } else if (!(offer->framework_id() == framework->id)) {
+      invalid = Option<string>::some(
+          "Task launched with offer for another framework");
+    }
+
+    if (invalid.isSome()) {
+      LOG(WARNING) << "Offer " << launch.offer_id() << " is not valid for "
+                   << "framework " << framework->id;
+      foreach (const TaskInfo& task, launch.tasks()) {
+        sendTaskLost(framework, task.task_id(), invalid.get());
+      }
+      continue;
+    }
+
+    Slave* slave = getSlave(offer->slave_id());
+    CHECK(slave != NULL) << "An offer should not outlive a slave!";
+
+    LOG(INFO) << "Processing reply for offer " << offer->id()
+              << " on slave " << slave->id
+              << " (" << slave->info.hostname() << ")"
+              << " for framework " << framework->id;
+
+    if (launch.tasks().size() == 0) {
+      framework->declineOffer(offer, Clock::now());
+    }
+
+    // Accumulated resources used from this offer.
+    Resources usedResources =
+      launchValidTasks(offer, framework, slave, launch.tasks(), visitors);
+
+    unused[slave->id] += offer->resources() - usedResources;
+
+    removeOffer(offer);
+  }
+
+  // Cleanup visitors.
+  do {
+    TaskInfoVisitor* visitor = visitors.front();
+    visitors.pop_front();
+    delete visitor;
+  } while (!visitors.empty());
+
+  // Tell the allocator about the unused (e.g., refused) resources.
+  foreachpair (const SlaveID& slaveId, const Resources& resources, unused) {
+    if (resources.allocatable().size() > 0) {
+      allocator->resourcesUnused(framework->id, slaveId, resources, filters);
+    }
+  }
+}
+
+Resources Master::launchValidTasks(
+    Offer* offer,
+    Framework* framework,
+    Slave* slave,
+    const google::protobuf::RepeatedPtrField<TaskInfo>& tasks,
+    const list<TaskInfoVisitor*>& visitors)
+{
+  // Resource usage is relative to this offer (unlike, e.g., the
+  // uniqueness of task IDs which the caller might check across
+  // offers) so it gets checked separately.
+  ResourceUsageChecker usage;
+
+  Resources usedResources; // Accumulated resources used from this offer.
+
   // Loop through each task and check it's validity.
   foreach (const TaskInfo& task, tasks) {
     // Possible error found while checking task's validity.
@@ -1487,6 +1644,10 @@ void Master::processTasks(Offer* offer,
       }
     }
 
+    if (error.isNone()) {
+      error = usage(task, offer, framework, slave);
+    }
+
     if (error.isNone()) {
       // Task looks good, get it running!
       usedResources += launchTask(task, framework, slave);
@@ -1494,41 +1655,32 @@ void Master::processTasks(Offer* offer,
       // Error validating task, send a failed status update.
       LOG(WARNING) << "Error validating task " << task.task_id()
                    << " : " << error.get();
-      StatusUpdateMessage message;
-      StatusUpdate* update = message.mutable_update();
-      update->mutable_framework_id()->MergeFrom(framework->id);
-      TaskStatus* status = update->mutable_status();
-      status->mutable_task_id()->MergeFrom(task.task_id());
-      status->set_state(TASK_LOST);
-      status->set_message(error.get());
-      update->set_timestamp(Clock::now());
-      update->set_uuid(UUID::random().toBytes());
-      send(framework->pid, message);
+      sendTaskLost(framework, task.task_id(), error.get());
     }
   }
 
-  // Cleanup visitors.
-  do {
-    TaskInfoVisitor* visitor = visitors.front();
-    visitors.pop_front();
-    delete visitor;
-  } while (!visitors.empty());
-
   // All used resources should be allocatable, enforced by our validators.
   CHECK(usedResources == usedResources.allocatable());
 
-  // Calculate unused resources.
-  Resources unusedResources = offer->resources() - usedResources;
+  return usedResources;
+}
 
-  if (unusedResources.allocatable().size() > 0) {
-    // Tell the allocator about the unused (e.g., refused) resources.
-    allocator->resourcesUnused(offer->framework_id(),
-                               offer->slave_id(),
-                               unusedResources,
-                               filters);
-  }
 
-  removeOffer(offer);
+void Master::sendTaskLost(
+    Framework* framework,
+    const TaskID& taskId,
+    const string& reason)
+{
+  StatusUpdateMessage message;
+  StatusUpdate* update = message.mutable_update();
+  update->mutable_framework_id()->MergeFrom(framework->id);
+  TaskStatus* status = update->mutable_status();
+  status->mutable_task_id()->MergeFrom(taskId);
+  status->set_state(TASK_LOST);
+  status->set_message(reason);
+  update->set_timestamp(Clock::now());
+  update->set_uuid(UUID::random().toBytes());
+  send(framework->pid, message);
 }
 
 
@@ -1582,7 +1734,7 @@ Resources Master::launchTask(const TaskInfo& task,
             << " with resources " << task.resources() << " on slave "
             << slave->id << " (" << slave->info.hostname() << ")";
 
-  RunTaskMessage message;
+  RunTaskMessage& message = reuse<RunTaskMessage>();
   message.mutable_framework()->MergeFrom(framework->info);
   message.mutable_framework_id()->MergeFrom(framework->id);
   message.set_pid(framework->pid);
@@ -68,6 +68,7 @@ class WhitelistWatcher;
 
 struct Framework;
 struct Slave;
+struct TaskInfoVisitor;
 
 
 class Master : public ProtobufProcess<Master>
@@ -93,8 +94,13 @@ public:
                        const std::vector<Request>& requests);
   void launchTasks(const FrameworkID& frameworkId,
                    const OfferID& offerId,
-                   const std::vector<TaskInfo>& tasks,
+                   const google::protobuf::RepeatedPtrField<TaskInfo>& tasks,
                    const Filters& filters);
+  void batchLaunchTasks(
+      const FrameworkID& frameworkId,
+      const google::protobuf::RepeatedPtrField<
+          BatchLaunchTasksMessage::Launch>& launches,
+      const Filters& filters);
   void reviveOffers(const FrameworkID& frameworkId);
   void killTask(const FrameworkID& frameworkId, const TaskID& taskId);
   void schedulerMessage(const SlaveID& slaveId,
@@ -108,6 +114,9 @@ public:
                        const std::vector<Task>& tasks);
   void unregisterSlave(const SlaveID& slaveId);
   void statusUpdate(const StatusUpdate& update, const UPID& pid);
+  void statusUpdates(
+      const google::protobuf::RepeatedPtrField<StatusUpdate>& updates,
+      const UPID& pid);
   void executorMessage(const SlaveID& slaveId,
                        const FrameworkID& frameworkId,
                        const ExecutorID& executorId,
@@ -122,7 +131,8 @@ public:
                                 double reregisteredTime);
 
   void offer(const FrameworkID& framework,
-             const hashmap<SlaveID, Resources>& resources);
+             const hashmap<SlaveID, Resources>& resources,
+             double allocated);
 
 protected:
   virtual void initialize();
@@ -140,9 +150,33 @@ protected:
   void processTasks(Offer* offer,
                     Framework* framework,
                     Slave* slave,
-                    const std::vector<TaskInfo>& tasks,
+                    const google::protobuf::RepeatedPtrField<TaskInfo>& tasks,
                     const Filters& filters);
 
+  // Process the launch tasks requests for a batch of offers in a
+  // single pass, failing only the tasks of a launch whose offer is
+  // no longer valid.
+  void processTasks(Framework* framework,
+                    const google::protobuf::RepeatedPtrField<
+                        BatchLaunchTasksMessage::Launch>& launches,
+                    const Filters& filters);
+
+  // Validates each of the tasks against the offer (using the visitors
+  // and a check of the resources used from the offer so far), then
+  // launches the valid tasks and reports the others as lost. Returns
+  // the resources used from the offer.
+  Resources launchValidTasks(
+      Offer* offer,
+      Framework* framework,
+      Slave* slave,
+      const google::protobuf::RepeatedPtrField<TaskInfo>& tasks,
+      const std::list<TaskInfoVisitor*>& visitors);
+
+  // Sends a TASK_LOST status update for the task to the framework.
+  void sendTaskLost(Framework* framework,
+                    const TaskID& taskId,
+                    const std::string& reason);
+
   // Add a framework.
   void addFramework(Framework* framework);
 
@@ -242,6 +276,7 @@ private:
     uint64_t invalidStatusUpdates;
     uint64_t validFrameworkMessages;
     uint64_t invalidFrameworkMessages;
+    uint64_t relayedFrameworkMessages; // From schedulers to executors.
   } stats;
 
   double startTime; // Start time used to calculate uptime.
@@ -391,7 +426,10 @@ struct Framework
       active(true),
       registeredTime(time),
       reregisteredTime(time),
-      completedTasks(MAX_COMPLETED_TASKS_PER_FRAMEWORK) {}
+      completedTasks(MAX_COMPLETED_TASKS_PER_FRAMEWORK),
+      relayedMessages(0),
+      declinedOffers(0),
+      declineTime(0.0) {}
 
   ~Framework() {}
 
@@ -420,10 +458,11 @@ struct Framework
     resources -= task->resources();
   }
 
-  void addOffer(Offer* offer)
+  void addOffer(Offer* offer, double time)
   {
     CHECK(!offers.contains(offer));
     offers.insert(offer);
+    offeredTimes[offer->id()] = time;
     resources += offer->resources();
   }
 
@@ -431,9 +470,19 @@ struct Framework
   {
     CHECK(offers.find(offer) != offers.end());
     offers.erase(offer);
+    offeredTimes.erase(offer->id());
     resources -= offer->resources();
   }
 
+  // Accounts for an offer being declined (i.e., used to launch no
+  // tasks) at the specified time.
+  void declineOffer(Offer* offer, double time)
+  {
+    CHECK(offeredTimes.contains(offer->id()));
+    declinedOffers++;
+    declineTime += time - offeredTimes[offer->id()];
+  }
+
   bool hasExecutor(const SlaveID& slaveId,
                    const ExecutorID& executorId)
   {
@@ -482,6 +531,13 @@ struct Framework
 
   hashset<Offer*> offers; // Active offers for framework.
 
+  hashmap<OfferID, double> offeredTimes; // When active offers were made.
+
+  uint64_t relayedMessages; // Framework messages sent via the master.
+
+  uint64_t declinedOffers; // Number of offers declined.
+  double declineTime; // Total time it took to decline those offers.
+
   Resources resources; // Total resources (tasks + offers + executors).
 
   hashmap<SlaveID, hashmap<ExecutorID, ExecutorInfo> > executors;
@@ -56,6 +56,62 @@ using std::map;
 PyObject* mesos::python::mesos_pb2 = NULL;
 
 
+PyObject* mesos::python::createLazyPythonProtobufs(
+    const string& data,
+    const vector<size_t>& offsets,
+    const char* typeName)
+{
+  PyObject* type = PyDict_GetItemString(PyModule_GetDict(mesos_pb2), typeName);
+  if (type == NULL) {
+    PyErr_Format(PyExc_Exception, "Could not resolve mesos_pb2.%s", typeName);
+    return NULL;
+  }
+
+  // NOTE: The public mesos module has already been imported (it's
+  // what imports us) so this is just a lookup in sys.modules.
+  PyObject* mesos = PyImport_ImportModule("mesos");
+  if (mesos == NULL) {
+    return NULL;
+  }
+
+  PyObject* lazy = PyObject_GetAttrString(mesos, "_LazyProtobufList");
+  Py_DECREF(mesos);
+  if (lazy == NULL) {
+    return NULL;
+  }
+
+  PyObject* str = NULL;
+  PyObject* ends = NULL;
+  PyObject* list = NULL;
+
+  str = PyString_FromStringAndSize(data.data(), data.size());
+  if (str == NULL) {
+    goto cleanup;
+  }
+
+  ends = PyTuple_New(offsets.size());
+  if (ends == NULL) {
+    goto cleanup;
+  }
+
+  for (size_t i = 0; i < offsets.size(); i++) {
+    PyObject* end = PyInt_FromSsize_t(offsets[i]);
+    if (end == NULL) {
+      goto cleanup;
+    }
+    PyTuple_SET_ITEM(ends, i, end); // Steals the reference to end.
+  }
+
+  list = PyObject_CallFunction(lazy, (char*) "OOO", type, str, ends);
+
+cleanup:
+  Py_DECREF(lazy);
+  Py_XDECREF(str);
+  Py_XDECREF(ends);
+  return list;
+}
+
+
 namespace {
 
 /**
@@ -22,6 +22,8 @@
 #include <Python.h>
 
 #include <iostream>
+#include <string>
+#include <vector>
 
 #include <google/protobuf/io/zero_copy_stream_impl.h>
 
@@ -130,6 +132,48 @@ PyObject* createPythonProtobuf(const T& t, const char* typeName)
                              str.size());
 }
 
+
+/**
+ * Serialize a batch of C++ protocol buffers into a single string,
+ * recording the offset at which each one ends in 'offsets'. This does
+ * not touch any Python objects so it should be done _before_
+ * acquiring the global interpreter lock.
+ */
+template <typename T>
+void serializeProtobufs(const std::vector<T>& ts,
+                        std::string* data,
+                        std::vector<size_t>* offsets)
+{
+  size_t size = 0;
+  for (size_t i = 0; i < ts.size(); i++) {
+    size += ts[i].ByteSize();
+  }
+
+  data->resize(size);
+  offsets->reserve(ts.size());
+
+  google::protobuf::uint8* start = (google::protobuf::uint8*) &(*data)[0];
+  google::protobuf::uint8* target = start;
+  for (size_t i = 0; i < ts.size(); i++) {
+    target = ts[i].SerializeWithCachedSizesToArray(target);
+    offsets->push_back(target - start);
+  }
+}
+
+
+/**
+ * Create a list of lazily parsed protocol buffers (a
+ * mesos._LazyProtobufList) of the given type from a batch serialized
+ * with serializeProtobufs. All of the protocol buffers share one
+ * Python string and each gets parsed into a real message the first
+ * time it's accessed. Must be called with the global interpreter lock
+ * held. Returns the list on success or raises a Python exception and
+ * returns NULL on failure.
+ */
+PyObject* createLazyPythonProtobufs(const std::string& data,
+                                    const std::vector<size_t>& offsets,
+                                    const char* typeName);
+
 }} /* namespace mesos { namespace python { */
 
 #endif /* MODULE_HPP */
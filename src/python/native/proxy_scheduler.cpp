@@ -135,21 +135,20 @@ cleanup:
 void ProxyScheduler::resourceOffers(SchedulerDriver* driver,
                                     const vector<Offer>& offers)
 {
+  // Serialize the offers before acquiring the interpreter lock so
+  // that other Python threads can keep running while we do so.
+  string data;
+  vector<size_t> offsets;
+  serializeProtobufs(offers, &data, &offsets);
+
   InterpreterLock lock;
 
   PyObject* list = NULL;
   PyObject* res = NULL;
 
-  list = PyList_New(offers.size());
+  list = createLazyPythonProtobufs(data, offsets, "Offer");
   if (list == NULL) {
-    goto cleanup;
-  }
-  for (size_t i = 0; i < offers.size(); i++) {
-    PyObject* offer = createPythonProtobuf(offers[i], "Offer");
-    if (offer == NULL) {
-      goto cleanup;
-    }
-    PyList_SetItem(list, i, offer); // Steals the reference to offer
+    goto cleanup; // createLazyPythonProtobufs will have set an exception
   }
 
   res = PyObject_CallMethod(impl->pythonScheduler,
@@ -239,6 +238,56 @@ cleanup:
 }
 
 
+void ProxyScheduler::statusUpdates(SchedulerDriver* driver,
+                                   const vector<TaskStatus>& statuses)
+{
+  // See the comment in ProxyScheduler::resourceOffers.
+  string data;
+  vector<size_t> offsets;
+  serializeProtobufs(statuses, &data, &offsets);
+
+  InterpreterLock lock;
+
+  PyObject* list = NULL;
+  PyObject* status = NULL;
+  PyObject* res = NULL;
+
+  list = createLazyPythonProtobufs(data, offsets, "TaskStatus");
+  if (list == NULL) {
+    goto cleanup; // createLazyPythonProtobufs will have set an exception
+  }
+
+  for (size_t i = 0; i < statuses.size(); i++) {
+    status = PySequence_GetItem(list, i); // Parses the status.
+    if (status == NULL) {
+      goto cleanup;
+    }
+    res = PyObject_CallMethod(impl->pythonScheduler,
+                              (char*) "statusUpdate",
+                              (char*) "OO",
+                              impl,
+                              status);
+    if (res == NULL) {
+      cerr << "Failed to call scheduler's statusUpdate" << endl;
+      goto cleanup;
+    }
+    Py_DECREF(status);
+    status = NULL;
+    Py_DECREF(res);
+    res = NULL;
+  }
+
+cleanup:
+  if (PyErr_Occurred()) {
+    PyErr_Print();
+    driver->abort();
+  }
+  Py_XDECREF(list);
+  Py_XDECREF(status);
+  Py_XDECREF(res);
+}
+
+
 void ProxyScheduler::frameworkMessage(SchedulerDriver* driver,
                                       const ExecutorID& executorId,
                                       const SlaveID& slaveId,
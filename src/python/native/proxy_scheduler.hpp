@@ -51,6 +51,8 @@ public:
                               const std::vector<Offer>& offers);
   virtual void offerRescinded(SchedulerDriver* driver, const OfferID& offerId);
   virtual void statusUpdate(SchedulerDriver* driver, const TaskStatus& status);
+  virtual void statusUpdates(SchedulerDriver* driver,
+                             const std::vector<TaskStatus>& statuses);
   virtual void frameworkMessage(SchedulerDriver* driver,
                                 const ExecutorID& executorId,
                                 const SlaveID& slaveId,
@@ -96,3 +96,62 @@ MesosSchedulerDriver = _mesos.MesosSchedulerDriverImpl
 # class inherit from ExecutorDriver somehow, but this complicates the C++
 # code, and there seems to be no point in doing it in a dynamic language.
 MesosExecutorDriver = _mesos.MesosExecutorDriverImpl
+
+
+# A (read only) list of protobufs that have been serialized by the
+# native code as one batch (e.g., all of the offers passed to a single
+# resourceOffers callback), where 'offsets' are the end offsets of
+# each protobuf in 'data'. Each protobuf gets parsed into a real
+# message (of the given type) the first time it's accessed, so the
+# (pure Python) parsing cost is never paid for protobufs that a
+# framework doesn't look at.
+class _LazyProtobufList(object):
+  def __init__(self, type, data, offsets):
+    self._type = type
+    self._data = data
+    self._offsets = offsets
+    self._messages = [None] * len(offsets)
+    self._unparsed = len(offsets)
+
+  def __len__(self):
+    return len(self._messages)
+
+  def __getitem__(self, index):
+    if isinstance(index, slice):
+      return [self[i] for i in xrange(*index.indices(len(self)))]
+
+    if index < 0:
+      index += len(self)
+
+    if index < 0 or index >= len(self):
+      raise IndexError("list index out of range")
+
+    message = self._messages[index]
+    if message is None:
+      start = self._offsets[index - 1] if index > 0 else 0
+      end = self._offsets[index]
+      message = self._type.FromString(self._data[start:end])
+      self._messages[index] = message
+      self._unparsed -= 1
+      if self._unparsed == 0:
+        self._data = None # Don't keep the entire batch alive.
+
+    return message
+
+  def __iter__(self):
+    for i in xrange(len(self)):
+      yield self[i]
+
+  def __eq__(self, other):
+    if isinstance(other, (list, tuple, _LazyProtobufList)):
+      return list(self) == list(other)
+    return False
+
+  def __ne__(self, other):
+    return not self == other
+
+  def __str__(self):
+    return str(list(self))
+
+  def __repr__(self):
+    return repr(list(self))
@@ -0,0 +1,338 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+
+#include <stout/foreach.hpp>
+#include <stout/hashset.hpp>
+
+#include "common/lock.hpp"
+
+#include "sched/offer_pool.hpp"
+
+using std::multimap;
+using std::string;
+using std::vector;
+
+namespace mesos {
+namespace internal {
+
+// Returns the resources needed to launch the task, which includes
+// the resources of its executor unless the executor was already
+// placed into the same offer (as recorded in 'executors').
+static Resources required(
+    const TaskInfo& task,
+    hashset<ExecutorID>* executors)
+{
+  Resources resources = task.resources();
+
+  if (task.has_executor() &&
+      !executors->contains(task.executor().executor_id())) {
+    resources += task.executor().resources();
+  }
+
+  return resources;
+}
+
+
+// Orders tasks by decreasing CPUs and then memory, so that the
+// largest tasks get placed first.
+struct Larger
+{
+  Larger(const vector<TaskInfo>& _tasks) : tasks(_tasks) {}
+
+  bool operator () (size_t left, size_t right) const
+  {
+    Resources l = tasks[left].resources();
+    Resources r = tasks[right].resources();
+
+    double lcpus = l.get("cpus", Value::Scalar()).value();
+    double rcpus = r.get("cpus", Value::Scalar()).value();
+
+    if (lcpus != rcpus) {
+      return lcpus > rcpus;
+    }
+
+    return l.get("mem", Value::Scalar()).value() >
+      r.get("mem", Value::Scalar()).value();
+  }
+
+  const vector<TaskInfo>& tasks;
+};
+
+
+OfferPool::OfferPool(size_t _capacity)
+  : capacity(_capacity)
+{
+  pthread_mutex_init(&mutex, NULL);
+}
+
+
+OfferPool::~OfferPool()
+{
+  pthread_mutex_destroy(&mutex);
+}
+
+
+vector<OfferID> OfferPool::add(const Offer& offer)
+{
+  Lock lock(&mutex);
+
+  vector<OfferID> evicted;
+
+  if (capacity == 0 || offers.contains(offer.id())) {
+    return evicted;
+  }
+
+  while (offers.size() >= capacity) {
+    evicted.push_back(order.front());
+    erase(order.front());
+  }
+
+  Held& held = offers[offer.id()];
+  held.offer = offer;
+  held.available = offer.resources();
+  held.position = order.insert(order.end(), offer.id());
+
+  index(offer.id());
+
+  return evicted;
+}
+
+
+bool OfferPool::remove(const OfferID& offerId)
+{
+  Lock lock(&mutex);
+
+  if (!offers.contains(offerId)) {
+    return false;
+  }
+
+  erase(offerId);
+
+  return true;
+}
+
+
+vector<OfferID> OfferPool::clear()
+{
+  Lock lock(&mutex);
+
+  vector<OfferID> offerIds(order.begin(), order.end());
+
+  offers.clear();
+  order.clear();
+  slaves.clear();
+  scalars.clear();
+
+  return offerIds;
+}
+
+
+hashmap<OfferID, vector<TaskInfo> > OfferPool::match(
+    const vector<TaskInfo>& tasks,
+    vector<TaskInfo>* unmatched)
+{
+  Lock lock(&mutex);
+
+  // Place the tasks in decreasing order of size (but keep the
+  // relative order of equally sized tasks).
+  vector<size_t> indexes;
+  for (size_t i = 0; i < tasks.size(); i++) {
+    indexes.push_back(i);
+  }
+
+  std::stable_sort(indexes.begin(), indexes.end(), Larger(tasks));
+
+  hashmap<OfferID, vector<TaskInfo> > matched;
+
+  // Executors already placed into each offer.
+  hashmap<OfferID, hashset<ExecutorID> > executors;
+
+  foreach (size_t i, indexes) {
+    const TaskInfo& task = tasks[i];
+
+    // Use the first scalar resource the task needs (typically CPUs)
+    // to find candidate offers.
+    string resource;
+    foreach (const Resource& r, task.resources()) {
+      if (r.type() == Value::SCALAR) {
+        resource = r.name();
+        break;
+      }
+    }
+
+    // NOTE: We conservatively look for an offer that also fits the
+    // task's executor, even though the executor might already have
+    // been placed into the offer we end up using.
+    hashset<ExecutorID> none;
+    Option<OfferID> offerId =
+      fit(resource, required(task, &none), task.slave_id());
+
+    if (offerId.isNone()) {
+      unmatched->push_back(task);
+      continue;
+    }
+
+    Held& held = offers[offerId.get()];
+
+    unindex(offerId.get());
+    held.available -= required(task, &executors[offerId.get()]);
+    index(offerId.get());
+
+    if (task.has_executor()) {
+      executors[offerId.get()].insert(task.executor().executor_id());
+    }
+
+    TaskInfo placed = task;
+    placed.mutable_slave_id()->MergeFrom(held.offer.slave_id());
+    matched[offerId.get()].push_back(placed);
+  }
+
+  // The offers that got tasks are now used up.
+  foreachkey (const OfferID& offerId, matched) {
+    erase(offerId);
+  }
+
+  return matched;
+}
+
+
+size_t OfferPool::size()
+{
+  Lock lock(&mutex);
+  return offers.size();
+}
+
+
+void OfferPool::index(const OfferID& offerId)
+{
+  const Held& held = offers[offerId];
+
+  slaves.put(held.offer.slave_id(), offerId);
+
+  foreach (const Resource& resource, held.available) {
+    if (resource.type() == Value::SCALAR) {
+      scalars[resource.name()].insert(
+          std::make_pair(resource.scalar().value(), offerId));
+    }
+  }
+}
+
+
+void OfferPool::unindex(const OfferID& offerId)
+{
+  const Held& held = offers[offerId];
+
+  slaves.remove(held.offer.slave_id(), offerId);
+
+  foreach (const Resource& resource, held.available) {
+    if (resource.type() == Value::SCALAR &&
+        scalars.contains(resource.name())) {
+      multimap<double, OfferID>& index = scalars[resource.name()];
+
+      multimap<double, OfferID>::iterator iterator =
+        index.lower_bound(resource.scalar().value());
+
+      while (iterator != index.end() &&
+             iterator->first == resource.scalar().value()) {
+        if (iterator->second == offerId) {
+          index.erase(iterator);
+          break;
+        }
+        ++iterator;
+      }
+
+      if (index.empty()) {
+        scalars.erase(resource.name());
+      }
+    }
+  }
+}
+
+
+void OfferPool::erase(const OfferID& offerId)
+{
+  unindex(offerId);
+
+  // NOTE: The offer ID gets removed from 'order' last since
+  // 'offerId' might refer to it.
+  std::list<OfferID>::iterator position = offers[offerId].position;
+  offers.erase(offerId);
+  order.erase(position);
+}
+
+
+Option<OfferID> OfferPool::fit(
+    const string& resource,
+    const Resources& required,
+    const SlaveID& slaveId)
+{
+  // Only offers from the specified slave are candidates.
+  if (!slaveId.value().empty()) {
+    Option<OfferID> best;
+    double least = 0.0;
+
+    foreach (const OfferID& offerId, slaves.get(slaveId)) {
+      const Held& held = offers[offerId];
+      if (required <= held.available) {
+        double amount = held.available.get(resource, Value::Scalar()).value();
+        if (best.isNone() || amount < least) {
+          best = offerId;
+          least = amount;
+        }
+      }
+    }
+
+    return best;
+  }
+
+  // Without a scalar resource to go by, take the oldest offer that
+  // fits.
+  if (resource.empty()) {
+    foreach (const OfferID& offerId, order) {
+      if (required <= offers[offerId].available) {
+        return offerId;
+      }
+    }
+
+    return Option<OfferID>::none();
+  }
+
+  if (!scalars.contains(resource)) {
+    return Option<OfferID>::none();
+  }
+
+  // Offers are ordered by how much of the resource they have
+  // available, so the first one that fits is the tightest.
+  const multimap<double, OfferID>& index = scalars[resource];
+
+  multimap<double, OfferID>::const_iterator iterator =
+    index.lower_bound(required.get(resource, Value::Scalar()).value());
+
+  for (; iterator != index.end(); ++iterator) {
+    if (required <= offers[iterator->second].available) {
+      return iterator->second;
+    }
+  }
+
+  return Option<OfferID>::none();
+}
+
+} // namespace internal {
+} // namespace mesos {
@@ -0,0 +1,124 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __OFFER_POOL_HPP__
+#define __OFFER_POOL_HPP__
+
+#include <pthread.h>
+
+#include <list>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <mesos/mesos.hpp>
+
+#include <stout/hashmap.hpp>
+#include <stout/multihashmap.hpp>
+#include <stout/option.hpp>
+
+#include "common/resources.hpp"
+#include "common/type_utils.hpp"
+
+namespace mesos {
+namespace internal {
+
+// A bounded collection of the offers a scheduler driver is holding
+// on behalf of its scheduler, indexed by slave and by the amount of
+// each scalar resource available so that tasks can be matched
+// against the offers without scanning all of them. An OfferPool is
+// thread-safe since it's used both by the driver's process (adding
+// and removing offers as they arrive and get rescinded) and by the
+// threads calling into the driver (matching tasks).
+class OfferPool
+{
+public:
+  // Creates a pool holding at most 'capacity' offers.
+  explicit OfferPool(size_t capacity);
+  ~OfferPool();
+
+  // Adds the offer to the pool. If the pool is at capacity the
+  // oldest offers get removed to make room and are returned so that
+  // the caller can decline them.
+  std::vector<OfferID> add(const Offer& offer);
+
+  // Removes the offer from the pool (e.g., because it was rescinded
+  // or used to launch tasks). Returns false if the offer wasn't held.
+  bool remove(const OfferID& offerId);
+
+  // Removes all the offers from the pool and returns their IDs.
+  std::vector<OfferID> clear();
+
+  // Bin packs the tasks into the held offers (first-fit decreasing:
+  // the largest tasks are placed first, each into the offer with the
+  // least available resources that still fits it). A task with a
+  // non-empty slave ID only gets placed into an offer from that
+  // slave. Returns the tasks (with their slave IDs set) keyed by the
+  // offer they were placed into and removes those offers from the
+  // pool. Tasks that don't fit are appended to 'unmatched'.
+  hashmap<OfferID, std::vector<TaskInfo> > match(
+      const std::vector<TaskInfo>& tasks,
+      std::vector<TaskInfo>* unmatched);
+
+  size_t size();
+
+private:
+  struct Held
+  {
+    Offer offer;
+    Resources available;
+    std::list<OfferID>::iterator position;
+  };
+
+  // Adds/removes the offer to/from the slave and resource indexes.
+  void index(const OfferID& offerId);
+  void unindex(const OfferID& offerId);
+
+  // Removes the offer from the pool and the indexes.
+  void erase(const OfferID& offerId);
+
+  // Returns the held offer with the least 'resource' available that
+  // still has all the 'required' resources (from 'slaveId' only, if
+  // not empty), or none if no held offer fits.
+  Option<OfferID> fit(const std::string& resource,
+                      const Resources& required,
+                      const SlaveID& slaveId);
+
+  OfferPool(const OfferPool&);
+  OfferPool& operator = (const OfferPool&);
+
+  const size_t capacity;
+
+  pthread_mutex_t mutex;
+
+  hashmap<OfferID, Held> offers;
+
+  // IDs of the held offers, oldest first.
+  std::list<OfferID> order;
+
+  multihashmap<SlaveID, OfferID> slaves;
+
+  // Held offers ordered by the amount of each scalar resource that
+  // is available (keyed by resource name).
+  hashmap<std::string, std::multimap<double, OfferID> > scalars;
+};
+
+} // namespace internal {
+} // namespace mesos {
+
+#endif // __OFFER_POOL_HPP__
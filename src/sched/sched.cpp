@@ -37,10 +37,12 @@
 #include <process/id.hpp>
 #include <process/process.hpp>
 #include <process/protobuf.hpp>
+#include <process/statistics.hpp>
 
 #include <stout/duration.hpp>
 #include <stout/fatal.hpp>
 #include <stout/hashmap.hpp>
+#include <stout/hashset.hpp>
 #include <stout/os.hpp>
 #include <stout/uuid.hpp>
 
@@ -61,12 +63,15 @@
 
 #include "messages/messages.hpp"
 
+#include "sched/offer_pool.hpp"
+
 using namespace mesos;
 using namespace mesos::internal;
 
 using namespace process;
 
 using std::map;
+using std::pair;
 using std::string;
 using std::vector;
 
@@ -90,7 +95,9 @@ public:
                    const FrameworkInfo& _framework,
                    const string& _url,
                    pthread_mutex_t* _mutex,
-                   pthread_cond_t* _cond)
+                   pthread_cond_t* _cond,
+                   const Option<Duration>& _batch,
+                   OfferPool* _pool)
     : ProcessBase(ID::generate("scheduler")),
       driver(_driver),
       scheduler(_scheduler),
@@ -98,12 +105,15 @@ public:
       url(_url),
       mutex(_mutex),
       cond(_cond),
+      batch(_batch),
+      pool(_pool),
       failover(_framework.has_id() && !framework.id().value().empty()),
       master(UPID()),
       connected(false),
       aborted(false),
       // TODO(benh): Add Try().
-      detector(Try<MasterDetector*>::error("uninitialized"))
+      detector(Try<MasterDetector*>::error("uninitialized")),
+      statistics(Seconds(60 * 60), ID::generate("scheduler-statistics"))
   {}
 
   virtual ~SchedulerProcess() {}
@@ -142,7 +152,9 @@ protected:
     install<ResourceOffersMessage>(
         &SchedulerProcess::resourceOffers,
         &ResourceOffersMessage::offers,
-        &ResourceOffersMessage::pids);
+        &ResourceOffersMessage::pids,
+        &ResourceOffersMessage::allocated,
+        &ResourceOffersMessage::sent);
 
     install<RescindResourceOfferMessage>(
         &SchedulerProcess::rescindOffer,
@@ -183,6 +195,9 @@ protected:
     master = pid;
     link(master);
 
+    // Offers made by a previous master are no longer valid.
+    pool->clear();
+
     connected = false;
     doReliableRegistration();
   }
@@ -270,7 +285,9 @@ protected:
   }
 
   void resourceOffers(const vector<Offer>& offers,
-                      const vector<string>& pids)
+                      const vector<string>& pids,
+                      double allocated,
+                      double sent)
   {
     if (aborted) {
       VLOG(1) << "Ignoring resource offers message because "
@@ -295,7 +312,58 @@ protected:
       }
     }
 
-    scheduler->resourceOffers(driver, offers);
+    // Record how long it took for the offers to get here after the
+    // allocator made them and the master sent them (the latter
+    // covers the network and the time the message spent queued in
+    // the driver). Older masters don't include the timestamps. Note
+    // that these are only accurate if the clocks of the master and
+    // scheduler hosts are synchronized.
+    double received = Clock::now();
+
+    if (allocated > 0.0) {
+      statistics.set(
+          "scheduler/offer_allocation_latency", received - allocated);
+    }
+
+    if (sent > 0.0) {
+      statistics.set("scheduler/offer_delivery_latency", received - sent);
+    }
+
+    // Hold the offers in the pool (if enabled). When the pool is
+    // full the oldest offers get declined to make room, including
+    // offers from this message (which are then never passed to the
+    // scheduler) if there are more than the pool can hold.
+    hashset<OfferID> evicted;
+    foreach (const Offer& offer, offers) {
+      foreach (const OfferID& offerId, pool->add(offer)) {
+        evicted.insert(offerId);
+      }
+    }
+
+    vector<Offer> remaining;
+    foreach (const Offer& offer, offers) {
+      if (evicted.contains(offer.id())) {
+        evicted.erase(offer.id());
+        VLOG(1) << "Declining offer " << offer.id()
+                << " because the offer pool is full";
+        launchTasks(offer.id(), vector<TaskInfo>(), Filters());
+      } else {
+        remaining.push_back(offer);
+      }
+    }
+
+    // The scheduler already got the rest of the evicted offers.
+    foreach (const OfferID& offerId, evicted) {
+      VLOG(1) << "Declining offer " << offerId
+              << " because the offer pool is full";
+      launchTasks(offerId, vector<TaskInfo>(), Filters());
+      scheduler->offerRescinded(driver, offerId);
+    }
+
+    scheduler->resourceOffers(driver, remaining);
+
+    statistics.set(
+        "scheduler/resource_offers_duration", Clock::now() - received);
   }
 
   void rescindOffer(const OfferID& offerId)
@@ -309,6 +377,7 @@ protected:
     VLOG(1) << "Rescinded offer " << offerId;
 
     savedOffers.erase(offerId);
+    pool->remove(offerId);
 
     scheduler->offerRescinded(driver, offerId);
   }
@@ -329,6 +398,13 @@ protected:
 
     CHECK(framework.id() == update.framework_id());
 
+    // Status updates forwarded by a slave also tell us its PID, which
+    // lets us send framework messages directly to slaves even if we
+    // didn't launch the tasks ourselves (e.g., after a failover).
+    if (pid) {
+      saveSlavePid(update.slave_id(), pid);
+    }
+
     // TODO(benh): Note that this maybe a duplicate status update!
     // Once we get support to try and have a more consistent view
     // of what's running in the cluster, we'll just let this one
@@ -338,8 +414,23 @@ protected:
     // multiple times (of course, if a scheduler re-uses a TaskID,
     // that could be bad.
 
+    // Collect the status update if we're batching, the batch gets
+    // delivered (and acknowledged) after the batch interval elapses.
+    if (batch.isSome()) {
+      pending.push_back(std::make_pair(update, pid));
+      if (pending.size() == 1) {
+        delay(batch.get(), self(), &Self::flushStatusUpdates);
+      }
+      return;
+    }
+
+    double received = Clock::now();
+
     scheduler->statusUpdate(driver, status);
 
+    statistics.set(
+        "scheduler/status_update_duration", Clock::now() - received);
+
     // Acknowledge the status update.
     // NOTE: We do a dispatch here instead of directly sending the ACK because,
     // we want to avoid sending the ACK if the driver was aborted when we
@@ -366,6 +457,80 @@ protected:
     send(pid, message);
   }
 
+  void flushStatusUpdates()
+  {
+    if (aborted) {
+      VLOG(1) << "Ignoring batched task status updates because "
+              << "the driver is aborted!";
+      pending.clear();
+      return;
+    }
+
+    if (pending.empty()) {
+      return;
+    }
+
+    VLOG(1) << "Delivering " << pending.size() << " batched status updates";
+
+    vector<pair<StatusUpdate, UPID> > updates;
+    std::swap(updates, pending);
+
+    vector<TaskStatus> statuses;
+    statuses.reserve(updates.size());
+    for (size_t i = 0; i < updates.size(); i++) {
+      statuses.push_back(updates[i].first.status());
+    }
+
+    double received = Clock::now();
+
+    scheduler->statusUpdates(driver, statuses);
+
+    statistics.set(
+        "scheduler/status_updates_duration", Clock::now() - received);
+
+    // Acknowledge the status updates (see the NOTE in 'statusUpdate'
+    // for why we dispatch rather than send the ACKs directly).
+    dispatch(self(), &Self::statusUpdateAcknowledgements, updates);
+  }
+
+  void statusUpdateAcknowledgements(
+      const vector<pair<StatusUpdate, UPID> >& updates)
+  {
+    if (aborted) {
+      VLOG(1) << "Not sending status update acknowledgment messages because "
+              << "the driver is aborted!";
+      return;
+    }
+
+    // Coalesce the ACKs into one message per slave.
+    map<UPID, StatusUpdateAcknowledgementsMessage> messages;
+
+    for (size_t i = 0; i < updates.size(); i++) {
+      const StatusUpdate& update = updates[i].first;
+      const UPID& pid = updates[i].second;
+
+      if (pid) {
+        StatusUpdateAcknowledgementMessage* message =
+          messages[pid].add_acknowledgements();
+        message->mutable_framework_id()->MergeFrom(framework.id());
+        message->mutable_slave_id()->MergeFrom(update.slave_id());
+        message->mutable_task_id()->MergeFrom(update.status().task_id());
+        message->set_uuid(update.uuid());
+      }
+    }
+
+    foreachpair (const UPID& pid,
+                 const StatusUpdateAcknowledgementsMessage& message,
+                 messages) {
+      // Use the unbatched message when there is only one ACK.
+      if (message.acknowledgements_size() == 1) {
+        send(pid, message.acknowledgements(0));
+      } else {
+        send(pid, message);
+      }
+    }
+  }
+
   void lostSlave(const SlaveID& slaveId)
   {
     if (aborted) {
@@ -399,6 +564,11 @@ protected:
 
     VLOG(1) << "Received framework message";
 
+    // Framework messages from executors come directly from the slave.
+    if (from != master) {
+      saveSlavePid(slaveId, from);
+    }
+
     scheduler->frameworkMessage(driver, executorId, slaveId, data);
   }
 
@@ -502,50 +672,132 @@ protected:
       // (message lost, master failover etc).  In the future, this
       // should be solved by the replicated log and timeouts.
       foreach (const TaskInfo& task, tasks) {
-        StatusUpdate update;
-        update.mutable_framework_id()->MergeFrom(framework.id());
-        TaskStatus* status = update.mutable_status();
-        status->mutable_task_id()->MergeFrom(task.task_id());
-        status->set_state(TASK_LOST);
-        status->set_message("Master Disconnected");
-        update.set_timestamp(Clock::now());
-        update.set_uuid(UUID::random().toBytes());
-
-        statusUpdate(update, UPID());
+        lost(task, "Master Disconnected");
       }
       return;
     }
 
-    // Check that each TaskInfo has either an ExecutorInfo or a
-    // CommandInfo but not both.
+    LaunchTasksMessage message;
+    message.mutable_framework_id()->MergeFrom(framework.id());
+    message.mutable_offer_id()->MergeFrom(offerId);
+    message.mutable_filters()->MergeFrom(filters);
+
+    prepare(offerId, tasks, message.mutable_tasks());
+
+    send(master, message);
+  }
+
+  void launchTasksBatch(const vector<OfferID>& offerIds,
+                        const vector<TaskInfo>& tasks,
+                        const Filters& filters)
+  {
+    if (!connected) {
+      VLOG(1) << "Ignoring launch tasks message as master is disconnected";
+      // NOTE: See the note in 'launchTasks' above.
+      foreach (const TaskInfo& task, tasks) {
+        lost(task, "Master Disconnected");
+      }
+      return;
+    }
+
+    BatchLaunchTasksMessage message;
+    message.mutable_framework_id()->MergeFrom(framework.id());
+    message.mutable_filters()->MergeFrom(filters);
+
+    // Determine which offer (i.e., launch) to use for each slave,
+    // using the first offer from a slave if there are multiple.
+    hashmap<SlaveID, int> launches;
+
+    foreach (const OfferID& offerId, offerIds) {
+      BatchLaunchTasksMessage::Launch* launch = message.add_launches();
+      launch->mutable_offer_id()->MergeFrom(offerId);
+
+      if (savedOffers.count(offerId) > 0) {
+        foreachkey (const SlaveID& slaveId, savedOffers[offerId]) {
+          if (!launches.contains(slaveId)) {
+            launches[slaveId] = message.launches_size() - 1;
+          }
+        }
+      } else {
+        VLOG(1) << "Attempting to launch tasks with an unknown offer";
+      }
+    }
+
+    // Group the tasks by the offer they'll be launched with.
+    vector<vector<TaskInfo> > grouped(offerIds.size());
+
     foreach (const TaskInfo& task, tasks) {
-      if (task.has_executor() == task.has_command()) {
-        StatusUpdate update;
-        update.mutable_framework_id()->MergeFrom(framework.id());
-        TaskStatus* status = update.mutable_status();
-        status->mutable_task_id()->MergeFrom(task.task_id());
-        status->set_state(TASK_LOST);
-        status->set_message(
-            "TaskInfo must have either an 'executor' or a 'command'");
-        update.set_timestamp(Clock::now());
-        update.set_uuid(UUID::random().toBytes());
-
-        statusUpdate(update, UPID());
+      if (launches.contains(task.slave_id())) {
+        grouped[launches[task.slave_id()]].push_back(task);
+      } else {
+        lost(task, "Task uses a slave that is not in any of the offers");
       }
     }
 
-    LaunchTasksMessage message;
+    for (size_t i = 0; i < offerIds.size(); i++) {
+      prepare(offerIds[i],
+              grouped[i],
+              message.mutable_launches(i)->mutable_tasks());
+    }
+
+    send(master, message);
+  }
+
+  // Launches the tasks that were matched to each offer (see
+  // MesosSchedulerDriver::matchTasks) in one batch. Unlike
+  // 'launchTasksBatch' the tasks are not grouped by slave, since
+  // tasks matched to different offers from the same slave have to be
+  // launched using the offer they were matched to.
+  void launchMatchedTasks(
+      const hashmap<OfferID, vector<TaskInfo> >& matched,
+      const Filters& filters)
+  {
+    if (!connected) {
+      VLOG(1) << "Ignoring launch tasks message as master is disconnected";
+      // NOTE: See the note in 'launchTasks' above.
+      foreachvalue (const vector<TaskInfo>& tasks, matched) {
+        foreach (const TaskInfo& task, tasks) {
+          lost(task, "Master Disconnected");
+        }
+      }
+      return;
+    }
+
+    BatchLaunchTasksMessage message;
     message.mutable_framework_id()->MergeFrom(framework.id());
-    message.mutable_offer_id()->MergeFrom(offerId);
     message.mutable_filters()->MergeFrom(filters);
 
+    foreachpair (const OfferID& offerId,
+                 const vector<TaskInfo>& tasks,
+                 matched) {
+      BatchLaunchTasksMessage::Launch* launch = message.add_launches();
+      launch->mutable_offer_id()->MergeFrom(offerId);
+      prepare(offerId, tasks, launch->mutable_tasks());
+    }
+
+    send(master, message);
+  }
+
+  // Checks the tasks to be launched using the specified offer, saves
+  // the PIDs of the slaves they'll run on, and adds them to 'result'.
+  void prepare(const OfferID& offerId,
+               const vector<TaskInfo>& tasks,
+               google::protobuf::RepeatedPtrField<TaskInfo>* result)
+  {
+    // Check that each TaskInfo has either an ExecutorInfo or a
+    // CommandInfo but not both.
+    foreach (const TaskInfo& task, tasks) {
+      if (task.has_executor() == task.has_command()) {
+        lost(task, "TaskInfo must have either an 'executor' or a 'command'");
+      }
+    }
+
     foreach (const TaskInfo& task, tasks) {
       // Keep only the slave PIDs where we run tasks so we can send
       // framework messages directly.
       if (savedOffers.count(offerId) > 0) {
         if (savedOffers[offerId].count(task.slave_id()) > 0) {
-          savedSlavePids[task.slave_id()] =
-            savedOffers[offerId][task.slave_id()];
+          saveSlavePid(task.slave_id(), savedOffers[offerId][task.slave_id()]);
         } else {
           VLOG(1) << "Attempting to launch a task with the wrong slave id";
         }
@@ -553,13 +805,27 @@ protected:
         VLOG(1) << "Attempting to launch a task with an unknown offer";
       }
 
-      message.add_tasks()->MergeFrom(task);
+      result->Add()->MergeFrom(task);
     }
 
     // Remove the offer since we saved all the PIDs we might use.
     savedOffers.erase(offerId);
+    pool->remove(offerId);
+  }
 
-    send(master, message);
+  // Sends ourselves a TASK_LOST status update for the specified task.
+  void lost(const TaskInfo& task, const string& message)
+  {
+    StatusUpdate update;
+    update.mutable_framework_id()->MergeFrom(framework.id());
+    TaskStatus* status = update.mutable_status();
+    status->mutable_task_id()->MergeFrom(task.task_id());
+    status->set_state(TASK_LOST);
+    status->set_message(message);
+    update.set_timestamp(Clock::now());
+    update.set_uuid(UUID::random().toBytes());
+
+    statusUpdate(update, UPID());
   }
 
   void reviveOffers()
@@ -586,11 +852,10 @@ protected:
     VLOG(1) << "Asked to send framework message to slave "
             << slaveId;
 
-    // TODO(benh): After a scheduler has re-registered it won't have
-    // any saved slave PIDs, maybe it makes sense to try and save each
-    // PID that this scheduler tries to send a message to? Or we can
-    // just wait for them to recollect as new offers come in and get
-    // accepted.
+    // NOTE: After a scheduler has re-registered it won't have any
+    // saved slave PIDs, but it recollects them from the status
+    // updates and framework messages of its tasks (as well as from
+    // the offers it accepts).
 
     if (savedSlavePids.count(slaveId) > 0) {
       UPID slave = savedSlavePids[slaveId];
@@ -615,6 +880,32 @@ protected:
     }
   }
 
+  virtual void exited(const UPID& pid)
+  {
+    // Forget the slave (its PID might change if it restarts) so that
+    // framework messages go through the master until we learn about
+    // the slave again.
+    foreachpair (const SlaveID& slaveId, const UPID& slave, savedSlavePids) {
+      if (slave == pid) {
+        VLOG(1) << "Lost connection to slave " << slaveId << " at " << pid;
+        savedSlavePids.erase(slaveId);
+        break;
+      }
+    }
+  }
+
+  // Saves the PID of a slave so we can send framework messages
+  // directly to it, linking to the slave so that the connection
+  // gets reused (and we find out when it breaks).
+  void saveSlavePid(const SlaveID& slaveId, const UPID& pid)
+  {
+    if (!savedSlavePids.contains(slaveId) || savedSlavePids[slaveId] != pid) {
+      VLOG(2) << "Saving PID '" << pid << "' of slave " << slaveId;
+      savedSlavePids[slaveId] = pid;
+      link(pid);
+    }
+  }
+
 private:
   friend class mesos::MesosSchedulerDriver;
 
@@ -624,6 +915,8 @@ private:
   string url; // URL for the master (e.g., zk://, file://, etc).
   pthread_mutex_t* mutex;
   pthread_cond_t* cond;
+  const Option<Duration> batch;
+  OfferPool* pool;
   bool failover;
   UPID master;
 
@@ -632,8 +925,18 @@ private:
 
   Try<MasterDetector*> detector;
 
+  // Offer latencies and callback durations for this driver, which
+  // can be retrieved via its own statistics process (e.g.,
+  // /scheduler-statistics(1)/series.json?name=
+  // scheduler/offer_delivery_latency).
+  Statistics statistics;
+
   hashmap<OfferID, hashmap<SlaveID, UPID> > savedOffers;
   hashmap<SlaveID, UPID> savedSlavePids;
+
+  // Status updates (and the PIDs to acknowledge them to) collected
+  // while batching, in the order they were received.
+  vector<pair<StatusUpdate, UPID> > pending;
 };
 
 } // namespace internal {
@@ -661,6 +964,7 @@ MesosSchedulerDriver::MesosSchedulerDriver(
     framework(_framework),
     master(_master),
     process(NULL),
+    pool(NULL),
     status(DRIVER_NOT_STARTED)
 {
   GOOGLE_PROTOBUF_VERIFY_VERSION;
@@ -716,6 +1020,18 @@ MesosSchedulerDriver::MesosSchedulerDriver(
     framework.set_user(os::user());
   }
 
+  // Determine whether or not status updates should be batched.
+  Option<Duration> batch;
+  double interval = configuration.get<double>(
+      "status_update_batch_interval", 0.0);
+  if (interval > 0.0) {
+    batch = Seconds(interval);
+  }
+
+  // Determine how many offers to hold on to (none by default).
+  int capacity = configuration.get<int>("offer_pool_capacity", 0);
+  pool = new OfferPool(capacity > 0 ? capacity : 0);
+
   // Launch a local cluster if necessary.
   Option<UPID> pid;
   if (master == "local" || master == "localquiet") {
@@ -726,10 +1042,10 @@ MesosSchedulerDriver::MesosSchedulerDriver(
 
   if (pid.isSome()) {
     process = new SchedulerProcess(
-        this, scheduler, framework, pid.get(), &mutex, &cond);
+        this, scheduler, framework, pid.get(), &mutex, &cond, batch, pool);
   } else {
     process = new SchedulerProcess(
-        this, scheduler, framework, master, &mutex, &cond);
+        this, scheduler, framework, master, &mutex, &cond, batch, pool);
   }
 }
 
@@ -757,6 +1073,8 @@ MesosSchedulerDriver::~MesosSchedulerDriver()
     delete process;
   }
 
+  delete pool;
+
   pthread_mutex_destroy(&mutex);
   pthread_cond_destroy(&cond);
 
@@ -884,6 +1202,53 @@ Status MesosSchedulerDriver::launchTasks(
 }
 
 
+Status MesosSchedulerDriver::launchTasks(
+    const vector<OfferID>& offerIds,
+    const vector<TaskInfo>& tasks,
+    const Filters& filters)
+{
+  Lock lock(&mutex);
+
+  if (status != DRIVER_RUNNING) {
+    return status;
+  }
+
+  CHECK(process != NULL);
+
+  dispatch(process, &SchedulerProcess::launchTasksBatch,
+           offerIds, tasks, filters);
+
+  return status;
+}
+
+
+Status MesosSchedulerDriver::matchTasks(
+    const vector<TaskInfo>& tasks,
+    vector<TaskInfo>* unmatched,
+    const Filters& filters)
+{
+  Lock lock(&mutex);
+
+  if (status != DRIVER_RUNNING) {
+    return status;
+  }
+
+  CHECK(process != NULL);
+  CHECK(pool != NULL);
+
+  hashmap<OfferID, vector<TaskInfo> > matched =
+    pool->match(tasks, unmatched);
+
+  if (matched.empty()) {
+    return status;
+  }
+
+  dispatch(process, &SchedulerProcess::launchMatchedTasks, matched, filters);
+
+  return status;
+}
+
+
 Status MesosSchedulerDriver::declineOffer(
     const OfferID& offerId,
     const Filters& filters)
@@ -218,6 +218,13 @@ void CgroupsIsolationModule::initialize(
 
   LOG(INFO) << "Using " << hierarchy << " as cgroups hierarchy root";
 
+  if (flags.cgroups_memory_soft_limit_fraction <= 0.0 ||
+      flags.cgroups_memory_soft_limit_fraction > 1.0) {
+    EXIT(1) << "Invalid --cgroups_memory_soft_limit_fraction "
+            << flags.cgroups_memory_soft_limit_fraction
+            << " (expecting a value in (0, 1])";
+  }
+
   // Determine desired subsystems.
   foreach (const string& subsystem,
            strings::tokenize(flags.cgroups_subsystems, ",")) {
@@ -543,6 +550,11 @@ void CgroupsIsolationModule::killExecutor(
     info->oomNotifier.discard();
   }
 
+  // Stop the memory pressure listener if needed.
+  if (info->pressureNotifier.isPending()) {
+    info->pressureNotifier.discard();
+  }
+
   // Destroy the cgroup that is associated with the executor. Here, we don't
   // wait for it to succeed as we don't want to block the isolation module.
   // Instead, we register a callback which will be invoked when its result is
@@ -703,18 +715,19 @@ Try<Nothing> CgroupsIsolationModule::memChanged(
   size_t limitInBytes =
     std::max((size_t) mem, MIN_MEMORY_MB) * 1024LL * 1024LL;
 
-  // Determine which control to set. If this is the first time we're
-  // setting the limit, use 'memory.limit_in_bytes'. The "first time"
-  // is determined by checking whether or not we've forked a process
-  // in the cgroup yet (i.e., 'info->pid != -1'). If this is not the
-  // first time we're setting the limit AND we're decreasing the
-  // limit, use 'memory.soft_limit_in_bytes'. We do this because we
-  // might not be able to decrease 'memory.limit_in_bytes' if too much
-  // memory is being used. This is probably okay if the machine has
-  // available resources; TODO(benh): Introduce a MemoryWatcherProcess
-  // which monitors the descrepancy between usage and soft limit and
-  // introduces a "manual oom" if necessary.
-  string control = "memory.limit_in_bytes";
+  // Determine whether or not to set the hard limit. If this is the
+  // first time we're setting the limit, use 'memory.limit_in_bytes'.
+  // The "first time" is determined by checking whether or not we've
+  // forked a process in the cgroup yet (i.e., 'info->pid != -1'). If
+  // this is not the first time we're setting the limit AND we're
+  // decreasing the limit, only update 'memory.soft_limit_in_bytes'.
+  // We do this because we might not be able to decrease
+  // 'memory.limit_in_bytes' if too much memory is being used. This is
+  // probably okay if the machine has available resources, and we
+  // listen for the usage crossing the soft limit (see
+  // 'pressureListen') so that the slave learns about it before the
+  // kernel has to invoke the OOM killer.
+  bool hard = true;
 
   if (info->pid != -1) {
     Try<string> read = cgroups::read(
@@ -728,21 +741,49 @@ Try<Nothing> CgroupsIsolationModule::memChanged(
     CHECK(currentLimitInBytes.isSome()) << currentLimitInBytes.error();
 
     if (limitInBytes <= currentLimitInBytes.get()) {
-      control = "memory.soft_limit_in_bytes";
+      hard = false;
     }
   }
 
+  if (hard) {
+    Try<Nothing> write = cgroups::write(
+        hierarchy, info->name(), "memory.limit_in_bytes",
+        stringify(limitInBytes));
+    if (write.isError()) {
+      return Try<Nothing>::error(
+          "Failed to update 'memory.limit_in_bytes': " + write.error());
+    }
+
+    LOG(INFO) << "Updated 'memory.limit_in_bytes' to " << limitInBytes
+              << " for executor " << info->executorId
+              << " of framework " << info->frameworkId;
+  }
+
+  // Always set the soft limit to a fraction of the allocated memory
+  // (see --cgroups_memory_soft_limit_fraction) so that the kernel
+  // reclaims from this cgroup first when the machine is under memory
+  // pressure, and so that crossing the soft limit (and thus
+  // 'pressureListen') happens before the hard limit is reached.
+  size_t softLimitInBytes =
+    (size_t) (limitInBytes * flags.cgroups_memory_soft_limit_fraction);
+
   Try<Nothing> write = cgroups::write(
-      hierarchy, info->name(), control, stringify(limitInBytes));
+      hierarchy, info->name(), "memory.soft_limit_in_bytes",
+      stringify(softLimitInBytes));
   if (write.isError()) {
     return Try<Nothing>::error(
-        "Failed to update '" + control + "': " + write.error());
+        "Failed to update 'memory.soft_limit_in_bytes': " + write.error());
   }
 
-  LOG(INFO) << "Updated '" << control << "' to " << limitInBytes
+  LOG(INFO) << "Updated 'memory.soft_limit_in_bytes' to " << softLimitInBytes
             << " for executor " << info->executorId
             << " of framework " << info->frameworkId;
 
+  if (info->softLimitInBytes != softLimitInBytes) {
+    info->softLimitInBytes = softLimitInBytes;
+    pressureListen(info->frameworkId, info->executorId);
+  }
+
   return Nothing();
 }
 
@@ -863,6 +904,100 @@ void CgroupsIsolationModule::oom(
 }
 
 
+void CgroupsIsolationModule::pressureListen(
+    const FrameworkID& frameworkId,
+    const ExecutorID& executorId)
+{
+  CgroupInfo* info = findCgroupInfo(frameworkId, executorId);
+  CHECK(info != NULL) << "Cgroup info is not registered";
+
+  // Stop listening on the previous threshold, if any.
+  if (info->pressureNotifier.isPending()) {
+    info->pressureNotifier.discard();
+  }
+
+  // Register a memory threshold on 'memory.usage_in_bytes'. The
+  // kernel signals the eventfd whenever the usage crosses the
+  // threshold (in either direction).
+  info->pressureNotifier = cgroups::listen(
+      hierarchy,
+      info->name(),
+      "memory.usage_in_bytes",
+      stringify(info->softLimitInBytes));
+
+  // Unlike OOM listening, memory pressure notifications are only
+  // advisory, so we don't treat a failure here as fatal.
+  if (info->pressureNotifier.isFailed()) {
+    LOG(ERROR) << "Failed to listen for memory pressure events for executor "
+               << executorId << " of framework " << frameworkId
+               << ": " << info->pressureNotifier.failure();
+    return;
+  }
+
+  info->pressureNotifier.onAny(
+      defer(PID<CgroupsIsolationModule>(this),
+            &CgroupsIsolationModule::pressureWaited,
+            frameworkId,
+            executorId,
+            info->tag,
+            lambda::_1));
+}
+
+
+void CgroupsIsolationModule::pressureWaited(
+    const FrameworkID& frameworkId,
+    const ExecutorID& executorId,
+    const string& tag,
+    const Future<uint64_t>& future)
+{
+  if (future.isDiscarded()) {
+    return;
+  } else if (future.isFailed()) {
+    LOG(ERROR) << "Listening on memory pressure events failed for executor "
+               << executorId << " of framework " << frameworkId
+               << " with tag " << tag << ": " << future.failure();
+    return;
+  }
+
+  CgroupInfo* info = findCgroupInfo(frameworkId, executorId);
+  if (info == NULL || info->killed || tag != info->tag) {
+    // The executor has already terminated (or is being killed), or
+    // this is an event for a previous executor instance.
+    return;
+  }
+
+  Try<string> read = cgroups::read(
+      hierarchy, info->name(), "memory.usage_in_bytes");
+  if (read.isError()) {
+    LOG(ERROR) << "Failed to read 'memory.usage_in_bytes' for executor "
+               << executorId << " of framework " << frameworkId
+               << ": " << read.error();
+  } else {
+    Try<uint64_t> usage = numify<uint64_t>(strings::trim(read.get()));
+    CHECK(usage.isSome()) << usage.error();
+
+    // The threshold fires both when going above and when coming back
+    // below the soft limit, we only tell the slave about the former.
+    if (usage.get() >= info->softLimitInBytes) {
+      LOG(INFO) << "Memory usage " << usage.get() << " bytes of executor "
+                << executorId << " of framework " << frameworkId
+                << " exceeds its soft limit of " << info->softLimitInBytes
+                << " bytes";
+
+      dispatch(slave,
+               &Slave::executorMemoryPressure,
+               frameworkId,
+               executorId,
+               usage.get(),
+               (uint64_t) info->softLimitInBytes);
+    }
+  }
+
+  // Keep listening for subsequent threshold crossings.
+  pressureListen(frameworkId, executorId);
+}
+
+
 void CgroupsIsolationModule::destroyWaited(
     const string& cgroup,
     const Future<bool>& future)
@@ -888,6 +1023,7 @@ CgroupsIsolationModule::CgroupInfo* CgroupsIsolationModule::registerCgroupInfo(
   info->killed = false;
   info->destroyed = false;
   info->reason = "";
+  info->softLimitInBytes = 0;
   if (subsystems.contains("cpuset")) {
     info->cpuset = new Cpuset();
   } else {
@@ -154,6 +154,12 @@ private:
     // Used to cancel the OOM listening.
     process::Future<uint64_t> oomNotifier;
 
+    // Used to cancel the memory pressure (soft limit) listening.
+    process::Future<uint64_t> pressureNotifier;
+
+    // The current soft limit (i.e., the allocated memory) in bytes.
+    size_t softLimitInBytes;
+
     // CPUs allocated if using 'cpuset' subsystem.
     Cpuset* cpuset;
   };
@@ -210,6 +216,27 @@ private:
       const ExecutorID& executorId,
       const std::string& tag);
 
+  // Start listening on memory pressure events, i.e., when the memory
+  // usage of the cgroup crosses its soft limit. This function will
+  // stop any previous listening, so it should be called whenever the
+  // soft limit changes.
+  // @param   frameworkId   The id of the given framework.
+  // @param   executorId    The id of the given executor.
+  void pressureListen(
+      const FrameworkID& frameworkId,
+      const ExecutorID& executorId);
+
+  // This function is invoked when the polling on the memory pressure
+  // eventfd has a result.
+  // @param   frameworkId   The id of the given framework.
+  // @param   executorId    The id of the given executor.
+  // @param   tag           The uuid tag.
+  void pressureWaited(
+      const FrameworkID& frameworkId,
+      const ExecutorID& executorId,
+      const std::string& tag,
+      const process::Future<uint64_t>& future);
+
   // This callback is invoked when destroy cgroup has a result.
   // @param   cgroup        The cgroup that is being destroyed.
   // @param   future        The future describing the destroy process.
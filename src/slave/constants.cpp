@@ -23,9 +23,11 @@ namespace internal {
 namespace slave {
 
 const Duration EXECUTOR_SHUTDOWN_GRACE_PERIOD = Seconds(5.0);
+const Duration EXECUTOR_REREGISTER_TIMEOUT = Minutes(1.0);
 const Duration STATUS_UPDATE_RETRY_INTERVAL = Seconds(10.0);
 const Duration GC_DELAY = Weeks(1.0);
 const Duration DISK_WATCH_INTERVAL = Minutes(1.0);
+const uint32_t STATUS_UPDATE_BATCH_SIZE = 1000;
 const uint32_t MAX_COMPLETED_FRAMEWORKS = 50;
 const uint32_t MAX_COMPLETED_EXECUTORS_PER_FRAMEWORK = 150;
 const uint32_t MAX_COMPLETED_TASKS_PER_EXECUTOR = 200;
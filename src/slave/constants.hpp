@@ -34,10 +34,18 @@ namespace slave {
 // we can revert this.
 
 extern const Duration EXECUTOR_SHUTDOWN_GRACE_PERIOD;
+
+// How long an executor waits for a checkpointing slave to recover
+// (and reconnect) after the slave exits before shutting down.
+extern const Duration EXECUTOR_REREGISTER_TIMEOUT;
+
 extern const Duration STATUS_UPDATE_RETRY_INTERVAL;
 extern const Duration GC_DELAY;
 extern const Duration DISK_WATCH_INTERVAL;
 
+// Maximum number of status updates forwarded in one message.
+extern const uint32_t STATUS_UPDATE_BATCH_SIZE;
+
 // Maximum number of completed frameworks to store in memory.
 extern const uint32_t MAX_COMPLETED_FRAMEWORKS;
 
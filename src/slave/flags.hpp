@@ -95,12 +95,32 @@ public:
         "the available disk usage.",
         GC_DELAY);
 
+    add(&Flags::gc_workers,
+        "gc_workers",
+        "Number of worker threads removing garbage collected\n"
+        "directories",
+        1);
+
+    add(&Flags::gc_max_iops,
+        "gc_max_iops",
+        "Maximum number of file system operations (unlinks\n"
+        "and rmdirs) per second used by all the workers together\n"
+        "for removing garbage collected directories (no default,\n"
+        "not throttled)");
+
     add(&Flags::disk_watch_interval,
         "disk_watch_interval",
         "Periodic time interval (e.g., 10secs, 2mins, etc)\n"
         "to check the disk usage",
         DISK_WATCH_INTERVAL);
 
+    add(&Flags::checkpoint,
+        "checkpoint",
+        "Whether to checkpoint the slave id, frameworks, executors,\n"
+        "tasks and status updates to the work directory so that\n"
+        "they can be recovered when the slave restarts",
+        false);
+
 #ifdef __linux__
     add(&Flags::cgroups_hierarchy_root,
         "cgroups_hierarchy_root",
@@ -111,6 +131,13 @@ public:
         "cgroups_subsystems",
         "List of subsystems to enable (e.g., 'cpu,freezer')\n",
         "cpu,memory,freezer");
+
+    add(&Flags::cgroups_memory_soft_limit_fraction,
+        "cgroups_memory_soft_limit_fraction",
+        "Fraction of an executor's allocated memory to use as its\n"
+        "'memory.soft_limit_in_bytes', so that memory pressure is\n"
+        "noticed before the hard limit is reached (in (0, 1])\n",
+        0.9);
 #endif
   }
 
@@ -124,10 +151,14 @@ public:
   std::string frameworks_home;  // TODO(benh): Make an Option.
   Duration executor_shutdown_grace_period;
   Duration gc_delay;
+  uint32_t gc_workers;
+  Option<uint32_t> gc_max_iops;
   Duration disk_watch_interval;
+  bool checkpoint;
 #ifdef __linux__
   std::string cgroups_hierarchy_root;
   std::string cgroups_subsystems;
+  double cgroups_memory_soft_limit_fraction;
 #endif
 };
 
@@ -15,11 +15,26 @@
  * See the License for the specific language governing permissions and
  * limitations under the License.
  */
-
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/types.h>
+
+#include <algorithm>
+#include <list>
 #include <map>
 #include <string>
 #include <vector>
 
+#include <process/clock.hpp>
+#include <process/defer.hpp>
 #include <process/delay.hpp>
 #include <process/dispatch.hpp>
 #include <process/future.hpp>
@@ -28,7 +43,12 @@
 
 #include <stout/duration.hpp>
 #include <stout/foreach.hpp>
+#include <stout/hashset.hpp>
 #include <stout/os.hpp>
+#include <stout/path.hpp>
+#include <stout/uuid.hpp>
+
+#include "common/lock.hpp"
 
 #include "logging/logging.hpp"
 
@@ -38,18 +58,388 @@ using namespace process;
 
 using process::wait; // Necessary on some OS's to disambiguate.
 
+using std::list;
 using std::map;
 using std::string;
 using std::vector;
 
+namespace params = std::tr1::placeholders;
+
 namespace mesos {
 namespace internal {
 namespace slave {
 
+// Removes paths on dedicated threads (rather than on the threads
+// that run libprocess processes) since unlinking a large directory
+// tree can block for a long time. A path is removed one file system
+// operation at a time so that the operations of all the threads can
+// be throttled using a single token bucket and so that a removal can
+// be stopped in the middle of a large directory tree.
+class GarbageCollectorWorkers
+{
+public:
+  GarbageCollectorWorkers(uint32_t workers, const Option<uint32_t>& iops);
+
+  // Stops (and joins) the threads, discarding any pending removals.
+  ~GarbageCollectorWorkers();
+
+  Future<GarbageCollector::Statistics> remove(const string& path);
+
+private:
+  // An open directory (and its name within its parent directory).
+  struct Directory
+  {
+    Directory(DIR* _dir, const string& _name) : dir(_dir), name(_name) {}
+
+    DIR* dir;
+    string name;
+  };
+
+  struct Job
+  {
+    explicit Job(const string& _path) : path(_path), started(false) {}
+
+    ~Job()
+    {
+      foreach (const Directory& directory, stack) {
+        ::closedir(directory.dir);
+      }
+    }
+
+    const string path;
+    bool started;
+
+    // The directories currently being traversed (depth first).
+    vector<Directory> stack;
+
+    GarbageCollector::Statistics statistics;
+    Promise<GarbageCollector::Statistics> promise;
+  };
+
+  static void* run(void* arg);
+
+  // Removes paths until the workers get stopped.
+  void work();
+
+  // Blocks until there is a path to remove. Returns NULL once the
+  // workers are stopping.
+  Job* dequeue();
+
+  // Blocks until another operation is allowed. Returns false once
+  // the workers are stopping.
+  bool acquire();
+
+  // Performs a single file system operation for the job. Returns
+  // true once the path has been completely removed.
+  Try<bool> step(Job* job);
+
+  // Opens the directory 'name' relative to 'fd' and pushes it onto
+  // the stack of the job.
+  Try<Nothing> open(Job* job, int fd, const string& name);
+
+  const Option<uint32_t> iops;
+
+  vector<pthread_t> threads;
+
+  // Protects everything below.
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+
+  list<Job*> jobs;
+  size_t active; // Number of jobs being worked on by the threads.
+  bool stopping;
+
+  // The token bucket shared by all the threads (when throttled).
+  // Tokens accrue at 'iops' per second (as measured by the libprocess
+  // clock) while there is something to remove, so that the threads
+  // together never do more than 'iops' operations per second, no
+  // matter how many of them are busy.
+  double tokens;
+  double refilled; // Time the tokens were last topped up.
+};
+
+
+GarbageCollectorWorkers::GarbageCollectorWorkers(
+    uint32_t workers,
+    const Option<uint32_t>& _iops)
+  : iops(_iops), active(0), stopping(false), tokens(0), refilled(0)
+{
+  pthread_mutex_init(&mutex, NULL);
+  pthread_cond_init(&cond, NULL);
+
+  for (uint32_t i = 0; i < workers; i++) {
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, &GarbageCollectorWorkers::run, this)) {
+      PLOG(FATAL) << "Failed to create garbage collector thread";
+    }
+    threads.push_back(thread);
+  }
+}
+
+
+GarbageCollectorWorkers::~GarbageCollectorWorkers()
+{
+  {
+    Lock lock(&mutex);
+    stopping = true;
+    pthread_cond_broadcast(&cond);
+  }
+
+  foreach (const pthread_t& thread, threads) {
+    pthread_join(thread, NULL);
+  }
+
+  foreach (Job* job, jobs) {
+    job->promise.future().discard();
+    delete job;
+  }
+
+  pthread_cond_destroy(&cond);
+  pthread_mutex_destroy(&mutex);
+}
+
+
+Future<GarbageCollector::Statistics> GarbageCollectorWorkers::remove(
+    const string& path)
+{
+  Job* job = new Job(path);
+
+  Lock lock(&mutex);
+
+  // Don't let tokens accrued while there was nothing to remove be
+  // used for a burst of operations now.
+  // NOTE: We read the clock as the threads do (i.e., not as this
+  // process) since the two can differ while the clock is paused.
+  if (jobs.empty() && active == 0) {
+    tokens = 0;
+    refilled = Clock::now(NULL);
+  }
+
+  jobs.push_back(job);
+  pthread_cond_broadcast(&cond);
+
+  return job->promise.future();
+}
+
+
+void* GarbageCollectorWorkers::run(void* arg)
+{
+  reinterpret_cast<GarbageCollectorWorkers*>(arg)->work();
+  return NULL;
+}
+
+
+void GarbageCollectorWorkers::work()
+{
+  Job* job = NULL;
+  while ((job = dequeue()) != NULL) {
+    Try<bool> done = false;
+    while (done.isSome() && !done.get()) {
+      if (!acquire()) {
+        job->promise.future().discard();
+        break;
+      }
+      done = step(job);
+    }
+
+    if (done.isError()) {
+      LOG(WARNING) << "Failed to delete " << job->path << ": " << done.error();
+      job->promise.fail(done.error());
+    } else if (done.get()) {
+      LOG(INFO) << "Deleted " << job->path;
+      job->promise.set(job->statistics);
+    }
+
+    delete job;
+
+    Lock lock(&mutex);
+    active--;
+  }
+}
+
+
+GarbageCollectorWorkers::Job* GarbageCollectorWorkers::dequeue()
+{
+  Lock lock(&mutex);
+
+  while (!stopping && jobs.empty()) {
+    pthread_cond_wait(&cond, &mutex);
+  }
+
+  if (stopping) {
+    return NULL;
+  }
+
+  Job* job = jobs.front();
+  jobs.pop_front();
+  active++;
+  return job;
+}
+
+
+bool GarbageCollectorWorkers::acquire()
+{
+  Lock lock(&mutex);
+
+  while (!stopping) {
+    if (iops.isNone()) {
+      return true;
+    }
+
+    double now = Clock::now();
+    tokens += (now - refilled) * iops.get();
+    refilled = now;
+
+    if (tokens >= 1) {
+      tokens -= 1;
+      return true;
+    }
+
+    // Wait until the next token is due (or we get stopped). Note
+    // that while the clock is paused (in tests) this just polls.
+    double secs = std::max((1 - tokens) / iops.get(), 0.001);
+
+    timeval tv;
+    ::gettimeofday(&tv, NULL);
+
+    double deadline = tv.tv_sec + tv.tv_usec / 1000000.0 + secs;
+
+    timespec ts;
+    ts.tv_sec = (time_t) deadline;
+    ts.tv_nsec = (long) ((deadline - ts.tv_sec) * 1000000000.0);
+
+    pthread_cond_timedwait(&cond, &mutex, &ts);
+  }
+
+  return false;
+}
+
+
+Try<bool> GarbageCollectorWorkers::step(Job* job)
+{
+  struct stat s;
+
+  if (!job->started) {
+    job->started = true;
+
+    if (::lstat(job->path.c_str(), &s) < 0) {
+      return Try<bool>::error(strerror(errno));
+    }
+
+    job->statistics.bytes += s.st_blocks * 512;
+
+    if (!S_ISDIR(s.st_mode)) {
+      if (::unlink(job->path.c_str()) < 0) {
+        return Try<bool>::error(strerror(errno));
+      }
+      job->statistics.inodes++;
+      return true;
+    }
+
+    Try<Nothing> open = this->open(job, AT_FDCWD, job->path);
+    if (open.isError()) {
+      return Try<bool>::error(open.error());
+    }
+    return false;
+  }
+
+  CHECK(!job->stack.empty());
+
+  DIR* dir = job->stack.back().dir;
+
+  // Skip '.' and '..' (these don't count as an operation).
+  struct dirent* entry = NULL;
+  do {
+    errno = 0;
+    entry = ::readdir(dir);
+  } while (entry != NULL &&
+           (strcmp(entry->d_name, ".") == 0 ||
+            strcmp(entry->d_name, "..") == 0));
+
+  if (entry == NULL) {
+    if (errno != 0) {
+      return Try<bool>::error(strerror(errno));
+    }
+
+    // The directory is now empty, remove it.
+    const string name = job->stack.back().name;
+    ::closedir(dir);
+    job->stack.pop_back();
+
+    int result = job->stack.empty()
+      ? ::rmdir(job->path.c_str())
+      : ::unlinkat(::dirfd(job->stack.back().dir), name.c_str(), AT_REMOVEDIR);
+
+    if (result < 0) {
+      return Try<bool>::error(strerror(errno));
+    }
+
+    job->statistics.inodes++;
+    return job->stack.empty();
+  }
+
+  const string name = entry->d_name;
+
+  // NOTE: ENOENT is ignored below in case someone else removed the
+  // entry in the meantime (like os::rmdir does).
+  int fd = ::dirfd(dir);
+  if (::fstatat(fd, name.c_str(), &s, AT_SYMLINK_NOFOLLOW) < 0) {
+    return errno == ENOENT ? Try<bool>::some(false)
+                           : Try<bool>::error(strerror(errno));
+  }
+
+  job->statistics.bytes += s.st_blocks * 512;
+
+  if (S_ISDIR(s.st_mode)) {
+    Try<Nothing> open = this->open(job, fd, name);
+    if (open.isError()) {
+      return Try<bool>::error(open.error());
+    }
+  } else if (::unlinkat(fd, name.c_str(), 0) < 0) {
+    if (errno != ENOENT) {
+      return Try<bool>::error(strerror(errno));
+    }
+  } else {
+    job->statistics.inodes++;
+  }
+
+  return false;
+}
+
+
+Try<Nothing> GarbageCollectorWorkers::open(
+    Job* job,
+    int fd,
+    const string& name)
+{
+  int child = ::openat(fd, name.c_str(), O_RDONLY | O_DIRECTORY | O_NOFOLLOW);
+  if (child < 0) {
+    return Try<Nothing>::error(strerror(errno));
+  }
+
+  DIR* dir = ::fdopendir(child);
+  if (dir == NULL) {
+    ::close(child);
+    return Try<Nothing>::error(strerror(errno));
+  }
+
+  job->stack.push_back(Directory(dir, name));
+  return Nothing();
+}
+
 
 class GarbageCollectorProcess : public Process<GarbageCollectorProcess>
 {
 public:
+  GarbageCollectorProcess(
+      const Option<string>& _trash,
+      uint32_t _workers,
+      const Option<uint32_t>& _iops)
+    : trash(_trash),
+      iops(_iops.isSome() && _iops.get() == 0 ? Option<uint32_t>::none()
+                                               : _iops),
+      workers(std::max(_workers, (uint32_t) 1), iops) {}
+
   virtual ~GarbageCollectorProcess();
 
   // GarbageCollector implementation.
@@ -57,9 +447,23 @@ public:
 
   void prune(const Duration& d);
 
+  GarbageCollector::Statistics statistics();
+
+protected:
+  virtual void initialize();
+
 private:
   void remove(const Timeout& removalTime);
 
+  // Hands the path off to the workers.
+  Future<GarbageCollector::Statistics> _remove(const string& path);
+
+  // Invoked once a worker is done with a path.
+  void removed(
+      const string& path,
+      Promise<Nothing>* promise,
+      const Future<GarbageCollector::Statistics>& future);
+
   struct PathInfo
   {
     PathInfo(const string& _path, Promise<Nothing>* _promise)
@@ -74,8 +478,18 @@ private:
   // need the keys of the map (deletion time) to be sorted in ascending order.
   map<Timeout, vector<PathInfo> > paths;
 
+  // Promises of the paths currently being removed by the workers.
+  hashset<Promise<Nothing>*> removing;
+
   void reset();
   Timer timer;
+
+  const Option<string> trash;
+  const Option<uint32_t> iops;
+
+  GarbageCollectorWorkers workers;
+
+  GarbageCollector::Statistics stats;
 };
 
 
@@ -87,6 +501,36 @@ GarbageCollectorProcess::~GarbageCollectorProcess()
       delete info.promise;
     }
   }
+
+  foreach (Promise<Nothing>* promise, removing) {
+    promise->future().discard();
+    delete promise;
+  }
+}
+
+
+void GarbageCollectorProcess::initialize()
+{
+  if (trash.isSome()) {
+    Try<Nothing> mkdir = os::mkdir(trash.get());
+    if (mkdir.isError()) {
+      LOG(WARNING) << "Failed to create trash directory " << trash.get()
+                   << ": " << mkdir.error();
+      return;
+    }
+
+    // Finish removing anything left over in the trash (e.g., from
+    // before the slave was restarted).
+    foreach (const string& entry, os::ls(trash.get())) {
+      const string& path = path::join(trash.get(), entry);
+
+      LOG(INFO) << "Deleting " << path << " left in the trash";
+
+      _remove(path)
+        .onAny(defer(self(), &Self::removed, path, (Promise<Nothing>*) NULL,
+                     params::_1));
+    }
+  }
 }
 
 
@@ -137,15 +581,34 @@ void GarbageCollectorProcess::remove(const Timeout& removalTime)
 
       LOG(INFO) << "Deleting " << path;
 
-      Try<Nothing> result = os::rmdir(path);
-      if (result.isError()) {
-        LOG(WARNING) << "Failed to delete " << path << ": " << result.error();
-        promise->fail(result.error());
-      } else {
-        LOG(INFO) << "Deleted " << path;
-        promise->set(result.get());
+      string target = path;
+
+      // Move the path into the trash first so that it is gone from
+      // the namespace right away, even if the removal itself takes
+      // a long time. If the rename fails (e.g., the trash is on a
+      // different file system) we remove the path in place.
+      if (trash.isSome()) {
+        const string& renamed =
+          path::join(trash.get(), UUID::random().toString());
+
+        if (::rename(path.c_str(), renamed.c_str()) == 0) {
+          target = renamed;
+        } else if (errno == ENOENT) {
+          LOG(WARNING) << "Failed to delete " << path << ": "
+                       << strerror(errno);
+          promise->fail(strerror(errno));
+          delete promise;
+          continue;
+        } else {
+          LOG(WARNING) << "Failed to move " << path << " to the trash: "
+                       << strerror(errno);
+        }
       }
-      delete promise;
+
+      removing.insert(promise);
+
+      _remove(target)
+        .onAny(defer(self(), &Self::removed, path, promise, params::_1));
     }
     paths.erase(removalTime);
   } else {
@@ -159,6 +622,41 @@ void GarbageCollectorProcess::remove(const Timeout& removalTime)
 }
 
 
+Future<GarbageCollector::Statistics> GarbageCollectorProcess::_remove(
+    const string& path)
+{
+  return workers.remove(path);
+}
+
+
+void GarbageCollectorProcess::removed(
+    const string& path,
+    Promise<Nothing>* promise,
+    const Future<GarbageCollector::Statistics>& future)
+{
+  if (future.isReady()) {
+    stats.paths++;
+    stats.bytes += future.get().bytes;
+    stats.inodes += future.get().inodes;
+  }
+
+  if (promise == NULL) {
+    return;
+  }
+
+  if (future.isReady()) {
+    promise->set(Nothing());
+  } else {
+    promise->fail(future.isFailed()
+                  ? future.failure()
+                  : "Removal of " + path + " was discarded");
+  }
+
+  removing.erase(promise);
+  delete promise;
+}
+
+
 void GarbageCollectorProcess::prune(const Duration& d)
 {
   foreachkey (const Timeout& removalTime, paths) {
@@ -171,9 +669,26 @@ void GarbageCollectorProcess::prune(const Duration& d)
 }
 
 
+GarbageCollector::Statistics GarbageCollectorProcess::statistics()
+{
+  return stats;
+}
+
+
 GarbageCollector::GarbageCollector()
 {
-  process = new GarbageCollectorProcess();
+  process = new GarbageCollectorProcess(
+      Option<string>::none(), 1, Option<uint32_t>::none());
+  spawn(process);
+}
+
+
+GarbageCollector::GarbageCollector(
+    const Option<string>& trash,
+    uint32_t workers,
+    const Option<uint32_t>& iops)
+{
+  process = new GarbageCollectorProcess(trash, workers, iops);
   spawn(process);
 }
 
@@ -199,6 +714,12 @@ void GarbageCollector::prune(const Duration& d)
   return dispatch(process, &GarbageCollectorProcess::prune, d);
 }
 
+
+Future<GarbageCollector::Statistics> GarbageCollector::statistics() const
+{
+  return dispatch(process, &GarbageCollectorProcess::statistics);
+}
+
 } // namespace mesos {
 } // namespace internal {
 } // namespace slave {
@@ -25,6 +25,7 @@
 
 #include <stout/duration.hpp>
 #include <stout/nothing.hpp>
+#include <stout/option.hpp>
 #include <stout/try.hpp>
 
 namespace mesos {
@@ -44,7 +45,29 @@ class GarbageCollectorProcess;
 class GarbageCollector
 {
 public:
+  // Amount of storage reclaimed by the garbage collector.
+  struct Statistics
+  {
+    Statistics() : paths(0), bytes(0), inodes(0) {}
+
+    uint64_t paths;  // Number of scheduled paths removed.
+    uint64_t bytes;  // Number of bytes (allocated on disk) freed.
+    uint64_t inodes; // Number of files and directories removed.
+  };
+
   GarbageCollector();
+
+  // Paths get removed by 'workers' dedicated threads so that neither
+  // the garbage collector nor any other process ever blocks on the
+  // file system. If 'trash' is specified, paths are first renamed
+  // into that directory (which must be on the same file system) so
+  // that they disappear from the namespace immediately. The number
+  // of file system operations can be throttled using 'iops', which
+  // limits all the workers together.
+  GarbageCollector(const Option<std::string>& trash,
+                   uint32_t workers,
+                   const Option<uint32_t>& iops);
+
   ~GarbageCollector();
 
   // Schedules the specified path for removal after the specified
@@ -57,6 +80,9 @@ public:
   // is within the next 'd' duration of time.
   void prune(const Duration& d);
 
+  // Returns the amount of storage reclaimed so far.
+  process::Future<Statistics> statistics() const;
+
 private:
   GarbageCollectorProcess* process;
 };
@@ -23,8 +23,10 @@
 
 #include <stout/foreach.hpp>
 #include <stout/json.hpp>
+#include <stout/lambda.hpp>
 #include <stout/net.hpp>
 #include <stout/numify.hpp>
+#include <stout/option.hpp>
 #include <stout/stringify.hpp>
 #include <stout/strings.hpp>
 
@@ -33,6 +35,7 @@
 #include "common/resources.hpp"
 #include "common/type_utils.hpp"
 
+#include "slave/gc.hpp"
 #include "slave/http.hpp"
 #include "slave/slave.hpp"
 
@@ -270,6 +273,20 @@ Future<Response> vars(
 
 namespace json {
 
+// Continuation of 'stats' below.
+static Future<Response> _stats(
+    JSON::Object object,
+    const Option<string>& jsonp,
+    const GarbageCollector::Statistics& statistics)
+{
+  object.values["gc_removed_paths"] = statistics.paths;
+  object.values["gc_reclaimed_bytes"] = statistics.bytes;
+  object.values["gc_reclaimed_inodes"] = statistics.inodes;
+
+  return OK(object, jsonp);
+}
+
+
 Future<Response> stats(
     const Slave& slave,
     const Request& request)
@@ -287,8 +304,13 @@ Future<Response> stats(
   object.values["lost_tasks"] = slave.stats.tasks[TASK_LOST];
   object.values["valid_status_updates"] = slave.stats.validStatusUpdates;
   object.values["invalid_status_updates"] = slave.stats.invalidStatusUpdates;
+  object.values["memory_pressure_events"] = slave.stats.memoryPressureEvents;
 
-  return OK(object, request.query.get("jsonp"));
+  // Add the garbage collection statistics once they're available.
+  lambda::function<Future<Response>(const GarbageCollector::Statistics&)>
+    f = lambda::bind(&_stats, object, request.query.get("jsonp"), lambda::_1);
+
+  return slave.gc.statistics().then(f);
 }
 
 
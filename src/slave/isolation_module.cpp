@@ -16,6 +16,8 @@
  * limitations under the License.
  */
 
+#include <glog/logging.h>
+
 #include "isolation_module.hpp"
 #include "process_based_isolation_module.hpp"
 #ifdef __sun__
@@ -53,4 +55,16 @@ void IsolationModule::destroy(IsolationModule* module)
   }
 }
 
+
+void IsolationModule::recoverExecutor(
+    const FrameworkID& frameworkId,
+    const ExecutorInfo& executorInfo,
+    const std::string& directory,
+    pid_t pid)
+{
+  LOG(WARNING) << "Isolation module cannot recover executor '"
+               << executorInfo.executor_id() << "' of framework "
+               << frameworkId << " (forked at " << pid << ")";
+}
+
 }}} // namespace mesos { namespace internal { namespace slave {
@@ -19,6 +19,8 @@
 #ifndef __ISOLATION_MODULE_HPP__
 #define __ISOLATION_MODULE_HPP__
 
+#include <sys/types.h> // For pid_t.
+
 #include <string>
 
 #include <mesos/mesos.hpp>
@@ -68,6 +70,16 @@ public:
   virtual void resourcesChanged(const FrameworkID& frameworkId,
                                 const ExecutorID& executorId,
                                 const Resources& resources) = 0;
+
+  // Called by a slave that has recovered its checkpointed state for
+  // each executor (forked as 'pid' by a previous instance of the
+  // slave) that is still running, so that the executor can later be
+  // killed via 'killExecutor'. The default implementation does
+  // nothing, i.e., the executor can't be killed by this module.
+  virtual void recoverExecutor(const FrameworkID& frameworkId,
+                               const ExecutorInfo& executorInfo,
+                               const std::string& directory,
+                               pid_t pid);
 };
 
 } // namespace slave {
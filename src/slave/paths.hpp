@@ -46,6 +46,9 @@ const std::string ROOT_PATH =
 const std::string SLAVEID_PATH =
   ROOT_PATH + "/slaves/slave.id";
 
+const std::string TRASH_PATH =
+  ROOT_PATH + "/trash";
+
 const std::string SLAVE_PATH =
   ROOT_PATH + "/slaves/%s";
 
@@ -55,6 +58,9 @@ const std::string FRAMEWORK_PATH =
 const std::string FRAMEWORK_PID_PATH =
   FRAMEWORK_PATH + "/framework.pid";
 
+const std::string FRAMEWORK_INFO_PATH =
+  FRAMEWORK_PATH + "/framework.info";
+
 const std::string EXECUTOR_PATH =
   FRAMEWORK_PATH + "/executors/%s";
 
@@ -64,6 +70,9 @@ const std::string EXECUTOR_RUN_PATH =
 const std::string EXECUTOR_LATEST_RUN_PATH =
   EXECUTOR_PATH + "/runs/" + EXECUTOR_LATEST_SYMLINK;
 
+const std::string EXECUTOR_INFO_PATH =
+  EXECUTOR_RUN_PATH + "/executor.info";
+
 const std::string PIDS_PATH =
   EXECUTOR_RUN_PATH + "/pids";
 
@@ -93,6 +102,12 @@ inline std::string getSlaveIDPath(const std::string& rootDir)
 }
 
 
+inline std::string getTrashPath(const std::string& rootDir)
+{
+  return strings::format(TRASH_PATH, rootDir).get();
+}
+
+
 inline std::string getSlavePath(const std::string& rootDir,
                                 const SlaveID& slaveId)
 {
@@ -118,6 +133,15 @@ inline std::string getFrameworkPIDPath(const std::string& rootDir,
 }
 
 
+inline std::string getFrameworkInfoPath(const std::string& rootDir,
+                                        const SlaveID& slaveId,
+                                        const FrameworkID& frameworkId)
+{
+  return strings::format(FRAMEWORK_INFO_PATH, rootDir, slaveId,
+                         frameworkId).get();
+}
+
+
 inline std::string getExecutorPath(const std::string& rootDir,
                                    const SlaveID& slaveId,
                                    const FrameworkID& frameworkId,
@@ -149,6 +173,17 @@ inline std::string getExecutorLatestRunPath(const std::string& rootDir,
 }
 
 
+inline std::string getExecutorInfoPath(const std::string& rootDir,
+                                       const SlaveID& slaveId,
+                                       const FrameworkID& frameworkId,
+                                       const ExecutorID& executorId,
+                                       const UUID& executorUUID)
+{
+  return strings::format(EXECUTOR_INFO_PATH, rootDir, slaveId, frameworkId,
+                         executorId, executorUUID.toString()).get();
+}
+
+
 inline std::string getLibprocessPIDPath(const std::string& rootDir,
                                         const SlaveID& slaveId,
                                         const FrameworkID& frameworkId,
@@ -248,6 +248,33 @@ void ProcessBasedIsolationModule::resourcesChanged(
 }
 
 
+void ProcessBasedIsolationModule::recoverExecutor(
+    const FrameworkID& frameworkId,
+    const ExecutorInfo& executorInfo,
+    const string& directory,
+    pid_t pid)
+{
+  CHECK(initialized) << "Cannot recover executors before initialization!";
+
+  const ExecutorID& executorId = executorInfo.executor_id();
+
+  LOG(INFO) << "Recovered executor " << executorId
+            << " of framework " << frameworkId << " forked at " << pid;
+
+  // NOTE: The executor is no longer our child (it got reparented
+  // when the previous slave exited), so the reaper won't tell us
+  // when it exits; the slave learns about that from libprocess
+  // instead. We only keep track of it here so that we can kill it.
+  ProcessInfo* info = new ProcessInfo();
+  info->frameworkId = frameworkId;
+  info->executorId = executorId;
+  info->directory = directory;
+  info->pid = pid;
+
+  infos[frameworkId][executorId] = info;
+}
+
+
 ExecutorLauncher* ProcessBasedIsolationModule::createExecutorLauncher(
     const FrameworkID& frameworkId,
     const FrameworkInfo& frameworkInfo,
@@ -62,6 +62,11 @@ public:
                                 const ExecutorID& executorId,
                                 const Resources& resources);
 
+  virtual void recoverExecutor(const FrameworkID& frameworkId,
+                               const ExecutorInfo& executorInfo,
+                               const std::string& directory,
+                               pid_t pid);
+
   virtual void processExited(pid_t pid, int status);
 
 protected:
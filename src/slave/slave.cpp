@@ -22,6 +22,7 @@
 #include <algorithm>
 #include <iomanip>
 
+#include <process/async.hpp>
 #include <process/defer.hpp>
 #include <process/delay.hpp>
 #include <process/dispatch.hpp>
@@ -50,6 +51,7 @@
 namespace params = std::tr1::placeholders;
 
 using std::string;
+using std::vector;
 
 using process::wait; // Necessary on some OS's to disambiguate.
 
@@ -71,7 +73,10 @@ Slave::Slave(const Resources& _resources,
     resources(_resources),
     completedFrameworks(MAX_COMPLETED_FRAMEWORKS),
     isolationModule(_isolationModule),
-    files(_files) {}
+    files(_files),
+    gc(paths::getTrashPath(flags.work_dir),
+       flags.gc_workers,
+       flags.gc_max_iops) {}
 
 
 Slave::Slave(const flags::Flags<logging::Flags, slave::Flags>& _flags,
@@ -83,7 +88,10 @@ Slave::Slave(const flags::Flags<logging::Flags, slave::Flags>& _flags,
     local(_local),
     completedFrameworks(MAX_COMPLETED_FRAMEWORKS),
     isolationModule(_isolationModule),
-    files(_files)
+    files(_files),
+    gc(paths::getTrashPath(flags.work_dir),
+       flags.gc_workers,
+       flags.gc_max_iops)
 {
   if (flags.resources.isNone()) {
     // TODO(benh): Move this computation into Flags as the "default".
@@ -158,6 +166,10 @@ Slave::~Slave()
   foreachvalue (Framework* framework, frameworks) {
     delete framework;
   }
+
+  foreachvalue (StatusUpdateStream* stream, streams) {
+    delete stream;
+  }
 }
 
 
@@ -201,6 +213,10 @@ void Slave::initialize()
            local,
            self());
 
+  if (flags.checkpoint) {
+    recover();
+  }
+
   // Start disk monitoring.
   // NOTE: We send a delayed message here instead of directly calling
   // checkDiskUsage, to make disabling this feature easy (e.g by specifying
@@ -219,6 +235,7 @@ void Slave::initialize()
   stats.invalidStatusUpdates = 0;
   stats.validFrameworkMessages = 0;
   stats.invalidFrameworkMessages = 0;
+  stats.memoryPressureEvents = 0;
 
   startTime = Clock::now();
 
@@ -275,15 +292,28 @@ void Slave::initialize()
       &StatusUpdateAcknowledgementMessage::task_id,
       &StatusUpdateAcknowledgementMessage::uuid);
 
+  install<StatusUpdateAcknowledgementsMessage>(
+      &Slave::statusUpdateAcknowledgements,
+      &StatusUpdateAcknowledgementsMessage::acknowledgements);
+
   install<RegisterExecutorMessage>(
       &Slave::registerExecutor,
       &RegisterExecutorMessage::framework_id,
       &RegisterExecutorMessage::executor_id);
 
+  install<ReregisterExecutorMessage>(
+      &Slave::reregisterExecutor,
+      &ReregisterExecutorMessage::framework_id,
+      &ReregisterExecutorMessage::executor_id);
+
   install<StatusUpdateMessage>(
       &Slave::statusUpdate,
       &StatusUpdateMessage::update);
 
+  install<StatusUpdatesMessage>(
+      &Slave::statusUpdates,
+      &StatusUpdatesMessage::updates);
+
   install<ExecutorToFrameworkMessage>(
       &Slave::executorMessage,
       &ExecutorToFrameworkMessage::slave_id,
@@ -318,18 +348,25 @@ void Slave::finalize()
 {
   LOG(INFO) << "Slave terminating";
 
-  foreachkey (const FrameworkID& frameworkId, frameworks) {
-    // TODO(benh): Because a shut down isn't instantaneous (but has
-    // a shut down/kill phases) we might not actually propogate all
-    // the status updates appropriately here. Consider providing
-    // an alternative function which skips the shut down phase and
-    // simply does a kill (sending all status updates
-    // immediately). Of course, this still isn't sufficient
-    // because those status updates might get lost and we won't
-    // resend them unless we build that into the system.
-    shutdownFramework(frameworkId);
+  // With checkpointing the executors keep running so that the next
+  // instance of the slave can reconnect to them (see 'recover').
+  if (!flags.checkpoint) {
+    foreachkey (const FrameworkID& frameworkId, frameworks) {
+      // TODO(benh): Because a shut down isn't instantaneous (but has
+      // a shut down/kill phases) we might not actually propogate all
+      // the status updates appropriately here. Consider providing
+      // an alternative function which skips the shut down phase and
+      // simply does a kill (sending all status updates
+      // immediately). Of course, this still isn't sufficient
+      // because those status updates might get lost and we won't
+      // resend them unless we build that into the system.
+      shutdownFramework(frameworkId);
+    }
   }
 
+  // Write out any status update records that are still queued.
+  flushRecords();
+
   // Stop the isolation module.
   terminate(isolationModule);
   wait(isolationModule);
@@ -395,6 +432,10 @@ void Slave::registered(const SlaveID& slaveId)
   LOG(INFO) << "Registered with master; given slave ID " << slaveId;
   id = slaveId;
 
+  if (flags.checkpoint) {
+    state::writeSlaveID(flags.work_dir, id);
+  }
+
   connected = true;
 
   // Schedule all old slave directories to get garbage
@@ -488,6 +529,11 @@ void Slave::runTask(
   if (framework == NULL) {
     framework = new Framework(frameworkId, frameworkInfo, pid, flags);
     frameworks[frameworkId] = framework;
+
+    if (flags.checkpoint) {
+      state::writeFrameworkPID(flags.work_dir, id, frameworkId, pid);
+      state::writeFrameworkInfo(flags.work_dir, id, frameworkId, frameworkInfo);
+    }
   }
 
   const ExecutorInfo& executorInfo = framework->getExecutorInfo(task);
@@ -523,7 +569,7 @@ void Slave::runTask(
       executor->queuedTasks[task.task_id()] = task;
     } else {
       // Add the task and send it to the executor.
-      executor->addTask(task);
+      checkpointTask(*executor, *executor->addTask(task));
 
       stats.tasks[TASK_STAGING]++;
 
@@ -538,17 +584,17 @@ void Slave::runTask(
                 << "' to executor '" << executorId
                 << "' of framework " << framework->id;
 
-      RunTaskMessage message;
-      message.mutable_framework()->MergeFrom(framework->info);
-      message.mutable_framework_id()->MergeFrom(framework->id);
-      message.set_pid(framework->pid);
-      message.mutable_task()->MergeFrom(task);
-      send(executor->pid, message);
+      forwardTask(*framework, *executor, task);
     }
   } else {
     // Launch an executor for this task.
     executor = framework->createExecutor(id, executorInfo);
 
+    if (flags.checkpoint) {
+      state::writeExecutorInfo(
+          flags.work_dir, id, frameworkId, executor->uuid, executorInfo);
+    }
+
     files->attach(executor->directory, executor->directory)
       .onAny(defer(self(),
                    &Self::fileAttached,
@@ -635,7 +681,10 @@ void Slave::killTask(const FrameworkID& frameworkId, const TaskID& taskId)
     send(master, message);
   } else {
     // Otherwise, send a message to the executor and wait for
-    // it to send us a status update.
+    // it to send us a status update. Any tasks still queued for the
+    // executor go out first so that the kill can't overtake them.
+    sendQueuedTasks(*framework, *executor);
+
     KillTaskMessage message;
     message.mutable_framework_id()->MergeFrom(frameworkId);
     message.mutable_task_id()->MergeFrom(taskId);
@@ -701,6 +750,9 @@ void Slave::schedulerMessage(
                  << " because executor is not running";
     stats.invalidFrameworkMessages++;
   } else {
+    // Make sure the message doesn't overtake any queued tasks.
+    sendQueuedTasks(*framework, *executor);
+
     FrameworkToExecutorMessage message;
     message.mutable_slave_id()->MergeFrom(slaveId);
     message.mutable_framework_id()->MergeFrom(frameworkId);
@@ -720,6 +772,10 @@ void Slave::updateFramework(const FrameworkID& frameworkId, const string& pid)
     LOG(INFO) << "Updating framework " << frameworkId
               << " pid to " <<pid;
     framework->pid = pid;
+
+    if (flags.checkpoint) {
+      state::writeFrameworkPID(flags.work_dir, id, frameworkId, pid);
+    }
   }
 }
 
@@ -730,24 +786,51 @@ void Slave::statusUpdateAcknowledgement(
     const TaskID& taskId,
     const string& uuid)
 {
+  if (!streams.contains(frameworkId) ||
+      !streams[frameworkId]->contains(UUID::fromBytes(uuid))) {
+    return;
+  }
+
+  LOG(INFO) << "Got acknowledgement of status update"
+            << " for task " << taskId
+            << " of framework " << frameworkId;
+
+  StatusUpdateStream* stream = streams[frameworkId];
+
+  Option<string> path = stream->acknowledge(UUID::fromBytes(uuid));
+  if (path.isSome()) {
+    StatusUpdateRecord record;
+    record.set_type(StatusUpdateRecord::ACK);
+    record.set_uuid(uuid);
+    checkpointRecord(path.get(), record);
+  }
+
+  // NOTE: An empty stream gets removed by its retry timer.
+
+  // Cleanup if this framework has no executors running and no pending updates.
   Framework* framework = getFramework(frameworkId);
-  if (framework != NULL) {
-    if (framework->updates.contains(UUID::fromBytes(uuid))) {
-      LOG(INFO) << "Got acknowledgement of status update"
-                << " for task " << taskId
-                << " of framework " << frameworkId;
+  if (framework != NULL &&
+      framework->executors.size() == 0 &&
+      stream->empty()) {
+    frameworks.erase(framework->id);
 
-      framework->updates.erase(UUID::fromBytes(uuid));
+    // Pass ownership of the framework pointer.
+    completedFrameworks.push_back(
+        std::tr1::shared_ptr<Framework>(framework));
+  }
+}
 
-      // Cleanup if this framework has no executors running and no pending updates.
-      if (framework->executors.size() == 0 && framework->updates.empty()) {
-        frameworks.erase(framework->id);
 
-        // Pass ownership of the framework pointer.
-        completedFrameworks.push_back(
-            std::tr1::shared_ptr<Framework>(framework));
-      }
-    }
+void Slave::statusUpdateAcknowledgements(
+    const google::protobuf::RepeatedPtrField<
+        StatusUpdateAcknowledgementMessage>& messages)
+{
+  foreach (const StatusUpdateAcknowledgementMessage& message, messages) {
+    statusUpdateAcknowledgement(
+        message.slave_id(),
+        message.framework_id(),
+        message.task_id(),
+        message.uuid());
   }
 }
 
@@ -790,10 +873,15 @@ void Slave::registerExecutor(
     // Save the pid for the executor.
     executor->pid = from;
 
+    if (flags.checkpoint) {
+      state::writeLibprocessPID(flags.work_dir, id, frameworkId, executorId,
+                                executor->uuid, executor->pid);
+    }
+
     // First account for the tasks we're about to start.
     foreachvalue (const TaskInfo& task, executor->queuedTasks) {
       // Add the task to the executor.
-      executor->addTask(task);
+      checkpointTask(*executor, *executor->addTask(task));
     }
 
     // Now that the executor is up, set its resource limits including the
@@ -812,22 +900,84 @@ void Slave::registerExecutor(
     message.mutable_framework_info()->MergeFrom(framework->info);
     message.mutable_slave_id()->MergeFrom(id);
     message.mutable_slave_info()->MergeFrom(info);
+    message.set_checkpoint(flags.checkpoint);
     send(executor->pid, message);
 
     LOG(INFO) << "Flushing queued tasks for framework " << framework->id;
 
+    vector<TaskInfo> tasks;
     foreachvalue (const TaskInfo& task, executor->queuedTasks) {
       stats.tasks[TASK_STAGING]++;
+      tasks.push_back(task);
+    }
+
+    if (!tasks.empty()) {
+      sendTasks(*framework, *executor, tasks);
+    }
+
+    executor->queuedTasks.clear();
+  }
+}
+
+
+void Slave::reregisterExecutor(
+    const FrameworkID& frameworkId,
+    const ExecutorID& executorId)
+{
+  LOG(INFO) << "Got re-registration for executor '" << executorId
+            << "' of framework " << frameworkId;
+
+  Framework* framework = getFramework(frameworkId);
+  if (framework == NULL) {
+    LOG(WARNING) << "Framework " << frameworkId
+                 << " does not exist, telling executor to exit";
+    reply(ShutdownExecutorMessage());
+    return;
+  }
+
+  Executor* executor = framework->getExecutor(executorId);
+
+  if (executor == NULL) {
+    LOG(WARNING) << "WARNING! Unexpected executor '" << executorId
+                 << "' re-registering for framework " << frameworkId;
+    reply(ShutdownExecutorMessage());
+  } else if (executor->pid) {
+    LOG(WARNING) << "WARNING! executor '" << executorId
+                 << "' of framework " << frameworkId
+                 << " is already running";
+    reply(ShutdownExecutorMessage());
+  } else {
+    executor->pid = from;
+
+    // We're not the parent of a reattached executor, so we rely on
+    // libprocess to tell us when it exits (see 'exited').
+    link(executor->pid);
+
+    if (executor->shutdown) {
+      // The framework got shut down while the executor was
+      // reconnecting, so pass that along now.
+      send(executor->pid, ShutdownExecutorMessage());
+      return;
+    }
 
-      RunTaskMessage message;
-      message.mutable_framework_id()->MergeFrom(framework->id);
-      message.mutable_framework()->MergeFrom(framework->info);
-      message.set_pid(framework->pid);
-      message.mutable_task()->MergeFrom(task);
-      send(executor->pid, message);
+    // Launch the tasks that arrived while the executor was
+    // reconnecting.
+    vector<TaskInfo> tasks;
+    foreachvalue (const TaskInfo& task, executor->queuedTasks) {
+      checkpointTask(*executor, *executor->addTask(task));
+      stats.tasks[TASK_STAGING]++;
+      tasks.push_back(task);
     }
 
     executor->queuedTasks.clear();
+
+    dispatch(isolationModule,
+             &IsolationModule::resourcesChanged,
+             framework->id, executor->id, executor->resources);
+
+    if (!tasks.empty()) {
+      sendTasks(*framework, *executor, tasks);
+    }
   }
 }
 
@@ -855,20 +1005,21 @@ void Slave::statusUpdate(const StatusUpdate& update)
                  framework->id, executor->id, executor->resources);
       }
 
-      // Send message and record the status for possible resending.
-      StatusUpdateMessage message;
-      message.mutable_update()->MergeFrom(update);
-      message.set_pid(self());
-      send(master, message);
-
-      UUID uuid = UUID::fromBytes(update.uuid());
-
-      // Send us a message to try and resend after some delay.
-      delay(STATUS_UPDATE_RETRY_INTERVAL,
-            self(), &Slave::statusUpdateTimeout,
-            framework->id, uuid);
+      // Checkpoint the update (if necessary) before forwarding it so
+      // that it can be resent after a restart until acknowledged.
+      Option<string> path;
+      if (flags.checkpoint) {
+        path = paths::getTaskUpdatesPath(
+            flags.work_dir, id, framework->id, executor->id, executor->uuid,
+            status.task_id());
+
+        StatusUpdateRecord record;
+        record.set_type(StatusUpdateRecord::UPDATE);
+        record.mutable_update()->MergeFrom(update);
+        checkpointRecord(path.get(), record);
+      }
 
-      framework->updates[uuid] = update;
+      forwardStatusUpdate(update, path);
 
       stats.tasks[status.state()]++;
 
@@ -886,6 +1037,15 @@ void Slave::statusUpdate(const StatusUpdate& update)
 }
 
 
+void Slave::statusUpdates(
+    const google::protobuf::RepeatedPtrField<StatusUpdate>& updates)
+{
+  foreach (const StatusUpdate& update, updates) {
+    statusUpdate(update);
+  }
+}
+
+
 void Slave::executorMessage(
     const SlaveID& slaveId,
     const FrameworkID& frameworkId,
@@ -921,34 +1081,205 @@ void Slave::ping(const UPID& from, const string& body)
 }
 
 
-void Slave::statusUpdateTimeout(
-    const FrameworkID& frameworkId,
-    const UUID& uuid)
+void Slave::statusUpdateTimeout(const FrameworkID& frameworkId)
 {
-  // Check and see if we still need to send this update.
-  Framework* framework = getFramework(frameworkId);
-  if (framework != NULL) {
-    if (framework->updates.contains(uuid)) {
-      const StatusUpdate& update = framework->updates[uuid];
+  // Check and see if we still need to send any updates.
+  if (!streams.contains(frameworkId)) {
+    return;
+  }
 
-      LOG(INFO) << "Resending status update"
-                << " for task " << update.status().task_id()
-                << " of framework " << update.framework_id();
+  StatusUpdateStream* stream = streams[frameworkId];
 
-      StatusUpdateMessage message;
-      message.mutable_update()->MergeFrom(update);
-      message.set_pid(self());
-      send(master, message);
+  if (stream->empty()) {
+    streams.erase(frameworkId);
+    delete stream;
+    return;
+  }
+
+  // Only resend the updates that haven't been (re)sent within the
+  // last retry interval, e.g., not the ones that were just forwarded.
+  double now = Clock::now();
+
+  vector<StatusUpdate> updates =
+    stream->unsent(now - STATUS_UPDATE_RETRY_INTERVAL.secs());
+
+  if (!updates.empty()) {
+    LOG(INFO) << "Resending " << updates.size() << " status update(s)"
+              << " of framework " << frameworkId;
+
+    sendStatusUpdates(updates);
+
+    foreach (const StatusUpdate& update, updates) {
+      stream->sent(UUID::fromBytes(update.uuid()), now);
+    }
+  }
+
+  // Try and resend once the oldest unacknowledged update is due.
+  Option<double> oldest = stream->oldest();
+  CHECK_SOME(oldest);
+
+  delay(Seconds(oldest.get() + STATUS_UPDATE_RETRY_INTERVAL.secs() - now),
+        self(), &Slave::statusUpdateTimeout,
+        frameworkId);
+}
+
+
+void Slave::forwardStatusUpdate(
+    const StatusUpdate& update,
+    const Option<string>& path)
+{
+  const FrameworkID& frameworkId = update.framework_id();
+
+  // A single timer per stream resends the pending updates (rather
+  // than one timer per update).
+  if (!streams.contains(frameworkId)) {
+    streams[frameworkId] = new StatusUpdateStream();
+    delay(STATUS_UPDATE_RETRY_INTERVAL,
+          self(), &Slave::statusUpdateTimeout,
+          frameworkId);
+  }
+
+  streams[frameworkId]->add(update, path);
+
+  // NOTE: The update gets sent when the queued messages have been
+  // processed, which is what its retry interval is measured from.
+  streams[frameworkId]->sent(UUID::fromBytes(update.uuid()), Clock::now());
+
+  // Forward once we're done processing the messages that are already
+  // queued so that a burst of updates goes out in a few messages.
+  if (outgoing.empty()) {
+    dispatch(self(), &Slave::flushStatusUpdates);
+  }
+
+  outgoing.push_back(update);
+}
 
-      // Send us a message to try and resend after some delay.
-      delay(STATUS_UPDATE_RETRY_INTERVAL,
-            self(), &Slave::statusUpdateTimeout,
-            framework->id, uuid);
+
+void Slave::flushStatusUpdates()
+{
+  // Make sure the updates have been checkpointed before we let the
+  // master (and hence the scheduler) see them.
+  flushRecords();
+
+  sendStatusUpdates(outgoing);
+  outgoing.clear();
+}
+
+
+void Slave::sendStatusUpdates(const vector<StatusUpdate>& updates)
+{
+  // NOTE: A single update is sent as a StatusUpdateMessage so that
+  // masters that don't know about batches can still handle it.
+  if (updates.size() == 1) {
+    StatusUpdateMessage& message = reuse<StatusUpdateMessage>();
+    message.mutable_update()->MergeFrom(updates.front());
+    message.set_pid(self());
+    send(master, message);
+    return;
+  }
+
+  for (size_t i = 0; i < updates.size(); i += STATUS_UPDATE_BATCH_SIZE) {
+    StatusUpdatesMessage& message = reuse<StatusUpdatesMessage>();
+    for (size_t j = i;
+         j < std::min(updates.size(), i + STATUS_UPDATE_BATCH_SIZE);
+         j++) {
+      message.add_updates()->MergeFrom(updates[j]);
     }
+    message.set_pid(self());
+    send(master, message);
+  }
+}
+
+
+void Slave::forwardTask(
+    const Framework& framework,
+    const Executor& executor,
+    const TaskInfo& task)
+{
+  if (tasks.empty()) {
+    dispatch(self(), &Slave::flushTasks);
+  }
+
+  tasks[framework.id][executor.id].push_back(task);
+}
+
+
+void Slave::flushTasks()
+{
+  foreachkey (const FrameworkID& frameworkId, tasks) {
+    foreachkey (const ExecutorID& executorId, tasks[frameworkId]) {
+      // The executor might have exited (or started shutting down)
+      // since the tasks were queued, in which case its tasks get
+      // handled as part of terminating the executor.
+      Framework* framework = getFramework(frameworkId);
+      if (framework == NULL) {
+        continue;
+      }
+
+      Executor* executor = framework->getExecutor(executorId);
+      if (executor == NULL || executor->shutdown || !executor->pid) {
+        continue;
+      }
+
+      sendTasks(*framework, *executor, tasks[frameworkId][executorId]);
+    }
+  }
+
+  tasks.clear();
+}
+
+
+void Slave::sendQueuedTasks(
+    const Framework& framework,
+    const Executor& executor)
+{
+  if (!tasks.contains(framework.id) ||
+      !tasks[framework.id].contains(executor.id)) {
+    return;
+  }
+
+  if (!executor.shutdown) {
+    sendTasks(framework, executor, tasks[framework.id][executor.id]);
+  }
+
+  tasks[framework.id].erase(executor.id);
+
+  if (tasks[framework.id].empty()) {
+    tasks.erase(framework.id);
   }
 }
 
 
+void Slave::sendTasks(
+    const Framework& framework,
+    const Executor& executor,
+    const vector<TaskInfo>& tasks)
+{
+  CHECK(!tasks.empty());
+
+  // NOTE: A single task is still sent as a RunTaskMessage (see the
+  // NOTE in 'sendStatusUpdates').
+  if (tasks.size() == 1) {
+    RunTaskMessage message;
+    message.mutable_framework_id()->MergeFrom(framework.id);
+    message.mutable_framework()->MergeFrom(framework.info);
+    message.set_pid(framework.pid);
+    message.mutable_task()->MergeFrom(tasks.front());
+    send(executor.pid, message);
+    return;
+  }
+
+  RunTasksMessage message;
+  message.mutable_framework_id()->MergeFrom(framework.id);
+  message.mutable_framework()->MergeFrom(framework.info);
+  message.set_pid(framework.pid);
+  foreach (const TaskInfo& task, tasks) {
+    message.add_tasks()->MergeFrom(task);
+  }
+  send(executor.pid, message);
+}
+
+
 void Slave::exited(const UPID& pid)
 {
   LOG(INFO) << "Process exited: " << from;
@@ -957,6 +1288,29 @@ void Slave::exited(const UPID& pid)
     LOG(WARNING) << "WARNING! Master disconnected!"
                  << " Waiting for a new master to be elected.";
     // TODO(benh): After so long waiting for a master, commit suicide.
+    return;
+  }
+
+  // The only executors we link to are the ones we reattached to
+  // after a restart (see 'reregisterExecutor'), which we learn have
+  // terminated only this way.
+  foreachvalue (Framework* framework, frameworks) {
+    foreachvalue (Executor* executor, framework->executors) {
+      if (executor->pid == pid) {
+        const FrameworkID frameworkId = framework->id;
+        const ExecutorID executorId = executor->id;
+
+        executorTerminated(frameworkId, executorId, 0, false,
+                           "Executor exited");
+
+        // Make sure the rest of the executor's processes are gone.
+        dispatch(isolationModule,
+                 &IsolationModule::killExecutor,
+                 frameworkId,
+                 executorId);
+        return;
+      }
+    }
   }
 }
 
@@ -978,7 +1332,173 @@ void Slave::executorStarted(
     const ExecutorID& executorId,
     pid_t pid)
 {
+  if (!flags.checkpoint) {
+    return;
+  }
+
+  Framework* framework = getFramework(frameworkId);
+  if (framework != NULL) {
+    Executor* executor = framework->getExecutor(executorId);
+    if (executor != NULL) {
+      state::writeForkedPID(
+          flags.work_dir, id, frameworkId, executorId, executor->uuid, pid);
+    }
+  }
+}
+
+
+void Slave::recover()
+{
+  CHECK(flags.checkpoint);
+
+  if (!os::exists(paths::getSlaveIDPath(flags.work_dir))) {
+    LOG(INFO) << "No checkpointed slave id found in " << flags.work_dir;
+    return;
+  }
+
+  const SlaveID& slaveId = state::readSlaveID(flags.work_dir);
+  if (slaveId == "") {
+    return;
+  }
+
+  LOG(INFO) << "Recovering state of slave " << slaveId;
+
+  // Re-using the slave id lets the slave re-register with the master
+  // (rather than register as a new slave) once a master is detected.
+  id = slaveId;
+  state = state::parse(flags.work_dir, id);
+
+  typedef state::SlaveState::FrameworkState::RunState::ExecutorState
+    ExecutorState;
+
+  foreachpair (const FrameworkID& frameworkId,
+               const state::SlaveState::FrameworkState& framework,
+               state.frameworks) {
+    foreachpair (const ExecutorID& executorId,
+                 const state::SlaveState::FrameworkState::RunState& executor,
+                 framework.executors) {
+      LOG(INFO) << "Recovered " << executor.runs.size() << " run(s)"
+                << " of executor '" << executorId << "'"
+                << " of framework " << frameworkId;
+
+      foreachpair (const UUID& uuid, const ExecutorState& run, executor.runs) {
+        // Resume the stream of the status updates that were never
+        // acknowledged (these get resent once the retry timer fires,
+        // by which time a master has hopefully been detected).
+        foreachpair (const TaskID& taskId,
+                     const vector<StatusUpdate>& updates,
+                     run.updates) {
+          const string& path = paths::getTaskUpdatesPath(
+              flags.work_dir, id, frameworkId, executorId, uuid, taskId);
+
+          foreach (const StatusUpdate& update, updates) {
+            if (!streams.contains(frameworkId)) {
+              streams[frameworkId] = new StatusUpdateStream();
+              delay(STATUS_UPDATE_RETRY_INTERVAL,
+                    self(), &Slave::statusUpdateTimeout,
+                    frameworkId);
+            }
+
+            streams[frameworkId]->add(update, path);
+          }
+        }
+
+        // Reattach to the run if it's still running, which needs all
+        // of the checkpointed information about it.
+        if (framework.pid.isNone() || framework.info.isNone() ||
+            run.info.isNone() || run.forkedPid.isNone() ||
+            run.libprocessPid.isNone()) {
+          continue;
+        }
+
+        // TODO(vinod): Guard against the (unlikely) reuse of the
+        // forked pid by an unrelated process.
+        if (::kill(run.forkedPid.get(), 0) != 0) {
+          continue;
+        }
+
+        if (!frameworks.contains(frameworkId)) {
+          frameworks[frameworkId] = new Framework(
+              frameworkId, framework.info.get(), framework.pid.get(), flags);
+        }
+
+        Framework* f = frameworks[frameworkId];
+
+        if (f->getExecutor(executorId) != NULL) {
+          LOG(WARNING) << "Ignoring run " << uuid << " of executor '"
+                       << executorId << "' of framework " << frameworkId
+                       << " since another run is still running";
+          continue;
+        }
+
+        Executor* e = f->recoverExecutor(id, run.info.get(), uuid);
+
+        foreachvalue (const Task& task, run.infos) {
+          if (!protobuf::isTerminalState(task.state())) {
+            e->recoverTask(task);
+          }
+        }
+
+        dispatch(isolationModule,
+                 &IsolationModule::recoverExecutor,
+                 frameworkId,
+                 e->info,
+                 e->directory,
+                 run.forkedPid.get());
+
+        LOG(INFO) << "Reconnecting to executor '" << executorId
+                  << "' of framework " << frameworkId
+                  << " at " << run.libprocessPid.get();
+
+        // The executor holds on to its status updates until it has
+        // re-registered (see 'reregisterExecutor'); if it doesn't,
+        // its tasks are lost once the executor shuts itself down.
+        ReconnectExecutorMessage message;
+        message.mutable_slave_id()->MergeFrom(id);
+        send(run.libprocessPid.get(), message);
+      }
+    }
+  }
+}
+
+
+void Slave::checkpointTask(const Executor& executor, const Task& task)
+{
+  if (flags.checkpoint) {
+    state::writeTask(
+        task,
+        paths::getTaskPath(flags.work_dir, id, executor.frameworkId,
+                           executor.id, executor.uuid, task.task_id()));
+  }
+}
+
+
+void Slave::checkpointRecord(
+    const string& path,
+    const StatusUpdateRecord& record)
+{
+  CHECK(flags.checkpoint);
 
+  // Flush once we're done processing the messages that are already
+  // queued so that a burst of updates gets written together.
+  if (records.empty()) {
+    dispatch(self(), &Slave::flushRecords);
+  }
+
+  records[path].push_back(record);
+}
+
+
+void Slave::flushRecords()
+{
+  foreachpair (const string& path,
+               const vector<StatusUpdateRecord>& batch,
+               records) {
+    Try<Nothing> write = state::writeRecords(path, batch);
+    CHECK_SOME(write) << "Failed to checkpoint status updates to " << path;
+  }
+
+  records.clear();
 }
 
 
@@ -997,6 +1517,23 @@ void Slave::sendStatusUpdate(
 }
 
 
+// Called by the isolation module when an executor exceeds its
+// allocated memory (but has not yet hit its hard limit).
+void Slave::executorMemoryPressure(
+    const FrameworkID& frameworkId,
+    const ExecutorID& executorId,
+    uint64_t usage,
+    uint64_t limit)
+{
+  LOG(WARNING) << "Executor '" << executorId
+               << "' of framework " << frameworkId
+               << " is using " << usage << " bytes of memory which exceeds"
+               << " its allocated " << limit << " bytes";
+
+  stats.memoryPressureEvents++;
+}
+
+
 // Called by the isolation module when an executor process terminates.
 void Slave::executorTerminated(
     const FrameworkID& frameworkId,
@@ -1149,9 +1686,9 @@ Duration Slave::age(double usage)
 
 void Slave::checkDiskUsage()
 {
-  // TODO(vinod): We are making usage a Future, so that we can plug in
-  // os::usage() into async.
-  Future<Try<double> >(os::usage())
+  // NOTE: os::usage() is done asynchronously since statvfs may block
+  // (e.g., while the garbage collector is hammering the disk).
+  async(&os::usage, string("/"))
     .onAny(defer(self(), &Slave::_checkDiskUsage, params::_1));
 }
 
@@ -19,8 +19,10 @@
 #ifndef __SLAVE_HPP__
 #define __SLAVE_HPP__
 
+#include <algorithm>
 #include <list>
 #include <string>
+#include <vector>
 
 #include <tr1/functional>
 
@@ -30,7 +32,9 @@
 #include <process/process.hpp>
 #include <process/protobuf.hpp>
 
+#include <stout/foreach.hpp>
 #include <stout/hashmap.hpp>
+#include <stout/option.hpp>
 #include <stout/os.hpp>
 #include <stout/path.hpp>
 #include <stout/uuid.hpp>
@@ -61,6 +65,7 @@ using namespace process;
 // Some forward declarations.
 struct Executor;
 struct Framework;
+struct StatusUpdateStream;
 
 
 class Slave : public ProtobufProcess<Slave>
@@ -111,12 +116,25 @@ public:
       const TaskID& taskId,
       const std::string& uuid);
 
+  void statusUpdateAcknowledgements(
+      const google::protobuf::RepeatedPtrField<
+          StatusUpdateAcknowledgementMessage>& messages);
+
   void registerExecutor(
       const FrameworkID& frameworkId,
       const ExecutorID& executorId);
 
+  // Handles the reply of a still running executor to a
+  // ReconnectExecutorMessage sent during recovery.
+  void reregisterExecutor(
+      const FrameworkID& frameworkId,
+      const ExecutorID& executorId);
+
   void statusUpdate(const StatusUpdate& update);
 
+  void statusUpdates(
+      const google::protobuf::RepeatedPtrField<StatusUpdate>& updates);
+
   void executorMessage(
       const SlaveID& slaveId,
       const FrameworkID& frameworkId,
@@ -125,7 +143,8 @@ public:
 
   void ping(const UPID& from, const std::string& body);
 
-  void statusUpdateTimeout(const FrameworkID& frameworkId, const UUID& uuid);
+  // Resends all the unacknowledged status updates of a framework.
+  void statusUpdateTimeout(const FrameworkID& frameworkId);
 
   void sendStatusUpdate(
       const FrameworkID& frameworkId,
@@ -146,6 +165,14 @@ public:
       bool destroyed,
       const std::string& message);
 
+  // Called by the isolation module when the memory usage of an
+  // executor crosses its soft limit (i.e., its allocated memory).
+  void executorMemoryPressure(
+      const FrameworkID& frameworkId,
+      const ExecutorID& executorId,
+      uint64_t usage,
+      uint64_t limit);
+
   // NOTE: Pulled this to public to make it visible for testing.
   // Garbage collects the directories based on the current disk usage.
   // TODO(vinod): Instead of making this function public, we need to
@@ -185,6 +212,61 @@ protected:
   // Checks the current disk usage and schedules for gc as necessary.
   void checkDiskUsage();
 
+  // Recovers the slave id and the checkpointed state (if any) from
+  // the work directory and reconnects to the executors that are
+  // still running. Only used when checkpointing is enabled.
+  void recover();
+
+  // Checkpoints the given task (if checkpointing is enabled).
+  void checkpointTask(const Executor& executor, const Task& task);
+
+  // Queues a status update record to be checkpointed to 'path' (if
+  // checkpointing is enabled). Records are written in batches (see
+  // 'flushRecords') so that a burst of status updates and
+  // acknowledgements shares fsyncs.
+  void checkpointRecord(
+      const std::string& path,
+      const StatusUpdateRecord& record);
+
+  // Writes out all queued status update records.
+  void flushRecords();
+
+  // Adds the status update to the stream of its framework (arming
+  // the retry timer of the stream if necessary) and queues it to be
+  // forwarded to the master.
+  void forwardStatusUpdate(
+      const StatusUpdate& update,
+      const Option<std::string>& path);
+
+  // Forwards all queued status updates to the master.
+  void flushStatusUpdates();
+
+  // Sends the given status updates to the master, in batches of at
+  // most STATUS_UPDATE_BATCH_SIZE updates.
+  void sendStatusUpdates(const std::vector<StatusUpdate>& updates);
+
+  // Queues the task to be sent to its (running) executor. Like
+  // status updates, tasks are sent once we're done processing the
+  // messages that are already queued so that a burst of tasks for
+  // the same executor goes out in a single message.
+  void forwardTask(
+      const Framework& framework,
+      const Executor& executor,
+      const TaskInfo& task);
+
+  // Sends all queued tasks to their executors.
+  void flushTasks();
+
+  // Sends the tasks queued for the executor (if any), e.g., before
+  // sending it anything else that must not overtake them.
+  void sendQueuedTasks(const Framework& framework, const Executor& executor);
+
+  // Sends the given tasks to the executor.
+  void sendTasks(
+      const Framework& framework,
+      const Executor& executor,
+      const std::vector<TaskInfo>& tasks);
+
 private:
   Slave(const Slave&);              // No copying.
   Slave& operator = (const Slave&); // No assigning.
@@ -229,6 +311,7 @@ private:
     uint64_t invalidStatusUpdates;
     uint64_t validFrameworkMessages;
     uint64_t invalidFrameworkMessages;
+    uint64_t memoryPressureEvents;
   } stats;
 
   double startTime;
@@ -238,6 +321,124 @@ private:
   GarbageCollector gc;
 
   state::SlaveState state;
+
+  // Status update records waiting to be checkpointed, keyed by the
+  // path of the 'updates' file they belong to.
+  hashmap<std::string, std::vector<StatusUpdateRecord> > records;
+
+  // Unacknowledged status updates of each framework. These are kept
+  // separately from the frameworks since a framework might complete
+  // (or not even exist after recovery) before all of its updates have
+  // been acknowledged.
+  hashmap<FrameworkID, StatusUpdateStream*> streams;
+
+  // Status updates waiting to be forwarded to the master (see
+  // 'flushStatusUpdates').
+  std::vector<StatusUpdate> outgoing;
+
+  // Tasks waiting to be sent to their executors (see 'flushTasks').
+  hashmap<FrameworkID, hashmap<ExecutorID, std::vector<TaskInfo> > > tasks;
+};
+
+
+// An ordered stream of the unacknowledged status updates of a
+// framework. The pending updates of a stream get resent using a
+// single retry timer, which only resends the updates that were last
+// sent at least a retry interval ago and also removes the stream once
+// it has become empty.
+struct StatusUpdateStream
+{
+  StatusUpdateStream() {}
+
+  void add(const StatusUpdate& update, const Option<std::string>& path)
+  {
+    const UUID& uuid = UUID::fromBytes(update.uuid());
+    CHECK(!index.contains(uuid));
+    index[uuid] = updates.insert(updates.end(), update);
+    if (path.isSome()) {
+      checkpoints[uuid] = path.get();
+    }
+  }
+
+  bool contains(const UUID& uuid) const
+  {
+    return index.contains(uuid);
+  }
+
+  // Removes the update from the stream and returns the path of the
+  // file it was checkpointed to, if any.
+  Option<std::string> acknowledge(const UUID& uuid)
+  {
+    CHECK(index.contains(uuid));
+    updates.erase(index[uuid]);
+    index.erase(uuid);
+
+    timestamps.erase(uuid);
+
+    Option<std::string> path;
+    if (checkpoints.contains(uuid)) {
+      path = checkpoints[uuid];
+      checkpoints.erase(uuid);
+    }
+    return path;
+  }
+
+  // Records that the update was (re)sent at 'time'.
+  void sent(const UUID& uuid, double time)
+  {
+    CHECK(index.contains(uuid));
+    timestamps[uuid] = time;
+  }
+
+  // Returns the pending updates that haven't been sent since 'time'
+  // (including the ones that were never sent), in order.
+  std::vector<StatusUpdate> unsent(double time) const
+  {
+    std::vector<StatusUpdate> result;
+    foreach (const StatusUpdate& update, updates) {
+      const UUID& uuid = UUID::fromBytes(update.uuid());
+      if (!timestamps.contains(uuid) || timestamps.get(uuid).get() <= time) {
+        result.push_back(update);
+      }
+    }
+    return result;
+  }
+
+  // Returns the earliest time a pending update was last sent, or
+  // none if some pending update was never sent (or there are none).
+  Option<double> oldest() const
+  {
+    if (updates.empty() || timestamps.size() != updates.size()) {
+      return Option<double>::none();
+    }
+
+    double oldest = timestamps.begin()->second;
+    foreachvalue (double time, timestamps) {
+      oldest = std::min(oldest, time);
+    }
+    return oldest;
+  }
+
+  bool empty() const
+  {
+    return updates.empty();
+  }
+
+  // Pending status updates, in the order they were received.
+  std::list<StatusUpdate> updates;
+
+private:
+  StatusUpdateStream(const StatusUpdateStream&);              // No copying.
+  StatusUpdateStream& operator = (const StatusUpdateStream&); // No assigning.
+
+  hashmap<UUID, std::list<StatusUpdate>::iterator> index;
+
+  // The path of the file where each status update was checkpointed
+  // (if checkpointing is enabled), keyed by uuid.
+  hashmap<UUID, std::string> checkpoints;
+
+  // When each status update was last sent, keyed by uuid.
+  hashmap<UUID, double> timestamps;
 };
 
 
@@ -308,6 +509,16 @@ struct Executor
     }
   }
 
+  // Adds a (live) task that was checkpointed by a previous instance
+  // of the slave (see Slave::recover).
+  void recoverTask(const Task& task)
+  {
+    CHECK(!launchedTasks.contains(task.task_id()));
+
+    launchedTasks[task.task_id()] = new Task(task);
+    resources += task.resources();
+  }
+
   void updateTaskState(const TaskID& taskId, TaskState state)
   {
     if (launchedTasks.contains(taskId)) {
@@ -430,6 +641,22 @@ struct Framework
     return executor;
   }
 
+  // Re-creates an executor that was launched by a previous instance
+  // of the slave and is still running (see Slave::recover).
+  Executor* recoverExecutor(const SlaveID& slaveId,
+                            const ExecutorInfo& executorInfo,
+                            const UUID& executorUUID)
+  {
+    const std::string& directory = paths::getExecutorRunPath(
+        flags.work_dir, slaveId, id, executorInfo.executor_id(), executorUUID);
+
+    Executor* executor =
+      new Executor(id, executorInfo, executorUUID, directory);
+    CHECK(!executors.contains(executorInfo.executor_id()));
+    executors[executorInfo.executor_id()] = executor;
+    return executor;
+  }
+
   void destroyExecutor(const ExecutorID& executorId)
   {
     if (executors.contains(executorId)) {
@@ -475,9 +702,6 @@ struct Framework
   // Up to MAX_COMPLETED_EXECUTORS_PER_FRAMEWORK completed executors.
   boost::circular_buffer<std::tr1::shared_ptr<Executor> > completedExecutors;
 
-  // Status updates keyed by uuid.
-  hashmap<UUID, StatusUpdate> updates;
-
 private:
   Framework(const Framework&);              // No copying.
   Framework& operator = (const Framework&); // No assigning.
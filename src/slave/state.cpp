@@ -1,9 +1,15 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h> // For rename.
+#include <unistd.h>
+
 #include <glog/logging.h>
 
 #include "stout/foreach.hpp"
 #include "stout/format.hpp"
 #include "stout/numify.hpp"
 #include "stout/os.hpp"
+#include "stout/path.hpp"
 #include "stout/protobuf.hpp"
 #include "stout/try.hpp"
 
@@ -18,6 +24,7 @@ namespace state {
 using std::list;
 using std::string;
 using std::max;
+using std::vector;
 
 SlaveState parse(const string& rootDir, const SlaveID& slaveId)
 {
@@ -39,6 +46,25 @@ SlaveState parse(const string& rootDir, const SlaveID& slaveId)
     FrameworkID frameworkId;
     frameworkId.set_value(os::basename(path).get());
 
+    if (os::exists(paths::getFrameworkPIDPath(rootDir, slaveId, frameworkId))) {
+      state.frameworks[frameworkId].pid =
+        readFrameworkPID(rootDir, slaveId, frameworkId);
+    }
+
+    const string& frameworkInfoPath =
+      paths::getFrameworkInfoPath(rootDir, slaveId, frameworkId);
+
+    if (os::exists(frameworkInfoPath)) {
+      FrameworkInfo frameworkInfo;
+      Result<bool> read = protobuf::read(frameworkInfoPath, &frameworkInfo);
+      if (read.isSome() && read.get()) {
+        state.frameworks[frameworkId].info = frameworkInfo;
+      } else {
+        LOG(WARNING) << "Failed to read framework info from "
+                     << frameworkInfoPath;
+      }
+    }
+
     // Find the executors.
     Try<list<string> > executors =
         os::glob(strings::format(paths::EXECUTOR_PATH, rootDir, slaveId,
@@ -72,6 +98,39 @@ SlaveState parse(const string& rootDir, const SlaveID& slaveId)
 
         const UUID& uuid = UUID::fromString(os::basename(path).get());
 
+        SlaveState::FrameworkState::RunState::ExecutorState& run =
+          state.frameworks[frameworkId].executors[executorId].runs[uuid];
+
+        run.forkedPid = readForkedPID(
+            rootDir, slaveId, frameworkId, executorId, uuid);
+
+        const string& libprocessPidPath = paths::getLibprocessPIDPath(
+            rootDir, slaveId, frameworkId, executorId, uuid);
+
+        if (os::exists(libprocessPidPath)) {
+          Result<string> read = os::read(libprocessPidPath);
+          if (read.isSome()) {
+            run.libprocessPid = process::UPID(read.get());
+          } else {
+            LOG(WARNING) << "Failed to read libprocess pid from "
+                         << libprocessPidPath;
+          }
+        }
+
+        const string& executorInfoPath = paths::getExecutorInfoPath(
+            rootDir, slaveId, frameworkId, executorId, uuid);
+
+        if (os::exists(executorInfoPath)) {
+          ExecutorInfo executorInfo;
+          Result<bool> read = protobuf::read(executorInfoPath, &executorInfo);
+          if (read.isSome() && read.get()) {
+            run.info = executorInfo;
+          } else {
+            LOG(WARNING) << "Failed to read executor info from "
+                         << executorInfoPath;
+          }
+        }
+
         // Find the tasks.
         Try<list<string> > tasks =
             os::glob(strings::format(paths::TASK_PATH, rootDir, slaveId,
@@ -87,8 +146,59 @@ SlaveState parse(const string& rootDir, const SlaveID& slaveId)
           TaskID taskId;
           taskId.set_value(os::basename(path).get());
 
-          state.frameworks[frameworkId].executors[executorId].runs[uuid].tasks
-            .insert(taskId);
+          run.tasks.insert(taskId);
+
+          // Read the checkpointed task (if any).
+          const string& infoPath = paths::getTaskInfoPath(
+              rootDir, slaveId, frameworkId, executorId, uuid, taskId);
+
+          if (os::exists(infoPath)) {
+            Task task;
+            Result<bool> read = protobuf::read(infoPath, &task);
+            if (read.isSome() && read.get()) {
+              run.infos[taskId] = task;
+            } else {
+              LOG(WARNING) << "Failed to read task from " << infoPath;
+            }
+          }
+
+          // Replay the checkpointed status updates, dropping those
+          // that have already been acknowledged.
+          const string& updatesPath = paths::getTaskUpdatesPath(
+              rootDir, slaveId, frameworkId, executorId, uuid, taskId);
+
+          if (os::exists(updatesPath)) {
+            Try<vector<StatusUpdateRecord> > records =
+              readRecords(updatesPath);
+
+            if (records.isError()) {
+              LOG(WARNING) << "Failed to read status updates from "
+                           << updatesPath << ": " << records.error();
+              continue;
+            }
+
+            vector<StatusUpdate>& updates = run.updates[taskId];
+
+            foreach (const StatusUpdateRecord& record, records.get()) {
+              if (record.type() == StatusUpdateRecord::UPDATE) {
+                updates.push_back(record.update());
+
+                // The task itself is only checkpointed when it gets
+                // launched, so bring its state up to date.
+                if (run.infos.contains(taskId)) {
+                  run.infos[taskId].set_state(record.update().status().state());
+                }
+              } else {
+                for (vector<StatusUpdate>::iterator it = updates.begin();
+                     it != updates.end(); ++it) {
+                  if (it->uuid() == record.uuid()) {
+                    updates.erase(it);
+                    break;
+                  }
+                }
+              }
+            }
+          }
         }
       }
     }
@@ -99,37 +209,183 @@ SlaveState parse(const string& rootDir, const SlaveID& slaveId)
 
 // Helper functions for check-pointing slave data.
 
-void writeTask(Task* task, const string& taskDir)
+Try<Nothing> checkpoint(const string& path, const string& data)
 {
-  const string& path = taskDir + "/task";
+  Try<Nothing> mkdir = os::mkdir(os::dirname(path).get());
+  if (mkdir.isError()) {
+    return Try<Nothing>::error(
+        "Failed to create directory '" + os::dirname(path).get() + "': " +
+        mkdir.error());
+  }
 
-  Try<Nothing> created = os::mkdir(taskDir);
+  // Write to a temporary file first, so that a crash while writing
+  // leaves the previous checkpoint (if any) intact.
+  const string& temp = path + ".tmp";
 
-  CHECK_SOME(created) << "Failed to create task directory '" << taskDir << "'";
+  Try<int> fd = os::open(temp, O_WRONLY | O_CREAT | O_TRUNC,
+                         S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+  if (fd.isError()) {
+    return Try<Nothing>::error(
+        "Failed to open file '" + temp + "': " + fd.error());
+  }
 
-  LOG(INFO) << "Writing task description for task "
-            << task->task_id() << " to " << path;
+  Try<Nothing> write = os::write(fd.get(), data);
+
+  if (write.isSome() && ::fsync(fd.get()) != 0) {
+    write = Try<Nothing>::error(
+        "Failed to sync file '" + temp + "': " + strerror(errno));
+  }
+
+  os::close(fd.get());
+
+  if (write.isError()) {
+    os::rm(temp);
+    return write;
+  }
+
+  // Atomically replace the previous checkpoint.
+  if (::rename(temp.c_str(), path.c_str()) != 0) {
+    return Try<Nothing>::error(
+        "Failed to rename '" + temp + "' to '" + path + "': " +
+        strerror(errno));
+  }
+
+  // Sync the directory too, otherwise the rename might not survive
+  // a crash (leaving behind the previous checkpoint, or none at all).
+  const string& directory = os::dirname(path).get();
 
-  Try<bool> result = protobuf::write(path, *task);
+  fd = os::open(directory, O_RDONLY);
+  if (fd.isError()) {
+    return Try<Nothing>::error(
+        "Failed to open directory '" + directory + "': " + fd.error());
+  }
 
-  if (result.isError()) {
-    LOG(FATAL) << "Failed to write task description to disk " << result.error();
+  if (::fsync(fd.get()) != 0) {
+    string error = strerror(errno);
+    os::close(fd.get());
+    return Try<Nothing>::error(
+        "Failed to sync directory '" + directory + "': " + error);
   }
+
+  os::close(fd.get());
+
+  return Nothing();
 }
 
 
-void writeSlaveID(const string& rootDir, const SlaveID& slaveId)
+Try<Nothing> checkpoint(
+    const string& path,
+    const google::protobuf::Message& message)
 {
-  const string& path = paths::getSlaveIDPath(rootDir);
+  string data;
+  if (!message.SerializeToString(&data)) {
+    return Try<Nothing>::error("Failed to serialize protobuf");
+  }
+
+  // Checkpoint in the same (length prefixed) format that
+  // 'protobuf::write' uses so that 'protobuf::read' can read it.
+  uint32_t size = data.size();
+  return checkpoint(path, string((char*) &size, sizeof(size)) + data);
+}
+
 
-  Try<Nothing> created = os::mkdir(os::dirname(path).get());
+Try<Nothing> writeRecords(
+    const string& path,
+    const vector<StatusUpdateRecord>& records)
+{
+  Try<Nothing> mkdir = os::mkdir(os::dirname(path).get());
+  if (mkdir.isError()) {
+    return Try<Nothing>::error(
+        "Failed to create directory '" + os::dirname(path).get() + "': " +
+        mkdir.error());
+  }
+
+  Try<int> fd = os::open(path, O_WRONLY | O_CREAT | O_APPEND,
+                         S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+  if (fd.isError()) {
+    return Try<Nothing>::error(
+        "Failed to open file '" + path + "': " + fd.error());
+  }
 
-  CHECK_SOME(created)
-    << "Failed to create directory '" << os::dirname(path).get() << "'";
+  foreach (const StatusUpdateRecord& record, records) {
+    Try<bool> write = protobuf::write(fd.get(), record);
+    if (write.isError() || !write.get()) {
+      os::close(fd.get());
+      return Try<Nothing>::error(
+          "Failed to write record to '" + path + "'" +
+          (write.isError() ? ": " + write.error() : ""));
+    }
+  }
+
+  // Sync all of the records at once.
+  if (::fsync(fd.get()) != 0) {
+    string error = strerror(errno);
+    os::close(fd.get());
+    return Try<Nothing>::error(
+        "Failed to sync file '" + path + "': " + error);
+  }
+
+  os::close(fd.get());
+
+  return Nothing();
+}
+
+
+Try<vector<StatusUpdateRecord> > readRecords(const string& path)
+{
+  Try<int> fd = os::open(path, O_RDONLY);
+  if (fd.isError()) {
+    return Try<vector<StatusUpdateRecord> >::error(
+        "Failed to open file '" + path + "': " + fd.error());
+  }
+
+  vector<StatusUpdateRecord> records;
+
+  while (true) {
+    StatusUpdateRecord record;
+    Result<bool> read = protobuf::read(fd.get(), &record);
+
+    if (read.isError()) {
+      os::close(fd.get());
+      return Try<vector<StatusUpdateRecord> >::error(read.error());
+    } else if (read.isNone()) {
+      break; // Reached the end of the file.
+    } else if (!read.get()) {
+      // A partially written record, most likely because we crashed
+      // while appending, so just ignore it.
+      LOG(WARNING) << "Ignoring truncated record at the end of " << path;
+      break;
+    }
+
+    records.push_back(record);
+  }
+
+  os::close(fd.get());
+
+  return records;
+}
+
+
+void writeTask(const Task& task, const string& taskDir)
+{
+  const string& path = path::join(taskDir, "info");
+
+  LOG(INFO) << "Writing task description for task "
+            << task.task_id() << " to " << path;
+
+  Try<Nothing> result = checkpoint(path, task);
+
+  CHECK_SOME(result) << "Failed to write task description to disk";
+}
+
+
+void writeSlaveID(const string& rootDir, const SlaveID& slaveId)
+{
+  const string& path = paths::getSlaveIDPath(rootDir);
 
   LOG(INFO) << "Writing slave id " << slaveId << " to " << path;
 
-  Try<Nothing> result = os::write(path, stringify(slaveId));
+  Try<Nothing> result = checkpoint(path, stringify(slaveId));
 
   CHECK_SOME(result) << "Failed to write slave id to disk";
 }
@@ -164,14 +420,9 @@ void writeFrameworkPID(const string& metaRootDir,
   const string& path = paths::getFrameworkPIDPath(metaRootDir, slaveId,
                                                   frameworkId);
 
-  Try<Nothing> created = os::mkdir(os::dirname(path).get());
-
-  CHECK_SOME(created)
-    << "Failed to create directory '" << os::dirname(path).get() << "'";
-
   LOG(INFO) << "Writing framework pid " << pid << " to " << path;
 
-  Try<Nothing> result = os::write(path, pid);
+  Try<Nothing> result = checkpoint(path, pid);
 
   CHECK_SOME(result) << "Failed to write framework pid to disk";
 }
@@ -197,6 +448,112 @@ process::UPID readFrameworkPID(const string& metaRootDir,
   return process::UPID(result.get());
 }
 
+
+void writeFrameworkInfo(const string& metaRootDir,
+                        const SlaveID& slaveId,
+                        const FrameworkID& frameworkId,
+                        const FrameworkInfo& frameworkInfo)
+{
+  const string& path = paths::getFrameworkInfoPath(metaRootDir, slaveId,
+                                                   frameworkId);
+
+  LOG(INFO) << "Writing framework info to " << path;
+
+  Try<Nothing> result = checkpoint(path, frameworkInfo);
+
+  CHECK_SOME(result) << "Failed to write framework info to disk";
+}
+
+
+void writeExecutorInfo(const string& metaRootDir,
+                       const SlaveID& slaveId,
+                       const FrameworkID& frameworkId,
+                       const UUID& executorUUID,
+                       const ExecutorInfo& executorInfo)
+{
+  const string& path = paths::getExecutorInfoPath(metaRootDir, slaveId,
+                                                  frameworkId,
+                                                  executorInfo.executor_id(),
+                                                  executorUUID);
+
+  LOG(INFO) << "Writing executor info to " << path;
+
+  Try<Nothing> result = checkpoint(path, executorInfo);
+
+  CHECK_SOME(result) << "Failed to write executor info to disk";
+}
+
+
+void writeLibprocessPID(const string& metaRootDir,
+                        const SlaveID& slaveId,
+                        const FrameworkID& frameworkId,
+                        const ExecutorID& executorId,
+                        const UUID& executorUUID,
+                        const process::UPID& pid)
+{
+  const string& path = paths::getLibprocessPIDPath(metaRootDir, slaveId,
+                                                   frameworkId, executorId,
+                                                   executorUUID);
+
+  LOG(INFO) << "Writing libprocess pid " << pid << " to " << path;
+
+  Try<Nothing> result = checkpoint(path, stringify(pid));
+
+  CHECK_SOME(result) << "Failed to write libprocess pid to disk";
+}
+
+
+void writeForkedPID(const string& metaRootDir,
+                    const SlaveID& slaveId,
+                    const FrameworkID& frameworkId,
+                    const ExecutorID& executorId,
+                    const UUID& executorUUID,
+                    pid_t pid)
+{
+  const string& path = paths::getForkedPIDPath(metaRootDir, slaveId,
+                                               frameworkId, executorId,
+                                               executorUUID);
+
+  LOG(INFO) << "Writing forked pid " << pid << " to " << path;
+
+  Try<Nothing> result = checkpoint(path, stringify(pid));
+
+  CHECK_SOME(result) << "Failed to write forked pid to disk";
+}
+
+
+Option<pid_t> readForkedPID(const string& metaRootDir,
+                            const SlaveID& slaveId,
+                            const FrameworkID& frameworkId,
+                            const ExecutorID& executorId,
+                            const UUID& executorUUID)
+{
+  const string& path = paths::getForkedPIDPath(metaRootDir, slaveId,
+                                               frameworkId, executorId,
+                                               executorUUID);
+
+  if (!os::exists(path)) {
+    return Option<pid_t>::none();
+  }
+
+  Result<string> result = os::read(path);
+
+  if (!result.isSome()) {
+    LOG(WARNING) << "Cannot read forked pid from " << path;
+    return Option<pid_t>::none();
+  }
+
+  Try<pid_t> pid = numify<pid_t>(result.get());
+
+  if (pid.isError()) {
+    LOG(WARNING) << "Invalid forked pid '" << result.get() << "' in " << path
+                 << ": " << pid.error();
+    return Option<pid_t>::none();
+  }
+
+  return pid.get();
+}
+
 } // namespace state {
 } // namespace slave {
 } // namespace internal {
@@ -19,10 +19,20 @@
 #ifndef __SLAVE_STATE_HPP__
 #define __SLAVE_STATE_HPP__
 
+#include <sys/types.h>
+
+#include <string>
+#include <vector>
+
+#include <google/protobuf/message.h>
+
 #include "stout/foreach.hpp"
 #include "stout/hashmap.hpp"
 #include "stout/hashset.hpp"
+#include "stout/nothing.hpp"
+#include "stout/option.hpp"
 #include "stout/strings.hpp"
+#include "stout/try.hpp"
 #include "stout/utils.hpp"
 
 #include "common/type_utils.hpp"
@@ -48,12 +58,34 @@ struct SlaveState
       struct ExecutorState
       {
         hashset<TaskID> tasks;
+
+        // The checkpointed tasks (if any).
+        hashmap<TaskID, Task> infos;
+
+        // The status updates of each task that were checkpointed but
+        // not yet acknowledged, in the order they were generated.
+        hashmap<TaskID, std::vector<StatusUpdate> > updates;
+
+        // The pid of the forked executor process (if checkpointed).
+        Option<pid_t> forkedPid;
+
+        // The libprocess pid of the executor (if it registered).
+        Option<process::UPID> libprocessPid;
+
+        // The checkpointed executor info of this run (if any).
+        Option<ExecutorInfo> info;
       };
 
       hashmap<UUID, ExecutorState> runs;
     };
 
     hashmap<ExecutorID, RunState> executors;
+
+    // The checkpointed framework pid (if any).
+    Option<process::UPID> pid;
+
+    // The checkpointed framework info (if any).
+    Option<FrameworkInfo> info;
   };
 
   SlaveID slaveId;
@@ -70,8 +102,36 @@ SlaveState parse(const std::string& rootDir, const SlaveID& slaveId);
 // TODO(vinod): Re-evaluate the need for these helpers (or genericize them)
 // after StatusUpdateManager is integrated.
 
-// Writes the task information to "taskDir + '/task'".
-void writeTask(Task* task, const std::string& taskDir);
+// Atomically writes 'data' to 'path' by first writing (and syncing)
+// a temporary file and then renaming it (and syncing the directory
+// so the rename itself is durable), so that a crash never leaves
+// behind a partially written checkpoint. Any missing parent
+// directories are created.
+Try<Nothing> checkpoint(const std::string& path, const std::string& data);
+
+
+// Atomically writes the serialized protobuf 'message' to 'path'.
+Try<Nothing> checkpoint(
+    const std::string& path,
+    const google::protobuf::Message& message);
+
+
+// Appends the given records to 'path' (creating it if necessary)
+// using the length prefixed format of stout/protobuf.hpp. All of the
+// records are synced to disk together, which lets callers amortize a
+// single fsync across a batch of status updates and acknowledgements.
+Try<Nothing> writeRecords(
+    const std::string& path,
+    const std::vector<StatusUpdateRecord>& records);
+
+
+// Reads all the records from 'path'. A truncated record at the end of
+// the file (i.e., from a crash in the middle of an append) is ignored.
+Try<std::vector<StatusUpdateRecord> > readRecords(const std::string& path);
+
+
+// Writes the task information to "taskDir + '/info'".
+void writeTask(const Task& task, const std::string& taskDir);
 
 
 // Writes slaveId to the file path returned by getSlaveIDPath(metaRootDir).
@@ -94,6 +154,52 @@ process::UPID readFrameworkPID(const std::string& metaRootDir,
                                const SlaveID& slaveId,
                                const FrameworkID& frameworkId);
 
+
+// Writes the framework info to the path returned by
+// getFrameworkInfoPath().
+void writeFrameworkInfo(const std::string& metaRootDir,
+                        const SlaveID& slaveId,
+                        const FrameworkID& frameworkId,
+                        const FrameworkInfo& frameworkInfo);
+
+
+// Writes the executor info of a run to the path returned by
+// getExecutorInfoPath().
+void writeExecutorInfo(const std::string& metaRootDir,
+                       const SlaveID& slaveId,
+                       const FrameworkID& frameworkId,
+                       const UUID& executorUUID,
+                       const ExecutorInfo& executorInfo);
+
+
+// Writes the libprocess pid of a registered executor to the path
+// returned by getLibprocessPIDPath().
+void writeLibprocessPID(const std::string& metaRootDir,
+                        const SlaveID& slaveId,
+                        const FrameworkID& frameworkId,
+                        const ExecutorID& executorId,
+                        const UUID& executorUUID,
+                        const process::UPID& pid);
+
+
+// Writes the pid of the forked executor process to the path returned
+// by getForkedPIDPath().
+void writeForkedPID(const std::string& metaRootDir,
+                    const SlaveID& slaveId,
+                    const FrameworkID& frameworkId,
+                    const ExecutorID& executorId,
+                    const UUID& executorUUID,
+                    pid_t pid);
+
+
+// Reads the pid of the forked executor process from the path returned
+// by getForkedPIDPath().
+Option<pid_t> readForkedPID(const std::string& metaRootDir,
+                            const SlaveID& slaveId,
+                            const FrameworkID& frameworkId,
+                            const ExecutorID& executorId,
+                            const UUID& executorUUID);
+
 } // namespace state {
 } // namespace slave {
 } // namespace internal {
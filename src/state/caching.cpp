@@ -0,0 +1,203 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string>
+#include <vector>
+
+#include <process/defer.hpp>
+#include <process/future.hpp>
+#include <process/http.hpp>
+#include <process/id.hpp>
+#include <process/process.hpp>
+
+#include <stout/foreach.hpp>
+#include <stout/hashmap.hpp>
+#include <stout/hashset.hpp>
+#include <stout/json.hpp>
+#include <stout/lambda.hpp>
+#include <stout/nothing.hpp>
+#include <stout/option.hpp>
+#include <stout/uuid.hpp>
+
+#include "messages/state.hpp"
+
+#include "state/caching.hpp"
+
+using namespace process;
+
+using std::string;
+using std::vector;
+
+namespace mesos {
+namespace internal {
+namespace state {
+
+CachingStateProcess::CachingStateProcess(
+    const Fetch& fetch,
+    const Swap& swap,
+    const Watch& watch)
+  : ProcessBase(ID::generate("caching-state"))
+{
+  underlying.fetch = fetch;
+  underlying.swap = swap;
+  underlying.watch = watch;
+}
+
+
+void CachingStateProcess::initialize()
+{
+  route("/stats.json", &CachingStateProcess::stats);
+}
+
+
+Future<Option<Entry> > CachingStateProcess::fetch(const string& name)
+{
+  if (entries.contains(name)) {
+    counts.hits++;
+    return entries[name];
+  }
+
+  counts.misses++;
+
+  // Start watching before fetching so that we can't miss a change
+  // that happens after the entry was read.
+  watch(name);
+
+  Future<Option<Entry> > future = underlying.fetch(name);
+
+  future
+    .onAny(defer(self(), &Self::_fetch, name, generations[name], lambda::_1));
+
+  return future;
+}
+
+
+Future<bool> CachingStateProcess::swap(const Entry& entry, const UUID& uuid)
+{
+  return swapAll(vector<Entry>(1, entry), vector<UUID>(1, uuid));
+}
+
+
+Future<bool> CachingStateProcess::swapAll(
+    const vector<Entry>& entries,
+    const vector<UUID>& uuids)
+{
+  vector<uint64_t> generations;
+
+  foreach (const Entry& entry, entries) {
+    const string& name = entry.name();
+
+    watch(name);
+
+    // Stop serving the entry while the swap is outstanding since we
+    // don't know which version it will end up being.
+    this->generations[name]++;
+    this->entries.erase(name);
+
+    generations.push_back(this->generations[name]);
+  }
+
+  Future<bool> future = underlying.swap(entries, uuids);
+
+  future
+    .onAny(defer(self(), &Self::_swap, entries, generations, lambda::_1));
+
+  return future;
+}
+
+
+CachingStateProcess::Statistics CachingStateProcess::statistics()
+{
+  return counts;
+}
+
+
+void CachingStateProcess::_fetch(
+    const string& name,
+    uint64_t generation,
+    const Future<Option<Entry> >& future)
+{
+  if (future.isReady() && generations[name] == generation) {
+    entries[name] = future.get();
+  }
+}
+
+
+void CachingStateProcess::_swap(
+    const vector<Entry>& entries,
+    const vector<uint64_t>& generations,
+    const Future<bool>& future)
+{
+  for (size_t i = 0; i < entries.size(); i++) {
+    const string& name = entries[i].name();
+
+    if (this->generations[name] != generations[i]) {
+      continue; // Already changed (or invalidated) again.
+    }
+
+    if (future.isReady() && future.get()) {
+      this->entries[name] = entries[i]; // Write through.
+    } else {
+      // The entry must have been changed by someone else (or we don't
+      // know what happened), so it stays invalidated until fetched.
+      counts.invalidations++;
+    }
+  }
+}
+
+
+void CachingStateProcess::watch(const string& name)
+{
+  if (!watching.contains(name)) {
+    watching.insert(name);
+    underlying.watch(name)
+      .onAny(defer(self(), &Self::changed, name));
+  }
+}
+
+
+void CachingStateProcess::changed(const string& name)
+{
+  watching.erase(name);
+  invalidate(name);
+}
+
+
+void CachingStateProcess::invalidate(const string& name)
+{
+  generations[name]++;
+
+  if (entries.erase(name) > 0) {
+    counts.invalidations++;
+  }
+}
+
+
+Future<http::Response> CachingStateProcess::stats(const http::Request& request)
+{
+  JSON::Object object;
+  object.values["hits"] = JSON::Number(counts.hits);
+  object.values["misses"] = JSON::Number(counts.misses);
+  object.values["invalidations"] = JSON::Number(counts.invalidations);
+  object.values["entries"] = JSON::Number(entries.size());
+  return http::OK(object, request.query.get("jsonp"));
+}
+
+} // namespace state {
+} // namespace internal {
+} // namespace mesos {
@@ -0,0 +1,262 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __STATE_CACHING_HPP__
+#define __STATE_CACHING_HPP__
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include <process/dispatch.hpp>
+#include <process/future.hpp>
+#include <process/http.hpp>
+#include <process/process.hpp>
+
+#include <stout/hashmap.hpp>
+#include <stout/hashset.hpp>
+#include <stout/lambda.hpp>
+#include <stout/nothing.hpp>
+#include <stout/option.hpp>
+#include <stout/uuid.hpp>
+
+#include "messages/state.hpp"
+
+#include "state/serializer.hpp"
+#include "state/state.hpp"
+
+namespace mesos {
+namespace internal {
+namespace state {
+
+// Forward declarations.
+class CachingStateProcess;
+
+
+// Number of cache hits, misses, and invalidations of a CachingState.
+struct CachingStateStatistics
+{
+  CachingStateStatistics() : hits(0), misses(0), invalidations(0) {}
+
+  uint64_t hits;          // Fetches served from the cache.
+  uint64_t misses;        // Fetches sent to the underlying state.
+  uint64_t invalidations; // Entries dropped from the cache.
+};
+
+
+// A State that decorates another State by caching the most recently
+// fetched (or swapped) entry of each variable in memory. Fetches of
+// cached entries are served without going to the underlying state
+// (e.g., without a round trip to ZooKeeper or a read from leveldb).
+// Swaps always go to the underlying state, which remains the
+// authority on whether or not a swap succeeds: a successful swap
+// replaces the cached entry while a failed swap invalidates it (the
+// variable must have been changed by someone else). Cached entries
+// are also invalidated whenever the underlying state reports that
+// they might have changed (see State::watch), which for ZooKeeper
+// is done using watches.
+//
+// Note that the CachingState does not take ownership of the
+// underlying state, which must outlive it.
+template <typename Serializer = StringSerializer>
+class CachingState : public State<Serializer>
+{
+public:
+  typedef CachingStateStatistics Statistics;
+
+  CachingState(State<Serializer>* state);
+  virtual ~CachingState();
+
+  // State implementation.
+  virtual process::Future<std::vector<std::string> > names();
+
+  process::Future<Statistics> statistics();
+
+protected:
+  // More State implementation.
+  virtual process::Future<Option<Entry> > fetch(const std::string& name);
+  virtual process::Future<bool> swap(const Entry& entry, const UUID& uuid);
+  virtual process::Future<bool> swapAll(
+      const std::vector<Entry>& entries,
+      const std::vector<UUID>& uuids);
+  virtual process::Future<Nothing> watch(const std::string& name);
+
+private:
+  State<Serializer>* state;
+  CachingStateProcess* process;
+};
+
+
+class CachingStateProcess : public process::Process<CachingStateProcess>
+{
+public:
+  typedef CachingStateStatistics Statistics;
+
+  // The underlying state's fetch, swapAll, and watch (see State),
+  // bound so that this process can be agnostic of the Serializer.
+  typedef lambda::function<
+    process::Future<Option<Entry> >(const std::string&)> Fetch;
+  typedef lambda::function<
+    process::Future<bool>(
+        const std::vector<Entry>&,
+        const std::vector<UUID>&)> Swap;
+  typedef lambda::function<
+    process::Future<Nothing>(const std::string&)> Watch;
+
+  CachingStateProcess(const Fetch& fetch, const Swap& swap, const Watch& watch);
+
+  virtual void initialize();
+
+  // State implementation.
+  process::Future<Option<Entry> > fetch(const std::string& name);
+  process::Future<bool> swap(const Entry& entry, const UUID& uuid);
+  process::Future<bool> swapAll(
+      const std::vector<Entry>& entries,
+      const std::vector<UUID>& uuids);
+
+  Statistics statistics();
+
+private:
+  // Continuations that update the cache once the underlying state
+  // responds. The generation is used to detect that the entry was
+  // changed (or invalidated) while the operation was outstanding, in
+  // which case the result must not be cached.
+  void _fetch(
+      const std::string& name,
+      uint64_t generation,
+      const process::Future<Option<Entry> >& future);
+
+  void _swap(
+      const std::vector<Entry>& entries,
+      const std::vector<uint64_t>& generations,
+      const process::Future<bool>& future);
+
+  // Starts watching the entry with the specified name (unless
+  // already watching it).
+  void watch(const std::string& name);
+
+  // Invoked when the underlying state reports that the entry with
+  // the specified name might have changed.
+  void changed(const std::string& name);
+
+  // Drops the entry with the specified name from the cache (if
+  // present) and makes sure outstanding operations don't cache it.
+  void invalidate(const std::string& name);
+
+  // HTTP endpoint for the statistics.
+  process::Future<process::http::Response> stats(
+      const process::http::Request& request);
+
+  struct {
+    Fetch fetch;
+    Swap swap;
+    Watch watch;
+  } underlying;
+
+  // Cached entries, where none means the entry is known not to exist.
+  hashmap<std::string, Option<Entry> > entries;
+
+  // Incremented every time an entry changes or gets invalidated.
+  hashmap<std::string, uint64_t> generations;
+
+  // Names of the entries being watched in the underlying state.
+  hashset<std::string> watching;
+
+  Statistics counts;
+};
+
+
+template <typename Serializer>
+CachingState<Serializer>::CachingState(State<Serializer>* _state)
+  : state(_state)
+{
+  process = new CachingStateProcess(
+      lambda::bind(&State<Serializer>::fetch, state, lambda::_1),
+      lambda::bind(
+          &State<Serializer>::swapAll, state, lambda::_1, lambda::_2),
+      lambda::bind(&State<Serializer>::watch, state, lambda::_1));
+  process::spawn(process);
+}
+
+
+template <typename Serializer>
+CachingState<Serializer>::~CachingState()
+{
+  process::terminate(process);
+  process::wait(process);
+  delete process;
+}
+
+
+template <typename Serializer>
+process::Future<std::vector<std::string> > CachingState<Serializer>::names()
+{
+  return state->names();
+}
+
+
+template <typename Serializer>
+process::Future<typename CachingState<Serializer>::Statistics>
+CachingState<Serializer>::statistics()
+{
+  return process::dispatch(process, &CachingStateProcess::statistics);
+}
+
+
+template <typename Serializer>
+process::Future<Option<Entry> > CachingState<Serializer>::fetch(
+    const std::string& name)
+{
+  return process::dispatch(process, &CachingStateProcess::fetch, name);
+}
+
+
+template <typename Serializer>
+process::Future<bool> CachingState<Serializer>::swap(
+    const Entry& entry,
+    const UUID& uuid)
+{
+  return process::dispatch(process, &CachingStateProcess::swap, entry, uuid);
+}
+
+
+template <typename Serializer>
+process::Future<bool> CachingState<Serializer>::swapAll(
+    const std::vector<Entry>& entries,
+    const std::vector<UUID>& uuids)
+{
+  return process::dispatch(
+      process, &CachingStateProcess::swapAll, entries, uuids);
+}
+
+
+template <typename Serializer>
+process::Future<Nothing> CachingState<Serializer>::watch(
+    const std::string& name)
+{
+  // Decorating a CachingState should be no different than decorating
+  // its underlying state.
+  return state->watch(name);
+}
+
+} // namespace state {
+} // namespace internal {
+} // namespace mesos {
+
+#endif // __STATE_CACHING_HPP__
@@ -1,4 +1,5 @@
 #include <leveldb/db.h>
+#include <leveldb/write_batch.h>
 
 #include <google/protobuf/message.h>
 
@@ -9,6 +10,7 @@
 #include <process/future.hpp>
 #include <process/process.hpp>
 
+#include <stout/foreach.hpp>
 #include <stout/option.hpp>
 #include <stout/try.hpp>
 #include <stout/uuid.hpp>
@@ -97,30 +99,43 @@ Future<Option<Entry> > LevelDBStateProcess::fetch(const string& name)
 
 Future<bool> LevelDBStateProcess::swap(const Entry& entry, const UUID& uuid)
 {
+  return swapAll(vector<Entry>(1, entry), vector<UUID>(1, uuid));
+}
+
+
+Future<bool> LevelDBStateProcess::swapAll(
+    const vector<Entry>& entries,
+    const vector<UUID>& uuids)
+{
+  CHECK(entries.size() == uuids.size());
+
   if (error.isSome()) {
     return Future<bool>::failed(error.get());
   }
 
-  // We do a fetch first to make sure the version has not changed. This
-  // could be optimized in the future, for now it will probably hit
-  // the cache anyway.
-  Try<Option<Entry> > option = get(entry.name());
+  // We do a fetch first to make sure the versions have not changed.
+  // This could be optimized in the future, for now it will probably
+  // hit the cache anyway.
+  for (size_t i = 0; i < entries.size(); i++) {
+    Try<Option<Entry> > option = get(entries[i].name());
 
-  if (option.isError()) {
-    return Future<bool>::failed(option.error());
-  }
+    if (option.isError()) {
+      return Future<bool>::failed(option.error());
+    }
 
-  if (option.get().isSome()) {
-    if (UUID::fromBytes(option.get().get().uuid()) != uuid) {
-      return false;
+    if (option.get().isSome()) {
+      if (UUID::fromBytes(option.get().get().uuid()) != uuids[i]) {
+        return false;
+      }
     }
   }
 
-  // Note that there is no need to do the DB::Get and DB::Put
+  // Note that there is no need to do the DB::Get and DB::Write
   // "atomically" because only one db can be opened at a time, so
-  // there can not be any writes that occur concurrently.
+  // there can not be any writes that occur concurrently. All of the
+  // entries get written atomically since they're in one batch.
 
-  Try<bool> result = put(entry);
+  Try<bool> result = put(entries);
 
   if (result.isError()) {
     return Future<bool>::failed(result.error());
@@ -158,20 +173,26 @@ Try<Option<Entry> > LevelDBStateProcess::get(const string& name)
 }
 
 
-Try<bool> LevelDBStateProcess::put(const Entry& entry)
+Try<bool> LevelDBStateProcess::put(const vector<Entry>& entries)
 {
   CHECK(error.isNone());
 
   leveldb::WriteOptions options;
   options.sync = true;
 
-  string value;
+  leveldb::WriteBatch batch;
+
+  foreach (const Entry& entry, entries) {
+    string value;
+
+    if (!entry.SerializeToString(&value)) {
+      return Try<bool>::error("Failed to serialize Entry");
+    }
 
-  if (!entry.SerializeToString(&value)) {
-    return Try<bool>::error("Failed to serialize Entry");
+    batch.Put(entry.name(), value);
   }
 
-  leveldb::Status status = db->Put(options, entry.name(), value);
+  leveldb::Status status = db->Write(options, &batch);
 
   if (!status.ok()) {
     return Try<bool>::error(status.ToString());
@@ -43,6 +43,9 @@ protected:
   // More State implementation.
   virtual process::Future<Option<Entry> > fetch(const std::string& name);
   virtual process::Future<bool> swap(const Entry& entry, const UUID& uuid);
+  virtual process::Future<bool> swapAll(
+      const std::vector<Entry>& entries,
+      const std::vector<UUID>& uuids);
 
 private:
   LevelDBStateProcess* process;
@@ -61,11 +64,15 @@ public:
   process::Future<std::vector<std::string> > names();
   process::Future<Option<Entry> > fetch(const std::string& name);
   process::Future<bool> swap(const Entry& entry, const UUID& uuid);
+  process::Future<bool> swapAll(
+      const std::vector<Entry>& entries,
+      const std::vector<UUID>& uuids);
 
 private:
-  // Helpers for interacting with leveldb.
+  // Helpers for interacting with leveldb. Multiple entries are put
+  // using a single (synchronous) write batch.
   Try<Option<Entry> > get(const std::string& name);
-  Try<bool> put(const Entry& entry);
+  Try<bool> put(const std::vector<Entry>& entries);
 
   const std::string path;
   leveldb::DB* db;
@@ -114,6 +121,16 @@ process::Future<bool> LevelDBState<Serializer>::swap(
   return process::dispatch(process, &LevelDBStateProcess::swap, entry, uuid);
 }
 
+
+template <typename Serializer>
+process::Future<bool> LevelDBState<Serializer>::swapAll(
+    const std::vector<Entry>& entries,
+    const std::vector<UUID>& uuids)
+{
+  return process::dispatch(
+      process, &LevelDBStateProcess::swapAll, entries, uuids);
+}
+
 } // namespace state {
 } // namespace internal {
 } // namespace mesos {
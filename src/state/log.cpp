@@ -0,0 +1,315 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <list>
+#include <queue>
+#include <string>
+#include <vector>
+
+#include <process/dispatch.hpp>
+#include <process/future.hpp>
+#include <process/process.hpp>
+#include <process/timeout.hpp>
+
+#include <stout/duration.hpp>
+#include <stout/foreach.hpp>
+#include <stout/hashmap.hpp>
+#include <stout/nothing.hpp>
+#include <stout/option.hpp>
+#include <stout/result.hpp>
+#include <stout/try.hpp>
+#include <stout/uuid.hpp>
+
+#include "log/log.hpp"
+
+#include "logging/logging.hpp"
+
+#include "messages/state.hpp"
+
+#include "state/log.hpp"
+
+using namespace process;
+
+using std::list;
+using std::queue;
+using std::string;
+using std::vector;
+
+using mesos::internal::log::Log;
+
+namespace mesos {
+namespace internal {
+namespace state {
+
+LogStateProcess::LogStateProcess(Log* _log, const Duration& _timeout)
+  : log(_log),
+    timeout(_timeout),
+    reader(_log),
+    writer(NULL),
+    flushing(false)
+{}
+
+
+LogStateProcess::~LogStateProcess()
+{
+  delete writer;
+
+  while (!pending.empty()) {
+    Swap* swap = pending.front();
+    pending.pop();
+    swap->promise.fail("No longer managing state");
+    delete swap;
+  }
+}
+
+
+Future<vector<string> > LogStateProcess::names()
+{
+  Try<Nothing> caughtup = catchup();
+
+  if (caughtup.isError()) {
+    return Future<vector<string> >::failed(caughtup.error());
+  }
+
+  vector<string> names;
+  foreachkey (const string& name, entries) {
+    names.push_back(name);
+  }
+
+  return names;
+}
+
+
+Future<Option<Entry> > LogStateProcess::fetch(const string& name)
+{
+  Try<Nothing> caughtup = catchup();
+
+  if (caughtup.isError()) {
+    return Future<Option<Entry> >::failed(caughtup.error());
+  }
+
+  if (entries.contains(name)) {
+    return Option<Entry>::some(entries[name]);
+  }
+
+  return Option<Entry>::none();
+}
+
+
+Future<bool> LogStateProcess::swap(const Entry& entry, const UUID& uuid)
+{
+  return swapAll(vector<Entry>(1, entry), vector<UUID>(1, uuid));
+}
+
+
+Future<bool> LogStateProcess::swapAll(
+    const vector<Entry>& entries,
+    const vector<UUID>& uuids)
+{
+  CHECK(entries.size() == uuids.size());
+
+  Swap* swap = new Swap(entries, uuids);
+  Future<bool> future = swap->promise.future();
+
+  pending.push(swap);
+
+  // Swaps that arrive while we're flushing (or before the flush gets
+  // processed) get batched together into the next flush.
+  if (!flushing) {
+    flushing = true;
+    dispatch(self(), &Self::flush);
+  }
+
+  return future;
+}
+
+
+void LogStateProcess::flush()
+{
+  flushing = false;
+
+  vector<Swap*> swaps;
+  while (!pending.empty()) {
+    swaps.push_back(pending.front());
+    pending.pop();
+  }
+
+  Try<Nothing> caughtup = catchup();
+
+  // Fail the swaps that can't succeed without appending them.
+  vector<Swap*> appending;
+  vector<string> data;
+
+  foreach (Swap* swap, swaps) {
+    // Multiple entries get stored in a single transaction.
+    Operation operation;
+    bool stale = false;
+
+    for (size_t i = 0; i < swap->entries.size(); i++) {
+      Operation::Store* store = swap->entries.size() == 1
+        ? operation.mutable_store()
+        : operation.mutable_transaction()->add_stores();
+
+      store->mutable_entry()->CopyFrom(swap->entries[i]);
+      store->set_uuid(swap->uuids[i].toBytes());
+
+      stale = stale || !applicable(*store);
+    }
+
+    operation.set_type(swap->entries.size() == 1
+                       ? Operation::STORE
+                       : Operation::TRANSACTION);
+
+    string bytes;
+
+    if (caughtup.isError()) {
+      swap->promise.fail(caughtup.error());
+    } else if (swap->entries.empty()) {
+      swap->promise.set(true);
+    } else if (stale) {
+      swap->promise.set(false);
+    } else if (!operation.SerializeToString(&bytes)) {
+      swap->promise.fail("Failed to serialize Operation");
+    } else {
+      appending.push_back(swap);
+      data.push_back(bytes);
+      continue;
+    }
+
+    delete swap;
+  }
+
+  if (appending.empty()) {
+    return;
+  }
+
+  if (writer == NULL) {
+    writer = new Log::Writer(log, timeout);
+  }
+
+  Result<Log::Position> result =
+    writer->append(data, WINDOW, BATCH, Timeout(timeout));
+
+  if (result.isError()) {
+    // The writer is no longer valid (e.g., another writer got
+    // elected), so we create a new one for the next flush.
+    delete writer;
+    writer = NULL;
+  }
+
+  // Even if the append failed or timed out some of the operations
+  // might have been appended, so we determine the outcome of each
+  // swap by catching up with the log.
+  caughtup = catchup();
+
+  foreach (Swap* swap, appending) {
+    // Since swaps are atomic it's sufficient to check the first entry.
+    const Entry& entry = swap->entries.front();
+
+    if (caughtup.isError()) {
+      swap->promise.fail(caughtup.error());
+    } else if (entries.contains(entry.name()) &&
+               entries[entry.name()].uuid() == entry.uuid()) {
+      swap->promise.set(true);
+    } else if (result.isError()) {
+      swap->promise.fail("Failed to append to the log: " + result.error());
+    } else if (result.isNone()) {
+      swap->promise.fail("Timed out appending to the log");
+    } else {
+      swap->promise.set(false); // Lost to an earlier operation.
+    }
+
+    delete swap;
+  }
+}
+
+
+Try<Nothing> LogStateProcess::catchup()
+{
+  // NOTE: Positions can't be incremented, so we read starting from
+  // the last applied position (and skip it) rather than after it.
+  Log::Position from = position.isSome() ? position.get() : reader.beginning();
+  Log::Position to = reader.ending();
+
+  if (to < from || (position.isSome() && to == position.get())) {
+    return Nothing(); // Nothing new to read.
+  }
+
+  Result<list<Log::Entry> > result = reader.read(from, to, Timeout(timeout));
+
+  if (result.isError()) {
+    return Try<Nothing>::error("Failed to read the log: " + result.error());
+  } else if (result.isNone()) {
+    return Try<Nothing>::error("Timed out reading the log");
+  }
+
+  foreach (const Log::Entry& entry, result.get()) {
+    if (position.isNone() || entry.position > position.get()) {
+      apply(entry);
+    }
+  }
+
+  position = to;
+
+  return Nothing();
+}
+
+
+void LogStateProcess::apply(const Log::Entry& entry)
+{
+  Operation operation;
+
+  if (!operation.ParseFromString(entry.data)) {
+    // Every replica skips the same entries so the views still agree.
+    LOG(WARNING) << "Skipping log entry that is not an Operation";
+    return;
+  }
+
+  if (operation.type() == Operation::STORE) {
+    CHECK(operation.has_store());
+    if (applicable(operation.store())) {
+      const Entry& entry = operation.store().entry();
+      entries[entry.name()] = entry;
+    }
+  } else if (operation.type() == Operation::TRANSACTION) {
+    CHECK(operation.has_transaction());
+
+    foreach (const Operation::Store& store,
+             operation.transaction().stores()) {
+      if (!applicable(store)) {
+        return; // None of the entries get stored.
+      }
+    }
+
+    foreach (const Operation::Store& store,
+             operation.transaction().stores()) {
+      entries[store.entry().name()] = store.entry();
+    }
+  }
+}
+
+
+bool LogStateProcess::applicable(const Operation::Store& store)
+{
+  const string& name = store.entry().name();
+  return !entries.contains(name) || entries[name].uuid() == store.uuid();
+}
+
+} // namespace state {
+} // namespace internal {
+} // namespace mesos {
@@ -0,0 +1,205 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __STATE_LOG_HPP__
+#define __STATE_LOG_HPP__
+
+#include <queue>
+#include <string>
+#include <vector>
+
+#include <process/dispatch.hpp>
+#include <process/future.hpp>
+#include <process/process.hpp>
+
+#include <stout/duration.hpp>
+#include <stout/hashmap.hpp>
+#include <stout/nothing.hpp>
+#include <stout/option.hpp>
+#include <stout/try.hpp>
+#include <stout/uuid.hpp>
+
+#include "log/log.hpp"
+
+#include "messages/state.hpp"
+
+#include "state/serializer.hpp"
+#include "state/state.hpp"
+
+namespace mesos {
+namespace internal {
+namespace state {
+
+// Forward declarations.
+class LogStateProcess;
+
+
+// A State backed by the replicated log. Every swap is appended to the
+// log as an operation (see Operation in messages/state.proto) and the
+// state itself is an in-memory view that is materialized by reading
+// (and applying) the operations in log order, so every replica of the
+// log ends up with the same state. Whether or not a swap succeeded is
+// determined by applying it, i.e., after it has been appended.
+//
+// Swapping multiple entries appends a single (transaction) operation
+// so it's atomic. Concurrent swaps get appended as one batch, and
+// values are only limited by what the log can store (rather than the
+// 1 MB limit of a znode). Note that only one writer of the log can
+// be active at a time (see Log::Writer), so a LogState is meant to be
+// used by a single (e.g., elected) process at a time, while others can
+// read the state from their local replica (which might be stale).
+//
+// NOTE: The log operations block, so a LogState must not be used from
+// a process that is needed by the log itself (e.g., a replica).
+template <typename Serializer = StringSerializer>
+class LogState : public State<Serializer>
+{
+public:
+  LogState(log::Log* log, const Duration& timeout);
+  virtual ~LogState();
+
+  // State implementation.
+  virtual process::Future<std::vector<std::string> > names();
+
+protected:
+  // More State implementation.
+  virtual process::Future<Option<Entry> > fetch(const std::string& name);
+  virtual process::Future<bool> swap(const Entry& entry, const UUID& uuid);
+  virtual process::Future<bool> swapAll(
+      const std::vector<Entry>& entries,
+      const std::vector<UUID>& uuids);
+
+private:
+  LogStateProcess* process;
+};
+
+
+class LogStateProcess : public process::Process<LogStateProcess>
+{
+public:
+  LogStateProcess(log::Log* log, const Duration& timeout);
+  virtual ~LogStateProcess();
+
+  // State implementation.
+  process::Future<std::vector<std::string> > names();
+  process::Future<Option<Entry> > fetch(const std::string& name);
+  process::Future<bool> swap(const Entry& entry, const UUID& uuid);
+  process::Future<bool> swapAll(
+      const std::vector<Entry>& entries,
+      const std::vector<UUID>& uuids);
+
+private:
+  struct Swap
+  {
+    Swap(const std::vector<Entry>& _entries, const std::vector<UUID>& _uuids)
+      : entries(_entries), uuids(_uuids) {}
+    std::vector<Entry> entries;
+    std::vector<UUID> uuids;
+    process::Promise<bool> promise;
+  };
+
+  // Appends all of the pending swaps to the log (as a single batch)
+  // and then determines which of them succeeded.
+  void flush();
+
+  // Reads and applies all of the operations in the log that haven't
+  // been applied to the view yet.
+  Try<Nothing> catchup();
+
+  // Applies the operation stored in the specified log entry.
+  void apply(const log::Log::Entry& entry);
+
+  // Returns true if the specified store would be applied (i.e., the
+  // current entry, if any, has the expected UUID).
+  bool applicable(const Operation::Store& store);
+
+  // Maximum number of batches of appends in flight and maximum number
+  // of appends per batch when flushing (see Log::Writer::append).
+  static const size_t WINDOW = 16;
+  static const size_t BATCH = 128;
+
+  log::Log* log;
+  const Duration timeout;
+
+  log::Log::Reader reader;
+  log::Log::Writer* writer; // Created lazily, replaced after an error.
+
+  // The state as of (and including) the operation at 'position'.
+  hashmap<std::string, Entry> entries;
+  Option<log::Log::Position> position;
+
+  // Swaps waiting to be appended by the next flush.
+  std::queue<Swap*> pending;
+  bool flushing; // Whether or not a flush has been dispatched.
+};
+
+
+template <typename Serializer>
+LogState<Serializer>::LogState(log::Log* log, const Duration& timeout)
+{
+  process = new LogStateProcess(log, timeout);
+  process::spawn(process);
+}
+
+
+template <typename Serializer>
+LogState<Serializer>::~LogState()
+{
+  process::terminate(process);
+  process::wait(process);
+  delete process;
+}
+
+
+template <typename Serializer>
+process::Future<std::vector<std::string> > LogState<Serializer>::names()
+{
+  return process::dispatch(process, &LogStateProcess::names);
+}
+
+
+template <typename Serializer>
+process::Future<Option<Entry> > LogState<Serializer>::fetch(
+    const std::string& name)
+{
+  return process::dispatch(process, &LogStateProcess::fetch, name);
+}
+
+
+template <typename Serializer>
+process::Future<bool> LogState<Serializer>::swap(
+    const Entry& entry,
+    const UUID& uuid)
+{
+  return process::dispatch(process, &LogStateProcess::swap, entry, uuid);
+}
+
+
+template <typename Serializer>
+process::Future<bool> LogState<Serializer>::swapAll(
+    const std::vector<Entry>& entries,
+    const std::vector<UUID>& uuids)
+{
+  return process::dispatch(process, &LogStateProcess::swapAll, entries, uuids);
+}
+
+} // namespace state {
+} // namespace internal {
+} // namespace mesos {
+
+#endif // __STATE_LOG_HPP__
@@ -19,11 +19,17 @@
 #ifndef __STATE_STATE_HPP__
 #define __STATE_STATE_HPP__
 
+#include <list>
 #include <string>
 #include <vector>
 
+#include <process/collect.hpp>
 #include <process/future.hpp>
 
+#include <stout/foreach.hpp>
+#include <stout/gzip.hpp>
+#include <stout/hashset.hpp>
+#include <stout/nothing.hpp>
 #include <stout/option.hpp>
 #include <stout/try.hpp>
 #include <stout/uuid.hpp>
@@ -57,10 +63,22 @@ namespace state {
 //   Variable<Slaves> slaves = variable.get();
 //   slaves->add_infos()->MergeFrom(info);
 //   Future<bool> set = state->set(&slaves);
+//
+// Multiple (related) variables can be gotten, and atomically set, at
+// once, e.g., to update some of the slaves and all of their tasks:
+//
+//   std::vector<std::string> names = ...;
+//   Future<std::vector<Variable<Slaves> > > variables =
+//     state->get<Slaves>(names);
+//   ...
+//   Future<Option<std::vector<Variable<Slaves> > > > set =
+//     state->set(variables.get());
 
 // Forward declarations.
 template <typename Serializer>
 class State;
+template <typename Serializer>
+class CachingState;
 class ZooKeeperStateProcess;
 
 
@@ -104,6 +122,22 @@ public:
   template <typename T>
   process::Future<Option<Variable<T> > > set(const Variable<T>& variable);
 
+  // Returns the variables with the specified names (in the same
+  // order), creating new ones for those that previously did not
+  // exist (or an error if one occurs). The variables are fetched all
+  // at once rather than one after another.
+  template <typename T>
+  process::Future<std::vector<Variable<T> > > get(
+      const std::vector<std::string>& names);
+
+  // Atomically sets all of the specified variables (which must have
+  // distinct names): returns the new variables if none of them had
+  // changed since last fetched, otherwise none (and none of the
+  // variables were set), or an error if one occurs.
+  template <typename T>
+  process::Future<Option<std::vector<Variable<T> > > > set(
+      const std::vector<Variable<T> >& variables);
+
   // Returns the collection of variable names in the state.
   virtual process::Future<std::vector<std::string> > names() = 0;
 
@@ -113,7 +147,54 @@ protected:
   virtual process::Future<Option<Entry> > fetch(const std::string& name) = 0;
   virtual process::Future<bool> swap(const Entry& entry, const UUID& uuid) = 0;
 
+  // Swaps all of the specified entries provided each of the current
+  // entries (if any) has the corresponding UUID, otherwise swaps none
+  // of them. Implementations that can't swap multiple entries
+  // atomically only support swapping a single entry, which is the
+  // default.
+  virtual process::Future<bool> swapAll(
+      const std::vector<Entry>& entries,
+      const std::vector<UUID>& uuids)
+  {
+    CHECK(entries.size() == uuids.size());
+
+    if (entries.empty()) {
+      return true;
+    } else if (entries.size() == 1) {
+      return swap(entries[0], uuids[0]);
+    }
+
+    return process::Future<bool>::failed(
+        "Atomically swapping multiple entries is not supported");
+  }
+
+  // Returns a future that is satisfied once the entry with the
+  // specified name might have been changed by someone other than
+  // this instance (e.g., another ZooKeeperState talking to the same
+  // ZooKeeper ensemble). Implementations that can not observe such
+  // changes (or where they can not happen) return a future that is
+  // never satisfied, which is the default.
+  virtual process::Future<Nothing> watch(const std::string& name)
+  {
+    return process::Future<Nothing>();
+  }
+
 private:
+  template <typename S>
+  friend class CachingState; // Decorates fetch, swap(All), and watch.
+
+  // Values at least this big get compressed (provided they actually
+  // get smaller, and that compression is available).
+  static const size_t COMPRESSION_THRESHOLD = 4096; // 4 KB.
+
+  // Returns a new entry (with a random UUID) for the specified
+  // serialized value, compressing the value if it's big enough.
+  static Entry create(const std::string& name, const std::string& value);
+
+  // Returns the serialized value of the specified entry, i.e., after
+  // decompressing it if necessary.
+  static Try<std::string> value(const Entry& entry);
+
   // Helpers to handle future results from fetch and swap. We make
   // these static members of State for friend access to Variable's
   // constructor.
@@ -127,9 +208,65 @@ private:
       const Entry& entry,
       const T& t,
       const bool& b); // TODO(benh): Remove 'const &' after fixing libprocess.
+
+  template <typename T>
+  static process::Future<std::vector<Variable<T> > > _getAll(
+      const std::list<process::Future<Variable<T> > >& futures,
+      const std::list<Variable<T> >& variables);
+
+  template <typename T>
+  static process::Future<Option<std::vector<Variable<T> > > > _setAll(
+      const std::vector<Entry>& entries,
+      const std::vector<T>& ts,
+      const bool& b); // TODO(benh): Remove 'const &' after fixing libprocess.
 };
 
 
+template <typename Serializer>
+Entry State<Serializer>::create(
+    const std::string& name,
+    const std::string& value)
+{
+  Entry entry;
+  entry.set_name(name);
+  entry.set_uuid(UUID::random().toBytes());
+
+  if (value.size() >= COMPRESSION_THRESHOLD) {
+    Try<std::string> compressed = gzip::compress(value);
+
+    // Failing to compress isn't an error, we just store the value
+    // uncompressed (e.g., if compression isn't available).
+    if (compressed.isSome() && compressed.get().size() < value.size()) {
+      entry.set_value(compressed.get());
+      entry.set_compressed(true);
+      return entry;
+    }
+  }
+
+  entry.set_value(value);
+  return entry;
+}
+
+
+template <typename Serializer>
+Try<std::string> State<Serializer>::value(const Entry& entry)
+{
+  if (entry.compressed()) {
+    Try<std::string> decompressed = gzip::decompress(entry.value());
+
+    if (decompressed.isError()) {
+      return Try<std::string>::error(
+          "Failed to decompress entry '" + entry.name() + "': " +
+          decompressed.error());
+    }
+
+    return decompressed.get();
+  }
+
+  return entry.value();
+}
+
+
 template <typename Serializer>
 template <typename T>
 process::Future<Variable<T> > State<Serializer>::_get(
@@ -139,7 +276,13 @@ process::Future<Variable<T> > State<Serializer>::_get(
   if (option.isSome()) {
     const Entry& entry = option.get();
 
-    Try<T> t = Serializer::template deserialize<T>(entry.value());
+    Try<std::string> value = State<Serializer>::value(entry);
+
+    if (value.isError()) {
+      return process::Future<Variable<T> >::failed(value.error());
+    }
+
+    Try<T> t = Serializer::template deserialize<T>(value.get());
 
     if (t.isError()) {
       return process::Future<Variable<T> >::failed(t.error());
@@ -158,12 +301,7 @@ process::Future<Variable<T> > State<Serializer>::_get(
     return process::Future<Variable<T> >::failed(value.error());
   }
 
-  Entry entry;
-  entry.set_name(name);
-  entry.set_uuid(UUID::random().toBytes());
-  entry.set_value(value.get());
-
-  return Variable<T>(entry, t);
+  return Variable<T>(create(name, value.get()), t);
 }
 
 
@@ -212,10 +350,7 @@ process::Future<Option<Variable<T> > > State<Serializer>::set(
 
   // Create a new entry that should be replace the existing entry
   // provided the UUID matches.
-  Entry entry;
-  entry.set_name(variable.entry.name());
-  entry.set_uuid(UUID::random().toBytes());
-  entry.set_value(value.get());
+  Entry entry = create(variable.entry.name(), value.get());
 
   std::tr1::function<
   process::Future<Option<Variable<T> > >(const bool&)> _set =
@@ -228,6 +363,108 @@ process::Future<Option<Variable<T> > > State<Serializer>::set(
 }
 
 
+template <typename Serializer>
+template <typename T>
+process::Future<std::vector<Variable<T> > > State<Serializer>::_getAll(
+    const std::list<process::Future<Variable<T> > >& futures,
+    const std::list<Variable<T> >& variables)
+{
+  // NOTE: The variables are in the order the futures completed, so
+  // we get them from the (now ready) futures instead.
+  std::vector<Variable<T> > results;
+  foreach (const process::Future<Variable<T> >& future, futures) {
+    results.push_back(future.get());
+  }
+  return results;
+}
+
+
+template <typename Serializer>
+template <typename T>
+process::Future<Option<std::vector<Variable<T> > > > State<Serializer>::_setAll(
+    const std::vector<Entry>& entries,
+    const std::vector<T>& ts,
+    const bool& b) // TODO(benh): Remove 'const &' after fixing libprocess.
+{
+  if (b) {
+    std::vector<Variable<T> > variables;
+    for (size_t i = 0; i < entries.size(); i++) {
+      variables.push_back(Variable<T>(entries[i], ts[i]));
+    }
+    return Option<std::vector<Variable<T> > >::some(variables);
+  }
+
+  return Option<std::vector<Variable<T> > >::none();
+}
+
+
+template <typename Serializer>
+template <typename T>
+process::Future<std::vector<Variable<T> > > State<Serializer>::get(
+    const std::vector<std::string>& names)
+{
+  // Fetch all of the entries at once (rather than waiting for each
+  // one before fetching the next).
+  std::list<process::Future<Variable<T> > > futures;
+  foreach (const std::string& name, names) {
+    futures.push_back(get<T>(name));
+  }
+
+  std::tr1::function<
+  process::Future<std::vector<Variable<T> > >(
+      const std::list<Variable<T> >&)> _get =
+    std::tr1::bind(&State<Serializer>::template _getAll<T>,
+                   futures,
+                   std::tr1::placeholders::_1);
+
+  return process::collect(futures).then(_get);
+}
+
+
+template <typename Serializer>
+template <typename T>
+process::Future<Option<std::vector<Variable<T> > > > State<Serializer>::set(
+    const std::vector<Variable<T> >& variables)
+{
+  std::vector<Entry> entries;
+  std::vector<UUID> uuids;
+  std::vector<T> ts;
+
+  hashset<std::string> names;
+
+  foreach (const Variable<T>& variable, variables) {
+    if (names.contains(variable.entry.name())) {
+      return process::Future<Option<std::vector<Variable<T> > > >::failed(
+          "Duplicate variable '" + variable.entry.name() + "'");
+    }
+
+    names.insert(variable.entry.name());
+
+    Try<std::string> value = Serializer::template serialize<T>(variable.t);
+
+    if (value.isError()) {
+      return process::Future<Option<std::vector<Variable<T> > > >::failed(
+          value.error());
+    }
+
+    // Like above, create new entries that should replace the existing
+    // entries provided the UUIDs match.
+    entries.push_back(create(variable.entry.name(), value.get()));
+    uuids.push_back(UUID::fromBytes(variable.entry.uuid()));
+    ts.push_back(variable.t);
+  }
+
+  std::tr1::function<
+  process::Future<Option<std::vector<Variable<T> > > >(const bool&)> _set =
+    std::tr1::bind(&State<Serializer>::template _setAll<T>,
+                   entries,
+                   ts,
+                   std::tr1::placeholders::_1);
+
+  return swapAll(entries, uuids).then(_set);
+}
+
+
 
 } // namespace state {
 } // namespace internal {
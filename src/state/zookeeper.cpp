@@ -1,16 +1,23 @@
 #include <google/protobuf/message.h>
 
 #include <queue>
+#include <set>
 #include <string>
 #include <vector>
 
+#include <process/defer.hpp>
 #include <process/dispatch.hpp>
 #include <process/future.hpp>
 #include <process/process.hpp>
 
 #include <stout/duration.hpp>
+#include <stout/foreach.hpp>
+#include <stout/hashmap.hpp>
+#include <stout/lambda.hpp>
+#include <stout/nothing.hpp>
 #include <stout/option.hpp>
 #include <stout/result.hpp>
+#include <stout/stringify.hpp>
 #include <stout/strings.hpp>
 #include <stout/try.hpp>
 #include <stout/uuid.hpp>
@@ -29,6 +36,7 @@
 using namespace process;
 
 using std::queue;
+using std::set;
 using std::string;
 using std::vector;
 
@@ -38,7 +46,24 @@ namespace mesos {
 namespace internal {
 namespace state {
 
-// Helper for failing a queue of promises.
+// Entries are stored in a single znode unless they're bigger than
+// this, in which case the value is split into chunks of (at most)
+// this size that get stored as children of the entry's znode (since
+// ZooKeeper limits the size of a znode to 1 MB).
+static const size_t CHUNK_SIZE = 512 * 1024; // 512 KB.
+
+
+// Returns the path of the specified chunk of an entry. Chunks are
+// named after the UUID of the entry so that swapping an entry never
+// changes the chunks of the entry it replaces.
+static string chunk(const string& path, const Entry& entry, uint32_t index)
+{
+  return path + "/" + UUID::fromBytes(entry.uuid()).toString() +
+    "-" + stringify(index);
+}
+
+
+// Helpers for failing a queue (or set) of promises.
 template <typename T>
 void fail(queue<T*>* queue, const string& message)
 {
@@ -51,6 +76,17 @@ void fail(queue<T*>* queue, const string& message)
 }
 
 
+template <typename T>
+void fail(set<T*>* operations, const string& message)
+{
+  foreach (T* t, *operations) {
+    t->promise.fail(message);
+    delete t;
+  }
+  operations->clear();
+}
+
+
 ZooKeeperStateProcess::ZooKeeperStateProcess(
     const string& _servers,
     const Duration& _timeout,
@@ -65,18 +101,32 @@ ZooKeeperStateProcess::ZooKeeperStateProcess(
         : ZOO_OPEN_ACL_UNSAFE),
     watcher(NULL),
     zk(NULL),
-    state(DISCONNECTED)
+    state(DISCONNECTED),
+    parents(false)
 {}
 
 
 ZooKeeperStateProcess::~ZooKeeperStateProcess()
 {
+  // NOTE: Deleting the ZooKeeper instance completes all of the
+  // outstanding operations (with ZCLOSING) so it's safe to delete
+  // them afterwards.
+  delete zk;
+  delete watcher;
+
   fail(&pending.names, "No longer managing state");
   fail(&pending.fetches, "No longer managing state");
   fail(&pending.swaps, "No longer managing state");
 
-  delete zk;
-  delete watcher;
+  fail(&outstanding.names, "No longer managing state");
+  fail(&outstanding.fetches, "No longer managing state");
+  fail(&outstanding.swaps, "No longer managing state");
+
+  foreachvalue (Promise<Nothing>* promise, watches) {
+    promise->fail("No longer managing state");
+    delete promise;
+  }
+  watches.clear();
 }
 
 
@@ -93,23 +143,18 @@ Future<vector<string> > ZooKeeperStateProcess::names()
 {
   if (error.isSome()) {
     return Future<vector<string> >::failed(error.get());
-  } else if (state != CONNECTED) {
-    Names* names = new Names();
-    pending.names.push(names);
-    return names->promise.future();
   }
 
-  Result<vector<string> > result = doNames();
+  Names* names = new Names();
+  Future<vector<string> > future = names->promise.future();
 
-  if (result.isNone()) { // Try again later.
-    Names* names = new Names();
+  if (state != CONNECTED) {
     pending.names.push(names);
-    return names->promise.future();
-  } else if (result.isError()) {
-    return Future<vector<string> >::failed(result.error());
+  } else {
+    doNames(names);
   }
 
-  return result.get();
+  return future;
 }
 
 
@@ -117,23 +162,18 @@ Future<Option<Entry> > ZooKeeperStateProcess::fetch(const string& name)
 {
   if (error.isSome()) {
     return Future<Option<Entry> >::failed(error.get());
-  } else if (state != CONNECTED) {
-    Fetch* fetch = new Fetch(name);
-    pending.fetches.push(fetch);
-    return fetch->promise.future();
   }
 
-  Result<Option<Entry> > result = doFetch(name);
+  Fetch* fetch = new Fetch(name);
+  Future<Option<Entry> > future = fetch->promise.future();
 
-  if (result.isNone()) { // Try again later.
-    Fetch* fetch = new Fetch(name);
+  if (state != CONNECTED) {
     pending.fetches.push(fetch);
-    return fetch->promise.future();
-  } else if (result.isError()) {
-    return Future<Option<Entry> >::failed(result.error());
+  } else {
+    doFetch(fetch);
   }
 
-  return result.get();
+  return future;
 }
 
 
@@ -141,23 +181,64 @@ Future<bool> ZooKeeperStateProcess::swap(const Entry& entry, const UUID& uuid)
 {
   if (error.isSome()) {
     return Future<bool>::failed(error.get());
-  } else if (state != CONNECTED) {
-    Swap* swap = new Swap(entry, uuid);
-    pending.swaps.push(swap);
-    return swap->promise.future();
   }
 
-  Result<bool> result = doSwap(entry, uuid);
+  // Serialize to determine whether or not we're under the chunk size
+  // (and thus the 1 MB limit), otherwise we store the value in chunks
+  // and only a "header" (the entry without its value) in the znode.
+  string data;
+
+  if (!entry.SerializeToString(&data)) {
+    return Future<bool>::failed("Failed to serialize Entry");
+  }
+
+  vector<string> chunks;
 
-  if (result.isNone()) { // Try again later.
-    Swap* swap = new Swap(entry, uuid);
+  if (data.size() > CHUNK_SIZE) {
+    const string& value = entry.value();
+    for (size_t offset = 0; offset < value.size(); offset += CHUNK_SIZE) {
+      chunks.push_back(value.substr(offset, CHUNK_SIZE));
+    }
+
+    Entry header = entry;
+    header.set_value("");
+    header.set_chunks(chunks.size());
+
+    if (!header.SerializeToString(&data)) {
+      return Future<bool>::failed("Failed to serialize Entry");
+    }
+  }
+
+  Swap* swap = new Swap(entry, uuid, data, chunks);
+  Future<bool> future = swap->promise.future();
+
+  if (state != CONNECTED) {
     pending.swaps.push(swap);
-    return swap->promise.future();
-  } else if (result.isError()) {
-    return Future<bool>::failed(result.error());
+  } else {
+    doSwap(swap);
+  }
+
+  return future;
+}
+
+
+Future<Nothing> ZooKeeperStateProcess::watch(const string& name)
+{
+  if (error.isSome()) {
+    return Future<Nothing>::failed(error.get());
+  }
+
+  const string path = znode + "/" + name;
+
+  if (!watches.contains(path)) {
+    watches[path] = new Promise<Nothing>();
+
+    if (state == CONNECTED) {
+      doWatch(path, false);
+    }
   }
 
-  return result.get();
+  return watches[path]->future();
 }
 
 
@@ -184,46 +265,32 @@ void ZooKeeperStateProcess::connected(bool reconnect)
 
   state = CONNECTED;
 
+  // (Re)issue all of the pending operations (without waiting for
+  // any of them to complete).
   while (!pending.names.empty()) {
     Names* names = pending.names.front();
-    Result<vector<string> > result = doNames();
-    if (result.isNone()) {
-      return; // Try again later.
-    } else if (result.isError()) {
-      names->promise.fail(result.error());
-    } else {
-      names->promise.set(result.get());
-    }
     pending.names.pop();
-    delete names;
+    doNames(names);
   }
 
   while (!pending.fetches.empty()) {
     Fetch* fetch = pending.fetches.front();
-    Result<Option<Entry> > result = doFetch(fetch->name);
-    if (result.isNone()) {
-      return; // Try again later.
-    } else if (result.isError()) {
-      fetch->promise.fail(result.error());
-    } else {
-      fetch->promise.set(result.get());
-    }
     pending.fetches.pop();
-    delete fetch;
+    doFetch(fetch);
   }
 
   while (!pending.swaps.empty()) {
     Swap* swap = pending.swaps.front();
-    Result<bool> result = doSwap(swap->entry, swap->uuid);
-    if (result.isNone()) {
-      return; // Try again later.
-    } else if (result.isError()) {
-      swap->promise.fail(result.error());
-    } else {
-      swap->promise.set(result.get());
-    }
     pending.swaps.pop();
-    delete swap;
+    doSwap(swap);
+  }
+
+  // (Re)set the watches, some of which might have been requested
+  // while we were disconnected. Note that setting a watch on a znode
+  // that is already being watched is harmless (the event gets
+  // delivered only once).
+  foreachkey (const string& path, watches) {
+    doWatch(path, false);
   }
 }
 
@@ -238,6 +305,16 @@ void ZooKeeperStateProcess::expired()
 {
   state = DISCONNECTED;
 
+  // The watches were lost with the session, so we conservatively
+  // assume that every watched znode might have changed.
+  foreachvalue (Promise<Nothing>* promise, watches) {
+    promise->set(Nothing());
+    delete promise;
+  }
+  watches.clear();
+
+  // NOTE: Any outstanding operations will complete (with ZCLOSING)
+  // and get retried once we've reconnected.
   delete zk;
   zk = new ZooKeeper(servers, timeout, watcher);
 
@@ -247,173 +324,499 @@ void ZooKeeperStateProcess::expired()
 
 void ZooKeeperStateProcess::updated(const string& path)
 {
-  LOG(FATAL) << "Unexpected ZooKeeper event";
+  check(path);
 }
 
 
 void ZooKeeperStateProcess::created(const string& path)
 {
-  LOG(FATAL) << "Unexpected ZooKeeper event";
+  check(path);
 }
 
 
 void ZooKeeperStateProcess::deleted(const string& path)
 {
-  LOG(FATAL) << "Unexpected ZooKeeper event";
+  check(path);
 }
 
 
-Result<vector<string> > ZooKeeperStateProcess::doNames()
+void ZooKeeperStateProcess::doNames(Names* names)
 {
+  CHECK(error.isNone()) << ": " << error.get();
+  CHECK(state == CONNECTED);
+
+  outstanding.names.insert(names);
+
   // Get all children to determine current memberships.
-  vector<string> results;
+  names->results.clear();
 
-  int code = zk->getChildren(znode, false, &results);
+  zk->agetChildren(znode, false, &names->results)
+    .onAny(defer(self(), &Self::_names, names, lambda::_1));
+}
 
-  if (code == ZINVALIDSTATE || (code != ZOK && zk->retryable(code))) {
-    CHECK(zk->getState() != ZOO_AUTH_FAILED_STATE);
-    return Result<vector<string> >::none(); // Try again later.
-  } else if (code != ZOK) {
-    return Result<vector<string> >::error(
+
+void ZooKeeperStateProcess::_names(Names* names, const Future<int>& code)
+{
+  outstanding.names.erase(names);
+
+  if (retry(code)) {
+    pending.names.push(names); // Try again later.
+    return;
+  } else if (code.get() != ZOK) {
+    names->promise.fail(
         "Failed to get children of '" + znode +
-        "' in ZooKeeper: " + zk->message(code));
+        "' in ZooKeeper: " + zk->message(code.get()));
+  } else {
+    // TODO(benh): It might make sense to "mangle" the names so that
+    // we can determine when a znode has incorrectly been added that
+    // actually doesn't store an Entry.
+    names->promise.set(names->results);
   }
 
-  // TODO(benh): It might make sense to "mangle" the names so that we
-  // can determine when a znode has incorrectly been added that
-  // actually doesn't store an Entry.
-  return results;
+  delete names;
 }
 
 
-Result<Option<Entry> > ZooKeeperStateProcess::doFetch(const string& name)
+void ZooKeeperStateProcess::doFetch(Fetch* fetch)
 {
   CHECK(error.isNone()) << ": " << error.get();
   CHECK(state == CONNECTED);
 
-  string result;
-  Stat stat;
+  outstanding.fetches.insert(fetch);
 
-  int code = zk->get(znode + "/" + name, false, &result, &stat);
+  zk->aget(znode + "/" + fetch->name, false, &fetch->result, &fetch->stat)
+    .onAny(defer(self(), &Self::_fetch, fetch, lambda::_1));
+}
 
-  if (code == ZNONODE) {
-    return Option<Entry>::none();
-  } else if (code == ZINVALIDSTATE || (code != ZOK && zk->retryable(code))) {
-    CHECK(zk->getState() != ZOO_AUTH_FAILED_STATE);
-    return Result<Option<Entry> >::none(); // Try again later.
-  } else if (code != ZOK) {
-    return Result<Option<Entry> >::error(
-        "Failed to get '" + znode + "/" + name +
-        "' in ZooKeeper: " + zk->message(code));
+
+void ZooKeeperStateProcess::_fetch(Fetch* fetch, const Future<int>& code)
+{
+  outstanding.fetches.erase(fetch);
+
+  if (retry(code)) {
+    pending.fetches.push(fetch); // Try again later.
+    return;
+  } else if (code.get() == ZNONODE) {
+    fetch->promise.set(Option<Entry>::none());
+  } else if (code.get() != ZOK) {
+    fetch->promise.fail(
+        "Failed to get '" + znode + "/" + fetch->name +
+        "' in ZooKeeper: " + zk->message(code.get()));
+  } else {
+    google::protobuf::io::ArrayInputStream stream(
+        fetch->result.data(),
+        fetch->result.size());
+
+    Entry entry;
+
+    if (!entry.ParseFromZeroCopyStream(&stream)) {
+      fetch->promise.fail("Failed to deserialize Entry");
+    } else if (entry.chunks() > 0) {
+      // Get all of the chunks (without waiting for each one).
+      outstanding.fetches.insert(fetch);
+
+      const string path = znode + "/" + fetch->name;
+
+      fetch->entry = entry;
+      fetch->chunks = vector<string>(entry.chunks());
+      fetch->gets.clear();
+
+      for (uint32_t i = 0; i < entry.chunks(); i++) {
+        fetch->gets.push_back(
+            zk->aget(chunk(path, entry, i), false, &fetch->chunks[i], NULL));
+      }
+
+      // The gets complete in order so we only need to wait for the
+      // last one (see ZooKeeperStateProcess::__fetch).
+      fetch->gets.back()
+        .onAny(defer(self(), &Self::__fetch, fetch, lambda::_1));
+      return;
+    } else {
+      fetch->promise.set(Option<Entry>::some(entry));
+    }
   }
 
-  google::protobuf::io::ArrayInputStream stream(result.data(), result.size());
+  delete fetch;
+}
+
 
-  Entry entry;
+void ZooKeeperStateProcess::__fetch(Fetch* fetch, const Future<int>& code)
+{
+  outstanding.fetches.erase(fetch);
+
+  foreach (const Future<int>& get, fetch->gets) {
+    if (!get.isReady() || retry(get)) {
+      pending.fetches.push(fetch); // Try again later.
+      return;
+    } else if (get.get() == ZNONODE) {
+      // The entry must have been swapped (and the chunks removed)
+      // since we got the header, so start over.
+      if (state == CONNECTED) {
+        doFetch(fetch);
+      } else {
+        pending.fetches.push(fetch);
+      }
+      return;
+    } else if (get.get() != ZOK) {
+      fetch->promise.fail(
+          "Failed to get chunk of '" + znode + "/" + fetch->name +
+          "' in ZooKeeper: " + zk->message(get.get()));
+      delete fetch;
+      return;
+    }
+  }
 
-  if (!entry.ParseFromZeroCopyStream(&stream)) {
-    return Result<Option<Entry> >::error("Failed to deserialize Entry");
+  string value;
+  foreach (const string& chunk, fetch->chunks) {
+    value += chunk;
   }
 
-  return Option<Entry>::some(entry);
+  Entry entry = fetch->entry;
+  entry.set_value(value);
+  entry.clear_chunks();
+
+  fetch->promise.set(Option<Entry>::some(entry));
+
+  delete fetch;
 }
 
 
-Result<bool> ZooKeeperStateProcess::doSwap(const Entry& entry, const UUID& uuid)
+void ZooKeeperStateProcess::doSwap(Swap* swap)
 {
   CHECK(error.isNone()) << ": " << error.get();
   CHECK(state == CONNECTED);
 
-  // Serialize to make sure we're under the 1 MB limit.
-  string data;
+  outstanding.swaps.insert(swap);
 
-  if (!entry.SerializeToString(&data)) {
-    return Result<bool>::error("Failed to serialize Entry");
-  }
+  const string path = znode + "/" + swap->entry.name();
+
+  zk->aget(path, false, &swap->result, &swap->stat)
+    .onAny(defer(self(), &Self::_swap, swap, lambda::_1));
+}
 
-  if (data.size() > 1024 * 1024) { // 1 MB
-    // TODO(benh): Implement compression.
-    return Result<bool>::error("Serialized data is too big (> 1 MB)");
+
+void ZooKeeperStateProcess::_swap(Swap* swap, const Future<int>& code)
+{
+  const string path = znode + "/" + swap->entry.name();
+
+  if (retry(code)) {
+    outstanding.swaps.erase(swap);
+    pending.swaps.push(swap); // Try again later.
+    return;
+  } else if (code.get() == ZNONODE) {
+    swap->creates.clear();
+
+    // Create directory path znodes as necessary (unless we already
+    // know they exist). Note that we don't need to wait for these to
+    // complete before creating the znode since ZooKeeper processes
+    // the operations in the order they were issued.
+    if (!parents) {
+      CHECK(znode.size() == 0 || znode.at(znode.size() - 1) != '/');
+      size_t index = znode.find("/", 0);
+
+      while (index < string::npos) {
+        // Get out the prefix to create.
+        index = znode.find("/", index + 1);
+        string prefix = znode.substr(0, index);
+
+        // Create the znode (even if it already exists).
+        swap->creates.push_back(zk->acreate(prefix, "", acl, 0, NULL));
+      }
+    }
+
+    string data = swap->data;
+
+    // A chunked entry needs its znode to exist before the chunks can
+    // be created, so we first create the znode with a "placeholder"
+    // entry that is equivalent to the entry not existing (an empty
+    // value with the UUID the caller expects) and then swap that.
+    if (!swap->chunks.empty()) {
+      Entry placeholder;
+      placeholder.set_name(swap->entry.name());
+      placeholder.set_uuid(swap->uuid.toBytes());
+      placeholder.set_value("");
+
+      if (!placeholder.SerializeToString(&data)) {
+        swap->promise.fail("Failed to serialize Entry");
+        outstanding.swaps.erase(swap);
+        delete swap;
+        return;
+      }
+    }
+
+    zk->acreate(path, data, acl, 0, NULL)
+      .onAny(defer(self(), &Self::__swap, swap, lambda::_1));
+    return;
+  } else if (code.get() != ZOK) {
+    swap->promise.fail(
+        "Failed to get '" + path + "' in ZooKeeper: " +
+        zk->message(code.get()));
+  } else {
+    google::protobuf::io::ArrayInputStream stream(
+        swap->result.data(),
+        swap->result.size());
+
+    Entry current;
+
+    if (!current.ParseFromZeroCopyStream(&stream)) {
+      swap->promise.fail("Failed to deserialize Entry");
+    } else if (UUID::fromBytes(current.uuid()) != swap->uuid) {
+      swap->promise.set(false);
+    } else if (!swap->chunks.empty()) {
+      swap->current = current;
+      storeChunks(swap, swap->stat.version);
+      return;
+    } else {
+      swap->current = current;
+      swap->creates.clear(); // Nothing to create.
+
+      // Okay, do a set, we get atomic swap by requiring 'stat.version'.
+      swap->version = swap->stat.version;
+      zk->aset(path, swap->data, swap->version)
+        .onAny(defer(self(), &Self::___swap, swap, lambda::_1));
+      return;
+    }
   }
 
-  string result;
-  Stat stat;
+  outstanding.swaps.erase(swap);
+  delete swap;
+}
+
 
-  int code = zk->get(znode + "/" + entry.name(), false, &result, &stat);
+void ZooKeeperStateProcess::__swap(Swap* swap, const Future<int>& code)
+{
+  outstanding.swaps.erase(swap);
+
+  // Check the results of creating the parent znodes first (these
+  // completed before the znode itself was created).
+  foreach (const Future<int>& create, swap->creates) {
+    if (!create.isReady() || retry(create)) {
+      pending.swaps.push(swap); // Try again later.
+      return;
+    } else if (create.get() != ZOK && create.get() != ZNODEEXISTS) {
+      swap->promise.fail(
+          "Failed to create parent of '" + znode + "/" +
+          swap->entry.name() + "' in ZooKeeper: " +
+          zk->message(create.get()));
+      delete swap;
+      return;
+    }
+  }
 
-  if (code == ZNONODE) {
-    // Create directory path znodes as necessary.
-    CHECK(znode.size() == 0 || znode.at(znode.size() - 1) != '/');
-    size_t index = znode.find("/", 0);
+  if (retry(code)) {
+    pending.swaps.push(swap); // Try again later.
+    return;
+  }
 
-    while (index < string::npos) {
-      // Get out the prefix to create.
-      index = znode.find("/", index + 1);
-      string prefix = znode.substr(0, index);
+  parents = true; // The znode's parents must exist now.
+
+  if (code.get() == ZNODEEXISTS) {
+    swap->promise.set(false); // Lost a race with someone else.
+  } else if (code.get() != ZOK) {
+    swap->promise.fail(
+        "Failed to create '" + znode + "/" + swap->entry.name() +
+        "' in ZooKeeper: " + zk->message(code.get()));
+  } else if (!swap->chunks.empty()) {
+    versions[znode + "/" + swap->entry.name()] = 0;
+
+    // Now swap the placeholder (which is at its first version).
+    outstanding.swaps.insert(swap);
+    storeChunks(swap, 0);
+    return;
+  } else {
+    versions[znode + "/" + swap->entry.name()] = 0;
+    swap->promise.set(true);
+  }
 
-      // Create the znode (even if it already exists).
-      code = zk->create(prefix, "", acl, 0, NULL);
+  delete swap;
+}
 
-      if (code == ZINVALIDSTATE || (code != ZOK && zk->retryable(code))) {
-        CHECK(zk->getState() != ZOO_AUTH_FAILED_STATE);
-        return Result<bool>::none(); // Try again later.
-      } else if (code != ZOK && code != ZNODEEXISTS) {
-        return Result<bool>::error(
-            "Failed to create '" + prefix +
-            "' in ZooKeeper: " + zk->message(code));
-      }
+
+void ZooKeeperStateProcess::___swap(Swap* swap, const Future<int>& code)
+{
+  outstanding.swaps.erase(swap);
+
+  // Check the results of creating the chunk znodes first (if any).
+  // Note that a chunk can only fail to get created for reasons that
+  // also fail the subsequent set (e.g., a lost connection), so the
+  // header never refers to chunks that don't exist. A chunk might
+  // already exist if we're retrying.
+  foreach (const Future<int>& create, swap->creates) {
+    if (!create.isReady() || retry(create)) {
+      pending.swaps.push(swap); // Try again later.
+      return;
+    } else if (create.get() != ZOK && create.get() != ZNODEEXISTS) {
+      swap->promise.fail(
+          "Failed to create chunk of '" + znode + "/" +
+          swap->entry.name() + "' in ZooKeeper: " +
+          zk->message(create.get()));
+      delete swap;
+      return;
     }
+  }
 
-    code = zk->create(znode + "/" + entry.name(), data, acl, 0, NULL);
-
-    if (code == ZNODEEXISTS) {
-      return false; // Lost a race with someone else.
-    } else if (code == ZINVALIDSTATE || (code != ZOK && zk->retryable(code))) {
-      CHECK(zk->getState() != ZOO_AUTH_FAILED_STATE);
-      return Result<bool>::none(); // Try again later.
-    } else if (code != ZOK) {
-      return Result<bool>::error(
-          "Failed to create '" + znode + "/" + entry.name() +
-          "' in ZooKeeper: " + zk->message(code));
+  if (retry(code)) {
+    pending.swaps.push(swap); // Try again later.
+    return;
+  } else if (code.get() == ZBADVERSION) {
+    swap->promise.set(false);
+
+    // Remove the chunks that we created in vain (if any).
+    if (!swap->chunks.empty()) {
+      Entry entry = swap->entry;
+      entry.set_chunks(swap->chunks.size());
+      removeChunks(entry);
     }
+  } else if (code.get() != ZOK) {
+    swap->promise.fail(
+        "Failed to set '" + znode + "/" + swap->entry.name() +
+        "' in ZooKeeper: " + zk->message(code.get()));
+  } else {
+    // A successful set bumps the version we set at.
+    versions[znode + "/" + swap->entry.name()] = swap->version + 1;
+
+    swap->promise.set(true);
+
+    // Remove the chunks of the entry we replaced (if any).
+    if (swap->current.isSome()) {
+      removeChunks(swap->current.get());
+    }
+  }
 
-    return true;
-  } else if (code == ZINVALIDSTATE || (code != ZOK && zk->retryable(code))) {
-    CHECK(zk->getState() != ZOO_AUTH_FAILED_STATE);
-    return Result<bool>::none(); // Try again later.
-  } else if (code != ZOK) {
-    return Result<bool>::error(
-        "Failed to get '" + znode + "/" + entry.name() +
-        "' in ZooKeeper: " + zk->message(code));
+  delete swap;
+}
+
+
+void ZooKeeperStateProcess::storeChunks(Swap* swap, int version)
+{
+  const string path = znode + "/" + swap->entry.name();
+
+  swap->creates.clear();
+
+  // Like creating the parent znodes, we don't need to wait for the
+  // chunks to be created before setting the znode since ZooKeeper
+  // processes the operations in the order they were issued.
+  for (size_t i = 0; i < swap->chunks.size(); i++) {
+    swap->creates.push_back(
+        zk->acreate(
+            chunk(path, swap->entry, i), swap->chunks[i], acl, 0, NULL));
   }
 
-  google::protobuf::io::ArrayInputStream stream(result.data(), result.size());
+  swap->version = version;
+  zk->aset(path, swap->data, version)
+    .onAny(defer(self(), &Self::___swap, swap, lambda::_1));
+}
+
 
-  Entry current;
+void ZooKeeperStateProcess::removeChunks(const Entry& entry)
+{
+  const string path = znode + "/" + entry.name();
 
-  if (!current.ParseFromZeroCopyStream(&stream)) {
-    return Result<bool>::error("Failed to deserialize Entry");
+  // We don't wait for (or retry) the removals, a chunk that doesn't
+  // get removed just takes up space.
+  for (uint32_t i = 0; i < entry.chunks(); i++) {
+    zk->aremove(chunk(path, entry, i), -1);
   }
+}
+
+
+void ZooKeeperStateProcess::doWatch(const string& path, bool changed)
+{
+  CHECK(error.isNone()) << ": " << error.get();
+  CHECK(state == CONNECTED);
+
+  Stat* stat = new Stat();
+
+  // Note that 'exists' sets a watch even if the znode doesn't exist
+  // (yet), in which case we'll get a 'created' event.
+  zk->aexists(path, true, stat)
+    .onAny(defer(self(), &Self::_watch, path, changed, stat, lambda::_1));
+}
+
 
-  if (UUID::fromBytes(current.uuid()) != uuid) {
-    return false;
+void ZooKeeperStateProcess::_watch(
+    const string& path,
+    bool changed,
+    Stat* stat,
+    const Future<int>& code)
+{
+  Option<int> version;
+  if (code.isReady() && code.get() == ZOK) {
+    version = stat->version;
   }
 
-  // Okay, do a set, we get atomic swap by requiring 'stat.version'.
-  code = zk->set(znode + "/" + entry.name(), data, stat.version);
+  delete stat;
 
-  if (code == ZBADVERSION) {
-    return false;
-  } else if (code == ZINVALIDSTATE || (code != ZOK && zk->retryable(code))) {
+  if (retry(code)) {
+    // The watch gets set again once we've (re)connected, but we
+    // can't tell whether the change we were checking was our own.
+    if (changed) {
+      notify(path);
+    }
+  } else if (code.get() != ZOK && code.get() != ZNONODE) {
+    // We can't tell when the znode changes so we conservatively
+    // assume that it already has.
+    LOG(WARNING) << "Failed to watch '" << path << "' in ZooKeeper: "
+                 << zk->message(code.get());
+    notify(path);
+  } else if (changed) {
+    // ZooKeeper returns the results of our own writes before this
+    // 'exists', so if the znode is still at the version of our last
+    // write to it then the event was caused by that write (and the
+    // watch has been set again).
+    if (version.isNone() ||
+        !versions.contains(path) ||
+        versions[path] != version.get()) {
+      notify(path);
+    }
+  }
+}
+
+
+void ZooKeeperStateProcess::check(const string& path)
+{
+  if (!watches.contains(path)) {
+    return; // Not watching (any more).
+  }
+
+  // Check whether this was caused by one of our own swaps (in which
+  // case there is no need to tell anybody) before notifying.
+  if (state == CONNECTED) {
+    doWatch(path, true);
+  } else {
+    notify(path);
+  }
+}
+
+
+void ZooKeeperStateProcess::notify(const string& path)
+{
+  // NOTE: We might get events for znodes we're no longer watching
+  // (e.g., because the promise was already satisfied after a failed
+  // attempt to set the watch), which we just ignore.
+  if (watches.contains(path)) {
+    Promise<Nothing>* promise = watches[path];
+    watches.erase(path);
+    promise->set(Nothing());
+    delete promise;
+  }
+}
+
+
+bool ZooKeeperStateProcess::retry(const Future<int>& code)
+{
+  CHECK(code.isReady());
+
+  // NOTE: ZCLOSING means the ZooKeeper instance got deleted after
+  // our session expired (see ZooKeeperStateProcess::expired).
+  if (code.get() == ZINVALIDSTATE ||
+      code.get() == ZCLOSING ||
+      (code.get() != ZOK && zk->retryable(code.get()))) {
     CHECK(zk->getState() != ZOO_AUTH_FAILED_STATE);
-    return Result<bool>::none(); // Try again later.
-  } else if (code != ZOK) {
-    return Result<bool>::error(
-        "Failed to set '" + znode + "/" + entry.name() +
-        "' in ZooKeeper: " + zk->message(code));
+    return true;
   }
 
-  return true;
+  return false;
 }
 
 } // namespace state {
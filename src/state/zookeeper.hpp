@@ -2,6 +2,7 @@
 #define __STATE_ZOOKEEPER_HPP__
 
 #include <queue>
+#include <set>
 #include <string>
 #include <vector>
 
@@ -10,6 +11,8 @@
 #include <process/process.hpp>
 
 #include <stout/duration.hpp>
+#include <stout/hashmap.hpp>
+#include <stout/nothing.hpp>
 #include <stout/option.hpp>
 #include <stout/result.hpp>
 #include <stout/try.hpp>
@@ -52,6 +55,7 @@ protected:
   // More State implementation.
   virtual process::Future<Option<Entry> > fetch(const std::string& name);
   virtual process::Future<bool> swap(const Entry& entry, const UUID& uuid);
+  virtual process::Future<Nothing> watch(const std::string& name);
 
 private:
   ZooKeeperStateProcess* process;
@@ -74,6 +78,7 @@ public:
   process::Future<std::vector<std::string> > names();
   process::Future<Option<Entry> > fetch(const std::string& name);
   process::Future<bool> swap(const Entry& entry, const UUID& uuid);
+  process::Future<Nothing> watch(const std::string& name);
 
   // ZooKeeper events.
   void connected(bool reconnect);
@@ -84,31 +89,10 @@ public:
   void deleted(const std::string& path);
 
 private:
-  // Helpers for getting the names, fetching, and swapping.
-  Result<std::vector<std::string> > doNames();
-  Result<Option<Entry> > doFetch(const std::string& name);
-  Result<bool> doSwap(const Entry& entry, const UUID& uuid);
-
-  const std::string servers;
-  const Duration timeout;
-  const std::string znode;
-
-  Option<zookeeper::Authentication> auth; // ZooKeeper authentication.
-
-  const ACL_vector acl; // Default ACL to use.
-
-  Watcher* watcher;
-  ZooKeeper* zk;
-
-  enum State { // ZooKeeper connection state.
-    DISCONNECTED,
-    CONNECTING,
-    CONNECTED,
-  } state;
-
   struct Names
   {
     process::Promise<std::vector<std::string> > promise;
+    std::vector<std::string> results;
   };
 
   struct Fetch
@@ -117,17 +101,95 @@ private:
       : name(_name) {}
     std::string name;
     process::Promise<Option<Entry> > promise;
+    std::string result;
+    Stat stat;
+    Entry entry; // Header of a chunked entry.
+    std::vector<std::string> chunks;
+    std::vector<process::Future<int> > gets; // Chunk znodes.
   };
 
   struct Swap
   {
-    Swap(const Entry& _entry, const UUID& _uuid)
-      : entry(_entry), uuid(_uuid) {}
+    Swap(const Entry& _entry,
+         const UUID& _uuid,
+         const std::string& _data,
+         const std::vector<std::string>& _chunks)
+      : entry(_entry), uuid(_uuid), data(_data), chunks(_chunks),
+        version(-1) {}
     Entry entry;
     UUID uuid;
+    std::string data; // Serialized entry (or header if chunked).
+    std::vector<std::string> chunks; // Chunks of the entry's value.
     process::Promise<bool> promise;
+    std::string result;
+    Stat stat;
+    Option<Entry> current; // Entry being swapped (if it exists).
+    std::vector<process::Future<int> > creates; // Parent/chunk znodes.
+    int version; // Version the znode is being set at.
   };
 
+  // Helpers for getting the names, fetching, and swapping. Each of
+  // these issues asynchronous ZooKeeper operations (so that many can
+  // be outstanding at a time) which get continued (e.g., '_fetch')
+  // once ZooKeeper responds.
+  void doNames(Names* names);
+  void _names(Names* names, const process::Future<int>& code);
+
+  void doFetch(Fetch* fetch);
+  void _fetch(Fetch* fetch, const process::Future<int>& code);
+  void __fetch(Fetch* fetch, const process::Future<int>& code);
+
+  void doSwap(Swap* swap);
+  void _swap(Swap* swap, const process::Future<int>& code);
+  void __swap(Swap* swap, const process::Future<int>& code);
+  void ___swap(Swap* swap, const process::Future<int>& code);
+
+  // Creates the chunk znodes of a chunked entry and then sets the
+  // entry's znode (at the specified version) to the header.
+  void storeChunks(Swap* swap, int version);
+
+  // Removes the chunk znodes of the specified (chunked) entry.
+  void removeChunks(const Entry& entry);
+
+  // Helpers for setting a ZooKeeper watch on a znode and for
+  // satisfying the corresponding promise once the watch triggers
+  // because of a change that wasn't one of our own swaps. When
+  // 'changed' is true the watch is being set again after it
+  // triggered, which is when the version of the znode gets checked.
+  void doWatch(const std::string& path, bool changed);
+  void _watch(
+      const std::string& path,
+      bool changed,
+      Stat* stat,
+      const process::Future<int>& code);
+  void check(const std::string& path);
+  void notify(const std::string& path);
+
+  // Returns true if an operation that completed with the specified
+  // code should be retried (once we're connected).
+  bool retry(const process::Future<int>& code);
+
+  const std::string servers;
+  const Duration timeout;
+  const std::string znode;
+
+  Option<zookeeper::Authentication> auth; // ZooKeeper authentication.
+
+  const ACL_vector acl; // Default ACL to use.
+
+  Watcher* watcher;
+  ZooKeeper* zk;
+
+  enum State { // ZooKeeper connection state.
+    DISCONNECTED,
+    CONNECTING,
+    CONNECTED,
+  } state;
+
+  // Whether or not the parent znodes are known to exist.
+  bool parents;
+
+  // Operations waiting to be (re)issued once we're connected.
   // TODO(benh): Make pending a single queue of "operations" that can
   // be "invoked" (C++11 lambdas would help).
   struct {
@@ -136,6 +198,20 @@ private:
     std::queue<Swap*> swaps;
   } pending;
 
+  // Operations waiting for a response from ZooKeeper.
+  struct {
+    std::set<Names*> names;
+    std::set<Fetch*> fetches;
+    std::set<Swap*> swaps;
+  } outstanding;
+
+  // Promises for watched znodes, satisfied (and removed) once the
+  // znode might have changed.
+  hashmap<std::string, process::Promise<Nothing>*> watches;
+
+  // Version of each znode as of our last successful swap of it.
+  hashmap<std::string, int> versions;
+
   Option<std::string> error;
 };
 
@@ -184,6 +260,14 @@ process::Future<bool> ZooKeeperState<Serializer>::swap(
   return process::dispatch(process, &ZooKeeperStateProcess::swap, entry, uuid);
 }
 
+
+template <typename Serializer>
+process::Future<Nothing> ZooKeeperState<Serializer>::watch(
+    const std::string& name)
+{
+  return process::dispatch(process, &ZooKeeperStateProcess::watch, name);
+}
+
 } // namespace state {
 } // namespace internal {
 } // namespace mesos {
@@ -16,24 +16,56 @@
  * limitations under the License.
  */
 
+#include <unistd.h>
+
 #include <map>
+#include <string>
+#include <vector>
 
 #include <gtest/gtest.h>
 
+#include <process/dispatch.hpp>
+#include <process/future.hpp>
+#include <process/http.hpp>
+#include <process/process.hpp>
+
+#include <stout/duration.hpp>
 #include <stout/foreach.hpp>
+#include <stout/json.hpp>
+#include <stout/numify.hpp>
+#include <stout/option.hpp>
+#include <stout/os.hpp>
+#include <stout/strings.hpp>
 #include <stout/stringify.hpp>
 
+#include "common/resources.hpp"
+
+#include "files/files.hpp"
+
+#include "logging/flags.hpp"
+
+#include "linux/cgroups.hpp"
 #include "linux/proc.hpp"
 
 #include "slave/cgroups_isolation_module.hpp"
+#include "slave/flags.hpp"
+#include "slave/slave.hpp"
 
+#include "tests/assert.hpp"
 #include "tests/script.hpp"
+#include "tests/utils.hpp"
 
 using namespace mesos;
 using namespace mesos::internal;
 using namespace mesos::internal::slave;
+using namespace mesos::internal::tests;
+
+using process::Future;
+using process::PID;
 
 using std::map;
+using std::string;
+using std::vector;
 
 // Run the balloon framework under the cgroups isolation module.
 TEST_SCRIPT(CgroupsIsolationTest,
@@ -299,3 +331,153 @@ TEST(CgroupsCpusetTest, IntegerAllocations)
   ASSERT_EQ(stringify(cpuset2), "");
   ASSERT_EQ(stringify(cpuset3), "");
 }
+
+
+// Returns the cgroup of the (single) executor named 'executor', if it
+// has been created yet (the cgroup is named with a random tag).
+static Option<string> executorCgroup(const string& hierarchy)
+{
+  Try<vector<string> > cgroups = cgroups::get(hierarchy, "mesos");
+  if (cgroups.isSome()) {
+    foreach (const string& cgroup, cgroups.get()) {
+      if (strings::contains(cgroup, "executor_executor_")) {
+        return cgroup;
+      }
+    }
+  }
+  return Option<string>::none();
+}
+
+
+static Try<size_t> softLimitInBytes(
+    const string& hierarchy,
+    const string& cgroup)
+{
+  Try<string> read =
+    cgroups::read(hierarchy, cgroup, "memory.soft_limit_in_bytes");
+  if (read.isError()) {
+    return Try<size_t>::error(read.error());
+  }
+  return numify<size_t>(strings::trim(read.get()));
+}
+
+
+// Returns the "memory_pressure_events" field of the slave's
+// 'stats.json'.
+static Try<double> memoryPressureEvents(const PID<Slave>& slave)
+{
+  Future<process::http::Response> response =
+    process::http::get(slave, "stats.json");
+
+  if (!response.await(Seconds(5.0)) || !response.isReady()) {
+    return Try<double>::error("Failed to get 'stats.json'");
+  }
+
+  Try<JSON::Value> parse = JSON::parse(response.get().body);
+  if (parse.isError()) {
+    return Try<double>::error(parse.error());
+  }
+
+  JSON::Value stats = parse.get();
+  JSON::Object* object = boost::get<JSON::Object>(&stats);
+  if (object == NULL ||
+      object->values.count("memory_pressure_events") == 0) {
+    return Try<double>::error("Missing 'memory_pressure_events'");
+  }
+
+  JSON::Number* events =
+    boost::get<JSON::Number>(&object->values["memory_pressure_events"]);
+  if (events == NULL) {
+    return Try<double>::error("Expecting 'memory_pressure_events' number");
+  }
+
+  return events->value;
+}
+
+
+// Lowers the memory allocated to an executor below what it's using
+// and checks that the soft limit gets updated and that the slave
+// learns about the memory pressure.
+TEST(CgroupsIsolationTest, ROOT_CGROUPS_MemoryPressure)
+{
+  Try<string> directory = mkdtemp();
+  ASSERT_SOME(directory);
+
+  flags::Flags<logging::Flags, slave::Flags> flags;
+  flags.work_dir = directory.get();
+  flags.resources = Option<string>::some("cpus:1;mem:512");
+
+  CgroupsIsolationModule isolationModule;
+  Files files;
+
+  Slave slave(flags, true, &isolationModule, &files);
+  PID<Slave> pid = process::spawn(slave);
+
+  // The slave spawns the isolation module when it gets initialized,
+  // which has happened once it responds to a request.
+  Try<double> events = memoryPressureEvents(pid);
+  ASSERT_SOME(events);
+  EXPECT_EQ(0, events.get());
+
+  PID<IsolationModule> module(isolationModule);
+
+  FrameworkID frameworkId;
+  frameworkId.set_value("framework");
+
+  FrameworkInfo frameworkInfo;
+  frameworkInfo.set_name("framework");
+  frameworkInfo.set_user(os::user());
+
+  // The executor uses 128 MB of memory (buffered by 'tail' since
+  // '/dev/zero' has no newlines) after giving us time to lower its
+  // allocation.
+  ExecutorInfo executorInfo;
+  executorInfo.mutable_executor_id()->set_value("executor");
+  executorInfo.mutable_command()->set_value(
+      "sleep 1; (head -c 134217728 /dev/zero; sleep 1000) | tail");
+
+  process::dispatch(module,
+                    &IsolationModule::launchExecutor,
+                    frameworkId,
+                    frameworkInfo,
+                    executorInfo,
+                    directory.get(),
+                    Resources::parse("cpus:1;mem:256"));
+
+  process::dispatch(module,
+                    &IsolationModule::resourcesChanged,
+                    frameworkId,
+                    executorInfo.executor_id(),
+                    Resources::parse("cpus:1;mem:64"));
+
+  Option<string> cgroup;
+  WAIT_FOR((cgroup = executorCgroup(flags.cgroups_hierarchy_root)).isSome(),
+           Seconds(10.0));
+
+  // Wait for the executor's allocation to be lowered; the soft limit
+  // is only a fraction of the (hard) allocation.
+  size_t expected = (size_t) (64 * 1024 * 1024 *
+                              flags.cgroups_memory_soft_limit_fraction);
+  ASSERT_LT(expected, 64u * 1024 * 1024);
+
+  Try<size_t> limit = Try<size_t>::error("Not yet read");
+  WAIT_FOR((limit = softLimitInBytes(
+                flags.cgroups_hierarchy_root, cgroup.get())).isSome() &&
+           limit.get() == expected,
+           Seconds(10.0));
+
+  // Wait for the slave to count the executor crossing its soft limit.
+  WAIT_FOR((events = memoryPressureEvents(pid)).isSome() &&
+           events.get() > 0,
+           Seconds(10.0));
+
+  process::dispatch(module,
+                    &IsolationModule::killExecutor,
+                    frameworkId,
+                    executorInfo.executor_id());
+
+  process::terminate(pid);
+  process::wait(pid);
+
+  os::rmdir(directory.get());
+}
@@ -37,6 +37,7 @@
 #include <stout/option.hpp>
 #include <stout/os.hpp>
 #include <stout/path.hpp>
+#include <stout/stopwatch.hpp>
 #include <stout/stringify.hpp>
 #include <stout/strings.hpp>
 
@@ -706,3 +707,117 @@ TEST_F(CgroupsAnyHierarchyWithCpuMemoryFreezerTest, ROOT_CGROUPS_Destroy)
     abort();
   }
 }
+
+
+// Creates 'count' cgroups nested in 'cgroup', each with a busy
+// process in it.
+static void nest(const std::string& hierarchy,
+                 const std::string& cgroup,
+                 int count)
+{
+  int pipes[2];
+  int dummy;
+  ASSERT_NE(-1, ::pipe(pipes));
+
+  for (int i = 0; i < count; i++) {
+    const std::string nested = path::join(cgroup, stringify(i));
+    ASSERT_SOME(cgroups::create(hierarchy, nested));
+
+    pid_t pid = ::fork();
+    ASSERT_NE(-1, pid);
+
+    if (pid == 0) {
+      // In child process.
+      Try<Nothing> assign = cgroups::assign(hierarchy, nested, ::getpid());
+      if (assign.isError()) {
+        std::cerr << "Failed to assign cgroup: " << assign.error() << std::endl;
+        abort();
+      }
+
+      // Notify the parent.
+      ::close(pipes[0]);
+      if (::write(pipes[1], &dummy, sizeof(dummy)) != sizeof(dummy)) {
+        perror("Failed to notify the parent");
+        abort();
+      }
+      ::close(pipes[1]);
+
+      // Wait kill signal from parent.
+      while (true) ;
+
+      // Should not reach here.
+      std::cerr << "Reach an unreachable statement!" << std::endl;
+      abort();
+    }
+  }
+
+  // In parent process.
+  ::close(pipes[1]);
+
+  // Wait until all children have assigned their cgroups.
+  for (int i = 0; i < count; i++) {
+    ASSERT_LT(0, ::read(pipes[0], &dummy, sizeof(dummy)));
+  }
+  ::close(pipes[0]);
+}
+
+
+// Reaps 'count' children that should have been killed.
+static void reap(int count)
+{
+  for (int i = 0; i < count; i++) {
+    int status;
+    EXPECT_NE(-1, ::waitpid((pid_t) -1, &status, 0));
+    ASSERT_TRUE(WIFSIGNALED(status));
+    EXPECT_EQ(SIGKILL, WTERMSIG(status));
+  }
+}
+
+
+// Tests destroying a cgroup that has a number of nested cgroups, each
+// with a busy process in it. The nested cgroups are killed
+// concurrently, so this should finish well within the timeout.
+TEST_F(CgroupsAnyHierarchyWithCpuMemoryFreezerTest, ROOT_CGROUPS_DestroyNested)
+{
+  const int CGROUPS = 16;
+
+  nest(hierarchy, "mesos_test", CGROUPS);
+
+  Future<bool> future = cgroups::destroy(hierarchy, "mesos_test");
+  future.await(Seconds(5.0));
+  ASSERT_TRUE(future.isReady());
+  EXPECT_TRUE(future.get());
+
+  reap(CGROUPS);
+}
+
+
+// Measures how long it takes to destroy a cgroup with an increasing
+// number of nested cgroups (each with a busy process in it). Since
+// the nested cgroups are killed concurrently the latency should stay
+// roughly the same. The latencies get recorded (in milliseconds) as
+// the properties 'destroy_<count>_ms'.
+TEST_F(CgroupsAnyHierarchyWithCpuMemoryFreezerTest,
+       ROOT_CGROUPS_BENCHMARK_DestroyLatency)
+{
+  const std::string cgroup = path::join("mesos_test", "benchmark");
+
+  for (int count = 1; count <= 64; count *= 4) {
+    ASSERT_SOME(cgroups::create(hierarchy, cgroup));
+
+    nest(hierarchy, cgroup, count);
+
+    Stopwatch stopwatch;
+    stopwatch.start();
+
+    Future<bool> future = cgroups::destroy(hierarchy, cgroup);
+    future.await(Seconds(5.0));
+    ASSERT_TRUE(future.isReady());
+    EXPECT_TRUE(future.get());
+
+    RecordProperty(("destroy_" + stringify(count) + "_ms").c_str(),
+                   (int) stopwatch.elapsed().ms());
+
+    reap(count);
+  }
+}
@@ -29,6 +29,7 @@
 
 #include "tests/environment.hpp"
 #include "tests/filter.hpp"
+#include "tests/utils.hpp"
 
 namespace mesos {
 namespace internal {
@@ -49,12 +50,14 @@ public:
 };
 
 // Returns true if we should enable a test case or test with the given
-// name. For now, this ONLY disables test cases and tests in two
+// name. For now, this ONLY disables test cases and tests in three
 // circumstances:
 //   (1) The test case or test contains the string 'ROOT' but the test
 //       is being run via a non-root user.
 //   (2) The test case or test contains the string 'CGROUPS' but
 //       cgroups are not supported on this machine.
+//   (3) The test case or test contains the string 'BENCHMARK' but
+//       benchmarks were not asked for (see --benchmark).
 // TODO(benh): Provide a generic way to enable/disable tests by
 // registering "filter" functions (also, make these functions take
 // ::testing::TestCase and ::testing::TestInfo instead of just a
@@ -69,6 +72,10 @@ static bool enable(const std::string& name)
     return false;
   }
 
+  if (strings::contains(name, "BENCHMARK") && !flags.benchmark) {
+    return false;
+  }
+
   return true;
 }
 
@@ -32,4 +32,5 @@ TEST_SCRIPT(ExamplesTest, JavaException, "java_exception_test.sh")
 
 #ifdef MESOS_HAS_PYTHON
 TEST_SCRIPT(ExamplesTest, PythonFramework, "python_framework_test.sh")
+TEST_SCRIPT(ExamplesTest, PythonProtobufs, "python_protobufs_test.sh")
 #endif
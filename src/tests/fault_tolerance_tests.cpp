@@ -18,6 +18,7 @@
 
 #include <gmock/gmock.h>
 
+#include <list>
 #include <map>
 #include <string>
 #include <vector>
@@ -25,17 +26,23 @@
 #include <mesos/executor.hpp>
 #include <mesos/scheduler.hpp>
 
+#include <stout/os.hpp>
+
 #include "detector/detector.hpp"
 
 #include "local/local.hpp"
 
+#include "logging/flags.hpp"
+
 #include "master/allocator.hpp"
 #include "master/hierarchical_allocator_process.hpp"
 #include "master/master.hpp"
 
+#include "slave/flags.hpp"
 #include "slave/process_based_isolation_module.hpp"
 #include "slave/slave.hpp"
 
+#include "tests/assert.hpp"
 #include "tests/filter.hpp"
 #include "tests/utils.hpp"
 
@@ -54,6 +61,7 @@ using mesos::internal::slave::STATUS_UPDATE_RETRY_INTERVAL;
 using process::Clock;
 using process::PID;
 
+using std::list;
 using std::string;
 using std::map;
 using std::vector;
@@ -959,3 +967,550 @@ TEST(FaultToleranceTest, SlaveReregister)
   process::terminate(master);
   process::wait(master);
 }
+
+
+TEST(FaultToleranceTest, StatusUpdateBatch)
+{
+  ASSERT_TRUE(GTEST_IS_THREADSAFE);
+
+  HierarchicalDRFAllocatorProcess allocator;
+  Allocator a(&allocator);
+  Files files;
+  Master m(&a, &files);
+  PID<Master> master = process::spawn(&m);
+
+  MockExecutor exec;
+
+  trigger shutdownCall;
+
+  EXPECT_CALL(exec, registered(_, _, _, _))
+    .Times(1);
+
+  // Both updates get sent while handling the same message.
+  EXPECT_CALL(exec, launchTask(_, _))
+    .WillOnce(DoAll(SendStatusUpdateFromTask(TASK_RUNNING),
+                    SendStatusUpdateFromTask(TASK_FINISHED)));
+
+  EXPECT_CALL(exec, shutdown(_))
+    .WillOnce(Trigger(&shutdownCall));
+
+  map<ExecutorID, Executor*> execs;
+  execs[DEFAULT_EXECUTOR_ID] = &exec;
+
+  TestingIsolationModule isolationModule(execs);
+
+  Resources resources = Resources::parse("cpus:2;mem:1024");
+
+  Slave s(resources, true, &isolationModule, &files);
+  PID<Slave> slave = process::spawn(&s);
+
+  // The slave forwards both updates in a single message.
+  trigger statusUpdatesMsg;
+
+  EXPECT_MESSAGE(Eq(StatusUpdatesMessage().GetTypeName()),
+                 Eq(slave),
+                 Eq(master))
+    .WillOnce(DoAll(Trigger(&statusUpdatesMsg),
+                    Return(false)));
+
+  EXPECT_MESSAGE(Eq(StatusUpdateMessage().GetTypeName()),
+                 Eq(slave),
+                 Eq(master))
+    .Times(0);
+
+  BasicMasterDetector detector(master, slave, true);
+
+  MockScheduler sched;
+  MesosSchedulerDriver driver(&sched, DEFAULT_FRAMEWORK_INFO, master);
+
+  vector<Offer> offers;
+  TaskStatus status1, status2;
+
+  trigger resourceOffersCall, statusUpdateCall;
+
+  EXPECT_CALL(sched, registered(&driver, _, _))
+    .Times(1);
+
+  EXPECT_CALL(sched, resourceOffers(&driver, _))
+    .WillOnce(DoAll(SaveArg<1>(&offers),
+                    Trigger(&resourceOffersCall)))
+    .WillRepeatedly(Return());
+
+  EXPECT_CALL(sched, statusUpdate(&driver, _))
+    .WillOnce(SaveArg<1>(&status1))
+    .WillOnce(DoAll(SaveArg<1>(&status2),
+                    Trigger(&statusUpdateCall)));
+
+  driver.start();
+
+  WAIT_UNTIL(resourceOffersCall);
+
+  EXPECT_NE(0u, offers.size());
+
+  TaskInfo task;
+  task.set_name("");
+  task.mutable_task_id()->set_value("1");
+  task.mutable_slave_id()->MergeFrom(offers[0].slave_id());
+  task.mutable_resources()->MergeFrom(offers[0].resources());
+  task.mutable_executor()->MergeFrom(DEFAULT_EXECUTOR_INFO);
+
+  vector<TaskInfo> tasks;
+  tasks.push_back(task);
+
+  driver.launchTasks(offers[0].id(), tasks);
+
+  WAIT_UNTIL(statusUpdatesMsg);
+
+  WAIT_UNTIL(statusUpdateCall);
+
+  EXPECT_EQ(TASK_RUNNING, status1.state());
+  EXPECT_EQ(TASK_FINISHED, status2.state());
+
+  driver.stop();
+  driver.join();
+
+  WAIT_UNTIL(shutdownCall); // Ensures MockExecutor can be deallocated.
+
+  process::terminate(slave);
+  process::wait(slave);
+
+  process::terminate(master);
+  process::wait(master);
+}
+
+
+TEST(FaultToleranceTest, StatusUpdateRetryWindow)
+{
+  ASSERT_TRUE(GTEST_IS_THREADSAFE);
+
+  Clock::pause();
+
+  HierarchicalDRFAllocatorProcess allocator;
+  Allocator a(&allocator);
+  Files files;
+  Master m(&a, &files);
+  PID<Master> master = process::spawn(&m);
+
+  MockExecutor exec;
+
+  trigger shutdownCall;
+
+  EXPECT_CALL(exec, registered(_, _, _, _))
+    .Times(1);
+
+  EXPECT_CALL(exec, launchTask(_, _))
+    .WillOnce(SendStatusUpdateFromTask(TASK_RUNNING));
+
+  EXPECT_CALL(exec, killTask(_, _))
+    .WillOnce(SendStatusUpdateFromTaskID(TASK_KILLED));
+
+  EXPECT_CALL(exec, shutdown(_))
+    .WillOnce(Trigger(&shutdownCall));
+
+  map<ExecutorID, Executor*> execs;
+  execs[DEFAULT_EXECUTOR_ID] = &exec;
+
+  TestingIsolationModule isolationModule(execs);
+
+  Resources resources = Resources::parse("cpus:2;mem:1024");
+
+  Slave s(resources, true, &isolationModule, &files);
+  PID<Slave> slave = process::spawn(&s);
+
+  // Drop the acknowledgements so that the updates stay pending.
+  EXPECT_MESSAGE(Eq(StatusUpdateAcknowledgementMessage().GetTypeName()), _, _)
+    .WillRepeatedly(Return(true));
+
+  EXPECT_MESSAGE(Eq(StatusUpdateAcknowledgementsMessage().GetTypeName()),
+                 _,
+                 _)
+    .WillRepeatedly(Return(true));
+
+  // Count the updates the slave (re)sends, each of which should go
+  // out on its own.
+  int updates = 0;
+
+  EXPECT_MESSAGE(Eq(StatusUpdateMessage().GetTypeName()),
+                 Eq(slave),
+                 Eq(master))
+    .WillRepeatedly(DoAll(Increment(&updates),
+                          Return(false)));
+
+  EXPECT_MESSAGE(Eq(StatusUpdatesMessage().GetTypeName()),
+                 Eq(slave),
+                 Eq(master))
+    .Times(0);
+
+  BasicMasterDetector detector(master, slave, true);
+
+  MockScheduler sched;
+  MesosSchedulerDriver driver(&sched, DEFAULT_FRAMEWORK_INFO, master);
+
+  vector<Offer> offers;
+
+  trigger resourceOffersCall;
+
+  EXPECT_CALL(sched, registered(&driver, _, _))
+    .Times(1);
+
+  EXPECT_CALL(sched, resourceOffers(&driver, _))
+    .WillOnce(DoAll(SaveArg<1>(&offers),
+                    Trigger(&resourceOffersCall)))
+    .WillRepeatedly(Return());
+
+  EXPECT_CALL(sched, statusUpdate(&driver, _))
+    .WillRepeatedly(Return());
+
+  driver.start();
+
+  WAIT_UNTIL(resourceOffersCall);
+
+  EXPECT_NE(0u, offers.size());
+
+  TaskInfo task;
+  task.set_name("");
+  task.mutable_task_id()->set_value("1");
+  task.mutable_slave_id()->MergeFrom(offers[0].slave_id());
+  task.mutable_resources()->MergeFrom(offers[0].resources());
+  task.mutable_executor()->MergeFrom(DEFAULT_EXECUTOR_INFO);
+
+  vector<TaskInfo> tasks;
+  tasks.push_back(task);
+
+  driver.launchTasks(offers[0].id(), tasks);
+
+  WAIT_UNTIL(updates == 1);
+
+  // Send the second update halfway through the retry interval of
+  // the first one.
+  Clock::advance(STATUS_UPDATE_RETRY_INTERVAL.secs() / 2);
+
+  driver.killTask(task.task_id());
+
+  WAIT_UNTIL(updates == 2);
+
+  // Only the first update is due to be resent.
+  Clock::advance(STATUS_UPDATE_RETRY_INTERVAL.secs() / 2);
+
+  WAIT_UNTIL(updates == 3);
+
+  Clock::settle();
+
+  EXPECT_EQ(3, updates);
+
+  // And then only the second one.
+  Clock::advance(STATUS_UPDATE_RETRY_INTERVAL.secs() / 2);
+
+  WAIT_UNTIL(updates == 4);
+
+  Clock::settle();
+
+  EXPECT_EQ(4, updates);
+
+  driver.stop();
+  driver.join();
+
+  WAIT_UNTIL(shutdownCall); // Ensures MockExecutor can be deallocated.
+
+  process::terminate(slave);
+  process::wait(slave);
+
+  process::terminate(master);
+  process::wait(master);
+
+  Clock::resume();
+}
+
+
+// Sets 'checkpointed' to whether or not some status updates have
+// been checkpointed under 'directory'.
+ACTION_P2(CheckCheckpointed, directory, checkpointed)
+{
+  *checkpointed = false;
+
+  Try<list<string> > paths = os::find(directory, "updates");
+  if (paths.isSome()) {
+    foreach (const string& path, paths.get()) {
+      Result<string> read = os::read(path);
+      if (read.isSome() && !read.get().empty()) {
+        *checkpointed = true;
+      }
+    }
+  }
+}
+
+
+TEST(FaultToleranceTest, StatusUpdateCheckpointedBeforeForwarding)
+{
+  ASSERT_TRUE(GTEST_IS_THREADSAFE);
+
+  Try<string> directory = mkdtemp();
+  ASSERT_SOME(directory);
+
+  HierarchicalDRFAllocatorProcess allocator;
+  Allocator a(&allocator);
+  Files files;
+  Master m(&a, &files);
+  PID<Master> master = process::spawn(&m);
+
+  MockExecutor exec;
+
+  trigger shutdownCall;
+
+  EXPECT_CALL(exec, registered(_, _, _, _))
+    .Times(1);
+
+  EXPECT_CALL(exec, launchTask(_, _))
+    .WillOnce(SendStatusUpdateFromTask(TASK_RUNNING));
+
+  EXPECT_CALL(exec, shutdown(_))
+    .WillOnce(Trigger(&shutdownCall));
+
+  map<ExecutorID, Executor*> execs;
+  execs[DEFAULT_EXECUTOR_ID] = &exec;
+
+  TestingIsolationModule isolationModule(execs);
+
+  flags::Flags<logging::Flags, slave::Flags> flags;
+  flags.work_dir = directory.get();
+  flags.checkpoint = true;
+  flags.resources = Option<string>::some("cpus:2;mem:1024");
+
+  Slave s(flags, true, &isolationModule, &files);
+  PID<Slave> slave = process::spawn(&s);
+
+  // Check for the checkpointed update when the slave forwards it.
+  bool checkpointed = false;
+  trigger statusUpdateMsg;
+
+  EXPECT_MESSAGE(Eq(StatusUpdateMessage().GetTypeName()),
+                 Eq(slave),
+                 Eq(master))
+    .WillOnce(DoAll(CheckCheckpointed(directory.get(), &checkpointed),
+                    Trigger(&statusUpdateMsg),
+                    Return(false)));
+
+  BasicMasterDetector detector(master, slave, true);
+
+  MockScheduler sched;
+  MesosSchedulerDriver driver(&sched, DEFAULT_FRAMEWORK_INFO, master);
+
+  vector<Offer> offers;
+
+  trigger resourceOffersCall, statusUpdateCall;
+
+  EXPECT_CALL(sched, registered(&driver, _, _))
+    .Times(1);
+
+  EXPECT_CALL(sched, resourceOffers(&driver, _))
+    .WillOnce(DoAll(SaveArg<1>(&offers),
+                    Trigger(&resourceOffersCall)))
+    .WillRepeatedly(Return());
+
+  EXPECT_CALL(sched, statusUpdate(&driver, _))
+    .WillOnce(Trigger(&statusUpdateCall));
+
+  driver.start();
+
+  WAIT_UNTIL(resourceOffersCall);
+
+  EXPECT_NE(0u, offers.size());
+
+  TaskInfo task;
+  task.set_name("");
+  task.mutable_task_id()->set_value("1");
+  task.mutable_slave_id()->MergeFrom(offers[0].slave_id());
+  task.mutable_resources()->MergeFrom(offers[0].resources());
+  task.mutable_executor()->MergeFrom(DEFAULT_EXECUTOR_INFO);
+
+  vector<TaskInfo> tasks;
+  tasks.push_back(task);
+
+  driver.launchTasks(offers[0].id(), tasks);
+
+  WAIT_UNTIL(statusUpdateMsg);
+
+  EXPECT_TRUE(checkpointed);
+
+  WAIT_UNTIL(statusUpdateCall);
+
+  driver.stop();
+  driver.join();
+
+  WAIT_UNTIL(shutdownCall); // Ensures MockExecutor can be deallocated.
+
+  process::terminate(slave);
+  process::wait(slave);
+
+  process::terminate(master);
+  process::wait(master);
+
+  os::rmdir(directory.get());
+}
+
+
+// Restarts a checkpointing slave while its executor is still running
+// and checks that the new slave reattaches to the executor and
+// resends the status update that was never acknowledged.
+TEST(FaultToleranceTest, SlaveRecoveryReattachExecutor)
+{
+  ASSERT_TRUE(GTEST_IS_THREADSAFE);
+
+  Try<string> directory = mkdtemp();
+  ASSERT_SOME(directory);
+
+  HierarchicalDRFAllocatorProcess allocator;
+  Allocator a(&allocator);
+  Files files;
+  Master m(&a, &files);
+  PID<Master> master = process::spawn(&m);
+
+  MockExecutor exec;
+
+  ExecutorDriver* execDriver;
+  trigger shutdownCall;
+
+  EXPECT_CALL(exec, registered(_, _, _, _))
+    .Times(1);
+
+  EXPECT_CALL(exec, launchTask(_, _))
+    .WillOnce(DoAll(SaveArg<0>(&execDriver),
+                    SendStatusUpdateFromTask(TASK_RUNNING)));
+
+  EXPECT_CALL(exec, shutdown(_))
+    .WillOnce(Trigger(&shutdownCall));
+
+  map<ExecutorID, Executor*> execs;
+  execs[DEFAULT_EXECUTOR_ID] = &exec;
+
+  TestingIsolationModule isolationModule1(execs);
+
+  flags::Flags<logging::Flags, slave::Flags> flags;
+  flags.work_dir = directory.get();
+  flags.checkpoint = true;
+  flags.resources = Option<string>::some("cpus:2;mem:1024");
+
+  // Drop the acknowledgements so that the update stays pending.
+  EXPECT_MESSAGE(Eq(StatusUpdateAcknowledgementMessage().GetTypeName()), _, _)
+    .WillRepeatedly(Return(true));
+
+  EXPECT_MESSAGE(Eq(StatusUpdateAcknowledgementsMessage().GetTypeName()),
+                 _,
+                 _)
+    .WillRepeatedly(Return(true));
+
+  Slave s1(flags, true, &isolationModule1, &files);
+  PID<Slave> slave1 = process::spawn(&s1);
+
+  BasicMasterDetector detector1(master, slave1, true);
+
+  MockScheduler sched;
+  MesosSchedulerDriver driver(&sched, DEFAULT_FRAMEWORK_INFO, master);
+
+  vector<Offer> offers;
+
+  trigger resourceOffersCall, statusUpdateCall;
+
+  EXPECT_CALL(sched, registered(&driver, _, _))
+    .Times(1);
+
+  EXPECT_CALL(sched, resourceOffers(&driver, _))
+    .WillOnce(DoAll(SaveArg<1>(&offers),
+                    Trigger(&resourceOffersCall)))
+    .WillRepeatedly(Return());
+
+  // The master also reports the task as lost once the first slave
+  // exits, and gets the resent update afterwards.
+  EXPECT_CALL(sched, statusUpdate(&driver, _))
+    .WillOnce(Trigger(&statusUpdateCall))
+    .WillRepeatedly(Return());
+
+  EXPECT_CALL(sched, slaveLost(&driver, _))
+    .Times(AtMost(1));
+
+  driver.start();
+
+  WAIT_UNTIL(resourceOffersCall);
+
+  EXPECT_NE(0u, offers.size());
+
+  TaskInfo task;
+  task.set_name("");
+  task.mutable_task_id()->set_value("1");
+  task.mutable_slave_id()->MergeFrom(offers[0].slave_id());
+  task.mutable_resources()->MergeFrom(offers[0].resources());
+  task.mutable_executor()->MergeFrom(DEFAULT_EXECUTOR_INFO);
+
+  vector<TaskInfo> tasks;
+  tasks.push_back(task);
+
+  driver.launchTasks(offers[0].id(), tasks);
+
+  // The update gets checkpointed before it's forwarded.
+  WAIT_UNTIL(statusUpdateCall);
+
+  // "Restart" the slave, which leaves the executor running.
+  process::terminate(slave1);
+  process::wait(slave1);
+
+  Clock::pause();
+
+  TestingIsolationModule isolationModule2(execs);
+
+  Slave s2(flags, true, &isolationModule2, &files);
+
+  trigger reregisterExecutorMsg;
+
+  EXPECT_MESSAGE(Eq(ReregisterExecutorMessage().GetTypeName()),
+                 _,
+                 Eq(s2.self()))
+    .WillOnce(DoAll(Trigger(&reregisterExecutorMsg),
+                    Return(false)));
+
+  int updates = 0;
+
+  EXPECT_MESSAGE(Eq(StatusUpdateMessage().GetTypeName()),
+                 Eq(s2.self()),
+                 Eq(master))
+    .WillRepeatedly(DoAll(Increment(&updates),
+                          Return(false)));
+
+  PID<Slave> slave2 = process::spawn(&s2);
+
+  BasicMasterDetector detector2(master, slave2, true);
+
+  WAIT_UNTIL(reregisterExecutorMsg);
+
+  // Nothing gets resent until the retry timer of the recovered
+  // update fires.
+  Clock::settle();
+  EXPECT_EQ(0, updates);
+
+  Clock::advance(STATUS_UPDATE_RETRY_INTERVAL.secs());
+
+  WAIT_UNTIL(updates == 1);
+
+  // The executor now talks to the new slave.
+  TaskStatus status;
+  status.mutable_task_id()->MergeFrom(task.task_id());
+  status.set_state(TASK_FINISHED);
+
+  execDriver->sendStatusUpdate(status);
+
+  WAIT_UNTIL(updates == 2);
+
+  Clock::resume();
+
+  driver.stop();
+  driver.join();
+
+  WAIT_UNTIL(shutdownCall); // Ensures MockExecutor can be deallocated.
+
+  process::terminate(slave2);
+  process::wait(slave2);
+
+  process::terminate(master);
+  process::wait(master);
+
+  os::rmdir(directory.get());
+}
@@ -60,9 +60,18 @@ public:
         "build_dir",
         "Where to find the build directory",
         path.get());
+
+    // Benchmarks (tests whose names contain 'BENCHMARK') take a while
+    // and only report measurements, so they don't run by default.
+    add(&Flags::benchmark,
+        "benchmark",
+        "Run the benchmarks, which record their measurements as\n"
+        "test properties (see --gtest_output=xml)",
+        false);
   }
 
   bool verbose;
+  bool benchmark;
   std::string source_dir;
   std::string build_dir;
 };
@@ -27,6 +27,8 @@
 
 #include <stout/duration.hpp>
 #include <stout/os.hpp>
+#include <stout/path.hpp>
+#include <stout/stringify.hpp>
 
 #include "common/resources.hpp"
 
@@ -42,6 +44,7 @@
 
 #include "slave/constants.hpp"
 #include "slave/flags.hpp"
+#include "slave/gc.hpp"
 #include "slave/slave.hpp"
 
 #include "tests/assert.hpp"
@@ -56,6 +59,7 @@ using mesos::internal::master::Allocator;
 using mesos::internal::master::HierarchicalDRFAllocatorProcess;
 using mesos::internal::master::Master;
 
+using mesos::internal::slave::GarbageCollector;
 using mesos::internal::slave::Slave;
 
 using process::Clock;
@@ -444,3 +448,70 @@ TEST_F(GarbageCollectorTest, DiskUsage)
   driver.stop();
   driver.join();
 }
+
+
+TEST(GarbageCollectorRemovalTest, ThrottledRemoval)
+{
+  Try<string> directory = os::mkdtemp();
+  ASSERT_SOME(directory);
+
+  const string& trash = path::join(directory.get(), "trash");
+  const string& sandbox = path::join(directory.get(), "sandbox");
+
+  // Create a directory tree with 10 directories of 10 files each.
+  for (int i = 0; i < 10; i++) {
+    const string& subdirectory = path::join(sandbox, stringify(i));
+    ASSERT_SOME(os::mkdir(subdirectory));
+
+    for (int j = 0; j < 10; j++) {
+      ASSERT_SOME(os::touch(path::join(subdirectory, stringify(j))));
+    }
+  }
+
+  Future<Nothing> removal;
+
+  {
+    Clock::pause();
+
+    // Throttled to 100 operations per second for 2 workers together,
+    // removing the 111 inodes above takes a bit over a second even
+    // though only one of the workers is busy.
+    GarbageCollector gc(trash, 2, 100);
+
+    removal = gc.schedule(Seconds(0), sandbox);
+
+    Clock::settle();
+
+    Clock::advance(1.0);
+    Clock::settle();
+
+    EXPECT_TRUE(removal.isPending());
+
+    // If the operations were split across the workers instead the
+    // removal would take more than 2 seconds.
+    Clock::advance(0.5);
+
+    ASSERT_FUTURE_WILL_SUCCEED(removal);
+
+    // The sandbox got moved into the trash first.
+    EXPECT_FALSE(os::exists(sandbox));
+    EXPECT_TRUE(os::ls(trash).empty());
+
+    Future<GarbageCollector::Statistics> statistics = gc.statistics();
+    ASSERT_TRUE(statistics.await(Seconds(5.0)));
+    ASSERT_TRUE(statistics.isReady());
+
+    EXPECT_EQ(1u, statistics.get().paths);
+    EXPECT_EQ(111u, statistics.get().inodes);
+
+    Clock::resume();
+  }
+
+  // Removing a path that does not exist should fail.
+  {
+    GarbageCollector gc(trash, 1, Option<uint32_t>::none());
+    EXPECT_FUTURE_WILL_FAIL(gc.schedule(Seconds(0), sandbox));
+  }
+
+  ASSERT_SOME(os::rmdir(directory.get()));
+}
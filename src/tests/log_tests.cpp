@@ -20,6 +20,7 @@
 
 #include <set>
 #include <string>
+#include <vector>
 
 #include <process/clock.hpp>
 #include <process/future.hpp>
@@ -29,6 +30,8 @@
 
 #include <stout/option.hpp>
 #include <stout/os.hpp>
+#include <stout/stopwatch.hpp>
+#include <stout/stringify.hpp>
 
 #include "common/type_utils.hpp"
 
@@ -52,6 +55,7 @@ using process::Timeout;
 using process::UPID;
 
 using testing::_;
+using testing::Between;
 using testing::Eq;
 using testing::Return;
 
@@ -267,6 +271,65 @@ TEST(ReplicaTest, Recover)
 }
 
 
+// Concurrent writes are persisted together but must each be durable
+// by the time they get acknowledged.
+TEST(ReplicaTest, GroupCommit)
+{
+  const std::string path = os::getcwd() + "/.log";
+
+  os::rmdir(path);
+
+  const uint64_t id = 1;
+
+  {
+    Replica replica(path);
+
+    PromiseRequest request;
+    request.set_id(id);
+
+    Future<PromiseResponse> future = protocol::promise(replica.pid(), request);
+
+    ASSERT_TRUE(future.await(Seconds(2.0)));
+    ASSERT_TRUE(future.isReady());
+    ASSERT_TRUE(future.get().okay());
+
+    std::list<Future<WriteResponse> > futures;
+
+    for (uint64_t position = 1; position <= 100; position++) {
+      WriteRequest request;
+      request.set_id(id);
+      request.set_position(position);
+      request.set_type(Action::APPEND);
+      request.mutable_append()->set_bytes(stringify(position));
+
+      futures.push_back(protocol::write(replica.pid(), request));
+    }
+
+    uint64_t position = 1;
+    foreach (const Future<WriteResponse>& future, futures) {
+      ASSERT_TRUE(future.await(Seconds(5.0)));
+      ASSERT_TRUE(future.isReady());
+      EXPECT_TRUE(future.get().okay());
+      EXPECT_EQ(position++, future.get().position());
+    }
+  }
+
+  Replica replica(path);
+
+  Future<std::list<Action> > actions = replica.read(1, 100);
+  ASSERT_TRUE(actions.await(Seconds(2.0)));
+  ASSERT_TRUE(actions.isReady());
+  ASSERT_EQ(100u, actions.get().size());
+
+  foreach (const Action& action, actions.get()) {
+    EXPECT_EQ(Action::APPEND, action.type());
+    EXPECT_EQ(stringify(action.position()), action.append().bytes());
+  }
+
+  os::rmdir(path);
+}
+
+
 TEST(CoordinatorTest, Elect)
 {
   const std::string path1 = os::getcwd() + "/.log1";
@@ -812,6 +875,327 @@ TEST(CoordinatorTest, MultipleAppends)
 }
 
 
+TEST(CoordinatorTest, PipelinedAppends)
+{
+  const std::string path1 = os::getcwd() + "/.log1";
+  const std::string path2 = os::getcwd() + "/.log2";
+
+  os::rmdir(path1);
+  os::rmdir(path2);
+
+  Replica replica1(path1);
+  Replica replica2(path2);
+
+  Network network;
+
+  network.add(replica1.pid());
+  network.add(replica2.pid());
+
+  Coordinator coord(2, &replica1, &network);
+
+  {
+    Result<uint64_t> result = coord.elect(Timeout(Seconds(2.0)));
+    ASSERT_SOME(result);
+    EXPECT_EQ(0u, result.get());
+  }
+
+  std::vector<std::string> entries;
+  for (uint64_t position = 1; position <= 100; position++) {
+    entries.push_back(stringify(position));
+  }
+
+  {
+    // 13 batches of (at most) 8 entries, 4 batches at a time.
+    Result<uint64_t> result =
+      coord.append(entries, 4, 8, Timeout(Seconds(10.0)));
+    ASSERT_SOME(result);
+    EXPECT_EQ(100u, result.get());
+  }
+
+  {
+    // Appends continue after the batched entries.
+    Result<uint64_t> result =
+      coord.append("101", Timeout(Seconds(2.0)));
+    ASSERT_SOME(result);
+    EXPECT_EQ(101u, result.get());
+  }
+
+  {
+    Future<std::list<Action> > actions = replica1.read(1, 101);
+    ASSERT_TRUE(actions.await(Seconds(2.0)));
+    ASSERT_TRUE(actions.isReady());
+    EXPECT_EQ(101u, actions.get().size());
+    foreach (const Action& action, actions.get()) {
+      ASSERT_TRUE(action.has_type());
+      ASSERT_EQ(Action::APPEND, action.type());
+      EXPECT_TRUE(action.learned());
+      EXPECT_EQ(stringify(action.position()), action.append().bytes());
+    }
+  }
+
+  os::rmdir(path1);
+  os::rmdir(path2);
+}
+
+
+// Appends with different window sizes, without and with batching,
+// and checks that the entries end up at consecutive positions.
+TEST(CoordinatorTest, AppendWindowedBatches)
+{
+  const std::string path1 = os::getcwd() + "/.log1";
+  const std::string path2 = os::getcwd() + "/.log2";
+  const std::string path3 = os::getcwd() + "/.log3";
+
+  os::rmdir(path1);
+  os::rmdir(path2);
+  os::rmdir(path3);
+
+  Replica replica1(path1);
+  Replica replica2(path2);
+  Replica replica3(path3);
+
+  Network network;
+
+  network.add(replica1.pid());
+  network.add(replica2.pid());
+  network.add(replica3.pid());
+
+  Coordinator coord(2, &replica1, &network);
+
+  Result<uint64_t> position = coord.elect(Timeout(Seconds(2.0)));
+  ASSERT_SOME(position);
+
+  const std::vector<std::string> entries(200, std::string(1024, 'x'));
+
+  size_t batches[] = { 1, 16 };
+  size_t windows[] = { 1, 2, 4, 8, 16 };
+
+  foreach (size_t batch, batches) {
+    foreach (size_t window, windows) {
+      Result<uint64_t> result =
+        coord.append(entries, window, batch, Timeout(Seconds(60.0)));
+
+      ASSERT_SOME(result);
+      EXPECT_EQ(position.get() + entries.size(), result.get());
+
+      position = result;
+    }
+  }
+
+  os::rmdir(path1);
+  os::rmdir(path2);
+  os::rmdir(path3);
+}
+
+
+// Measures the append throughput (with replicas in the same process)
+// for different window sizes, without and with batching. The
+// throughputs get recorded (in appends per second) as the properties
+// 'appends_batch_<batch>_window_<window>'.
+TEST(CoordinatorTest, BENCHMARK_AppendThroughput)
+{
+  const std::string path1 = os::getcwd() + "/.log1";
+  const std::string path2 = os::getcwd() + "/.log2";
+  const std::string path3 = os::getcwd() + "/.log3";
+
+  os::rmdir(path1);
+  os::rmdir(path2);
+  os::rmdir(path3);
+
+  Replica replica1(path1);
+  Replica replica2(path2);
+  Replica replica3(path3);
+
+  Network network;
+
+  network.add(replica1.pid());
+  network.add(replica2.pid());
+  network.add(replica3.pid());
+
+  Coordinator coord(2, &replica1, &network);
+
+  ASSERT_SOME(coord.elect(Timeout(Seconds(2.0))));
+
+  const std::vector<std::string> entries(1000, std::string(1024, 'x'));
+
+  size_t batches[] = { 1, 16 };
+  size_t windows[] = { 1, 2, 4, 8, 16 };
+
+  foreach (size_t batch, batches) {
+    foreach (size_t window, windows) {
+      Stopwatch stopwatch;
+      stopwatch.start();
+
+      ASSERT_SOME(coord.append(entries, window, batch, Timeout(Seconds(60.0))));
+
+      RecordProperty(("appends_batch_" + stringify(batch) +
+                      "_window_" + stringify(window)).c_str(),
+                     (int) (entries.size() / stopwatch.elapsed().secs()));
+    }
+  }
+
+  os::rmdir(path1);
+  os::rmdir(path2);
+  os::rmdir(path3);
+}
+
+
+// Checks that a coordinator whose local replica is missing thousands
+// of (learned) positions gets elected by catching up from the other
+// replicas.
+TEST(CoordinatorTest, CatchupElect)
+{
+  const std::string path1 = os::getcwd() + "/.log1";
+  const std::string path2 = os::getcwd() + "/.log2";
+  const std::string path3 = os::getcwd() + "/.log3";
+
+  os::rmdir(path1);
+  os::rmdir(path2);
+  os::rmdir(path3);
+
+  Replica replica1(path1);
+  Replica replica2(path2);
+
+  Network network1;
+
+  network1.add(replica1.pid());
+  network1.add(replica2.pid());
+
+  const std::vector<std::string> entries(5000, std::string(128, 'x'));
+
+  uint64_t position;
+
+  {
+    Coordinator coord(2, &replica1, &network1);
+
+    ASSERT_SOME(coord.elect(Timeout(Seconds(2.0))));
+
+    Result<uint64_t> result =
+      coord.append(entries, 4, 64, Timeout(Seconds(60.0)));
+
+    ASSERT_SOME(result);
+
+    position = result.get();
+  }
+
+  // A brand new replica that is missing all of the positions.
+  Replica replica3(path3);
+
+  Network network2;
+
+  network2.add(replica2.pid());
+  network2.add(replica3.pid());
+
+  Coordinator coord(2, &replica3, &network2);
+
+  // The missing positions should get learned from replica2 in ranges
+  // (of at most 1024 positions) rather than one at a time, and none
+  // of them should need to be filled (i.e., written).
+  EXPECT_MESSAGE(Eq(LearnRequest().GetTypeName()), _, Eq(replica2.pid()))
+    .Times(Between(1, (int) ((position + 1 + 1023) / 1024)))
+    .WillRepeatedly(Return(false));
+
+  EXPECT_MESSAGE(Eq(WriteRequest().GetTypeName()), _, _)
+    .Times(0);
+
+  // The first election attempt loses to the promise that replica2
+  // made to the first coordinator (but gets a higher id to retry).
+  Result<uint64_t> result = Result<uint64_t>::none();
+  for (int retries = 0; retries < 3 && result.isNone(); retries++) {
+    result = coord.elect(Timeout(Seconds(60.0)));
+  }
+
+  ASSERT_SOME(result);
+  EXPECT_EQ(position, result.get());
+
+  Future<std::list<Action> > actions = replica3.read(1, position);
+  ASSERT_TRUE(actions.await(Seconds(10.0)));
+  ASSERT_TRUE(actions.isReady());
+  ASSERT_EQ(position, actions.get().size());
+
+  foreach (const Action& action, actions.get()) {
+    ASSERT_TRUE(action.has_learned() && action.learned());
+    ASSERT_EQ(Action::APPEND, action.type());
+  }
+
+  os::rmdir(path1);
+  os::rmdir(path2);
+  os::rmdir(path3);
+}
+
+
+// Measures how long it takes a coordinator to get elected when its
+// local replica is missing an increasing number of (learned)
+// positions, i.e., has to catch up from the other replicas. The
+// election times get recorded (in milliseconds) as the properties
+// 'elect_<missing>_ms'.
+TEST(CoordinatorTest, BENCHMARK_CatchupElect)
+{
+  const std::string path1 = os::getcwd() + "/.log1";
+  const std::string path2 = os::getcwd() + "/.log2";
+  const std::string path3 = os::getcwd() + "/.log3";
+
+  for (size_t count = 1000; count <= 100000; count *= 10) {
+    os::rmdir(path1);
+    os::rmdir(path2);
+    os::rmdir(path3);
+
+    Replica replica1(path1);
+    Replica replica2(path2);
+
+    Network network1;
+
+    network1.add(replica1.pid());
+    network1.add(replica2.pid());
+
+    const std::vector<std::string> entries(count, std::string(128, 'x'));
+
+    uint64_t position;
+
+    {
+      Coordinator coord(2, &replica1, &network1);
+
+      ASSERT_SOME(coord.elect(Timeout(Seconds(2.0))));
+
+      Result<uint64_t> result =
+        coord.append(entries, 4, 64, Timeout(Seconds(600.0)));
+
+      ASSERT_SOME(result);
+
+      position = result.get();
+    }
+
+    Replica replica3(path3);
+
+    Network network2;
+
+    network2.add(replica2.pid());
+    network2.add(replica3.pid());
+
+    Coordinator coord(2, &replica3, &network2);
+
+    Stopwatch stopwatch;
+    stopwatch.start();
+
+    // See CatchupElect above regarding the retries.
+    Result<uint64_t> result = Result<uint64_t>::none();
+    for (int retries = 0; retries < 3 && result.isNone(); retries++) {
+      result = coord.elect(Timeout(Seconds(600.0)));
+    }
+
+    ASSERT_SOME(result);
+    EXPECT_EQ(position, result.get());
+
+    RecordProperty(("elect_" + stringify(position + 1) + "_ms").c_str(),
+                   (int) stopwatch.elapsed().ms());
+  }
+
+  os::rmdir(path1);
+  os::rmdir(path2);
+  os::rmdir(path3);
+}
+
+
 TEST(CoordinatorTest, MultipleAppendsNotLearnedFill)
 {
   EXPECT_MESSAGE(Eq(LearnedMessage().GetTypeName()), _, _)
@@ -1146,6 +1530,154 @@ TEST(LogTest, WriteRead)
 }
 
 
+// Reads spanning multiple chunks (see Log::Reader::read) return
+// every entry in order.
+TEST(LogTest, ReadRange)
+{
+  const std::string path1 = os::getcwd() + "/.log1";
+  const std::string path2 = os::getcwd() + "/.log2";
+
+  os::rmdir(path1);
+  os::rmdir(path2);
+
+  Replica replica1(path1);
+
+  std::set<UPID> pids;
+  pids.insert(replica1.pid());
+
+  Log log(2, path2, pids);
+
+  Log::Writer writer(&log, Seconds(2.0));
+
+  std::vector<std::string> data;
+  for (int i = 0; i < 3000; i++) {
+    data.push_back(stringify(i));
+  }
+
+  Result<Log::Position> end =
+    writer.append(data, 4, 128, Timeout(Seconds(30.0)));
+
+  ASSERT_SOME(end);
+
+  Log::Reader reader(&log);
+
+  Result<std::list<Log::Entry> > entries =
+    reader.read(reader.beginning(), end.get(), Timeout(Seconds(10.0)));
+
+  ASSERT_SOME(entries);
+  ASSERT_EQ(data.size(), entries.get().size());
+
+  int i = 0;
+  foreach (const Log::Entry& entry, entries.get()) {
+    EXPECT_EQ(stringify(i++), entry.data);
+  }
+
+  EXPECT_EQ(end.get(), entries.get().back().position);
+
+  os::rmdir(path1);
+  os::rmdir(path2);
+}
+
+
+// A snapshot replaces the positions it covers: the log can be
+// restored from the snapshot plus the tail, after a restart, and from
+// a replica that has fallen behind the truncation (which fetches the
+// snapshot from another replica).
+TEST(LogTest, Snapshot)
+{
+  const std::string path1 = os::getcwd() + "/.log1";
+  const std::string path2 = os::getcwd() + "/.log2";
+  const std::string path3 = os::getcwd() + "/.log3";
+
+  os::rmdir(path1);
+  os::rmdir(path2);
+  os::rmdir(path3);
+
+  Replica replica1(path1);
+
+  std::set<UPID> pids;
+  pids.insert(replica1.pid());
+
+  Option<Log::Position> position;
+
+  {
+    Log log(2, path2, pids);
+
+    Log::Writer writer(&log, Seconds(2.0));
+
+    std::vector<Log::Position> positions;
+    for (int i = 0; i < 10; i++) {
+      Result<Log::Position> result =
+        writer.append(stringify(i), Timeout(Seconds(2.0)));
+      ASSERT_SOME(result);
+      positions.push_back(result.get());
+    }
+
+    Log::Reader reader(&log);
+
+    Result<Log::Snapshot> snapshot = reader.snapshot(Timeout(Seconds(2.0)));
+    ASSERT_SOME(snapshot);
+    EXPECT_EQ(reader.beginning(), snapshot.get().position);
+    EXPECT_EQ("", snapshot.get().data);
+
+    // Snapshot the first 5 entries.
+    position = positions[5];
+
+    ASSERT_SOME(
+        writer.snapshot(position.get(), "0 1 2 3 4", Timeout(Seconds(2.0))));
+
+    EXPECT_EQ(position.get(), reader.beginning());
+
+    snapshot = reader.snapshot(Timeout(Seconds(2.0)));
+    ASSERT_SOME(snapshot);
+    EXPECT_EQ(position.get(), snapshot.get().position);
+    EXPECT_EQ("0 1 2 3 4", snapshot.get().data);
+
+    Result<std::list<Log::Entry> > entries =
+      reader.read(position.get(), positions[9], Timeout(Seconds(2.0)));
+
+    ASSERT_SOME(entries);
+    ASSERT_EQ(5u, entries.get().size());
+    EXPECT_EQ("5", entries.get().front().data);
+  }
+
+  {
+    // Recover the snapshot (and the tail) after a restart.
+    Log log(2, path2, pids);
+
+    Log::Reader reader(&log);
+
+    EXPECT_EQ(position.get(), reader.beginning());
+
+    Result<Log::Snapshot> snapshot = reader.snapshot(Timeout(Seconds(2.0)));
+    ASSERT_SOME(snapshot);
+    EXPECT_EQ(position.get(), snapshot.get().position);
+    EXPECT_EQ("0 1 2 3 4", snapshot.get().data);
+  }
+
+  {
+    // A brand new replica catches up past the truncation and then
+    // gets the snapshot from the other replica.
+    Log log(2, path3, pids);
+
+    Log::Writer writer(&log, Seconds(2.0));
+
+    Log::Reader reader(&log);
+
+    EXPECT_EQ(position.get(), reader.beginning());
+
+    Result<Log::Snapshot> snapshot = reader.snapshot(Timeout(Seconds(2.0)));
+    ASSERT_SOME(snapshot);
+    EXPECT_EQ(position.get(), snapshot.get().position);
+    EXPECT_EQ("0 1 2 3 4", snapshot.get().data);
+  }
+
+  os::rmdir(path1);
+  os::rmdir(path2);
+  os::rmdir(path3);
+}
+
+
 TEST(LogTest, Position)
 {
   const std::string path1 = os::getcwd() + "/.log1";
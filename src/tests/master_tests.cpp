@@ -22,6 +22,7 @@
 #include <mesos/executor.hpp>
 #include <mesos/scheduler.hpp>
 
+#include <stout/json.hpp>
 #include <stout/os.hpp>
 
 #include "detector/detector.hpp"
@@ -40,6 +41,7 @@
 
 #include <process/dispatch.hpp>
 #include <process/future.hpp>
+#include <process/http.hpp>
 
 #include "slave/slave.hpp"
 
@@ -57,10 +59,12 @@ using mesos::internal::master::HierarchicalDRFAllocatorProcess;
 using mesos::internal::master::Master;
 
 using mesos::internal::slave::Slave;
+using mesos::internal::slave::STATUS_UPDATE_RETRY_INTERVAL;
 
 using process::Clock;
 using process::Future;
 using process::PID;
+using process::UPID;
 
 using std::string;
 using std::map;
@@ -70,6 +74,7 @@ using testing::_;
 using testing::AtMost;
 using testing::DoAll;
 using testing::Eq;
+using testing::Expectation;
 using testing::Return;
 using testing::SaveArg;
 
@@ -170,7 +175,7 @@ TEST(MasterTest, TaskRunning)
 }
 
 
-TEST(MasterTest, ShutdownFrameworkWhileTaskRunning)
+TEST(MasterTest, BatchLaunchTasks)
 {
   ASSERT_TRUE(GTEST_IS_THREADSAFE);
 
@@ -198,10 +203,9 @@ TEST(MasterTest, ShutdownFrameworkWhileTaskRunning)
 
   TestingIsolationModule isolationModule(execs);
 
-  flags::Flags<logging::Flags, slave::Flags> flags;
-  flags.executor_shutdown_grace_period = Seconds(0.0);
-  flags.resources = Option<string>::some("cpus:2;mem:1024");
-  Slave s(flags, true, &isolationModule, &files);
+  Resources resources = Resources::parse("cpus:2;mem:1024");
+
+  Slave s(resources, true, &isolationModule, &files);
   PID<Slave> slave = process::spawn(&s);
 
   BasicMasterDetector detector(master, slave, true);
@@ -210,9 +214,9 @@ TEST(MasterTest, ShutdownFrameworkWhileTaskRunning)
   MesosSchedulerDriver driver(&sched, DEFAULT_FRAMEWORK_INFO, master);
 
   vector<Offer> offers;
-  TaskStatus status;
+  TaskStatus status1, status2;
 
-  trigger resourceOffersCall, statusUpdateCall, resourcesChangedCall;
+  trigger resourceOffersCall, statusUpdateCall;
 
   EXPECT_CALL(sched, registered(&driver, _, _))
     .Times(1);
@@ -223,7 +227,9 @@ TEST(MasterTest, ShutdownFrameworkWhileTaskRunning)
     .WillRepeatedly(Return());
 
   EXPECT_CALL(sched, statusUpdate(&driver, _))
-    .WillOnce(DoAll(SaveArg<1>(&status), Trigger(&statusUpdateCall)));
+    .WillOnce(SaveArg<1>(&status1))
+    .WillOnce(DoAll(SaveArg<1>(&status2),
+                    Trigger(&statusUpdateCall)));
 
   driver.start();
 
@@ -231,27 +237,39 @@ TEST(MasterTest, ShutdownFrameworkWhileTaskRunning)
 
   EXPECT_NE(0u, offers.size());
 
-  TaskInfo task;
-  task.set_name("");
-  task.mutable_task_id()->set_value("1");
-  task.mutable_slave_id()->MergeFrom(offers[0].slave_id());
-  task.mutable_resources()->MergeFrom(offers[0].resources());
-  task.mutable_executor()->MergeFrom(DEFAULT_EXECUTOR_INFO);
+  TaskInfo task1;
+  task1.set_name("");
+  task1.mutable_task_id()->set_value("1");
+  task1.mutable_slave_id()->MergeFrom(offers[0].slave_id());
+  task1.mutable_resources()->MergeFrom(offers[0].resources());
+  task1.mutable_executor()->MergeFrom(DEFAULT_EXECUTOR_INFO);
+
+  // A task for a slave that isn't in any of the offers.
+  TaskInfo task2;
+  task2.set_name("");
+  task2.mutable_task_id()->set_value("2");
+  task2.mutable_slave_id()->set_value("bogus");
+  task2.mutable_resources()->MergeFrom(offers[0].resources());
+  task2.mutable_executor()->MergeFrom(DEFAULT_EXECUTOR_INFO);
 
   vector<TaskInfo> tasks;
-  tasks.push_back(task);
+  tasks.push_back(task1);
+  tasks.push_back(task2);
 
-  EXPECT_CALL(isolationModule,
-              resourcesChanged(_, _, Resources(offers[0].resources())))
-    .WillOnce(Trigger(&resourcesChangedCall));
+  vector<OfferID> offerIds;
+  foreach (const Offer& offer, offers) {
+    offerIds.push_back(offer.id());
+  }
 
-  driver.launchTasks(offers[0].id(), tasks);
+  driver.launchTasks(offerIds, tasks);
 
   WAIT_UNTIL(statusUpdateCall);
 
-  EXPECT_EQ(TASK_RUNNING, status.state());
+  EXPECT_EQ("2", status1.task_id().value());
+  EXPECT_EQ(TASK_LOST, status1.state());
 
-  WAIT_UNTIL(resourcesChangedCall);
+  EXPECT_EQ("1", status2.task_id().value());
+  EXPECT_EQ(TASK_RUNNING, status2.state());
 
   driver.stop();
   driver.join();
@@ -266,7 +284,10 @@ TEST(MasterTest, ShutdownFrameworkWhileTaskRunning)
 }
 
 
-TEST(MasterTest, KillTask)
+// Launches a couple of tasks using the same executor, which get
+// sent to the executor (and their status updates sent back to the
+// slave) in batches.
+TEST(MasterTest, MultipleTasksSameExecutor)
 {
   ASSERT_TRUE(GTEST_IS_THREADSAFE);
 
@@ -278,16 +299,14 @@ TEST(MasterTest, KillTask)
 
   MockExecutor exec;
 
-  trigger killTaskCall, shutdownCall;
+  trigger shutdownCall;
 
   EXPECT_CALL(exec, registered(_, _, _, _))
     .Times(1);
 
   EXPECT_CALL(exec, launchTask(_, _))
-    .WillOnce(SendStatusUpdateFromTask(TASK_RUNNING));
-
-  EXPECT_CALL(exec, killTask(_, _))
-    .WillOnce(Trigger(&killTaskCall));
+    .Times(2)
+    .WillRepeatedly(SendStatusUpdateFromTask(TASK_RUNNING));
 
   EXPECT_CALL(exec, shutdown(_))
     .WillOnce(Trigger(&shutdownCall));
@@ -308,7 +327,7 @@ TEST(MasterTest, KillTask)
   MesosSchedulerDriver driver(&sched, DEFAULT_FRAMEWORK_INFO, master);
 
   vector<Offer> offers;
-  TaskStatus status;
+  TaskStatus status1, status2;
 
   trigger resourceOffersCall, statusUpdateCall;
 
@@ -321,42 +340,44 @@ TEST(MasterTest, KillTask)
     .WillRepeatedly(Return());
 
   EXPECT_CALL(sched, statusUpdate(&driver, _))
-    .WillOnce(DoAll(SaveArg<1>(&status),
+    .WillOnce(SaveArg<1>(&status1))
+    .WillOnce(DoAll(SaveArg<1>(&status2),
                     Trigger(&statusUpdateCall)));
 
+  EXPECT_CALL(isolationModule, resourcesChanged(_, _, _))
+    .WillRepeatedly(Return());
+
   driver.start();
 
   WAIT_UNTIL(resourceOffersCall);
 
   EXPECT_NE(0u, offers.size());
 
-  TaskID taskId;
-  taskId.set_value("1");
-
-  TaskInfo task;
-  task.set_name("");
-  task.mutable_task_id()->MergeFrom(taskId);
-  task.mutable_slave_id()->MergeFrom(offers[0].slave_id());
-  task.mutable_resources()->MergeFrom(offers[0].resources());
-  task.mutable_executor()->MergeFrom(DEFAULT_EXECUTOR_INFO);
-
   vector<TaskInfo> tasks;
-  tasks.push_back(task);
+
+  for (int i = 1; i <= 2; i++) {
+    TaskInfo task;
+    task.set_name("");
+    task.mutable_task_id()->set_value(stringify(i));
+    task.mutable_slave_id()->MergeFrom(offers[0].slave_id());
+    task.mutable_resources()->MergeFrom(
+        Resources::parse("cpus:1;mem:512"));
+    task.mutable_executor()->MergeFrom(DEFAULT_EXECUTOR_INFO);
+    tasks.push_back(task);
+  }
 
   driver.launchTasks(offers[0].id(), tasks);
 
   WAIT_UNTIL(statusUpdateCall);
 
-  EXPECT_EQ(TASK_RUNNING, status.state());
-
-  driver.killTask(taskId);
-
-  WAIT_UNTIL(killTaskCall);
+  EXPECT_EQ(TASK_RUNNING, status1.state());
+  EXPECT_EQ(TASK_RUNNING, status2.state());
+  EXPECT_NE(status1.task_id().value(), status2.task_id().value());
 
   driver.stop();
   driver.join();
 
-  WAIT_UNTIL(shutdownCall); // To ensure can deallocate MockExecutor.
+  WAIT_UNTIL(shutdownCall); // Ensures MockExecutor can be deallocated.
 
   process::terminate(slave);
   process::wait(slave);
@@ -366,7 +387,7 @@ TEST(MasterTest, KillTask)
 }
 
 
-TEST(MasterTest, StatusUpdateAck)
+TEST(MasterTest, BatchLaunchTasksInvalidOffer)
 {
   ASSERT_TRUE(GTEST_IS_THREADSAFE);
 
@@ -378,11 +399,6 @@ TEST(MasterTest, StatusUpdateAck)
 
   MockExecutor exec;
 
-  trigger statusUpdateAckMsg;
-  EXPECT_MESSAGE(Eq(StatusUpdateAcknowledgementMessage().GetTypeName()), _, _)
-    .WillOnce(DoAll(Trigger(&statusUpdateAckMsg),
-                    Return(false)));
-
   trigger shutdownCall;
 
   EXPECT_CALL(exec, registered(_, _, _, _))
@@ -409,13 +425,14 @@ TEST(MasterTest, StatusUpdateAck)
   MockScheduler sched;
   MesosSchedulerDriver driver(&sched, DEFAULT_FRAMEWORK_INFO, master);
 
+  FrameworkID frameworkId;
   vector<Offer> offers;
-  TaskStatus status;
+  TaskStatus status1, status2, status3;
 
   trigger resourceOffersCall, statusUpdateCall;
 
   EXPECT_CALL(sched, registered(&driver, _, _))
-    .Times(1);
+    .WillOnce(SaveArg<1>(&frameworkId));
 
   EXPECT_CALL(sched, resourceOffers(&driver, _))
     .WillOnce(DoAll(SaveArg<1>(&offers),
@@ -423,7 +440,9 @@ TEST(MasterTest, StatusUpdateAck)
     .WillRepeatedly(Return());
 
   EXPECT_CALL(sched, statusUpdate(&driver, _))
-    .WillOnce(DoAll(SaveArg<1>(&status),
+    .WillOnce(SaveArg<1>(&status1))
+    .WillOnce(SaveArg<1>(&status2))
+    .WillOnce(DoAll(SaveArg<1>(&status3),
                     Trigger(&statusUpdateCall)));
 
   driver.start();
@@ -432,24 +451,45 @@ TEST(MasterTest, StatusUpdateAck)
 
   EXPECT_NE(0u, offers.size());
 
+  // Launch with an offer that doesn't exist, then with a valid one,
+  // and then with the (by then used) valid one again. Only the tasks
+  // of the invalid launches should get lost.
+  BatchLaunchTasksMessage message;
+  message.mutable_framework_id()->MergeFrom(frameworkId);
+
   TaskInfo task;
   task.set_name("");
-  task.mutable_task_id()->set_value("1");
   task.mutable_slave_id()->MergeFrom(offers[0].slave_id());
-  task.mutable_resources()->MergeFrom(offers[0].resources());
+  task.mutable_resources()->MergeFrom(Resources::parse("cpus:1;mem:512"));
   task.mutable_executor()->MergeFrom(DEFAULT_EXECUTOR_INFO);
 
-  vector<TaskInfo> tasks;
-  tasks.push_back(task);
+  BatchLaunchTasksMessage::Launch* launch = message.add_launches();
+  launch->mutable_offer_id()->set_value("bogus");
+  task.mutable_task_id()->set_value("1");
+  launch->add_tasks()->MergeFrom(task);
 
-  driver.launchTasks(offers[0].id(), tasks);
+  launch = message.add_launches();
+  launch->mutable_offer_id()->MergeFrom(offers[0].id());
+  task.mutable_task_id()->set_value("2");
+  launch->add_tasks()->MergeFrom(task);
+
+  launch = message.add_launches();
+  launch->mutable_offer_id()->MergeFrom(offers[0].id());
+  task.mutable_task_id()->set_value("3");
+  launch->add_tasks()->MergeFrom(task);
+
+  process::post(master, message);
 
   WAIT_UNTIL(statusUpdateCall);
 
-  EXPECT_EQ(TASK_RUNNING, status.state());
+  EXPECT_EQ("1", status1.task_id().value());
+  EXPECT_EQ(TASK_LOST, status1.state());
 
-  // Ensure we get a status update ACK.
-  WAIT_UNTIL(statusUpdateAckMsg);
+  EXPECT_EQ("3", status2.task_id().value());
+  EXPECT_EQ(TASK_LOST, status2.state());
+
+  EXPECT_EQ("2", status3.task_id().value());
+  EXPECT_EQ(TASK_RUNNING, status3.state());
 
   driver.stop();
   driver.join();
@@ -464,7 +504,10 @@ TEST(MasterTest, StatusUpdateAck)
 }
 
 
-TEST(MasterTest, RecoverResources)
+// Launches a task on a running executor and kills it right away,
+// which must not let the kill overtake the task on its way to the
+// executor.
+TEST(MasterTest, LaunchAndKillTaskSameExecutor)
 {
   ASSERT_TRUE(GTEST_IS_THREADSAFE);
 
@@ -476,34 +519,43 @@ TEST(MasterTest, RecoverResources)
 
   MockExecutor exec;
 
+  trigger shutdownCall;
+
+  EXPECT_CALL(exec, registered(_, _, _, _))
+    .Times(1);
+
+  // The first task gets to run, the second one gets killed.
+  Expectation launchTaskCalls = EXPECT_CALL(exec, launchTask(_, _))
+    .WillOnce(SendStatusUpdateFromTask(TASK_RUNNING))
+    .WillOnce(Return());
+
+  EXPECT_CALL(exec, killTask(_, _))
+    .After(launchTaskCalls)
+    .WillOnce(SendStatusUpdateFromTaskID(TASK_KILLED));
+
+  EXPECT_CALL(exec, shutdown(_))
+    .WillOnce(Trigger(&shutdownCall));
+
   map<ExecutorID, Executor*> execs;
   execs[DEFAULT_EXECUTOR_ID] = &exec;
 
   TestingIsolationModule isolationModule(execs);
 
-  Resources slaveResources = Resources::parse(
-      "cpus:2;mem:1024;ports:[1-10, 20-30]");
+  Resources resources = Resources::parse("cpus:2;mem:1024");
 
-  Slave s(slaveResources, true, &isolationModule, &files);
+  Slave s(resources, true, &isolationModule, &files);
   PID<Slave> slave = process::spawn(&s);
 
   BasicMasterDetector detector(master, slave, true);
 
-  ExecutorInfo executorInfo;
-  executorInfo.MergeFrom(DEFAULT_EXECUTOR_INFO);
-
-  Resources executorResources = Resources::parse(
-      "cpus:0.3;mem:200;ports:[5-8, 23-25]");
-  executorInfo.mutable_resources()->MergeFrom(executorResources);
-
   MockScheduler sched;
   MesosSchedulerDriver driver(&sched, DEFAULT_FRAMEWORK_INFO, master);
 
-  vector<Offer> offers1, offers2, offers3;
-  TaskStatus status;
+  vector<Offer> offers1, offers2;
+  TaskStatus status1, status2;
 
-  trigger resourceOffersCall1, resourceOffersCall2, resourceOffersCall3;
-  trigger statusUpdateCall;
+  trigger resourceOffersCall1, resourceOffersCall2;
+  trigger statusUpdateCall1, statusUpdateCall2;
 
   EXPECT_CALL(sched, registered(&driver, _, _))
     .Times(1);
@@ -513,13 +565,16 @@ TEST(MasterTest, RecoverResources)
                     Trigger(&resourceOffersCall1)))
     .WillOnce(DoAll(SaveArg<1>(&offers2),
                     Trigger(&resourceOffersCall2)))
-    .WillOnce(DoAll(SaveArg<1>(&offers3),
-                    Trigger(&resourceOffersCall3)))
     .WillRepeatedly(Return());
 
   EXPECT_CALL(sched, statusUpdate(&driver, _))
-    .WillRepeatedly(DoAll(SaveArg<1>(&status),
-			                    Trigger(&statusUpdateCall)));
+    .WillOnce(DoAll(SaveArg<1>(&status1),
+                    Trigger(&statusUpdateCall1)))
+    .WillOnce(DoAll(SaveArg<1>(&status2),
+                    Trigger(&statusUpdateCall2)));
+
+  EXPECT_CALL(isolationModule, resourcesChanged(_, _, _))
+    .WillRepeatedly(Return());
 
   driver.start();
 
@@ -527,77 +582,50 @@ TEST(MasterTest, RecoverResources)
 
   EXPECT_NE(0u, offers1.size());
 
-  TaskID taskId;
-  taskId.set_value("1");
-
-  Resources taskResources = offers1[0].resources() - executorResources;
-
-  TaskInfo task;
-  task.set_name("");
-  task.mutable_task_id()->MergeFrom(taskId);
-  task.mutable_slave_id()->MergeFrom(offers1[0].slave_id());
-  task.mutable_resources()->MergeFrom(taskResources);
-  task.mutable_executor()->MergeFrom(executorInfo);
+  TaskInfo task1;
+  task1.set_name("");
+  task1.mutable_task_id()->set_value("1");
+  task1.mutable_slave_id()->MergeFrom(offers1[0].slave_id());
+  task1.mutable_resources()->MergeFrom(Resources::parse("cpus:1;mem:512"));
+  task1.mutable_executor()->MergeFrom(DEFAULT_EXECUTOR_INFO);
 
   vector<TaskInfo> tasks;
-  tasks.push_back(task);
-
-  EXPECT_CALL(exec, registered(_, _, _, _))
-    .Times(1);
-
-  EXPECT_CALL(exec, launchTask(_, _))
-    .WillOnce(SendStatusUpdateFromTask(TASK_RUNNING));
-
-  driver.launchTasks(offers1[0].id(), tasks);
-
-  WAIT_UNTIL(statusUpdateCall);
+  tasks.push_back(task1);
 
-  EXPECT_EQ(TASK_RUNNING, status.state());
+  // Get the rest of the resources offered again right away.
+  Filters filters;
+  filters.set_refuse_seconds(0);
 
-  trigger killTaskCall;
-  EXPECT_CALL(exec, killTask(_, _))
-    .WillOnce(DoAll(Trigger(&killTaskCall),
-                    SendStatusUpdateFromTaskID(TASK_KILLED)));
+  driver.launchTasks(offers1[0].id(), tasks, filters);
 
-  driver.killTask(taskId);
+  WAIT_UNTIL(statusUpdateCall1);
 
-  WAIT_UNTIL(killTaskCall);
+  EXPECT_EQ(TASK_RUNNING, status1.state());
 
-  // Scheduler should get an offer for task resources.
   WAIT_UNTIL(resourceOffersCall2);
 
   EXPECT_NE(0u, offers2.size());
 
-  Offer offer = offers2[0];
-  EXPECT_EQ(taskResources, offer.resources());
+  // Now that the executor is running, launch another task and kill
+  // it in one burst.
+  TaskInfo task2 = task1;
+  task2.mutable_task_id()->set_value("2");
 
-  driver.declineOffer(offer.id());
+  tasks.clear();
+  tasks.push_back(task2);
 
-  // Now simulate an executorExited call to the slave.
-  // We need to explicitly send this message because we don't spawn
-  // a real executor process in this test.
-  process::dispatch(
-      slave,
-      &Slave::executorTerminated,
-      offer.framework_id(),
-      executorInfo.executor_id(),
-      0,
-      false,
-      "Killed executor");
+  driver.launchTasks(offers2[0].id(), tasks);
+  driver.killTask(task2.task_id());
 
-  // Scheduler should get an offer for the complete slave resources.
-  WAIT_UNTIL(resourceOffersCall3);
+  WAIT_UNTIL(statusUpdateCall2);
 
-  EXPECT_NE(0u, offers3.size());
-  EXPECT_EQ(slaveResources, offers3[0].resources());
+  EXPECT_EQ("2", status2.task_id().value());
+  EXPECT_EQ(TASK_KILLED, status2.state());
 
   driver.stop();
   driver.join();
 
-  // The mock executor might get a shutdown in this case when the
-  // slave exits (since the driver links with the slave).
-  EXPECT_CALL(exec, shutdown(_))
-    .Times(AtMost(1));
+  WAIT_UNTIL(shutdownCall); // Ensures MockExecutor can be deallocated.
 
   process::terminate(slave);
   process::wait(slave);
@@ -607,7 +635,17 @@ TEST(MasterTest, RecoverResources)
 }
 
 
-TEST(MasterTest, FrameworkMessage)
+// Stops the executor driver (e.g., from within Executor::launchTask).
+ACTION(StopExecutorDriver)
+{
+  arg0->stop();
+}
+
+
+// Sends a final status update from the executor and stops its driver
+// right away, which shouldn't keep the status update from reaching
+// the scheduler.
+TEST(MasterTest, StatusUpdateBeforeExecutorDriverStop)
 {
   ASSERT_TRUE(GTEST_IS_THREADSAFE);
 
@@ -619,23 +657,16 @@ TEST(MasterTest, FrameworkMessage)
 
   MockExecutor exec;
 
-  ExecutorDriver* execDriver;
-  string execData;
-
-  trigger execFrameworkMessageCall, shutdownCall;
-
   EXPECT_CALL(exec, registered(_, _, _, _))
-    .WillOnce(SaveArg<0>(&execDriver));
+    .Times(1);
 
   EXPECT_CALL(exec, launchTask(_, _))
-    .WillOnce(SendStatusUpdateFromTask(TASK_RUNNING));
-
-  EXPECT_CALL(exec, frameworkMessage(_, _))
-    .WillOnce(DoAll(SaveArg<1>(&execData),
-                    Trigger(&execFrameworkMessageCall)));
+    .WillOnce(DoAll(SendStatusUpdateFromTask(TASK_FINISHED),
+                    StopExecutorDriver()));
 
+  // The executor driver is stopped so it might not get the shutdown.
   EXPECT_CALL(exec, shutdown(_))
-    .WillOnce(Trigger(&shutdownCall));
+    .Times(AtMost(1));
 
   map<ExecutorID, Executor*> execs;
   execs[DEFAULT_EXECUTOR_ID] = &exec;
@@ -649,35 +680,27 @@ TEST(MasterTest, FrameworkMessage)
 
   BasicMasterDetector detector(master, slave, true);
 
-  // Launch the first (i.e., failing) scheduler and wait until the
-  // first status update message is sent to it (drop the message).
-
   MockScheduler sched;
-  MesosSchedulerDriver schedDriver(&sched, DEFAULT_FRAMEWORK_INFO, master);
+  MesosSchedulerDriver driver(&sched, DEFAULT_FRAMEWORK_INFO, master);
 
   vector<Offer> offers;
   TaskStatus status;
-  string schedData;
 
-  trigger resourceOffersCall, statusUpdateCall, schedFrameworkMessageCall;
+  trigger resourceOffersCall, statusUpdateCall;
 
-  EXPECT_CALL(sched, registered(&schedDriver, _, _))
+  EXPECT_CALL(sched, registered(&driver, _, _))
     .Times(1);
 
-  EXPECT_CALL(sched, resourceOffers(&schedDriver, _))
+  EXPECT_CALL(sched, resourceOffers(&driver, _))
     .WillOnce(DoAll(SaveArg<1>(&offers),
                     Trigger(&resourceOffersCall)))
     .WillRepeatedly(Return());
 
-  EXPECT_CALL(sched, statusUpdate(&schedDriver, _))
+  EXPECT_CALL(sched, statusUpdate(&driver, _))
     .WillOnce(DoAll(SaveArg<1>(&status),
                     Trigger(&statusUpdateCall)));
 
-  EXPECT_CALL(sched, frameworkMessage(&schedDriver, _, _, _))
-    .WillOnce(DoAll(SaveArg<3>(&schedData),
-                    Trigger(&schedFrameworkMessageCall)));
-
-  schedDriver.start();
+  driver.start();
 
   WAIT_UNTIL(resourceOffersCall);
 
@@ -693,23 +716,1043 @@ TEST(MasterTest, FrameworkMessage)
   vector<TaskInfo> tasks;
   tasks.push_back(task);
 
-  schedDriver.launchTasks(offers[0].id(), tasks);
+  driver.launchTasks(offers[0].id(), tasks);
 
   WAIT_UNTIL(statusUpdateCall);
 
-  EXPECT_EQ(TASK_RUNNING, status.state());
+  EXPECT_EQ(TASK_FINISHED, status.state());
 
-  string hello = "hello";
+  driver.stop();
+  driver.join();
 
-  schedDriver.sendFrameworkMessage(DEFAULT_EXECUTOR_ID,
-                                   offers[0].slave_id(),
-                                   hello);
+  process::terminate(slave);
+  process::wait(slave);
 
-  WAIT_UNTIL(execFrameworkMessageCall);
+  process::terminate(master);
+  process::wait(master);
+}
 
-  EXPECT_EQ(hello, execData);
 
-  string reply = "reply";
+// Matches tasks against two offers from the same slave (the second
+// one made up of resources that a finished task freed up), each of
+// which should get used to launch the task placed into it.
+TEST(MasterTest, MatchTasksOffersFromSameSlave)
+{
+  ASSERT_TRUE(GTEST_IS_THREADSAFE);
+
+  HierarchicalDRFAllocatorProcess allocator;
+  Allocator a(&allocator);
+  Files files;
+  Master m(&a, &files);
+  PID<Master> master = process::spawn(&m);
+
+  MockExecutor exec;
+
+  ExecutorDriver* execDriver;
+
+  trigger launchTaskCall, shutdownCall;
+
+  EXPECT_CALL(exec, registered(_, _, _, _))
+    .Times(1);
+
+  // The first task keeps running until the test finishes it.
+  EXPECT_CALL(exec, launchTask(_, _))
+    .WillOnce(DoAll(SaveArg<0>(&execDriver),
+                    Trigger(&launchTaskCall)))
+    .WillRepeatedly(SendStatusUpdateFromTask(TASK_RUNNING));
+
+  EXPECT_CALL(exec, shutdown(_))
+    .WillOnce(Trigger(&shutdownCall));
+
+  map<ExecutorID, Executor*> execs;
+  execs[DEFAULT_EXECUTOR_ID] = &exec;
+
+  TestingIsolationModule isolationModule(execs);
+
+  Resources resources = Resources::parse("cpus:2;mem:1024");
+
+  Slave s(resources, true, &isolationModule, &files);
+  PID<Slave> slave = process::spawn(&s);
+
+  BasicMasterDetector detector(master, slave, true);
+
+  // Have the driver hold on to the offers.
+  setenv("MESOS_OFFER_POOL_CAPACITY", "10", 1);
+
+  MockScheduler sched;
+  MesosSchedulerDriver driver(&sched, DEFAULT_FRAMEWORK_INFO, master);
+
+  unsetenv("MESOS_OFFER_POOL_CAPACITY");
+
+  vector<Offer> offers1, offers2, offers3;
+  TaskStatus status1, status2, status3;
+
+  trigger resourceOffersCall1, resourceOffersCall2, resourceOffersCall3;
+  trigger statusUpdateCall1, statusUpdateCall3;
+
+  EXPECT_CALL(sched, registered(&driver, _, _))
+    .Times(1);
+
+  EXPECT_CALL(sched, resourceOffers(&driver, _))
+    .WillOnce(DoAll(SaveArg<1>(&offers1),
+                    Trigger(&resourceOffersCall1)))
+    .WillOnce(DoAll(SaveArg<1>(&offers2),
+                    Trigger(&resourceOffersCall2)))
+    .WillOnce(DoAll(SaveArg<1>(&offers3),
+                    Trigger(&resourceOffersCall3)))
+    .WillRepeatedly(Return());
+
+  EXPECT_CALL(sched, statusUpdate(&driver, _))
+    .WillOnce(DoAll(SaveArg<1>(&status1),
+                    Trigger(&statusUpdateCall1)))
+    .WillOnce(SaveArg<1>(&status2))
+    .WillOnce(DoAll(SaveArg<1>(&status3),
+                    Trigger(&statusUpdateCall3)));
+
+  EXPECT_CALL(isolationModule, resourcesChanged(_, _, _))
+    .WillRepeatedly(Return());
+
+  driver.start();
+
+  WAIT_UNTIL(resourceOffersCall1);
+
+  EXPECT_NE(0u, offers1.size());
+
+  TaskInfo task;
+  task.set_name("");
+  task.mutable_task_id()->set_value("0");
+  task.mutable_slave_id()->MergeFrom(offers1[0].slave_id());
+  task.mutable_resources()->MergeFrom(Resources::parse("cpus:1;mem:256"));
+  task.mutable_executor()->MergeFrom(DEFAULT_EXECUTOR_INFO);
+
+  vector<TaskInfo> tasks;
+  tasks.push_back(task);
+
+  // Get the rest of the resources offered again right away.
+  Filters filters;
+  filters.set_refuse_seconds(0);
+
+  driver.launchTasks(offers1[0].id(), tasks, filters);
+
+  WAIT_UNTIL(launchTaskCall);
+  WAIT_UNTIL(resourceOffersCall2);
+
+  EXPECT_NE(0u, offers2.size());
+
+  // Finish the first task so that its resources get offered (on
+  // their own) while the driver still holds the second offer.
+  TaskStatus finished;
+  finished.mutable_task_id()->MergeFrom(task.task_id());
+  finished.set_state(TASK_FINISHED);
+
+  execDriver->sendStatusUpdate(finished);
+
+  WAIT_UNTIL(statusUpdateCall1);
+
+  EXPECT_EQ(TASK_FINISHED, status1.state());
+
+  WAIT_UNTIL(resourceOffersCall3);
+
+  EXPECT_NE(0u, offers3.size());
+  EXPECT_EQ(offers2[0].slave_id(), offers3[0].slave_id());
+
+  // The larger task only fits into the second offer, which leaves
+  // only the third one for the smaller task.
+  TaskInfo task1;
+  task1.set_name("");
+  task1.mutable_task_id()->set_value("1");
+  task1.mutable_resources()->MergeFrom(Resources::parse("cpus:1;mem:512"));
+  task1.mutable_executor()->MergeFrom(DEFAULT_EXECUTOR_INFO);
+
+  TaskInfo task2 = task1;
+  task2.mutable_task_id()->set_value("2");
+  task2.mutable_resources()->Clear();
+  task2.mutable_resources()->MergeFrom(Resources::parse("cpus:1;mem:256"));
+
+  tasks.clear();
+  tasks.push_back(task1);
+  tasks.push_back(task2);
+
+  vector<TaskInfo> unmatched;
+
+  driver.matchTasks(tasks, &unmatched);
+
+  EXPECT_TRUE(unmatched.empty());
+
+  WAIT_UNTIL(statusUpdateCall3);
+
+  EXPECT_EQ(TASK_RUNNING, status2.state());
+  EXPECT_EQ(TASK_RUNNING, status3.state());
+  EXPECT_NE(status2.task_id().value(), status3.task_id().value());
+
+  driver.stop();
+  driver.join();
+
+  WAIT_UNTIL(shutdownCall); // Ensures MockExecutor can be deallocated.
+
+  process::terminate(slave);
+  process::wait(slave);
+
+  process::terminate(master);
+  process::wait(master);
+}
+
+
+TEST(MasterTest, ShutdownFrameworkWhileTaskRunning)
+{
+  ASSERT_TRUE(GTEST_IS_THREADSAFE);
+
+  HierarchicalDRFAllocatorProcess allocator;
+  Allocator a(&allocator);
+  Files files;
+  Master m(&a, &files);
+  PID<Master> master = process::spawn(&m);
+
+  MockExecutor exec;
+
+  trigger shutdownCall;
+
+  EXPECT_CALL(exec, registered(_, _, _, _))
+    .Times(1);
+
+  EXPECT_CALL(exec, launchTask(_, _))
+    .WillOnce(SendStatusUpdateFromTask(TASK_RUNNING));
+
+  EXPECT_CALL(exec, shutdown(_))
+    .WillOnce(Trigger(&shutdownCall));
+
+  map<ExecutorID, Executor*> execs;
+  execs[DEFAULT_EXECUTOR_ID] = &exec;
+
+  TestingIsolationModule isolationModule(execs);
+
+  flags::Flags<logging::Flags, slave::Flags> flags;
+  flags.executor_shutdown_grace_period = Seconds(0.0);
+  flags.resources = Option<string>::some("cpus:2;mem:1024");
+  Slave s(flags, true, &isolationModule, &files);
+  PID<Slave> slave = process::spawn(&s);
+
+  BasicMasterDetector detector(master, slave, true);
+
+  MockScheduler sched;
+  MesosSchedulerDriver driver(&sched, DEFAULT_FRAMEWORK_INFO, master);
+
+  vector<Offer> offers;
+  TaskStatus status;
+
+  trigger resourceOffersCall, statusUpdateCall, resourcesChangedCall;
+
+  EXPECT_CALL(sched, registered(&driver, _, _))
+    .Times(1);
+
+  EXPECT_CALL(sched, resourceOffers(&driver, _))
+    .WillOnce(DoAll(SaveArg<1>(&offers),
+                    Trigger(&resourceOffersCall)))
+    .WillRepeatedly(Return());
+
+  EXPECT_CALL(sched, statusUpdate(&driver, _))
+    .WillOnce(DoAll(SaveArg<1>(&status), Trigger(&statusUpdateCall)));
+
+  driver.start();
+
+  WAIT_UNTIL(resourceOffersCall);
+
+  EXPECT_NE(0u, offers.size());
+
+  TaskInfo task;
+  task.set_name("");
+  task.mutable_task_id()->set_value("1");
+  task.mutable_slave_id()->MergeFrom(offers[0].slave_id());
+  task.mutable_resources()->MergeFrom(offers[0].resources());
+  task.mutable_executor()->MergeFrom(DEFAULT_EXECUTOR_INFO);
+
+  vector<TaskInfo> tasks;
+  tasks.push_back(task);
+
+  EXPECT_CALL(isolationModule,
+              resourcesChanged(_, _, Resources(offers[0].resources())))
+    .WillOnce(Trigger(&resourcesChangedCall));
+
+  driver.launchTasks(offers[0].id(), tasks);
+
+  WAIT_UNTIL(statusUpdateCall);
+
+  EXPECT_EQ(TASK_RUNNING, status.state());
+
+  WAIT_UNTIL(resourcesChangedCall);
+
+  driver.stop();
+  driver.join();
+
+  WAIT_UNTIL(shutdownCall); // Ensures MockExecutor can be deallocated.
+
+  process::terminate(slave);
+  process::wait(slave);
+
+  process::terminate(master);
+  process::wait(master);
+}
+
+
+TEST(MasterTest, KillTask)
+{
+  ASSERT_TRUE(GTEST_IS_THREADSAFE);
+
+  HierarchicalDRFAllocatorProcess allocator;
+  Allocator a(&allocator);
+  Files files;
+  Master m(&a, &files);
+  PID<Master> master = process::spawn(&m);
+
+  MockExecutor exec;
+
+  trigger killTaskCall, shutdownCall;
+
+  EXPECT_CALL(exec, registered(_, _, _, _))
+    .Times(1);
+
+  EXPECT_CALL(exec, launchTask(_, _))
+    .WillOnce(SendStatusUpdateFromTask(TASK_RUNNING));
+
+  EXPECT_CALL(exec, killTask(_, _))
+    .WillOnce(Trigger(&killTaskCall));
+
+  EXPECT_CALL(exec, shutdown(_))
+    .WillOnce(Trigger(&shutdownCall));
+
+  map<ExecutorID, Executor*> execs;
+  execs[DEFAULT_EXECUTOR_ID] = &exec;
+
+  TestingIsolationModule isolationModule(execs);
+
+  Resources resources = Resources::parse("cpus:2;mem:1024");
+
+  Slave s(resources, true, &isolationModule, &files);
+  PID<Slave> slave = process::spawn(&s);
+
+  BasicMasterDetector detector(master, slave, true);
+
+  MockScheduler sched;
+  MesosSchedulerDriver driver(&sched, DEFAULT_FRAMEWORK_INFO, master);
+
+  vector<Offer> offers;
+  TaskStatus status;
+
+  trigger resourceOffersCall, statusUpdateCall;
+
+  EXPECT_CALL(sched, registered(&driver, _, _))
+    .Times(1);
+
+  EXPECT_CALL(sched, resourceOffers(&driver, _))
+    .WillOnce(DoAll(SaveArg<1>(&offers),
+                    Trigger(&resourceOffersCall)))
+    .WillRepeatedly(Return());
+
+  EXPECT_CALL(sched, statusUpdate(&driver, _))
+    .WillOnce(DoAll(SaveArg<1>(&status),
+                    Trigger(&statusUpdateCall)));
+
+  driver.start();
+
+  WAIT_UNTIL(resourceOffersCall);
+
+  EXPECT_NE(0u, offers.size());
+
+  TaskID taskId;
+  taskId.set_value("1");
+
+  TaskInfo task;
+  task.set_name("");
+  task.mutable_task_id()->MergeFrom(taskId);
+  task.mutable_slave_id()->MergeFrom(offers[0].slave_id());
+  task.mutable_resources()->MergeFrom(offers[0].resources());
+  task.mutable_executor()->MergeFrom(DEFAULT_EXECUTOR_INFO);
+
+  vector<TaskInfo> tasks;
+  tasks.push_back(task);
+
+  driver.launchTasks(offers[0].id(), tasks);
+
+  WAIT_UNTIL(statusUpdateCall);
+
+  EXPECT_EQ(TASK_RUNNING, status.state());
+
+  driver.killTask(taskId);
+
+  WAIT_UNTIL(killTaskCall);
+
+  driver.stop();
+  driver.join();
+
+  WAIT_UNTIL(shutdownCall); // To ensure can deallocate MockExecutor.
+
+  process::terminate(slave);
+  process::wait(slave);
+
+  process::terminate(master);
+  process::wait(master);
+}
+
+
+TEST(MasterTest, StatusUpdateAck)
+{
+  ASSERT_TRUE(GTEST_IS_THREADSAFE);
+
+  HierarchicalDRFAllocatorProcess allocator;
+  Allocator a(&allocator);
+  Files files;
+  Master m(&a, &files);
+  PID<Master> master = process::spawn(&m);
+
+  MockExecutor exec;
+
+  trigger statusUpdateAckMsg;
+  EXPECT_MESSAGE(Eq(StatusUpdateAcknowledgementMessage().GetTypeName()), _, _)
+    .WillOnce(DoAll(Trigger(&statusUpdateAckMsg),
+                    Return(false)));
+
+  trigger shutdownCall;
+
+  EXPECT_CALL(exec, registered(_, _, _, _))
+    .Times(1);
+
+  EXPECT_CALL(exec, launchTask(_, _))
+    .WillOnce(SendStatusUpdateFromTask(TASK_RUNNING));
+
+  EXPECT_CALL(exec, shutdown(_))
+    .WillOnce(Trigger(&shutdownCall));
+
+  map<ExecutorID, Executor*> execs;
+  execs[DEFAULT_EXECUTOR_ID] = &exec;
+
+  TestingIsolationModule isolationModule(execs);
+
+  Resources resources = Resources::parse("cpus:2;mem:1024");
+
+  Slave s(resources, true, &isolationModule, &files);
+  PID<Slave> slave = process::spawn(&s);
+
+  BasicMasterDetector detector(master, slave, true);
+
+  MockScheduler sched;
+  MesosSchedulerDriver driver(&sched, DEFAULT_FRAMEWORK_INFO, master);
+
+  vector<Offer> offers;
+  TaskStatus status;
+
+  trigger resourceOffersCall, statusUpdateCall;
+
+  EXPECT_CALL(sched, registered(&driver, _, _))
+    .Times(1);
+
+  EXPECT_CALL(sched, resourceOffers(&driver, _))
+    .WillOnce(DoAll(SaveArg<1>(&offers),
+                    Trigger(&resourceOffersCall)))
+    .WillRepeatedly(Return());
+
+  EXPECT_CALL(sched, statusUpdate(&driver, _))
+    .WillOnce(DoAll(SaveArg<1>(&status),
+                    Trigger(&statusUpdateCall)));
+
+  driver.start();
+
+  WAIT_UNTIL(resourceOffersCall);
+
+  EXPECT_NE(0u, offers.size());
+
+  TaskInfo task;
+  task.set_name("");
+  task.mutable_task_id()->set_value("1");
+  task.mutable_slave_id()->MergeFrom(offers[0].slave_id());
+  task.mutable_resources()->MergeFrom(offers[0].resources());
+  task.mutable_executor()->MergeFrom(DEFAULT_EXECUTOR_INFO);
+
+  vector<TaskInfo> tasks;
+  tasks.push_back(task);
+
+  driver.launchTasks(offers[0].id(), tasks);
+
+  WAIT_UNTIL(statusUpdateCall);
+
+  EXPECT_EQ(TASK_RUNNING, status.state());
+
+  // Ensure we get a status update ACK.
+  WAIT_UNTIL(statusUpdateAckMsg);
+
+  driver.stop();
+  driver.join();
+
+  WAIT_UNTIL(shutdownCall); // Ensures MockExecutor can be deallocated.
+
+  process::terminate(slave);
+  process::wait(slave);
+
+  process::terminate(master);
+  process::wait(master);
+}
+
+
+TEST(MasterTest, BatchedStatusUpdateAck)
+{
+  ASSERT_TRUE(GTEST_IS_THREADSAFE);
+
+  Clock::pause();
+
+  HierarchicalDRFAllocatorProcess allocator;
+  Allocator a(&allocator);
+  Files files;
+  Master m(&a, &files);
+  PID<Master> master = process::spawn(&m);
+
+  MockExecutor exec;
+
+  // The ACKs for both status updates should go out together.
+  trigger statusUpdateAcksMsg;
+  EXPECT_MESSAGE(Eq(StatusUpdateAcknowledgementsMessage().GetTypeName()),
+                 _,
+                 _)
+    .WillOnce(DoAll(Trigger(&statusUpdateAcksMsg),
+                    Return(false)));
+
+  EXPECT_MESSAGE(Eq(StatusUpdateAcknowledgementMessage().GetTypeName()), _, _)
+    .Times(0);
+
+  trigger launchTaskCall, shutdownCall;
+
+  EXPECT_CALL(exec, registered(_, _, _, _))
+    .Times(1);
+
+  EXPECT_CALL(exec, launchTask(_, _))
+    .WillOnce(SendStatusUpdateFromTask(TASK_RUNNING))
+    .WillOnce(DoAll(SendStatusUpdateFromTask(TASK_RUNNING),
+                    Trigger(&launchTaskCall)));
+
+  EXPECT_CALL(exec, shutdown(_))
+    .WillOnce(Trigger(&shutdownCall));
+
+  map<ExecutorID, Executor*> execs;
+  execs[DEFAULT_EXECUTOR_ID] = &exec;
+
+  TestingIsolationModule isolationModule(execs);
+
+  Resources resources = Resources::parse("cpus:2;mem:1024");
+
+  Slave s(resources, true, &isolationModule, &files);
+  PID<Slave> slave = process::spawn(&s);
+
+  // Count the messages the slave (re)sends status updates in.
+  int updates = 0;
+
+  EXPECT_MESSAGE(Eq(StatusUpdateMessage().GetTypeName()),
+                 Eq(slave),
+                 Eq(master))
+    .WillRepeatedly(DoAll(Increment(&updates),
+                          Return(false)));
+
+  EXPECT_MESSAGE(Eq(StatusUpdatesMessage().GetTypeName()),
+                 Eq(slave),
+                 Eq(master))
+    .WillRepeatedly(DoAll(Increment(&updates),
+                          Return(false)));
+
+  BasicMasterDetector detector(master, slave, true);
+
+  // Have the driver deliver status updates in batches.
+  setenv("MESOS_STATUS_UPDATE_BATCH_INTERVAL", "0.1", 1);
+
+  MockScheduler sched;
+  MesosSchedulerDriver driver(&sched, DEFAULT_FRAMEWORK_INFO, master);
+
+  unsetenv("MESOS_STATUS_UPDATE_BATCH_INTERVAL");
+
+  vector<Offer> offers;
+  TaskStatus status1, status2;
+
+  trigger resourceOffersCall, statusUpdateCall;
+
+  EXPECT_CALL(sched, registered(&driver, _, _))
+    .Times(1);
+
+  EXPECT_CALL(sched, resourceOffers(&driver, _))
+    .WillOnce(DoAll(SaveArg<1>(&offers),
+                    Trigger(&resourceOffersCall)))
+    .WillRepeatedly(Return());
+
+  EXPECT_CALL(sched, statusUpdate(&driver, _))
+    .WillOnce(SaveArg<1>(&status1))
+    .WillOnce(DoAll(SaveArg<1>(&status2),
+                    Trigger(&statusUpdateCall)));
+
+  driver.start();
+
+  WAIT_UNTIL(resourceOffersCall);
+
+  EXPECT_NE(0u, offers.size());
+
+  TaskInfo task1;
+  task1.set_name("");
+  task1.mutable_task_id()->set_value("1");
+  task1.mutable_slave_id()->MergeFrom(offers[0].slave_id());
+  task1.mutable_resources()->MergeFrom(Resources::parse("cpus:1;mem:512"));
+  task1.mutable_executor()->MergeFrom(DEFAULT_EXECUTOR_INFO);
+
+  TaskInfo task2 = task1;
+  task2.mutable_task_id()->set_value("2");
+
+  vector<TaskInfo> tasks;
+  tasks.push_back(task1);
+  tasks.push_back(task2);
+
+  driver.launchTasks(offers[0].id(), tasks);
+
+  WAIT_UNTIL(launchTaskCall);
+
+  // Wait for both status updates to reach the driver, which holds
+  // on to them until the batch interval elapses.
+  Clock::settle();
+
+  Clock::advance(0.1);
+
+  WAIT_UNTIL(statusUpdateCall);
+
+  EXPECT_EQ(TASK_RUNNING, status1.state());
+  EXPECT_EQ(TASK_RUNNING, status2.state());
+
+  WAIT_UNTIL(statusUpdateAcksMsg);
+
+  // Let the slave handle the ACKs.
+  Clock::settle();
+
+  EXPECT_LT(0, updates);
+
+  // The slave should have dropped both status updates from its
+  // stream, so nothing gets resent.
+  int sent = updates;
+
+  Clock::advance(STATUS_UPDATE_RETRY_INTERVAL.secs());
+  Clock::settle();
+
+  EXPECT_EQ(sent, updates);
+
+  driver.stop();
+  driver.join();
+
+  WAIT_UNTIL(shutdownCall); // Ensures MockExecutor can be deallocated.
+
+  process::terminate(slave);
+  process::wait(slave);
+
+  process::terminate(master);
+  process::wait(master);
+
+  Clock::resume();
+}
+
+
+TEST(MasterTest, RecoverResources)
+{
+  ASSERT_TRUE(GTEST_IS_THREADSAFE);
+
+  HierarchicalDRFAllocatorProcess allocator;
+  Allocator a(&allocator);
+  Files files;
+  Master m(&a, &files);
+  PID<Master> master = process::spawn(&m);
+
+  MockExecutor exec;
+
+  map<ExecutorID, Executor*> execs;
+  execs[DEFAULT_EXECUTOR_ID] = &exec;
+
+  TestingIsolationModule isolationModule(execs);
+
+  Resources slaveResources = Resources::parse(
+      "cpus:2;mem:1024;ports:[1-10, 20-30]");
+
+  Slave s(slaveResources, true, &isolationModule, &files);
+  PID<Slave> slave = process::spawn(&s);
+
+  BasicMasterDetector detector(master, slave, true);
+
+  ExecutorInfo executorInfo;
+  executorInfo.MergeFrom(DEFAULT_EXECUTOR_INFO);
+
+  Resources executorResources = Resources::parse(
+      "cpus:0.3;mem:200;ports:[5-8, 23-25]");
+  executorInfo.mutable_resources()->MergeFrom(executorResources);
+
+  MockScheduler sched;
+  MesosSchedulerDriver driver(&sched, DEFAULT_FRAMEWORK_INFO, master);
+
+  vector<Offer> offers1, offers2, offers3;
+  TaskStatus status;
+
+  trigger resourceOffersCall1, resourceOffersCall2, resourceOffersCall3;
+  trigger statusUpdateCall;
+
+  EXPECT_CALL(sched, registered(&driver, _, _))
+    .Times(1);
+
+  EXPECT_CALL(sched, resourceOffers(&driver, _))
+    .WillOnce(DoAll(SaveArg<1>(&offers1),
+                    Trigger(&resourceOffersCall1)))
+    .WillOnce(DoAll(SaveArg<1>(&offers2),
+                    Trigger(&resourceOffersCall2)))
+    .WillOnce(DoAll(SaveArg<1>(&offers3),
+                    Trigger(&resourceOffersCall3)))
+    .WillRepeatedly(Return());
+
+  EXPECT_CALL(sched, statusUpdate(&driver, _))
+    .WillRepeatedly(DoAll(SaveArg<1>(&status),
+			                    Trigger(&statusUpdateCall)));
+
+  driver.start();
+
+  WAIT_UNTIL(resourceOffersCall1);
+
+  EXPECT_NE(0u, offers1.size());
+
+  TaskID taskId;
+  taskId.set_value("1");
+
+  Resources taskResources = offers1[0].resources() - executorResources;
+
+  TaskInfo task;
+  task.set_name("");
+  task.mutable_task_id()->MergeFrom(taskId);
+  task.mutable_slave_id()->MergeFrom(offers1[0].slave_id());
+  task.mutable_resources()->MergeFrom(taskResources);
+  task.mutable_executor()->MergeFrom(executorInfo);
+
+  vector<TaskInfo> tasks;
+  tasks.push_back(task);
+
+  EXPECT_CALL(exec, registered(_, _, _, _))
+    .Times(1);
+
+  EXPECT_CALL(exec, launchTask(_, _))
+    .WillOnce(SendStatusUpdateFromTask(TASK_RUNNING));
+
+  driver.launchTasks(offers1[0].id(), tasks);
+
+  WAIT_UNTIL(statusUpdateCall);
+
+  EXPECT_EQ(TASK_RUNNING, status.state());
+
+  trigger killTaskCall;
+  EXPECT_CALL(exec, killTask(_, _))
+    .WillOnce(DoAll(Trigger(&killTaskCall),
+                    SendStatusUpdateFromTaskID(TASK_KILLED)));
+
+  driver.killTask(taskId);
+
+  WAIT_UNTIL(killTaskCall);
+
+  // Scheduler should get an offer for task resources.
+  WAIT_UNTIL(resourceOffersCall2);
+
+  EXPECT_NE(0u, offers2.size());
+
+  Offer offer = offers2[0];
+  EXPECT_EQ(taskResources, offer.resources());
+
+  driver.declineOffer(offer.id());
+
+  // Now simulate an executorExited call to the slave.
+  // We need to explicitly send this message because we don't spawn
+  // a real executor process in this test.
+  process::dispatch(
+      slave,
+      &Slave::executorTerminated,
+      offer.framework_id(),
+      executorInfo.executor_id(),
+      0,
+      false,
+      "Killed executor");
+
+  // Scheduler should get an offer for the complete slave resources.
+  WAIT_UNTIL(resourceOffersCall3);
+
+  EXPECT_NE(0u, offers3.size());
+  EXPECT_EQ(slaveResources, offers3[0].resources());
+
+  driver.stop();
+  driver.join();
+
+  // The mock executor might get a shutdown in this case when the
+  // slave exits (since the driver links with the slave).
+  EXPECT_CALL(exec, shutdown(_))
+    .Times(AtMost(1));
+
+  process::terminate(slave);
+  process::wait(slave);
+
+  process::terminate(master);
+  process::wait(master);
+}
+
+
+// Returns the JSON object served by the given master endpoint (e.g.,
+// 'state.json').
+static Try<JSON::Object> endpoint(
+    const PID<Master>& master,
+    const string& path)
+{
+  Future<process::http::Response> response =
+    process::http::get(master, path);
+
+  if (!response.await(Seconds(5.0)) || !response.isReady()) {
+    return Try<JSON::Object>::error("Failed to get '" + path + "'");
+  }
+
+  Try<JSON::Value> parse = JSON::parse(response.get().body);
+  if (parse.isError()) {
+    return Try<JSON::Object>::error(parse.error());
+  }
+
+  JSON::Value value = parse.get();
+  JSON::Object* object = boost::get<JSON::Object>(&value);
+  if (object == NULL) {
+    return Try<JSON::Object>::error("Expecting a JSON object");
+  }
+
+  return *object;
+}
+
+
+// Returns the (only) framework in the master's 'state.json'.
+static Try<JSON::Object> framework(const PID<Master>& master)
+{
+  Try<JSON::Object> state = endpoint(master, "state.json");
+  if (state.isError()) {
+    return state;
+  }
+
+  JSON::Array* frameworks =
+    boost::get<JSON::Array>(&state.get().values["frameworks"]);
+  if (frameworks == NULL || frameworks->values.size() != 1) {
+    return Try<JSON::Object>::error("Expecting a single framework");
+  }
+
+  JSON::Object* object =
+    boost::get<JSON::Object>(&frameworks->values.front());
+  if (object == NULL) {
+    return Try<JSON::Object>::error("Expecting a JSON object");
+  }
+
+  return *object;
+}
+
+
+// Returns the number stored in 'object' under 'key' (or -1 if there
+// is no such number).
+static double number(JSON::Object object, const string& key)
+{
+  JSON::Number* number = boost::get<JSON::Number>(&object.values[key]);
+  return number != NULL ? number->value : -1.0;
+}
+
+
+TEST(MasterTest, DeclineOfferStatistics)
+{
+  ASSERT_TRUE(GTEST_IS_THREADSAFE);
+
+  Clock::pause();
+
+  HierarchicalDRFAllocatorProcess allocator;
+  Allocator a(&allocator);
+  Files files;
+  Master m(&a, &files);
+  PID<Master> master = process::spawn(&m);
+
+  MockExecutor exec;
+
+  map<ExecutorID, Executor*> execs;
+  execs[DEFAULT_EXECUTOR_ID] = &exec;
+
+  TestingIsolationModule isolationModule(execs);
+
+  Resources resources = Resources::parse("cpus:2;mem:1024");
+
+  Slave s(resources, true, &isolationModule, &files);
+  PID<Slave> slave = process::spawn(&s);
+
+  BasicMasterDetector detector(master, slave, true);
+
+  MockScheduler sched;
+  MesosSchedulerDriver driver(&sched, DEFAULT_FRAMEWORK_INFO, master);
+
+  vector<Offer> offers;
+
+  trigger resourceOffersCall;
+
+  EXPECT_CALL(sched, registered(&driver, _, _))
+    .Times(1);
+
+  EXPECT_CALL(sched, resourceOffers(&driver, _))
+    .WillOnce(DoAll(SaveArg<1>(&offers),
+                    Trigger(&resourceOffersCall)))
+    .WillRepeatedly(Return());
+
+  driver.start();
+
+  WAIT_UNTIL(resourceOffersCall);
+
+  ASSERT_EQ(1u, offers.size());
+
+  Try<JSON::Object> object = framework(master);
+  ASSERT_TRUE(object.isSome()) << object.error();
+
+  EXPECT_EQ(1.0, number(object.get(), "offers_outstanding"));
+  EXPECT_EQ(0.0, number(object.get(), "average_decline_time"));
+  EXPECT_EQ(0.0, number(object.get(), "relayed_framework_messages"));
+
+  // Hold on to the offer for a while before declining it.
+  Clock::advance(2.0);
+
+  driver.declineOffer(offers[0].id());
+
+  Clock::settle();
+
+  object = framework(master);
+  ASSERT_TRUE(object.isSome()) << object.error();
+
+  EXPECT_EQ(0.0, number(object.get(), "offers_outstanding"));
+  EXPECT_EQ(2.0, number(object.get(), "average_decline_time"));
+
+  object = endpoint(master, "stats.json");
+  ASSERT_TRUE(object.isSome()) << object.error();
+
+  EXPECT_EQ(1.0, number(object.get(), "total_schedulers"));
+  EXPECT_EQ(0.0, number(object.get(), "relayed_framework_messages"));
+
+  // Declining the same offer again must not count towards the
+  // average (the master has forgotten when it was offered).
+  driver.declineOffer(offers[0].id());
+
+  Clock::settle();
+
+  object = framework(master);
+  ASSERT_TRUE(object.isSome()) << object.error();
+
+  EXPECT_EQ(2.0, number(object.get(), "average_decline_time"));
+
+  driver.stop();
+  driver.join();
+
+  process::terminate(slave);
+  process::wait(slave);
+
+  process::terminate(master);
+  process::wait(master);
+
+  Clock::resume();
+}
+
+
+TEST(MasterTest, FrameworkMessage)
+{
+  ASSERT_TRUE(GTEST_IS_THREADSAFE);
+
+  HierarchicalDRFAllocatorProcess allocator;
+  Allocator a(&allocator);
+  Files files;
+  Master m(&a, &files);
+  PID<Master> master = process::spawn(&m);
+
+  MockExecutor exec;
+
+  ExecutorDriver* execDriver;
+  string execData;
+
+  trigger execFrameworkMessageCall, shutdownCall;
+
+  EXPECT_CALL(exec, registered(_, _, _, _))
+    .WillOnce(SaveArg<0>(&execDriver));
+
+  EXPECT_CALL(exec, launchTask(_, _))
+    .WillOnce(SendStatusUpdateFromTask(TASK_RUNNING));
+
+  EXPECT_CALL(exec, frameworkMessage(_, _))
+    .WillOnce(DoAll(SaveArg<1>(&execData),
+                    Trigger(&execFrameworkMessageCall)));
+
+  EXPECT_CALL(exec, shutdown(_))
+    .WillOnce(Trigger(&shutdownCall));
+
+  map<ExecutorID, Executor*> execs;
+  execs[DEFAULT_EXECUTOR_ID] = &exec;
+
+  TestingIsolationModule isolationModule(execs);
+
+  Resources resources = Resources::parse("cpus:2;mem:1024");
+
+  Slave s(resources, true, &isolationModule, &files);
+  PID<Slave> slave = process::spawn(&s);
+
+  BasicMasterDetector detector(master, slave, true);
+
+  // Launch the first (i.e., failing) scheduler and wait until the
+  // first status update message is sent to it (drop the message).
+
+  MockScheduler sched;
+  MesosSchedulerDriver schedDriver(&sched, DEFAULT_FRAMEWORK_INFO, master);
+
+  vector<Offer> offers;
+  TaskStatus status;
+  string schedData;
+
+  trigger resourceOffersCall, statusUpdateCall, schedFrameworkMessageCall;
+
+  EXPECT_CALL(sched, registered(&schedDriver, _, _))
+    .Times(1);
+
+  EXPECT_CALL(sched, resourceOffers(&schedDriver, _))
+    .WillOnce(DoAll(SaveArg<1>(&offers),
+                    Trigger(&resourceOffersCall)))
+    .WillRepeatedly(Return());
+
+  EXPECT_CALL(sched, statusUpdate(&schedDriver, _))
+    .WillOnce(DoAll(SaveArg<1>(&status),
+                    Trigger(&statusUpdateCall)));
+
+  EXPECT_CALL(sched, frameworkMessage(&schedDriver, _, _, _))
+    .WillOnce(DoAll(SaveArg<3>(&schedData),
+                    Trigger(&schedFrameworkMessageCall)));
+
+  schedDriver.start();
+
+  WAIT_UNTIL(resourceOffersCall);
+
+  EXPECT_NE(0u, offers.size());
+
+  TaskInfo task;
+  task.set_name("");
+  task.mutable_task_id()->set_value("1");
+  task.mutable_slave_id()->MergeFrom(offers[0].slave_id());
+  task.mutable_resources()->MergeFrom(offers[0].resources());
+  task.mutable_executor()->MergeFrom(DEFAULT_EXECUTOR_INFO);
+
+  vector<TaskInfo> tasks;
+  tasks.push_back(task);
+
+  schedDriver.launchTasks(offers[0].id(), tasks);
+
+  WAIT_UNTIL(statusUpdateCall);
+
+  EXPECT_EQ(TASK_RUNNING, status.state());
+
+  string hello = "hello";
+
+  schedDriver.sendFrameworkMessage(DEFAULT_EXECUTOR_ID,
+                                   offers[0].slave_id(),
+                                   hello);
+
+  WAIT_UNTIL(execFrameworkMessageCall);
+
+  EXPECT_EQ(hello, execData);
+
+  string reply = "reply";
 
   execDriver->sendFrameworkMessage(reply);
 
@@ -730,6 +1773,322 @@ TEST(MasterTest, FrameworkMessage)
 }
 
 
+// Saves the destination of the message being filtered.
+ACTION_P(SaveMessageTo, pid)
+{
+  *pid = arg0.message->to;
+}
+
+
+// A stand-in for a slave that sends framework messages to a
+// scheduler, which lets a test decide when the scheduler loses its
+// connection to that "slave" (without the master noticing).
+class FakeSlaveProcess : public ProtobufProcess<FakeSlaveProcess>
+{
+public:
+  void frameworkMessage(
+      const UPID& scheduler,
+      const ExecutorToFrameworkMessage& message)
+  {
+    send(scheduler, message);
+  }
+};
+
+
+TEST(MasterTest, FrameworkMessageToLearnedSlave)
+{
+  ASSERT_TRUE(GTEST_IS_THREADSAFE);
+
+  HierarchicalDRFAllocatorProcess allocator;
+  Allocator a(&allocator);
+  Files files;
+  Master m(&a, &files);
+  PID<Master> master = process::spawn(&m);
+
+  MockExecutor exec;
+
+  string execData;
+
+  trigger execFrameworkMessageCall, shutdownCall;
+
+  EXPECT_CALL(exec, registered(_, _, _, _))
+    .Times(1);
+
+  EXPECT_CALL(exec, launchTask(_, _))
+    .WillOnce(SendStatusUpdateFromTask(TASK_RUNNING));
+
+  EXPECT_CALL(exec, frameworkMessage(_, _))
+    .WillOnce(DoAll(SaveArg<1>(&execData),
+                    Trigger(&execFrameworkMessageCall)));
+
+  EXPECT_CALL(exec, shutdown(_))
+    .WillOnce(Trigger(&shutdownCall));
+
+  map<ExecutorID, Executor*> execs;
+  execs[DEFAULT_EXECUTOR_ID] = &exec;
+
+  TestingIsolationModule isolationModule(execs);
+
+  Resources resources = Resources::parse("cpus:2;mem:1024");
+
+  Slave s(resources, true, &isolationModule, &files);
+  PID<Slave> slave = process::spawn(&s);
+
+  BasicMasterDetector detector(master, slave, true);
+
+  // The scheduler knows where the task runs, so the framework
+  // message should go straight to the slave.
+  EXPECT_MESSAGE(Eq(FrameworkToExecutorMessage().GetTypeName()),
+                 _,
+                 Eq(master))
+    .Times(0);
+
+  trigger frameworkToExecutorMsg;
+  EXPECT_MESSAGE(Eq(FrameworkToExecutorMessage().GetTypeName()),
+                 _,
+                 Eq(slave))
+    .WillOnce(DoAll(Trigger(&frameworkToExecutorMsg),
+                    Return(false)));
+
+  MockScheduler sched;
+  MesosSchedulerDriver schedDriver(&sched, DEFAULT_FRAMEWORK_INFO, master);
+
+  vector<Offer> offers;
+  TaskStatus status;
+
+  trigger resourceOffersCall, statusUpdateCall;
+
+  EXPECT_CALL(sched, registered(&schedDriver, _, _))
+    .Times(1);
+
+  EXPECT_CALL(sched, resourceOffers(&schedDriver, _))
+    .WillOnce(DoAll(SaveArg<1>(&offers),
+                    Trigger(&resourceOffersCall)))
+    .WillRepeatedly(Return());
+
+  EXPECT_CALL(sched, statusUpdate(&schedDriver, _))
+    .WillOnce(DoAll(SaveArg<1>(&status),
+                    Trigger(&statusUpdateCall)));
+
+  schedDriver.start();
+
+  WAIT_UNTIL(resourceOffersCall);
+
+  EXPECT_NE(0u, offers.size());
+
+  TaskInfo task;
+  task.set_name("");
+  task.mutable_task_id()->set_value("1");
+  task.mutable_slave_id()->MergeFrom(offers[0].slave_id());
+  task.mutable_resources()->MergeFrom(offers[0].resources());
+  task.mutable_executor()->MergeFrom(DEFAULT_EXECUTOR_INFO);
+
+  vector<TaskInfo> tasks;
+  tasks.push_back(task);
+
+  schedDriver.launchTasks(offers[0].id(), tasks);
+
+  WAIT_UNTIL(statusUpdateCall);
+
+  EXPECT_EQ(TASK_RUNNING, status.state());
+
+  string hello = "hello";
+
+  schedDriver.sendFrameworkMessage(DEFAULT_EXECUTOR_ID,
+                                   offers[0].slave_id(),
+                                   hello);
+
+  WAIT_UNTIL(frameworkToExecutorMsg);
+  WAIT_UNTIL(execFrameworkMessageCall);
+
+  EXPECT_EQ(hello, execData);
+
+  Try<JSON::Object> stats = endpoint(master, "stats.json");
+  ASSERT_TRUE(stats.isSome()) << stats.error();
+
+  EXPECT_EQ(0.0, number(stats.get(), "relayed_framework_messages"));
+
+  schedDriver.stop();
+  schedDriver.join();
+
+  WAIT_UNTIL(shutdownCall); // To ensure can deallocate MockExecutor.
+
+  process::terminate(slave);
+  process::wait(slave);
+
+  process::terminate(master);
+  process::wait(master);
+}
+
+
+TEST(MasterTest, FrameworkMessageRelayedAfterSlaveExits)
+{
+  ASSERT_TRUE(GTEST_IS_THREADSAFE);
+
+  HierarchicalDRFAllocatorProcess allocator;
+  Allocator a(&allocator);
+  Files files;
+  Master m(&a, &files);
+  PID<Master> master = process::spawn(&m);
+
+  MockExecutor exec;
+
+  string execData;
+
+  trigger execFrameworkMessageCall, shutdownCall;
+
+  EXPECT_CALL(exec, registered(_, _, _, _))
+    .Times(1);
+
+  EXPECT_CALL(exec, launchTask(_, _))
+    .WillOnce(SendStatusUpdateFromTask(TASK_RUNNING));
+
+  EXPECT_CALL(exec, frameworkMessage(_, _))
+    .WillOnce(DoAll(SaveArg<1>(&execData),
+                    Trigger(&execFrameworkMessageCall)));
+
+  EXPECT_CALL(exec, shutdown(_))
+    .WillOnce(Trigger(&shutdownCall));
+
+  map<ExecutorID, Executor*> execs;
+  execs[DEFAULT_EXECUTOR_ID] = &exec;
+
+  TestingIsolationModule isolationModule(execs);
+
+  Resources resources = Resources::parse("cpus:2;mem:1024");
+
+  Slave s(resources, true, &isolationModule, &files);
+  PID<Slave> slave = process::spawn(&s);
+
+  BasicMasterDetector detector(master, slave, true);
+
+  // Capture the scheduler's PID so the fake slave can message it.
+  UPID scheduler;
+  EXPECT_MESSAGE(Eq(FrameworkRegisteredMessage().GetTypeName()), _, _)
+    .WillOnce(DoAll(SaveMessageTo(&scheduler),
+                    Return(false)));
+
+  MockScheduler sched;
+  MesosSchedulerDriver schedDriver(&sched, DEFAULT_FRAMEWORK_INFO, master);
+
+  FrameworkID frameworkId;
+  vector<Offer> offers;
+  TaskStatus status;
+  string schedData;
+
+  trigger resourceOffersCall, statusUpdateCall, schedFrameworkMessageCall;
+
+  EXPECT_CALL(sched, registered(&schedDriver, _, _))
+    .WillOnce(SaveArg<1>(&frameworkId));
+
+  EXPECT_CALL(sched, resourceOffers(&schedDriver, _))
+    .WillOnce(DoAll(SaveArg<1>(&offers),
+                    Trigger(&resourceOffersCall)))
+    .WillRepeatedly(Return());
+
+  EXPECT_CALL(sched, statusUpdate(&schedDriver, _))
+    .WillOnce(DoAll(SaveArg<1>(&status),
+                    Trigger(&statusUpdateCall)));
+
+  EXPECT_CALL(sched, frameworkMessage(&schedDriver, _, _, _))
+    .WillOnce(DoAll(SaveArg<3>(&schedData),
+                    Trigger(&schedFrameworkMessageCall)));
+
+  schedDriver.start();
+
+  WAIT_UNTIL(resourceOffersCall);
+
+  EXPECT_NE(0u, offers.size());
+
+  TaskInfo task;
+  task.set_name("");
+  task.mutable_task_id()->set_value("1");
+  task.mutable_slave_id()->MergeFrom(offers[0].slave_id());
+  task.mutable_resources()->MergeFrom(offers[0].resources());
+  task.mutable_executor()->MergeFrom(DEFAULT_EXECUTOR_INFO);
+
+  vector<TaskInfo> tasks;
+  tasks.push_back(task);
+
+  schedDriver.launchTasks(offers[0].id(), tasks);
+
+  WAIT_UNTIL(statusUpdateCall);
+
+  EXPECT_EQ(TASK_RUNNING, status.state());
+
+  ASSERT_NE(UPID(), scheduler);
+
+  // Have the scheduler learn the fake slave's PID for the slave by
+  // sending it a framework message.
+  FakeSlaveProcess fakeSlaveProcess;
+  PID<FakeSlaveProcess> fakeSlave = process::spawn(&fakeSlaveProcess);
+
+  ExecutorToFrameworkMessage message;
+  message.mutable_slave_id()->MergeFrom(offers[0].slave_id());
+  message.mutable_framework_id()->MergeFrom(frameworkId);
+  message.mutable_executor_id()->MergeFrom(DEFAULT_EXECUTOR_ID);
+  message.set_data("reply");
+
+  process::dispatch(fakeSlave,
+                    &FakeSlaveProcess::frameworkMessage,
+                    scheduler,
+                    message);
+
+  WAIT_UNTIL(schedFrameworkMessageCall);
+
+  EXPECT_EQ("reply", schedData);
+
+  // Once the fake slave exits the scheduler should stop sending to
+  // it and have the master relay the framework message instead.
+  process::terminate(fakeSlave);
+  process::wait(fakeSlave);
+
+  EXPECT_MESSAGE(Eq(FrameworkToExecutorMessage().GetTypeName()),
+                 _,
+                 Eq(fakeSlave))
+    .Times(0);
+
+  trigger frameworkToExecutorMsg;
+  EXPECT_MESSAGE(Eq(FrameworkToExecutorMessage().GetTypeName()),
+                 _,
+                 Eq(master))
+    .WillOnce(DoAll(Trigger(&frameworkToExecutorMsg),
+                    Return(false)));
+
+  string hello = "hello";
+
+  schedDriver.sendFrameworkMessage(DEFAULT_EXECUTOR_ID,
+                                   offers[0].slave_id(),
+                                   hello);
+
+  WAIT_UNTIL(frameworkToExecutorMsg);
+  WAIT_UNTIL(execFrameworkMessageCall);
+
+  EXPECT_EQ(hello, execData);
+
+  Try<JSON::Object> stats = endpoint(master, "stats.json");
+  ASSERT_TRUE(stats.isSome()) << stats.error();
+
+  EXPECT_EQ(1.0, number(stats.get(), "relayed_framework_messages"));
+
+  Try<JSON::Object> object = framework(master);
+  ASSERT_TRUE(object.isSome()) << object.error();
+
+  EXPECT_EQ(1.0, number(object.get(), "relayed_framework_messages"));
+
+  schedDriver.stop();
+  schedDriver.join();
+
+  WAIT_UNTIL(shutdownCall); // To ensure can deallocate MockExecutor.
+
+  process::terminate(slave);
+  process::wait(slave);
+
+  process::terminate(master);
+  process::wait(master);
+}
+
+
 TEST(MasterTest, MultipleExecutors)
 {
   ASSERT_TRUE(GTEST_IS_THREADSAFE);
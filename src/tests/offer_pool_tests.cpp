@@ -0,0 +1,134 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gmock/gmock.h>
+
+#include <string>
+#include <vector>
+
+#include "common/resources.hpp"
+
+#include "sched/offer_pool.hpp"
+
+using namespace mesos;
+using namespace mesos::internal;
+
+using std::string;
+using std::vector;
+
+
+static Offer createOffer(const string& id,
+                         const string& slaveId,
+                         const string& resources)
+{
+  Offer offer;
+  offer.mutable_id()->set_value(id);
+  offer.mutable_framework_id()->set_value("framework");
+  offer.mutable_slave_id()->set_value(slaveId);
+  offer.set_hostname(slaveId);
+  offer.mutable_resources()->MergeFrom(Resources::parse(resources));
+  return offer;
+}
+
+
+static TaskInfo createTask(const string& id,
+                           const string& resources,
+                           const string& slaveId = "")
+{
+  TaskInfo task;
+  task.set_name(id);
+  task.mutable_task_id()->set_value(id);
+  task.mutable_slave_id()->set_value(slaveId);
+  task.mutable_resources()->MergeFrom(Resources::parse(resources));
+  task.mutable_command()->set_value("exit 0");
+  return task;
+}
+
+
+TEST(OfferPoolTest, Capacity)
+{
+  OfferPool pool(2);
+
+  EXPECT_TRUE(pool.add(createOffer("o1", "s1", "cpus:1;mem:1")).empty());
+  EXPECT_TRUE(pool.add(createOffer("o2", "s2", "cpus:1;mem:1")).empty());
+
+  // The oldest offer gets evicted.
+  vector<OfferID> evicted = pool.add(createOffer("o3", "s3", "cpus:1;mem:1"));
+  ASSERT_EQ(1u, evicted.size());
+  EXPECT_EQ("o1", evicted[0].value());
+  EXPECT_EQ(2u, pool.size());
+
+  OfferID offerId;
+  offerId.set_value("o2");
+  EXPECT_TRUE(pool.remove(offerId));
+  EXPECT_FALSE(pool.remove(offerId));
+  EXPECT_EQ(1u, pool.size());
+
+  EXPECT_EQ(1u, pool.clear().size());
+  EXPECT_EQ(0u, pool.size());
+
+  // A pool without any capacity doesn't hold any offers.
+  OfferPool disabled(0);
+  EXPECT_TRUE(disabled.add(createOffer("o1", "s1", "cpus:1")).empty());
+  EXPECT_EQ(0u, disabled.size());
+}
+
+
+TEST(OfferPoolTest, Match)
+{
+  OfferPool pool(10);
+
+  pool.add(createOffer("o1", "s1", "cpus:4;mem:1024"));
+  pool.add(createOffer("o2", "s2", "cpus:2;mem:512"));
+  pool.add(createOffer("o3", "s3", "cpus:8;mem:4096"));
+
+  vector<TaskInfo> tasks;
+  tasks.push_back(createTask("t1", "cpus:1;mem:256"));
+  tasks.push_back(createTask("t2", "cpus:3;mem:768"));
+  tasks.push_back(createTask("t3", "cpus:16;mem:256"));
+  tasks.push_back(createTask("t4", "cpus:1;mem:256", "s3"));
+
+  vector<TaskInfo> unmatched;
+  hashmap<OfferID, vector<TaskInfo> > matched = pool.match(tasks, &unmatched);
+
+  // The task that doesn't fit anywhere is unmatched.
+  ASSERT_EQ(1u, unmatched.size());
+  EXPECT_EQ("t3", unmatched[0].task_id().value());
+
+  // The largest task (t2) goes into the tightest offer that fits it
+  // (o1), after which t1 goes into the tightest remaining (o1 again)
+  // and t4 into the offer from the slave it asked for (o3).
+  ASSERT_EQ(2u, matched.size());
+
+  OfferID o1;
+  o1.set_value("o1");
+  ASSERT_TRUE(matched.contains(o1));
+  ASSERT_EQ(2u, matched[o1].size());
+  EXPECT_EQ("t2", matched[o1][0].task_id().value());
+  EXPECT_EQ("t1", matched[o1][1].task_id().value());
+  EXPECT_EQ("s1", matched[o1][1].slave_id().value());
+
+  OfferID o3;
+  o3.set_value("o3");
+  ASSERT_TRUE(matched.contains(o3));
+  ASSERT_EQ(1u, matched[o3].size());
+  EXPECT_EQ("t4", matched[o3][0].task_id().value());
+
+  // The used offers are no longer held.
+  EXPECT_EQ(1u, pool.size());
+}
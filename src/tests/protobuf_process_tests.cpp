@@ -0,0 +1,240 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gmock/gmock.h>
+
+#include <string>
+#include <vector>
+
+#include <process/dispatch.hpp>
+#include <process/future.hpp>
+#include <process/process.hpp>
+#include <process/protobuf.hpp>
+
+#include <stout/duration.hpp>
+
+#include "messages/messages.hpp"
+
+using namespace mesos::internal;
+
+using process::Future;
+using process::PID;
+using process::UPID;
+
+using std::string;
+using std::vector;
+
+
+// What a handler saw of a message it was given.
+struct Handled
+{
+  const void* address;
+  int pids;
+  int space;
+};
+
+
+// Records the messages its handler gets (without holding on to them).
+class HandlerProcess : public ProtobufProcess<HandlerProcess>
+{
+public:
+  using ProtobufProcess<HandlerProcess>::MAX_REUSED_MESSAGE_SPACE;
+
+  vector<Handled> handled() { return messages; }
+
+protected:
+  virtual void initialize()
+  {
+    install<ResourceOffersMessage>(&HandlerProcess::offers);
+  }
+
+private:
+  void offers(const ResourceOffersMessage& message)
+  {
+    Handled handled;
+    handled.address = &message;
+    handled.pids = message.pids_size();
+    handled.space = message.SpaceUsed();
+    messages.push_back(handled);
+  }
+
+  vector<Handled> messages;
+};
+
+
+// Waits until the process has handled all of the messages posted to
+// it so far and returns what it saw.
+static vector<Handled> handled(const PID<HandlerProcess>& pid)
+{
+  Future<vector<Handled> > handled =
+    process::dispatch(pid, &HandlerProcess::handled);
+
+  handled.await(Seconds(5.0));
+
+  return handled.isReady() ? handled.get() : vector<Handled>();
+}
+
+
+TEST(ProtobufProcessTest, HandlerReusesMessage)
+{
+  HandlerProcess process;
+  PID<HandlerProcess> pid = process::spawn(&process);
+
+  ResourceOffersMessage message;
+  message.add_pids("slave(1)@127.0.0.1:5051");
+  message.add_pids("slave(2)@127.0.0.1:5052");
+  message.add_pids("slave(3)@127.0.0.1:5053");
+
+  process::post(pid, message);
+
+  message.Clear();
+  message.add_pids("slave(4)@127.0.0.1:5054");
+
+  process::post(pid, message);
+
+  vector<Handled> messages = handled(pid);
+  ASSERT_EQ(2u, messages.size());
+
+  // The same instance gets used for both messages, but the repeated
+  // field must not carry over any of the items of the first message.
+  EXPECT_EQ(messages[0].address, messages[1].address);
+  EXPECT_EQ(3, messages[0].pids);
+  EXPECT_EQ(1, messages[1].pids);
+
+  process::terminate(pid);
+  process::wait(pid);
+}
+
+
+TEST(ProtobufProcessTest, HandlerReleasesLargeMessage)
+{
+  HandlerProcess process;
+  PID<HandlerProcess> pid = process::spawn(&process);
+
+  const int limit = HandlerProcess::MAX_REUSED_MESSAGE_SPACE;
+
+  ResourceOffersMessage message;
+  message.add_pids(string(limit, 'x'));
+  message.add_pids(string(limit, 'y'));
+
+  process::post(pid, message);
+
+  message.Clear();
+  message.add_pids("slave(1)@127.0.0.1:5051");
+
+  process::post(pid, message);
+
+  vector<Handled> messages = handled(pid);
+  ASSERT_EQ(2u, messages.size());
+
+  // Parsing the small message into the instance that held the large
+  // one would have kept the large allocations around.
+  EXPECT_LT(limit, messages[0].space);
+  EXPECT_GT(limit, messages[1].space);
+  EXPECT_EQ(1, messages[1].pids);
+
+  process::terminate(pid);
+  process::wait(pid);
+}
+
+
+// Builds messages in its reused instances.
+class ReuseProcess : public ProtobufProcess<ReuseProcess>
+{
+public:
+  using ProtobufProcess<ReuseProcess>::reuse;
+
+  // Sends 'count' messages to 'to', each with one more pid than the
+  // last, and returns the instances they were built in.
+  vector<const void*> offers(const UPID& to, int count)
+  {
+    vector<const void*> addresses;
+    for (int i = 1; i <= count; i++) {
+      ResourceOffersMessage& message = reuse<ResourceOffersMessage>();
+      for (int j = 0; j < i; j++) {
+        message.add_pids("slave(1)@127.0.0.1:5051");
+      }
+      send(to, message);
+      addresses.push_back(&message);
+    }
+    return addresses;
+  }
+
+  // Starts building a message but never sends it.
+  void unsent()
+  {
+    reuse<ResourceOffersMessage>().add_pids("slave(1)@127.0.0.1:5051");
+  }
+};
+
+
+TEST(ProtobufProcessTest, Reuse)
+{
+  HandlerProcess handler;
+  PID<HandlerProcess> handlerPid = process::spawn(&handler);
+
+  ReuseProcess process;
+  PID<ReuseProcess> pid = process::spawn(&process);
+
+  Future<vector<const void*> > addresses =
+    process::dispatch(pid, &ReuseProcess::offers, handlerPid, 2);
+
+  ASSERT_TRUE(addresses.await(Seconds(5.0)));
+  ASSERT_TRUE(addresses.isReady());
+  ASSERT_EQ(2u, addresses.get().size());
+
+  // Once a message has been sent its instance can be reused.
+  EXPECT_EQ(addresses.get()[0], addresses.get()[1]);
+
+  // A message that never got sent is only being built until the end
+  // of the event, after which its type can be reused again (and
+  // comes back cleared).
+  process::dispatch(pid, &ReuseProcess::unsent);
+
+  addresses = process::dispatch(pid, &ReuseProcess::offers, handlerPid, 1);
+
+  ASSERT_TRUE(addresses.await(Seconds(5.0)));
+  ASSERT_TRUE(addresses.isReady());
+
+  vector<Handled> messages = handled(handlerPid);
+  ASSERT_EQ(3u, messages.size());
+
+  EXPECT_EQ(1, messages[0].pids);
+  EXPECT_EQ(2, messages[1].pids);
+  EXPECT_EQ(1, messages[2].pids);
+
+  process::terminate(pid);
+  process::wait(pid);
+
+  process::terminate(handlerPid);
+  process::wait(handlerPid);
+}
+
+
+TEST(ProtobufProcessTest, NestedReuse)
+{
+  // Not spawned, the instances get built on this thread instead.
+  ReuseProcess process;
+
+  ResourceOffersMessage& message = process.reuse<ResourceOffersMessage>();
+  message.add_pids("slave(1)@127.0.0.1:5051");
+
+  // Reusing the type before the message got sent would clobber it.
+  EXPECT_DEBUG_DEATH(process.reuse<ResourceOffersMessage>(),
+                     "still being built");
+}
@@ -0,0 +1,19 @@
+#!/bin/sh
+
+# Expecting MESOS_SOURCE_DIR and MESOS_BUILD_DIR to be in environment.
+
+env | grep MESOS_SOURCE_DIR >/dev/null
+
+test $? != 0 && \
+  echo "Failed to find MESOS_SOURCE_DIR in environment" && \
+  exit 1
+
+env | grep MESOS_BUILD_DIR >/dev/null
+
+test $? != 0 && \
+  echo "Failed to find MESOS_BUILD_DIR in environment" && \
+  exit 1
+
+# Check that the lazily parsed protobufs passed to Python frameworks
+# behave like real messages (returns 0).
+exec $MESOS_BUILD_DIR/src/examples/python/test-protobufs
@@ -187,6 +187,99 @@ TEST_F(SlaveStateFixture, CheckpointFrameworkPID)
   ASSERT_EQ(upid, readFrameworkPID(rootDir, slaveId, frameworkId));
 }
 
+
+TEST_F(SlaveStateFixture, CheckpointForkedPID)
+{
+  writeForkedPID(rootDir, slaveId, frameworkId, executorId, uuid, 42);
+
+  Option<pid_t> pid =
+    readForkedPID(rootDir, slaveId, frameworkId, executorId, uuid);
+
+  ASSERT_TRUE(pid.isSome());
+  ASSERT_EQ(42, pid.get());
+}
+
+
+TEST_F(SlaveStateFixture, CheckpointExecutorRun)
+{
+  paths::createExecutorDirectory(
+      rootDir, slaveId, frameworkId, executorId, uuid);
+
+  FrameworkInfo frameworkInfo;
+  frameworkInfo.set_user("user");
+  frameworkInfo.set_name("framework");
+  writeFrameworkInfo(rootDir, slaveId, frameworkId, frameworkInfo);
+
+  ExecutorInfo executorInfo;
+  executorInfo.mutable_executor_id()->MergeFrom(executorId);
+  executorInfo.mutable_command()->set_value("exit 1");
+  writeExecutorInfo(rootDir, slaveId, frameworkId, uuid, executorInfo);
+
+  process::UPID upid("executor(1)@127.0.0.1:5050");
+  writeLibprocessPID(rootDir, slaveId, frameworkId, executorId, uuid, upid);
+
+  SlaveState state = parse(rootDir, slaveId);
+
+  ASSERT_TRUE(state.frameworks[frameworkId].info.isSome());
+  ASSERT_EQ("framework", state.frameworks[frameworkId].info.get().name());
+
+  const SlaveState::FrameworkState::RunState::ExecutorState& run =
+    state.frameworks[frameworkId].executors[executorId].runs[uuid];
+
+  ASSERT_TRUE(run.info.isSome());
+  ASSERT_EQ(executorId, run.info.get().executor_id());
+
+  ASSERT_TRUE(run.libprocessPid.isSome());
+  ASSERT_EQ(upid, run.libprocessPid.get());
+}
+
+
+TEST_F(SlaveStateFixture, CheckpointStatusUpdates)
+{
+  paths::createExecutorDirectory(
+      rootDir, slaveId, frameworkId, executorId, uuid);
+
+  const string& updatesPath = paths::getTaskUpdatesPath(
+      rootDir, slaveId, frameworkId, executorId, uuid, taskId);
+
+  std::vector<StatusUpdateRecord> records;
+
+  // Two updates, the first of which gets acknowledged.
+  for (int i = 0; i < 2; i++) {
+    StatusUpdateRecord record;
+    record.set_type(StatusUpdateRecord::UPDATE);
+    StatusUpdate* update = record.mutable_update();
+    update->mutable_framework_id()->MergeFrom(frameworkId);
+    update->mutable_status()->mutable_task_id()->MergeFrom(taskId);
+    update->mutable_status()->set_state(i == 0 ? TASK_RUNNING : TASK_FINISHED);
+    update->set_timestamp(i);
+    update->set_uuid(UUID::random().toBytes());
+    records.push_back(record);
+  }
+
+  StatusUpdateRecord ack;
+  ack.set_type(StatusUpdateRecord::ACK);
+  ack.set_uuid(records[0].update().uuid());
+
+  // Write the records in two batches.
+  ASSERT_SOME(writeRecords(updatesPath, records));
+  ASSERT_SOME(
+      writeRecords(updatesPath, std::vector<StatusUpdateRecord>(1, ack)));
+
+  Try<std::vector<StatusUpdateRecord> > read = readRecords(updatesPath);
+  ASSERT_SOME(read);
+  ASSERT_EQ(3u, read.get().size());
+
+  SlaveState state = parse(rootDir, slaveId);
+
+  const std::vector<StatusUpdate>& updates =
+    state.frameworks[frameworkId].executors[executorId].runs[uuid]
+    .updates[taskId];
+
+  ASSERT_EQ(1u, updates.size());
+  ASSERT_EQ(TASK_FINISHED, updates[0].status().state());
+}
+
 } // namespace state {
 } // namespace slave {
 } // namespace internal {
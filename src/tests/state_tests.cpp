@@ -27,14 +27,23 @@
 #include <process/future.hpp>
 #include <process/protobuf.hpp>
 
+#include <stout/duration.hpp>
+#include <stout/nothing.hpp>
 #include <stout/option.hpp>
 #include <stout/os.hpp>
+#include <stout/stringify.hpp>
+#include <stout/uuid.hpp>
 
 #include "common/type_utils.hpp"
 
+#include "log/log.hpp"
+#include "log/replica.hpp"
+
 #include "messages/messages.hpp"
 
+#include "state/caching.hpp"
 #include "state/leveldb.hpp"
+#include "state/log.hpp"
 #include "state/serializer.hpp"
 #include "state/state.hpp"
 #include "state/zookeeper.hpp"
@@ -46,6 +55,7 @@
 
 using namespace mesos;
 using namespace mesos::internal;
+using namespace mesos::internal::log;
 using namespace mesos::internal::state;
 using namespace mesos::internal::tests;
 
@@ -210,6 +220,145 @@ void Names(State<ProtobufSerializer>* state)
 }
 
 
+// Gets and then sets many variables at once (i.e., without waiting
+// for each operation to complete before issuing the next one).
+void ManyVariables(State<ProtobufSerializer>* state)
+{
+  const int COUNT = 200;
+
+  std::vector<Future<Variable<Slaves> > > variables;
+  for (int i = 0; i < COUNT; i++) {
+    variables.push_back(state->get<Slaves>("slaves" + stringify(i)));
+  }
+
+  SlaveInfo info;
+  info.set_hostname("localhost");
+  info.set_webui_hostname("localhost");
+
+  std::vector<Future<Option<Variable<Slaves> > > > results;
+  for (int i = 0; i < COUNT; i++) {
+    ASSERT_FUTURE_WILL_SUCCEED(variables[i]);
+    Variable<Slaves> slaves = variables[i].get();
+    EXPECT_TRUE(slaves->infos().size() == 0);
+    slaves->add_infos()->MergeFrom(info);
+    results.push_back(state->set(slaves));
+  }
+
+  for (int i = 0; i < COUNT; i++) {
+    results[i].await();
+    ASSERT_TRUE(results[i].isReady());
+    EXPECT_SOME(results[i].get());
+  }
+
+  Future<std::vector<std::string> > names = state->names();
+
+  names.await();
+
+  ASSERT_TRUE(names.isReady());
+  EXPECT_EQ(COUNT, (int) names.get().size());
+}
+
+
+// Gets and atomically sets multiple variables at once.
+void Transaction(State<ProtobufSerializer>* state)
+{
+  std::vector<std::string> names;
+  names.push_back("slaves1");
+  names.push_back("slaves2");
+  names.push_back("slaves3");
+
+  Future<std::vector<Variable<Slaves> > > variables =
+    state->get<Slaves>(names);
+  ASSERT_FUTURE_WILL_SUCCEED(variables);
+  ASSERT_EQ(3u, variables.get().size());
+
+  std::vector<Variable<Slaves> > slaves = variables.get();
+
+  for (size_t i = 0; i < slaves.size(); i++) {
+    EXPECT_TRUE(slaves[i]->infos().size() == 0);
+
+    SlaveInfo info;
+    info.set_hostname("localhost" + stringify(i));
+    info.set_webui_hostname("localhost" + stringify(i));
+
+    slaves[i]->add_infos()->MergeFrom(info);
+  }
+
+  Future<Option<std::vector<Variable<Slaves> > > > result = state->set(slaves);
+  ASSERT_FUTURE_WILL_SUCCEED(result);
+  ASSERT_SOME(result.get());
+
+  slaves = result.get().get();
+
+  // Now make one of the variables stale (by setting it on its own)
+  // so that setting all of them together must not set any of them.
+  Future<Option<Variable<Slaves> > > single = state->set(slaves[1]);
+  ASSERT_FUTURE_WILL_SUCCEED(single);
+  ASSERT_SOME(single.get());
+
+  for (size_t i = 0; i < slaves.size(); i++) {
+    slaves[i]->clear_infos();
+  }
+
+  result = state->set(slaves);
+  ASSERT_FUTURE_WILL_SUCCEED(result);
+  EXPECT_TRUE(result.get().isNone());
+
+  variables = state->get<Slaves>(names);
+  ASSERT_FUTURE_WILL_SUCCEED(variables);
+  ASSERT_EQ(3u, variables.get().size());
+
+  slaves = variables.get();
+
+  for (size_t i = 0; i < slaves.size(); i++) {
+    ASSERT_TRUE(slaves[i]->infos().size() == 1);
+    EXPECT_EQ("localhost" + stringify(i), slaves[i]->infos(0).hostname());
+  }
+}
+
+
+// Sets (and replaces) a variable that is bigger than what fits in a
+// single znode, even after it gets compressed.
+void LargeVariable(State<ProtobufSerializer>* state)
+{
+  Future<Variable<Slaves> > variable = state->get<Slaves>("slaves");
+  ASSERT_FUTURE_WILL_SUCCEED(variable);
+
+  Variable<Slaves> slaves = variable.get();
+
+  for (int i = 0; i < 2; i++) {
+    slaves->clear_infos();
+
+    // Random hostnames so that compression doesn't shrink it too much.
+    for (int j = 0; j < 40000; j++) {
+      SlaveInfo info;
+      info.set_hostname(UUID::random().toString());
+      info.set_webui_hostname(stringify(i));
+      slaves->add_infos()->MergeFrom(info);
+    }
+
+    const std::string hostname = slaves->infos(39999).hostname();
+
+    Future<Option<Variable<Slaves> > > result = state->set(slaves);
+    ASSERT_FUTURE_WILL_SUCCEED(result);
+    ASSERT_SOME(result.get());
+
+    variable = state->get<Slaves>("slaves");
+    ASSERT_FUTURE_WILL_SUCCEED(variable);
+
+    slaves = variable.get();
+    ASSERT_EQ(40000, slaves->infos().size());
+    EXPECT_EQ(hostname, slaves->infos(39999).hostname());
+    EXPECT_EQ(stringify(i), slaves->infos(0).webui_hostname());
+  }
+
+  Future<std::vector<std::string> > names = state->names();
+  ASSERT_FUTURE_WILL_SUCCEED(names);
+  ASSERT_EQ(1u, names.get().size());
+  EXPECT_EQ("slaves", names.get()[0]);
+}
+
+
 class LevelDBStateTest : public ::testing::Test
 {
 public:
@@ -260,6 +409,256 @@ TEST_F(LevelDBStateTest, Names)
 }
 
 
+TEST_F(LevelDBStateTest, ManyVariables)
+{
+  ManyVariables(state);
+}
+
+
+TEST_F(LevelDBStateTest, LargeVariable)
+{
+  LargeVariable(state);
+}
+
+
+TEST_F(LevelDBStateTest, Transaction)
+{
+  Transaction(state);
+}
+
+
+class CachingStateTest : public ::testing::Test
+{
+public:
+  CachingStateTest()
+    : leveldb(NULL), state(NULL), path(os::getcwd() + "/.state") {}
+
+protected:
+  virtual void SetUp()
+  {
+    os::rmdir(path);
+    leveldb = new LevelDBState<ProtobufSerializer>(path);
+    state = new CachingState<ProtobufSerializer>(leveldb);
+  }
+
+  virtual void TearDown()
+  {
+    delete state;
+    delete leveldb;
+    os::rmdir(path);
+  }
+
+  State<ProtobufSerializer>* leveldb;
+  CachingState<ProtobufSerializer>* state;
+
+private:
+  const std::string path;
+};
+
+
+TEST_F(CachingStateTest, GetSetGet)
+{
+  GetSetGet(state);
+}
+
+
+TEST_F(CachingStateTest, GetGetSetSetGet)
+{
+  GetGetSetSetGet(state);
+}
+
+
+TEST_F(CachingStateTest, ManyVariables)
+{
+  ManyVariables(state);
+}
+
+
+TEST_F(CachingStateTest, Transaction)
+{
+  Transaction(state);
+}
+
+
+TEST_F(CachingStateTest, Statistics)
+{
+  Future<Variable<Slaves> > variable = state->get<Slaves>("slaves");
+  ASSERT_FUTURE_WILL_SUCCEED(variable);
+
+  Variable<Slaves> slaves = variable.get();
+  EXPECT_TRUE(slaves->infos().size() == 0);
+
+  SlaveInfo info;
+  info.set_hostname("localhost");
+  info.set_webui_hostname("localhost");
+
+  slaves->add_infos()->MergeFrom(info);
+
+  Future<Option<Variable<Slaves> > > result = state->set(slaves);
+  ASSERT_FUTURE_WILL_SUCCEED(result);
+  ASSERT_SOME(result.get());
+
+  // Served from the cache (the set wrote through).
+  variable = state->get<Slaves>("slaves");
+  ASSERT_FUTURE_WILL_SUCCEED(variable);
+
+  slaves = variable.get();
+  ASSERT_TRUE(slaves->infos().size() == 1);
+  EXPECT_EQ("localhost", slaves->infos(0).hostname());
+
+  Future<CachingState<ProtobufSerializer>::Statistics> statistics =
+    state->statistics();
+  ASSERT_FUTURE_WILL_SUCCEED(statistics);
+
+  EXPECT_EQ(1u, statistics.get().hits);
+  EXPECT_EQ(1u, statistics.get().misses);
+  EXPECT_EQ(0u, statistics.get().invalidations);
+}
+
+
+TEST_F(CachingStateTest, FailedSwapInvalidates)
+{
+  // Another cache over the same leveldb state stands in for a writer
+  // that this cache doesn't know about (leveldb can not tell us).
+  CachingState<ProtobufSerializer> other(leveldb);
+
+  Future<Variable<Slaves> > variable = state->get<Slaves>("slaves");
+  ASSERT_FUTURE_WILL_SUCCEED(variable);
+
+  Variable<Slaves> slaves1 = variable.get();
+
+  variable = other.get<Slaves>("slaves");
+  ASSERT_FUTURE_WILL_SUCCEED(variable);
+
+  Variable<Slaves> slaves2 = variable.get();
+
+  SlaveInfo info2;
+  info2.set_hostname("localhost2");
+  info2.set_webui_hostname("localhost2");
+
+  slaves2->add_infos()->MergeFrom(info2);
+
+  Future<Option<Variable<Slaves> > > result = other.set(slaves2);
+  ASSERT_FUTURE_WILL_SUCCEED(result);
+  ASSERT_SOME(result.get());
+
+  SlaveInfo info1;
+  info1.set_hostname("localhost1");
+  info1.set_webui_hostname("localhost1");
+
+  slaves1->add_infos()->MergeFrom(info1);
+
+  // The underlying state rejects the swap of the stale entry.
+  result = state->set(slaves1);
+  ASSERT_FUTURE_WILL_SUCCEED(result);
+  EXPECT_TRUE(result.get().isNone());
+
+  // The invalidated entry gets fetched again.
+  variable = state->get<Slaves>("slaves");
+  ASSERT_FUTURE_WILL_SUCCEED(variable);
+
+  slaves1 = variable.get();
+  ASSERT_TRUE(slaves1->infos().size() == 1);
+  EXPECT_EQ("localhost2", slaves1->infos(0).hostname());
+
+  Future<CachingState<ProtobufSerializer>::Statistics> statistics =
+    state->statistics();
+  ASSERT_FUTURE_WILL_SUCCEED(statistics);
+
+  EXPECT_EQ(0u, statistics.get().hits);
+  EXPECT_EQ(2u, statistics.get().misses);
+  EXPECT_EQ(1u, statistics.get().invalidations);
+}
+
+
+class LogStateTest : public ::testing::Test
+{
+public:
+  LogStateTest()
+    : state(NULL),
+      replica1(NULL),
+      log(NULL),
+      path1(os::getcwd() + "/.log1"),
+      path2(os::getcwd() + "/.log2") {}
+
+protected:
+  virtual void SetUp()
+  {
+    os::rmdir(path1);
+    os::rmdir(path2);
+
+    replica1 = new Replica(path1);
+
+    std::set<UPID> pids;
+    pids.insert(replica1->pid());
+
+    log = new Log(2, path2, pids);
+
+    state = new LogState<ProtobufSerializer>(log, Seconds(10.0));
+  }
+
+  virtual void TearDown()
+  {
+    delete state;
+    delete log;
+    delete replica1;
+
+    os::rmdir(path1);
+    os::rmdir(path2);
+  }
+
+  State<ProtobufSerializer>* state;
+
+private:
+  Replica* replica1;
+  Log* log;
+  const std::string path1;
+  const std::string path2;
+};
+
+
+TEST_F(LogStateTest, GetSetGet)
+{
+  GetSetGet(state);
+}
+
+
+TEST_F(LogStateTest, GetSetSetGet)
+{
+  GetSetSetGet(state);
+}
+
+
+TEST_F(LogStateTest, GetGetSetSetGet)
+{
+  GetGetSetSetGet(state);
+}
+
+
+TEST_F(LogStateTest, Names)
+{
+  Names(state);
+}
+
+
+TEST_F(LogStateTest, ManyVariables)
+{
+  ManyVariables(state);
+}
+
+
+TEST_F(LogStateTest, LargeVariable)
+{
+  LargeVariable(state);
+}
+
+
+TEST_F(LogStateTest, Transaction)
+{
+  Transaction(state);
+}
+
+
 #ifdef MESOS_HAS_JAVA
 class ZooKeeperStateTest : public ZooKeeperTest
 {
@@ -308,4 +707,145 @@ TEST_F(ZooKeeperStateTest, Names)
 {
   Names(state);
 }
+
+
+TEST_F(ZooKeeperStateTest, ManyVariables)
+{
+  ManyVariables(state);
+}
+
+
+TEST_F(ZooKeeperStateTest, LargeVariable)
+{
+  LargeVariable(state);
+}
+
+
+// A ZooKeeperState that exposes 'watch' so that tests can wait for
+// the changes that a CachingState on top of it gets told about.
+class WatchableZooKeeperState : public ZooKeeperState<ProtobufSerializer>
+{
+public:
+  WatchableZooKeeperState(
+      const std::string& servers,
+      const Duration& timeout,
+      const std::string& znode)
+    : ZooKeeperState<ProtobufSerializer>(servers, timeout, znode) {}
+
+  virtual Future<Nothing> watch(const std::string& name)
+  {
+    return ZooKeeperState<ProtobufSerializer>::watch(name);
+  }
+};
+
+
+TEST_F(ZooKeeperStateTest, CachingWatch)
+{
+  WatchableZooKeeperState watchable(
+      server->connectString(),
+      NO_TIMEOUT,
+      "/state/");
+
+  CachingState<ProtobufSerializer> caching(&watchable);
+
+  ZooKeeperState<ProtobufSerializer> other(
+      server->connectString(),
+      NO_TIMEOUT,
+      "/state/");
+
+  Future<Variable<Slaves> > variable = caching.get<Slaves>("slaves");
+  ASSERT_FUTURE_WILL_SUCCEED(variable);
+  EXPECT_TRUE(variable.get()->infos().size() == 0);
+
+  // The cache is already watching the entry, so this is satisfied
+  // right after the cache gets told about the change.
+  Future<Nothing> changed = watchable.watch("slaves");
+
+  variable = other.get<Slaves>("slaves");
+  ASSERT_FUTURE_WILL_SUCCEED(variable);
+
+  Variable<Slaves> slaves = variable.get();
+
+  SlaveInfo info;
+  info.set_hostname("localhost");
+  info.set_webui_hostname("localhost");
+
+  slaves->add_infos()->MergeFrom(info);
+
+  Future<Option<Variable<Slaves> > > result = other.set(slaves);
+  ASSERT_FUTURE_WILL_SUCCEED(result);
+  ASSERT_SOME(result.get());
+
+  ASSERT_FUTURE_WILL_SUCCEED(changed);
+
+  Future<CachingState<ProtobufSerializer>::Statistics> statistics =
+    caching.statistics();
+  ASSERT_FUTURE_WILL_SUCCEED(statistics);
+
+  EXPECT_EQ(1u, statistics.get().invalidations);
+
+  variable = caching.get<Slaves>("slaves");
+  ASSERT_FUTURE_WILL_SUCCEED(variable);
+
+  slaves = variable.get();
+  ASSERT_TRUE(slaves->infos().size() == 1);
+  EXPECT_EQ("localhost", slaves->infos(0).hostname());
+}
+
+
+// The watch events caused by the cache's own writes must not
+// invalidate the entries it just wrote through.
+TEST_F(ZooKeeperStateTest, CachingSetHit)
+{
+  CachingState<ProtobufSerializer> caching(state);
+
+  Future<Variable<Slaves> > variable = caching.get<Slaves>("slaves");
+  ASSERT_FUTURE_WILL_SUCCEED(variable);
+
+  Variable<Slaves> slaves = variable.get();
+  EXPECT_TRUE(slaves->infos().size() == 0);
+
+  SlaveInfo info;
+  info.set_hostname("localhost1");
+  info.set_webui_hostname("localhost1");
+
+  slaves->add_infos()->MergeFrom(info);
+
+  // Creates the znode.
+  Future<Option<Variable<Slaves> > > result = caching.set(slaves);
+  ASSERT_FUTURE_WILL_SUCCEED(result);
+  ASSERT_SOME(result.get());
+
+  variable = caching.get<Slaves>("slaves");
+  ASSERT_FUTURE_WILL_SUCCEED(variable);
+
+  slaves = variable.get();
+  ASSERT_TRUE(slaves->infos().size() == 1);
+  EXPECT_EQ("localhost1", slaves->infos(0).hostname());
+
+  info.set_hostname("localhost2");
+  info.set_webui_hostname("localhost2");
+
+  slaves->add_infos()->MergeFrom(info);
+
+  // Updates the znode.
+  result = caching.set(slaves);
+  ASSERT_FUTURE_WILL_SUCCEED(result);
+  ASSERT_SOME(result.get());
+
+  variable = caching.get<Slaves>("slaves");
+  ASSERT_FUTURE_WILL_SUCCEED(variable);
+
+  slaves = variable.get();
+  ASSERT_TRUE(slaves->infos().size() == 2);
+  EXPECT_EQ("localhost2", slaves->infos(1).hostname());
+
+  Future<CachingState<ProtobufSerializer>::Statistics> statistics =
+    caching.statistics();
+  ASSERT_FUTURE_WILL_SUCCEED(statistics);
+
+  EXPECT_EQ(2u, statistics.get().hits);
+  EXPECT_EQ(1u, statistics.get().misses);
+  EXPECT_EQ(0u, statistics.get().invalidations);
+}
 #endif // MESOS_HAS_JAVA
@@ -2,6 +2,7 @@
 
 #include <cstdlib> // For rand.
 #include <map>
+#include <sstream>
 #include <string>
 #include <vector>
 
@@ -286,6 +287,62 @@ TEST(StoutStringsTest, Contains)
 }
 
 
+TEST(StoutJsonTest, Parse)
+{
+  JSON::Object object;
+  object.values["string"] = JSON::String("a \"quoted\"\n/string");
+  object.values["number"] = JSON::Number(42.5);
+  object.values["true"] = JSON::True();
+  object.values["null"] = JSON::Null();
+
+  JSON::Array array;
+  array.values.push_back(JSON::Number(1));
+  array.values.push_back(JSON::False());
+  array.values.push_back(JSON::Object());
+  object.values["array"] = array;
+
+  std::ostringstream out;
+  out << JSON::Value(object);
+
+  Try<JSON::Value> value = JSON::parse(out.str());
+  ASSERT_TRUE(value.isSome()) << value.error();
+
+  // Rendering the parsed value must yield the same text.
+  std::ostringstream out2;
+  out2 << value.get();
+  EXPECT_EQ(out.str(), out2.str());
+
+  const JSON::Object& parsed = boost::get<JSON::Object>(value.get());
+  EXPECT_EQ(5u, parsed.values.size());
+  EXPECT_EQ("a \"quoted\"\n/string",
+            boost::get<JSON::String>(
+                parsed.values.find("string")->second).value);
+  EXPECT_EQ(42.5,
+            boost::get<JSON::Number>(
+                parsed.values.find("number")->second).value);
+  EXPECT_EQ(3u,
+            boost::get<JSON::Array>(
+                parsed.values.find("array")->second).values.size());
+
+  // Whitespace and ASCII unicode escapes are accepted.
+  value = JSON::parse(" { \"a\" : [ 1 , \"\\u0041\" ] }\n");
+  ASSERT_TRUE(value.isSome()) << value.error();
+  EXPECT_EQ("A",
+            boost::get<JSON::String>(
+                boost::get<JSON::Array>(
+                    boost::get<JSON::Object>(value.get()).values["a"])
+                .values.back()).value);
+
+  EXPECT_TRUE(JSON::parse("").isError());
+  EXPECT_TRUE(JSON::parse("{\"a\":1").isError());
+  EXPECT_TRUE(JSON::parse("{\"a\" 1}").isError());
+  EXPECT_TRUE(JSON::parse("[1,]").isError());
+  EXPECT_TRUE(JSON::parse("\"unterminated").isError());
+  EXPECT_TRUE(JSON::parse("tru").isError());
+  EXPECT_TRUE(JSON::parse("{} {}").isError());
+}
+
+
 static hashset<std::string> listfiles(const std::string& dir)
 {
   hashset<std::string> fileset;
@@ -25,11 +25,13 @@
 
 #include <fstream>
 #include <map>
+#include <set>
 #include <string>
 
 #include <mesos/executor.hpp>
 #include <mesos/scheduler.hpp>
 
+#include <process/dispatch.hpp>
 #include <process/future.hpp>
 #include <process/http.hpp>
 #include <process/process.hpp>
@@ -639,6 +641,14 @@ public:
 
       driver->start();
 
+      // All the executors run in this process, which also makes for
+      // a live "forked" pid when the slave checkpoints.
+      process::dispatch(slave,
+                        &slave::Slave::executorStarted,
+                        frameworkId,
+                        executorInfo.executor_id(),
+                        getpid());
+
       os::unsetenv("MESOS_LOCAL");
       os::unsetenv("MESOS_DIRECTORY");
       os::unsetenv("MESOS_SLAVE_PID");
@@ -652,7 +662,10 @@ public:
   virtual void killExecutor(const FrameworkID& frameworkId,
                             const ExecutorID& executorId)
   {
-    if (drivers.count(executorId) > 0) {
+    if (recovered.count(executorId) > 0) {
+      // The driver belongs to the module that launched the executor.
+      recovered.erase(executorId);
+    } else if (drivers.count(executorId) > 0) {
       MesosExecutorDriver* driver = drivers[executorId];
       driver->stop();
       driver->join();
@@ -663,6 +676,15 @@ public:
     }
   }
 
+  virtual void recoverExecutor(const FrameworkID& frameworkId,
+                               const ExecutorInfo& executorInfo,
+                               const std::string& directory,
+                               pid_t pid)
+  {
+    recovered.insert(executorInfo.executor_id());
+    directories[executorInfo.executor_id()] = directory;
+  }
+
   // Mocked so tests can check that the resources reflect all started tasks.
   MOCK_METHOD3(resourcesChanged, void(const FrameworkID&,
                                       const ExecutorID&,
@@ -673,6 +695,7 @@ public:
 private:
   std::map<ExecutorID, Executor*> executors;
   std::map<ExecutorID, MesosExecutorDriver*> drivers;
+  std::set<ExecutorID> recovered;
   process::PID<slave::Slave> slave;
 };
 
@@ -586,6 +586,47 @@ int ZooKeeper::set(const string& path, const string& data, int version)
 }
 
 
+Future<int> ZooKeeper::acreate(const string& path, const string& data,
+                               const ACL_vector& acl, int flags,
+                               string* result)
+{
+  return impl->create(path, data, acl, flags, result);
+}
+
+
+Future<int> ZooKeeper::aexists(const string& path, bool watch, Stat* stat)
+{
+  return impl->exists(path, watch, stat);
+}
+
+
+Future<int> ZooKeeper::aget(const string& path, bool watch, string* result,
+                            Stat* stat)
+{
+  return impl->get(path, watch, result, stat);
+}
+
+
+Future<int> ZooKeeper::agetChildren(const string& path, bool watch,
+                                    vector<string>* results)
+{
+  return impl->getChildren(path, watch, results);
+}
+
+
+Future<int> ZooKeeper::aset(const string& path, const string& data,
+                            int version)
+{
+  return impl->set(path, data, version);
+}
+
+
+Future<int> ZooKeeper::aremove(const string& path, int version)
+{
+  return impl->remove(path, version);
+}
+
+
 string ZooKeeper::message(int code) const
 {
   return string(zerror(code));
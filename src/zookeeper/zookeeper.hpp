@@ -31,6 +31,8 @@
 #include <string>
 #include <vector>
 
+#include <process/future.hpp>
+
 #include <stout/duration.hpp>
 
 
@@ -290,6 +292,44 @@ public:
    */
   int set(const std::string &path, const std::string &data, int version);
 
+  /**
+   * \brief asynchronous versions of create (non-recursive), exists,
+   * get, getChildren, set, and remove (named after the zoo_a*
+   * functions of the C API they use, except for remove).
+   *
+   * Rather than blocking until the operation completes these return
+   * a future that is satisfied with the return code of the operation
+   * (see the synchronous versions above). Operations are processed
+   * (and their futures satisfied) in the order they were issued,
+   * which allows for pipelining many operations at a time. Note that
+   * any result and stat arguments must remain valid until the
+   * returned future has been satisfied.
+   */
+  process::Future<int> acreate(const std::string &path,
+                               const std::string &data,
+                               const ACL_vector &acl,
+                               int flags,
+                               std::string *result);
+
+  process::Future<int> aexists(const std::string &path,
+                               bool watch,
+                               Stat *stat);
+
+  process::Future<int> aget(const std::string &path,
+                            bool watch,
+                            std::string *result,
+                            Stat *stat);
+
+  process::Future<int> agetChildren(const std::string &path,
+                                    bool watch,
+                                    std::vector<std::string> *results);
+
+  process::Future<int> aset(const std::string &path,
+                            const std::string &data,
+                            int version);
+
+  process::Future<int> aremove(const std::string &path, int version);
+
   /**
    * \brief return a message describing the return code.
    *
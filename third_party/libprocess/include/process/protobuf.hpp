@@ -10,6 +10,7 @@
 #include <vector>
 
 #include <tr1/functional>
+#include <tr1/memory>
 #include <tr1/unordered_map>
 
 #include <process/dispatch.hpp>
@@ -48,15 +49,39 @@ const T& convert(const T& t)
 }
 
 
+// Wraps a repeated field so that it can be passed either as a
+// std::vector (which copies the items) or, without copying, as a
+// const reference to the repeated field itself.
 template <typename T>
-std::vector<T> convert(const google::protobuf::RepeatedPtrField<T>& items)
+struct Repeated
 {
-  std::vector<T> result;
-  for (int i = 0; i < items.size(); i++) {
-    result.push_back(items.Get(i));
+  explicit Repeated(const google::protobuf::RepeatedPtrField<T>& _items)
+    : items(_items) {}
+
+  operator std::vector<T> () const
+  {
+    std::vector<T> result;
+    result.reserve(items.size());
+    for (int i = 0; i < items.size(); i++) {
+      result.push_back(items.Get(i));
+    }
+
+    return result;
+  }
+
+  operator const google::protobuf::RepeatedPtrField<T>& () const
+  {
+    return items;
   }
 
-  return result;
+  const google::protobuf::RepeatedPtrField<T>& items;
+};
+
+
+template <typename T>
+Repeated<T> convert(const google::protobuf::RepeatedPtrField<T>& items)
+{
+  return Repeated<T>(items);
 }
 
 }} // namespace google { namespace protobuf {
@@ -71,15 +96,28 @@ public:
 protected:
   virtual void visit(const process::MessageEvent& event)
   {
-    if (protobufHandlers.count(event.message->name) > 0) {
+    typename handlers::iterator iterator =
+      protobufHandlers.find(event.message->name);
+
+    if (iterator != protobufHandlers.end()) {
       from = event.message->from; // For 'reply'.
-      protobufHandlers[event.message->name](event.message->body);
+      iterator->second(event.message->body);
       from = process::UPID();
     } else {
       process::Process<T>::visit(event);
     }
   }
 
+  virtual void serve(const process::Event& event)
+  {
+    process::Process<T>::serve(event);
+
+#ifndef NDEBUG
+    // Reused messages are only built within a single event.
+    building.clear();
+#endif
+  }
+
   void send(const process::UPID& to,
             const google::protobuf::Message& message)
   {
@@ -87,6 +125,15 @@ protected:
     message.SerializeToString(&data);
     process::Process<T>::send(to, message.GetTypeName(),
                               data.data(), data.size());
+
+#ifndef NDEBUG
+    // Sending a reused message means it is done being built.
+    instances::const_iterator iterator =
+      reusables.find(message.GetDescriptor());
+    if (iterator != reusables.end() && iterator->second.get() == &message) {
+      building.erase(message.GetDescriptor());
+    }
+#endif
   }
 
   using process::Process<T>::send;
@@ -94,33 +141,58 @@ protected:
   void reply(const google::protobuf::Message& message)
   {
     CHECK(from) << "Attempting to reply without a sender";
-    std::string data;
-    message.SerializeToString(&data);
     send(from, message);
   }
 
+  // Returns a (cleared) instance of M that can be used to build a
+  // message to send rather than constructing a new one each time,
+  // which is cheaper because the instance holds on to the memory
+  // that got allocated for any of its fields (unless that exceeds
+  // MAX_REUSED_MESSAGE_SPACE). The same instance is returned every
+  // time for the same type, so it should only be used from within
+  // this process and must be sent before the type gets reused (e.g.,
+  // by a nested call), which debug builds check.
+  template <typename M>
+  M& reuse()
+  {
+    std::tr1::shared_ptr<google::protobuf::Message>& m =
+      reusables[M::descriptor()];
+
+#ifndef NDEBUG
+    CHECK(building.insert(M::descriptor()).second)
+      << "Reusing a " << M::descriptor()->full_name()
+      << " that is still being built";
+#endif
+
+    if (!m || m->SpaceUsed() > MAX_REUSED_MESSAGE_SPACE) {
+      m.reset(new M());
+    } else {
+      m->Clear();
+    }
+
+    return *static_cast<M*>(m.get());
+  }
+
   template <typename M>
   void install(void (T::*method)(const M&))
   {
-    google::protobuf::Message* m = new M();
+    std::tr1::shared_ptr<M> m(new M());
     T* t = static_cast<T*>(this);
     protobufHandlers[m->GetTypeName()] =
       std::tr1::bind(&handlerM<M>,
-                     t, method,
+                     t, method, m,
                      std::tr1::placeholders::_1);
-    delete m;
   }
 
   template <typename M>
   void install(void (T::*method)())
   {
-    google::protobuf::Message* m = new M();
+    M m;
     T* t = static_cast<T*>(this);
-    protobufHandlers[m->GetTypeName()] =
+    protobufHandlers[m.GetTypeName()] =
       std::tr1::bind(&handler0,
                      t, method,
                      std::tr1::placeholders::_1);
-    delete m;
   }
 
   template <typename M,
@@ -128,13 +200,12 @@ protected:
   void install(void (T::*method)(P1C),
                               P1 (M::*param1)() const)
   {
-    google::protobuf::Message* m = new M();
+    std::tr1::shared_ptr<M> m(new M());
     T* t = static_cast<T*>(this);
     protobufHandlers[m->GetTypeName()] =
       std::tr1::bind(&handler1<M, P1, P1C>,
-                     t, method, param1,
+                     t, method, param1, m,
                      std::tr1::placeholders::_1);
-    delete m;
   }
 
   template <typename M,
@@ -144,13 +215,12 @@ protected:
                               P1 (M::*p1)() const,
                               P2 (M::*p2)() const)
   {
-    google::protobuf::Message* m = new M();
+    std::tr1::shared_ptr<M> m(new M());
     T* t = static_cast<T*>(this);
     protobufHandlers[m->GetTypeName()] =
       std::tr1::bind(&handler2<M, P1, P1C, P2, P2C>,
-                     t, method, p1, p2,
+                     t, method, p1, p2, m,
                      std::tr1::placeholders::_1);
-    delete m;
   }
 
   template <typename M,
@@ -162,13 +232,12 @@ protected:
                               P2 (M::*p2)() const,
                               P3 (M::*p3)() const)
   {
-    google::protobuf::Message* m = new M();
+    std::tr1::shared_ptr<M> m(new M());
     T* t = static_cast<T*>(this);
     protobufHandlers[m->GetTypeName()] =
       std::tr1::bind(&handler3<M, P1, P1C, P2, P2C, P3, P3C>,
-                     t, method, p1, p2, p3,
+                     t, method, p1, p2, p3, m,
                      std::tr1::placeholders::_1);
-    delete m;
   }
 
   template <typename M,
@@ -182,13 +251,12 @@ protected:
                               P3 (M::*p3)() const,
                               P4 (M::*p4)() const)
   {
-    google::protobuf::Message* m = new M();
+    std::tr1::shared_ptr<M> m(new M());
     T* t = static_cast<T*>(this);
     protobufHandlers[m->GetTypeName()] =
       std::tr1::bind(&handler4<M, P1, P1C, P2, P2C, P3, P3C, P4, P4C>,
-                     t, method, p1, p2, p3, p4,
+                     t, method, p1, p2, p3, p4, m,
                      std::tr1::placeholders::_1);
-    delete m;
   }
 
   template <typename M,
@@ -204,32 +272,51 @@ protected:
                               P4 (M::*p4)() const,
                               P5 (M::*p5)() const)
   {
-    google::protobuf::Message* m = new M();
+    std::tr1::shared_ptr<M> m(new M());
     T* t = static_cast<T*>(this);
     protobufHandlers[m->GetTypeName()] =
       std::tr1::bind(&handler5<M, P1, P1C, P2, P2C, P3, P3C, P4, P4C, P5, P5C>,
-                     t, method, p1, p2, p3, p4, p5,
+                     t, method, p1, p2, p3, p4, p5, m,
                      std::tr1::placeholders::_1);
-    delete m;
   }
 
   using process::Process<T>::install;
 
   process::UPID from; // Sender of "current" message, accessible by subclasses.
 
+  // Installed handlers parse every message into the same instance of
+  // M, which holds on to the memory of its fields across messages
+  // (parsing only clears them), and so does reuse(). An instance that
+  // uses more than this many bytes after a message (e.g., after an
+  // unusually large one) gets reallocated, so the memory each of them
+  // holds stays bounded.
+  static const int MAX_REUSED_MESSAGE_SPACE = 1024 * 1024;
+
 private:
+  // Releases the memory held by a reused message if it exceeds
+  // MAX_REUSED_MESSAGE_SPACE.
+  template <typename M>
+  static void shrink(M* m)
+  {
+    if (m->SpaceUsed() > MAX_REUSED_MESSAGE_SPACE) {
+      M empty;
+      m->Swap(&empty);
+    }
+  }
+
   template <typename M>
   static void handlerM(T* t, void (T::*method)(const M&),
+                       const std::tr1::shared_ptr<M>& m,
                        const std::string& data)
   {
-    M m;
-    m.ParseFromString(data);
-    if (m.IsInitialized()) {
-      (t->*method)(m);
+    m->ParseFromString(data);
+    if (m->IsInitialized()) {
+      (t->*method)(*m);
     } else {
       LOG(WARNING) << "Initialization errors: "
-                   << m.InitializationErrorString();
+                   << m->InitializationErrorString();
     }
+    shrink(m.get());
   }
 
   static void handler0(T* t, void (T::*method)(),
@@ -242,16 +329,17 @@ private:
             typename P1, typename P1C>
   static void handler1(T* t, void (T::*method)(P1C),
                        P1 (M::*p1)() const,
+                       const std::tr1::shared_ptr<M>& m,
                        const std::string& data)
   {
-    M m;
-    m.ParseFromString(data);
-    if (m.IsInitialized()) {
-      (t->*method)(google::protobuf::convert((&m->*p1)()));
+    m->ParseFromString(data);
+    if (m->IsInitialized()) {
+      (t->*method)(google::protobuf::convert((m.get()->*p1)()));
     } else {
       LOG(WARNING) << "Initialization errors: "
-                   << m.InitializationErrorString();
+                   << m->InitializationErrorString();
     }
+    shrink(m.get());
   }
 
   template <typename M,
@@ -260,17 +348,18 @@ private:
   static void handler2(T* t, void (T::*method)(P1C, P2C),
                        P1 (M::*p1)() const,
                        P2 (M::*p2)() const,
+                       const std::tr1::shared_ptr<M>& m,
                        const std::string& data)
   {
-    M m;
-    m.ParseFromString(data);
-    if (m.IsInitialized()) {
-      (t->*method)(google::protobuf::convert((&m->*p1)()),
-                   google::protobuf::convert((&m->*p2)()));
+    m->ParseFromString(data);
+    if (m->IsInitialized()) {
+      (t->*method)(google::protobuf::convert((m.get()->*p1)()),
+                   google::protobuf::convert((m.get()->*p2)()));
     } else {
       LOG(WARNING) << "Initialization errors: "
-                   << m.InitializationErrorString();
+                   << m->InitializationErrorString();
     }
+    shrink(m.get());
   }
 
   template <typename M,
@@ -281,18 +370,19 @@ private:
                        P1 (M::*p1)() const,
                        P2 (M::*p2)() const,
                        P3 (M::*p3)() const,
+                       const std::tr1::shared_ptr<M>& m,
                        const std::string& data)
   {
-    M m;
-    m.ParseFromString(data);
-    if (m.IsInitialized()) {
-      (t->*method)(google::protobuf::convert((&m->*p1)()),
-                   google::protobuf::convert((&m->*p2)()),
-                   google::protobuf::convert((&m->*p3)()));
+    m->ParseFromString(data);
+    if (m->IsInitialized()) {
+      (t->*method)(google::protobuf::convert((m.get()->*p1)()),
+                   google::protobuf::convert((m.get()->*p2)()),
+                   google::protobuf::convert((m.get()->*p3)()));
     } else {
       LOG(WARNING) << "Initialization errors: "
-                   << m.InitializationErrorString();
+                   << m->InitializationErrorString();
     }
+    shrink(m.get());
   }
 
   template <typename M,
@@ -305,19 +395,20 @@ private:
                        P2 (M::*p2)() const,
                        P3 (M::*p3)() const,
                        P4 (M::*p4)() const,
+                       const std::tr1::shared_ptr<M>& m,
                        const std::string& data)
   {
-    M m;
-    m.ParseFromString(data);
-    if (m.IsInitialized()) {
-      (t->*method)(google::protobuf::convert((&m->*p1)()),
-                   google::protobuf::convert((&m->*p2)()),
-                   google::protobuf::convert((&m->*p3)()),
-                   google::protobuf::convert((&m->*p4)()));
+    m->ParseFromString(data);
+    if (m->IsInitialized()) {
+      (t->*method)(google::protobuf::convert((m.get()->*p1)()),
+                   google::protobuf::convert((m.get()->*p2)()),
+                   google::protobuf::convert((m.get()->*p3)()),
+                   google::protobuf::convert((m.get()->*p4)()));
     } else {
       LOG(WARNING) << "Initialization errors: "
-                   << m.InitializationErrorString();
+                   << m->InitializationErrorString();
     }
+    shrink(m.get());
   }
 
   template <typename M,
@@ -332,24 +423,34 @@ private:
                        P3 (M::*p3)() const,
                        P4 (M::*p4)() const,
                        P5 (M::*p5)() const,
+                       const std::tr1::shared_ptr<M>& m,
                        const std::string& data)
   {
-    M m;
-    m.ParseFromString(data);
-    if (m.IsInitialized()) {
-      (t->*method)(google::protobuf::convert((&m->*p1)()),
-                   google::protobuf::convert((&m->*p2)()),
-                   google::protobuf::convert((&m->*p3)()),
-                   google::protobuf::convert((&m->*p4)()),
-                   google::protobuf::convert((&m->*p5)()));
+    m->ParseFromString(data);
+    if (m->IsInitialized()) {
+      (t->*method)(google::protobuf::convert((m.get()->*p1)()),
+                   google::protobuf::convert((m.get()->*p2)()),
+                   google::protobuf::convert((m.get()->*p3)()),
+                   google::protobuf::convert((m.get()->*p4)()),
+                   google::protobuf::convert((m.get()->*p5)()));
     } else {
       LOG(WARNING) << "Initialization errors: "
-                   << m.InitializationErrorString();
+                   << m->InitializationErrorString();
     }
+    shrink(m.get());
   }
 
   typedef std::tr1::function<void(const std::string&)> handler;
-  std::tr1::unordered_map<std::string, handler> protobufHandlers;
+  typedef std::tr1::unordered_map<std::string, handler> handlers;
+  handlers protobufHandlers;
+
+  typedef std::tr1::unordered_map<
+    const google::protobuf::Descriptor*,
+    std::tr1::shared_ptr<google::protobuf::Message> > instances;
+  instances reusables;
+
+  // Types whose reused instance is being built (i.e., not sent yet).
+  std::set<const google::protobuf::Descriptor*> building;
 };
 
 
@@ -1,6 +1,8 @@
 #ifndef __PROCESS_STATISTICS_HPP__
 #define __PROCESS_STATISTICS_HPP__
 
+#include <string>
+
 #include <process/future.hpp>
 
 #include <stout/duration.hpp>
@@ -13,11 +15,14 @@ class StatisticsProcess;
 
 // Provides an in-memory time series of statistics over some window
 // (values are truncated outside of the window, but no limit is
-// currently placed on the number of values within a window).
+// currently placed on the number of values within a window). The
+// statistics are exposed via the '/id/snapshot.json' and
+// '/id/series.json' endpoints, so each instance must use a distinct
+// process ID.
 class Statistics
 {
 public:
-  Statistics(const Seconds& window);
+  Statistics(const Seconds& window, const std::string& id = "statistics");
   ~Statistics();
 
   // Returns the time series of a statistic.
@@ -1,14 +1,17 @@
 #ifndef __STOUT_JSON__
 #define __STOUT_JSON__
 
+#include <stdlib.h> // For strtod.
+
 #include <iostream>
 #include <list>
 #include <map>
+#include <sstream>
 #include <string>
 
 #include <boost/variant.hpp>
 
-// TODO(jsirois): Implement parsing that constructs JSON objects.
+#include "try.hpp"
 
 
 namespace JSON {
@@ -180,6 +183,228 @@ inline std::ostream& operator<<(std::ostream& out, const JSON::Value& value)
   return out;
 }
 
+
+// Implementation of parsing JSON text back into the objects above
+// (e.g., for inspecting the output of an HTTP endpoint). This is a
+// simple recursive descent parser; all numbers are parsed as doubles
+// and, like the renderer, it DOES NOT handle unicode ('\uXXXX' escapes
+// are only accepted for ASCII characters).
+
+class Parser
+{
+public:
+  Parser(const std::string& _s) : s(_s), i(0) {}
+
+  Try<Value> parse()
+  {
+    Try<Value> value = parseValue();
+    if (value.isError()) {
+      return value;
+    }
+    whitespace();
+    if (i != s.size()) {
+      return error("Unexpected trailing characters");
+    }
+    return value;
+  }
+
+private:
+  Try<Value> parseValue()
+  {
+    whitespace();
+    if (i == s.size()) {
+      return error("Unexpected end of input");
+    }
+
+    switch (s[i]) {
+      case '{': return parseObject();
+      case '[': return parseArray();
+      case '"': {
+        Try<std::string> string = parseString();
+        if (string.isError()) {
+          return Try<Value>::error(string.error());
+        }
+        return Value(String(string.get()));
+      }
+      case 't': return literal("true", True());
+      case 'f': return literal("false", False());
+      case 'n': return literal("null", Null());
+      default: return parseNumber();
+    }
+  }
+
+  Try<Value> parseObject()
+  {
+    Object object;
+    i++; // Skip '{'.
+    whitespace();
+    if (i < s.size() && s[i] == '}') {
+      i++;
+      return Value(object);
+    }
+
+    while (true) {
+      whitespace();
+      if (i == s.size() || s[i] != '"') {
+        return error("Expecting a string as an object key");
+      }
+
+      Try<std::string> key = parseString();
+      if (key.isError()) {
+        return Try<Value>::error(key.error());
+      }
+
+      whitespace();
+      if (i == s.size() || s[i] != ':') {
+        return error("Expecting ':'");
+      }
+      i++;
+
+      Try<Value> value = parseValue();
+      if (value.isError()) {
+        return value;
+      }
+      object.values[key.get()] = value.get();
+
+      whitespace();
+      if (i < s.size() && s[i] == ',') {
+        i++;
+      } else if (i < s.size() && s[i] == '}') {
+        i++;
+        return Value(object);
+      } else {
+        return error("Expecting ',' or '}'");
+      }
+    }
+  }
+
+  Try<Value> parseArray()
+  {
+    Array array;
+    i++; // Skip '['.
+    whitespace();
+    if (i < s.size() && s[i] == ']') {
+      i++;
+      return Value(array);
+    }
+
+    while (true) {
+      Try<Value> value = parseValue();
+      if (value.isError()) {
+        return value;
+      }
+      array.values.push_back(value.get());
+
+      whitespace();
+      if (i < s.size() && s[i] == ',') {
+        i++;
+      } else if (i < s.size() && s[i] == ']') {
+        i++;
+        return Value(array);
+      } else {
+        return error("Expecting ',' or ']'");
+      }
+    }
+  }
+
+  Try<std::string> parseString()
+  {
+    std::string string;
+    i++; // Skip '"'.
+    while (i < s.size() && s[i] != '"') {
+      if (s[i] != '\\') {
+        string += s[i++];
+        continue;
+      }
+
+      if (++i == s.size()) {
+        break;
+      }
+
+      switch (s[i++]) {
+        case '"': string += '"'; break;
+        case '\\': string += '\\'; break;
+        case '/': string += '/'; break;
+        case 'b': string += '\b'; break;
+        case 'f': string += '\f'; break;
+        case 'n': string += '\n'; break;
+        case 'r': string += '\r'; break;
+        case 't': string += '\t'; break;
+        case 'u': {
+          if (s.size() - i < 4) {
+            return Try<std::string>::error("Truncated unicode escape");
+          }
+          char* end = NULL;
+          const std::string hex = s.substr(i, 4);
+          long code = strtol(hex.c_str(), &end, 16);
+          if (*end != '\0' || code > 0x7f) {
+            return Try<std::string>::error(
+                "Unsupported unicode escape '\\u" + hex + "'");
+          }
+          string += (char) code;
+          i += 4;
+          break;
+        }
+        default:
+          return Try<std::string>::error("Invalid escape sequence");
+      }
+    }
+
+    if (i == s.size()) {
+      return Try<std::string>::error("Unterminated string");
+    }
+
+    i++; // Skip '"'.
+    return string;
+  }
+
+  Try<Value> parseNumber()
+  {
+    const char* start = s.c_str() + i;
+    char* end = NULL;
+    double number = strtod(start, &end);
+    if (end == start) {
+      return error("Unexpected character");
+    }
+    i += end - start;
+    return Value(Number(number));
+  }
+
+  template <typename T>
+  Try<Value> literal(const std::string& name, const T& t)
+  {
+    if (s.compare(i, name.size(), name) != 0) {
+      return error("Unexpected character");
+    }
+    i += name.size();
+    return Value(t);
+  }
+
+  void whitespace()
+  {
+    while (i < s.size() &&
+           (s[i] == ' ' || s[i] == '\t' || s[i] == '\n' || s[i] == '\r')) {
+      i++;
+    }
+  }
+
+  Try<Value> error(const std::string& message)
+  {
+    std::ostringstream out;
+    out << message << " at offset " << i;
+    return Try<Value>::error(out.str());
+  }
+
+  const std::string& s;
+  size_t i;
+};
+
+
+inline Try<Value> parse(const std::string& s)
+{
+  return Parser(s).parse();
+}
+
 } // namespace JSON {
 
 #endif // __STOUT_JSON__
@@ -2,6 +2,7 @@
 #define __ENCODER_HPP__
 
 #include <ev.h>
+#include <stdio.h>
 
 #include <sstream>
 
@@ -63,8 +64,12 @@ public:
     return data.size() - index;
   }
 
+protected:
+  DataEncoder() : index(0) {}
+
+  std::string data;
+
 private:
-  const std::string data;
   size_t index;
 };
 
@@ -73,7 +78,11 @@ class MessageEncoder : public DataEncoder
 {
 public:
   MessageEncoder(Message* _message)
-    : DataEncoder(encode(_message)), message(_message) {}
+    : message(_message)
+  {
+    // Encode directly into our buffer to avoid copying the message.
+    encode(message, &data);
+  }
 
   virtual ~MessageEncoder()
   {
@@ -84,26 +93,53 @@ public:
 
   static std::string encode(Message* message)
   {
-    if (message != NULL) {
-      std::ostringstream out;
+    std::string out;
+    encode(message, &out);
+    return out;
+  }
 
-      out << "POST /" << message->to.id << "/" << message->name
-          << " HTTP/1.0\r\n"
-          << "User-Agent: libprocess/" << message->from << "\r\n"
-          << "Connection: Keep-Alive\r\n";
+  // Encodes the message into 'out' (replacing its contents), growing
+  // it at most once since messages can be large.
+  static void encode(Message* message, std::string* out)
+  {
+    out->clear();
+
+    if (message != NULL) {
+      const std::string from = message->from;
+
+      // The chunk size (in hex).
+      char size[32];
+      snprintf(size, sizeof(size), "%lx",
+               (unsigned long) message->body.size());
+
+      // Leave enough room for the fixed parts of the request too.
+      out->reserve(message->to.id.size() +
+                   message->name.size() +
+                   from.size() +
+                   message->body.size() +
+                   128);
+
+      out->append("POST /");
+      out->append(message->to.id);
+      out->append("/");
+      out->append(message->name);
+      out->append(" HTTP/1.0\r\n");
+      out->append("User-Agent: libprocess/");
+      out->append(from);
+      out->append("\r\n");
+      out->append("Connection: Keep-Alive\r\n");
 
       if (message->body.size() > 0) {
-        out << "Transfer-Encoding: chunked\r\n\r\n"
-            << std::hex << message->body.size() << "\r\n";
-        out.write(message->body.data(), message->body.size());
-        out << "\r\n"
-            << "0\r\n"
-            << "\r\n";
+        out->append("Transfer-Encoding: chunked\r\n\r\n");
+        out->append(size);
+        out->append("\r\n");
+        out->append(message->body);
+        out->append("\r\n");
+        out->append("0\r\n");
+        out->append("\r\n");
       } else {
-        out << "\r\n";
+        out->append("\r\n");
       }
-
-      return out.str();
     }
   }
 
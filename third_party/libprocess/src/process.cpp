@@ -644,13 +644,16 @@ void Clock::settle()
 static Message* encode(const UPID& from,
                        const UPID& to,
                        const string& name,
-                       const string& data = "")
+                       const char* data = NULL,
+                       size_t length = 0)
 {
   Message* message = new Message();
   message->from = from;
   message->to = to;
   message->name = name;
-  message->body = data;
+  if (data != NULL) {
+    message->body.assign(data, length);
+  }
   return message;
 }
 
@@ -2841,7 +2844,7 @@ void ProcessBase::inject(const UPID& from, const string& name, const char* data,
   if (!from)
     return;
 
-  Message* message = encode(from, pid, name, string(data, length));
+  Message* message = encode(from, pid, name, data, length);
 
   enqueue(new MessageEvent(message), true);
 }
@@ -2854,7 +2857,7 @@ void ProcessBase::send(const UPID& to, const string& name, const char* data, siz
   }
 
   // Encode and transport outgoing message.
-  transport(encode(pid, to, name, string(data, length)), this);
+  transport(encode(pid, to, name, data, length), this);
 }
 
 
@@ -3098,7 +3101,7 @@ void post(const UPID& to, const string& name, const char* data, size_t length)
   }
 
   // Encode and transport outgoing message.
-  transport(encode(UPID(), to, name, string(data, length)));
+  transport(encode(UPID(), to, name, data, length));
 }
 
 
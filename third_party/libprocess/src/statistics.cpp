@@ -34,8 +34,8 @@ namespace process {
 class StatisticsProcess : public Process<StatisticsProcess>
 {
 public:
-  StatisticsProcess(const Seconds& _window)
-    : ProcessBase("statistics"),
+  StatisticsProcess(const Seconds& _window, const string& id)
+    : ProcessBase(id),
       window(_window)
   {}
 
@@ -211,9 +211,9 @@ Future<Response> StatisticsProcess::series(const Request& request)
 }
 
 
-Statistics::Statistics(const Seconds& window)
+Statistics::Statistics(const Seconds& window, const string& id)
 {
-  process = new StatisticsProcess(window);
+  process = new StatisticsProcess(window, id);
   spawn(process);
 }
 
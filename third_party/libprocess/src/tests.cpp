@@ -1387,6 +1387,53 @@ TEST(Process, BufferedRead)
 }
 
 
+TEST(Encoder, message)
+{
+  Message* message = new Message();
+  message->name = "hello";
+  message->from = UPID("sender@127.0.0.1:1234");
+  message->to = UPID("receiver@127.0.0.1:5678");
+  message->body = std::string(300, 'x');
+
+  // The chunk size gets written in hex (300 == 0x12c).
+  std::string expected =
+    "POST /receiver/hello HTTP/1.0\r\n"
+    "User-Agent: libprocess/sender@127.0.0.1:1234\r\n"
+    "Connection: Keep-Alive\r\n"
+    "Transfer-Encoding: chunked\r\n"
+    "\r\n"
+    "12c\r\n" + message->body + "\r\n"
+    "0\r\n"
+    "\r\n";
+
+  EXPECT_EQ(expected, MessageEncoder::encode(message));
+
+  // Encoding in place replaces whatever the buffer held before.
+  std::string out = "stale";
+  MessageEncoder::encode(message, &out);
+  EXPECT_EQ(expected, out);
+
+  // The encoder sends exactly the encoded message (and owns it).
+  MessageEncoder encoder(message);
+  size_t length;
+  const char* data = encoder.next(&length);
+  EXPECT_EQ(expected, std::string(data, length));
+  EXPECT_EQ(0u, encoder.remaining());
+
+  // A message without a body isn't chunked.
+  Message empty;
+  empty.name = "hello";
+  empty.from = UPID("sender@127.0.0.1:1234");
+  empty.to = UPID("receiver@127.0.0.1:5678");
+
+  EXPECT_EQ("POST /receiver/hello HTTP/1.0\r\n"
+            "User-Agent: libprocess/sender@127.0.0.1:1234\r\n"
+            "Connection: Keep-Alive\r\n"
+            "\r\n",
+            MessageEncoder::encode(&empty));
+}
+
+
 int main(int argc, char** argv)
 {
   // Initialize Google Mock/Test.